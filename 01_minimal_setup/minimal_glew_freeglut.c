@@ -28,8 +28,8 @@ SOFTWARE.
  * Draws a triangle with a solid color
  *
  * Compiling this example:
- * Linux: gcc minimal_glew_freeglut.c -lGL -lGLEW -lglut -o minimal
- * Mac OS: clang minimal_glew_freeglut.c -framework OpenGL -lglew -framework GLUT -Wno-deprecated -framework Cocoa -o minimal
+ * Linux: gcc ../common/shader.c ../common/gl_state.c ../common/headless.c ../common/benchmark.c minimal_glew_freeglut.c -lGL -lGLEW -lglut -lEGL -o minimal
+ * Mac OS: clang ../common/shader.c ../common/benchmark.c minimal_glew_freeglut.c -framework OpenGL -lglew -framework GLUT -Wno-deprecated -framework Cocoa -o minimal
  *    Important note: Mac has the original glut version that is marked as deprecated, not the improved freeglut
  *
  * Requires OpenGL 3.2 and that GLEW and freeGLUT are installed or provided as includes for compilation
@@ -45,10 +45,20 @@ SOFTWARE.
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "../common/shader.h"
+#include "../common/benchmark.h"
+#ifndef __APPLE__ // EGL is not available on Mac OS
+#include "../common/headless.h"
+#endif
+
 typedef enum { false, true } bool;
 
 GLuint program;
 GLint attr_vpos;
+BenchmarkOptions benchmark;
+#ifndef __APPLE__
+HeadlessOptions headless;
+#endif
 
 
 void display()
@@ -65,43 +75,21 @@ void display()
 		0,         // stride if data is interleaved
 		0          // pointer offset to start of data
 	);
-	glDrawArrays(GL_TRIANGLES, 0, 3);
+	// the same triangle again for heavier benchmark workloads
+	int i;
+	for(i = 0; i < benchmark.workload; i++) {
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
 	glDisableVertexAttribArray(attr_vpos);
 	glUseProgram(0);
 
-	glutSwapBuffers(); // glutSwapBuffers makes a glFlush() call
-}
-
-
-int compile_shader(GLuint shader, const char* source, GLenum shader_type)
-{
-	GLint is_compile_ok = GL_FALSE;
-
-	fprintf(stdout, "Compiling %s Shader...  ", shader_type==GL_VERTEX_SHADER? "Vertex" : "Fragment");
-
-	glShaderSource(shader, 1, &source, NULL);
-	glCompileShader(shader);
-
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compile_ok);
-	fprintf(stdout, "%s!\n", is_compile_ok? "OK" : "FAILED");
-
-	GLint written, logSize = 0;
-	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize);
-	GLchar buf[logSize];
-	glGetShaderInfoLog(shader, logSize, &written, buf);
-	if(written) {
-		fprintf(stderr, "%s", buf);
-		if(logSize != written+1) { // +1 for NULL terminating character
-			fprintf(stderr, "... missing %d characters!\n", logSize-written+1);
-		}
+	#ifndef __APPLE__
+	if(headless.enabled) {
+		glFlush();
+		return;
 	}
-
-	if(!is_compile_ok) {
-		glDeleteShader(shader);
-		return false;
-	}
-
-	return true;
+	#endif
+	glutSwapBuffers(); // glutSwapBuffers makes a glFlush() call
 }
 
 
@@ -110,40 +98,24 @@ int init()
 	// global state
 	glClearColor(0.0, 0.0, 0.0, 0.0);
 
-	// compiling shaders
-	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+	// shader sources
 	const char *vs_source =
 	"#version 330\n"
 	"layout (location = 0) in vec2 v_pos;"
 	"void main(void) {"
 	"  gl_Position = vec4(v_pos, 0.0, 1.0);"
 	"}";
-	if(!compile_shader(vs, vs_source, GL_VERTEX_SHADER)) return false;
 
-	GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
 	const char *fs_source =
 	"#version 330\n"
 	"out vec4 FragColor;"
 	"void main(void) {"
 	"  FragColor = vec4(0.0, 1.0, 0.0, 1.0);"
 	"}";
-	if(!compile_shader(fs, fs_source, GL_FRAGMENT_SHADER)) return false;
-
-	// linking into a program
-	GLint is_link_ok = GL_FALSE;
-	program = glCreateProgram();
-	glAttachShader(program, vs);
-	glAttachShader(program, fs);
-	glLinkProgram(program);
-	glGetProgramiv(program, GL_LINK_STATUS, &is_link_ok);
-	glDetachShader(program, vs);
-	glDetachShader(program, fs);
-	glDeleteShader(vs);
-	glDeleteShader(fs);
-	if(!is_link_ok) {
-		fprintf(stderr, "Program didn't link\n");
-		return false;
-	}
+
+	// compiling and linking into a program, or loading it from the shader cache
+	program = create_program(vs_source, fs_source);
+	if(!program) return false;
 
 	// setting attributes from the application to the vertex shader
 	attr_vpos = glGetAttribLocation(program, "v_pos");
@@ -179,10 +151,26 @@ void key_cb(unsigned char key, int x, int y)
 		exit(0);
 }
 
+// display() already swaps, a benchmark frame ends once the GPU is done with it
+static void wait_gpu() { glFinish(); }
+
 // main
 
 int main(int argc, char** argv)
 {
+	benchmark_parse_args(&benchmark, argc, argv);
+	#ifndef __APPLE__
+	headless_parse_args(&headless, argc, argv);
+	if(headless.enabled) {
+		// no window, frames go to an offscreen framebuffer
+		HeadlessContext ctx;
+		if(!headless_init(&ctx, 250, 250, 3, 2) || !init()) exit(-1);
+		bool ok = benchmark.enabled ? benchmark_run(&benchmark, "minimal_glew_freeglut", display, NULL) : headless_run(&ctx, &headless, display);
+		headless_free(&ctx);
+		exit(ok ? 0 : -1);
+	}
+	#endif
+
 	glutInit(&argc, argv);
 	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH | GLUT_ALPHA
 		#ifdef __APPLE__
@@ -210,6 +198,11 @@ int main(int argc, char** argv)
 		exit(-1);
 	}
 
+	if(benchmark.enabled) {
+		// GLUT cannot turn off vsync, run with vblank_mode=0 (Mesa) or disable it in the driver settings
+		exit(benchmark_run(&benchmark, "minimal_glew_freeglut", display, wait_gpu) ? 0 : -1);
+	}
+
 	// callbacks
 	glutKeyboardFunc(key_cb);
 	glutDisplayFunc(display);
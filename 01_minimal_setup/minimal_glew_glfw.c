@@ -27,8 +27,12 @@ SOFTWARE.
  *
  * Draws a triangle with a solid color
  *
+ * The triangle and its color are streamed to the GPU every frame, like dynamic data would be,
+ * through per-frame regions of a buffer. Up to --frames-in-flight N frames (2 by default) are queued
+ * before the CPU waits on the GPU, see ../common/frame_pacer.h
+ *
  * Compiling this example:
- * Linux: gcc minimal_glew_glfw.c -lGL -lGLEW -lglfw -o minimal
+ * Linux: gcc ../common/shader.c ../common/gl_state.c ../common/headless.c ../common/benchmark.c ../common/profiler.c ../common/redraw.c ../common/frame_pacer.c minimal_glew_glfw.c -lGL -lGLEW -lglfw -lEGL -o minimal
  *
  * Requires OpenGL 3.2 and that GLEW and GLFW are installed or provided as includes for compilation
  */
@@ -38,19 +42,57 @@ SOFTWARE.
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+
+#include "../common/shader.h"
+#include "../common/headless.h"
+#include "../common/benchmark.h"
+#include "../common/profiler.h"
+#include "../common/redraw.h"
+#include "../common/frame_pacer.h"
 
 typedef enum { false, true } bool;
 
 GLuint program;
 GLint attr_vpos;
 GLFWwindow* window;
+BenchmarkOptions benchmark;
+RedrawScheduler redraw;
+
+#define UNIFORM_BINDING 0
+
+typedef struct {
+	GLfloat color[4];
+} FrameUniforms; // std140 layout of the 'Frame' block
+
+int frames_in_flight = 2;
+FramePacer pacer;
+FrameRing vertex_ring, uniform_ring;
+
+GLfloat vertices[] = {
+	-0.75, -0.75,
+	 0.00,  0.75,
+	 0.75, -0.75
+};
+FrameUniforms uniforms = {{0.0, 1.0, 0.0, 1.0}};
 
 
 void display()
 {
+	// waits only if the GPU is still on the frame that last used these regions
+	int slot = frame_pacer_begin(&pacer);
+	GLintptr vertex_offset = frame_ring_write(&vertex_ring, slot, vertices, sizeof(vertices));
+	GLintptr uniform_offset = frame_ring_write(&uniform_ring, slot, &uniforms, sizeof(uniforms));
+	if(vertex_offset < 0 || uniform_offset < 0) {
+		frame_pacer_end(&pacer);
+		return;
+	}
+
 	glClear(GL_COLOR_BUFFER_BIT);
 
 	glUseProgram(program);
+	glBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_BINDING, uniform_ring.buffer, uniform_offset, sizeof(FrameUniforms));
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_ring.buffer);
 	glEnableVertexAttribArray(attr_vpos);
 	glVertexAttribPointer(
 		attr_vpos, // shader attribute index
@@ -58,45 +100,18 @@ void display()
 		GL_FLOAT,  // data type of each element
 		GL_FALSE,  // normalized?
 		0,         // stride if data is interleaved
-		0          // pointer offset to start of data
+		(const GLvoid*)vertex_offset // this frame's region of the ring
 	);
-	glDrawArrays(GL_TRIANGLES, 0, 3);
+	// the same triangle again for heavier benchmark workloads
+	int i;
+	for(i = 0; i < benchmark.workload; i++) {
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
 	glDisableVertexAttribArray(attr_vpos);
 	glUseProgram(0);
 
-	glFlush();
-}
-
-
-int compile_shader(GLuint shader, const char* source, GLenum shader_type)
-{
-	GLint is_compile_ok = GL_FALSE;
-
-	fprintf(stdout, "Compiling %s Shader...  ", shader_type==GL_VERTEX_SHADER? "Vertex" : "Fragment");
-
-	glShaderSource(shader, 1, &source, NULL);
-	glCompileShader(shader);
-
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compile_ok);
-	fprintf(stdout, "%s!\n", is_compile_ok? "OK" : "FAILED");
-
-	GLint written, logSize = 0;
-	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize);
-	GLchar buf[logSize];
-	glGetShaderInfoLog(shader, logSize, &written, buf);
-	if(written) {
-		fprintf(stderr, "%s", buf);
-		if(logSize != written+1) { // +1 for NULL terminating character
-			fprintf(stderr, "... missing %d characters!\n", logSize-written+1);
-		}
-	}
-
-	if(!is_compile_ok) {
-		glDeleteShader(shader);
-		return false;
-	}
-
-	return true;
+	// the fence of this frame, the swap that comes after it flushes it
+	frame_pacer_end(&pacer);
 }
 
 
@@ -105,40 +120,25 @@ int init()
 	// global state
 	glClearColor(0.0, 0.0, 0.0, 0.0);
 
-	// compiling shaders
-	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+	// shader sources
 	const char *vs_source =
 	"#version 330\n"
 	"layout (location = 0) in vec2 v_pos;"
 	"void main(void) {"
 	"  gl_Position = vec4(v_pos, 0.0, 1.0);"
 	"}";
-	if(!compile_shader(vs, vs_source, GL_VERTEX_SHADER)) return false;
 
-	GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
 	const char *fs_source =
 	"#version 330\n"
+	"layout (std140) uniform Frame { vec4 color; };"
 	"out vec4 FragColor;"
 	"void main(void) {"
-	"  FragColor = vec4(0.0, 1.0, 0.0, 1.0);"
+	"  FragColor = color;"
 	"}";
-	if(!compile_shader(fs, fs_source, GL_FRAGMENT_SHADER)) return false;
-
-	// linking into a program
-	GLint is_link_ok = GL_FALSE;
-	program = glCreateProgram();
-	glAttachShader(program, vs);
-	glAttachShader(program, fs);
-	glLinkProgram(program);
-	glGetProgramiv(program, GL_LINK_STATUS, &is_link_ok);
-	glDetachShader(program, vs);
-	glDetachShader(program, fs);
-	glDeleteShader(vs);
-	glDeleteShader(fs);
-	if(!is_link_ok) {
-		fprintf(stderr, "Program didn't link\n");
-		return false;
-	}
+
+	// compiling and linking into a program, or loading it from the shader cache
+	program = create_program(vs_source, fs_source);
+	if(!program) return false;
 
 	// setting attributes from the application to the vertex shader
 	attr_vpos = glGetAttribLocation(program, "v_pos");
@@ -148,31 +148,48 @@ int init()
 		return false;
 	}
 
-	// setting up buffers and copying vertex data to the GPU
+	GLuint block = glGetUniformBlockIndex(program, "Frame");
+	if(block == GL_INVALID_INDEX) {
+		fprintf(stderr, "Finding shader uniform block 'Frame' failed.\n");
+		return false;
+	}
+	glUniformBlockBinding(program, block, UNIFORM_BINDING);
+
+	// setting up buffers, vertex data is copied to the GPU every frame
 	// a VAO holds and manages other buffers for vertex data such as VBOs
-	GLfloat vertices[] = {
-		-0.75, -0.75,
-		 0.00,  0.75,
-		 0.75, -0.75
-	};
-	GLuint vao, buffer;
+	GLuint vao;
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao); // binds to the current context
-	glGenBuffers(1, &buffer); // generate ID
-	glBindBuffer(GL_ARRAY_BUFFER, buffer); // connects the buffer to the context target
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW); // transfer data to target
+
+	// one region per frame in flight, so a frame never overwrites data the GPU is still reading
+	if(!frame_pacer_init(&pacer, frames_in_flight)) return false;
+	if(!frame_ring_init(&vertex_ring, GL_ARRAY_BUFFER, sizeof(vertices), pacer.frames_in_flight)) return false;
+	if(!frame_ring_init(&uniform_ring, GL_UNIFORM_BUFFER, sizeof(FrameUniforms), pacer.frames_in_flight)) return false;
 
 	return true;
 }
 
 
+// waits for the frames still in flight before the context goes away
+void shutdown_frame_pacing()
+{
+	frame_pacer_free(&pacer);
+	if(!benchmark.enabled) frame_pacer_print_stats(&pacer); // benchmark reports may go to stdout
+}
+
 void shutdown_glfw_and_exit(int status_code)
 {
+	shutdown_frame_pacing();
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	exit(status_code);
 }
 
+static void swap_buffers()
+{
+	glfwSwapBuffers(window);
+}
+
 // callbacks
 
 static void key_cb(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -192,6 +209,25 @@ static void error_cb(int error, const char* description)
 
 int main(int argc, char** argv)
 {
+	benchmark_parse_args(&benchmark, argc, argv);
+	HeadlessOptions headless;
+	headless_parse_args(&headless, argc, argv);
+	profiler_parse_args(argc, argv);
+	redraw_parse_args(&redraw, argc, argv);
+	int i;
+	for(i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) frames_in_flight = atoi(argv[++i]);
+	}
+	if(headless.enabled) {
+		// no window, frames go to an offscreen framebuffer
+		HeadlessContext ctx;
+		if(!headless_init(&ctx, 250, 250, 3, 2) || !init()) exit(-1);
+		bool ok = benchmark.enabled ? benchmark_run(&benchmark, "minimal_glew_glfw", display, NULL) : headless_run(&ctx, &headless, display);
+		shutdown_frame_pacing();
+		headless_free(&ctx);
+		exit(ok ? 0 : -1);
+	}
+
 	glfwSetErrorCallback(error_cb);
 
 	// GLFW init
@@ -226,19 +262,51 @@ int main(int argc, char** argv)
 	}
 	printf("Using OpenGL %s\n", glGetString(GL_VERSION));
 
-	glfwSwapInterval(1);
+	// benchmarks must not wait for vsync
+	glfwSwapInterval(benchmark.enabled ? 0 : 1);
 
 	if(!init()) {
 		shutdown_glfw_and_exit(-1);
 	}
 
-	// main loop
-	while (!glfwWindowShouldClose(window))
+	if(benchmark.enabled) {
+		shutdown_glfw_and_exit(benchmark_run(&benchmark, "minimal_glew_glfw", display, swap_buffers) ? 0 : -1);
+	}
+
+	if(!redraw_init(&redraw, window)) {
+		shutdown_glfw_and_exit(-1);
+	}
+
+	// frame timing, see --profile and --overlay in ../common/profiler.h
+	if(!profiler_init()) {
+		shutdown_glfw_and_exit(-1);
+	}
+	int scope_display = profiler_scope("display");
+	int scope_swap = profiler_scope("swap");
+	int scope_events = profiler_scope("events");
+
+	// main loop, a frame is only drawn when something changed. see ../common/redraw.h
+	while(true)
 	{
-		display();
+		profiler_begin(scope_events);
+		bool running = redraw_wait(&redraw); // blocks while there is nothing to draw
+		profiler_end(scope_events);
+		if(!running) break;
+
+		profiler_begin(scope_display);
+		if(redraw_begin(&redraw)) display();
+		redraw_end(&redraw);
+		profiler_end(scope_display);
+		profiler_draw_overlay();
+
+		profiler_begin(scope_swap);
 		glfwSwapBuffers(window);
-		glfwPollEvents();
+		profiler_end(scope_swap);
+		profiler_next_frame();
 	}
+	profiler_shutdown();
+	redraw_print_stats(&redraw);
+	redraw_free(&redraw);
 
 	// shutdown
 	shutdown_glfw_and_exit(0);
@@ -0,0 +1,239 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Benchmark of the batched 2D quad renderer
+ *
+ * Draws a fixed number of frames of randomly placed quads, spread over a few textures and
+ * blend modes, and reports quads per second and draw calls per frame.
+ * With --no-sort the quads are drawn in submission order, to see what the state sorting saves.
+ *
+ * Usage: batch2d_benchmark [--quads N] [--frames N] [--textures N] [--no-sort] [--headless]
+ *
+ * To run it without a GPU, under Mesa's software rasterizer:
+ *   LIBGL_ALWAYS_SOFTWARE=1 GALLIUM_DRIVER=llvmpipe ./batch2d_benchmark
+ * and without a display, with an EGL context instead of a window (see ../common/headless.h):
+ *   ./batch2d_benchmark --headless
+ *
+ * Compiling this benchmark:
+ * Linux: gcc ../common/shader.c ../common/gl_state.c ../common/batch2d.c ../common/headless.c batch2d_benchmark.c -lGL -lGLEW -lglfw -lEGL -o batch2d_benchmark
+ *
+ * Requires OpenGL 3.3 and that GLEW and GLFW are installed or provided as includes for compilation
+ */
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../common/batch2d.h"
+#include "../common/gl_state.h"
+#include "../common/headless.h"
+
+typedef enum { false, true } bool;
+
+GLFWwindow* window;
+HeadlessContext headless;
+bool use_headless = false;
+Batch2D batch;
+
+int num_quads = 100000;
+int num_frames = 100;
+int num_textures = 8;
+bool sort_enabled = true;
+
+GLuint* textures;
+
+void create_textures()
+{
+	int i;
+	textures = malloc(num_textures * sizeof(GLuint));
+	glGenTextures(num_textures, textures);
+	for(i = 0; i < num_textures; i++) {
+		// 2x2 of a different color each, the content does not matter for the benchmark
+		GLubyte data[16];
+		int j;
+		for(j = 0; j < 4; j++) {
+			data[j*4 + 0] = (i * 50) & 0xFF;
+			data[j*4 + 1] = (i * 90) & 0xFF;
+			data[j*4 + 2] = (i * 130) & 0xFF;
+			data[j*4 + 3] = 0xFF;
+		}
+		gl_state_bind_texture(GL_TEXTURE_2D, textures[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	}
+}
+
+static float frand()
+{
+	return (float) rand() / RAND_MAX;
+}
+
+void display()
+{
+	int i;
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	// same sequence every frame, so that frames are comparable
+	srand(1234);
+	batch2d_begin(&batch);
+	for(i = 0; i < num_quads; i++) {
+		float x = frand() * 2.0 - 1.0, y = frand() * 2.0 - 1.0, size = 0.01 + frand() * 0.02;
+		GLuint tex = textures[rand() % num_textures];
+		Batch2DBlend blend = (rand() % 2) ? BATCH2D_BLEND_ALPHA : BATCH2D_BLEND_ADDITIVE;
+		batch2d_quad(&batch, 0, tex, blend, x, y, x + size, y + size, 0.0, 0.0, 1.0, 1.0, 0xFFFFFFC0);
+	}
+	batch2d_flush(&batch);
+	gl_state_next_frame();
+}
+
+void shutdown_glfw_and_exit(int status_code)
+{
+	if(use_headless) {
+		headless_free(&headless);
+		exit(status_code);
+	}
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	exit(status_code);
+}
+
+static void error_cb(int error, const char* description)
+{
+	fprintf(stderr, "ERROR: %s\n", description);
+}
+
+// seconds, from the same clock with or without GLFW
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// a hidden window when there is a display, an EGL context otherwise
+static void create_context()
+{
+	if(use_headless) {
+		if(!headless_init(&headless, 512, 512, 3, 3)) exit(-1);
+		return;
+	}
+
+	glfwSetErrorCallback(error_cb);
+
+	// GLFW init
+	if(!glfwInit()) {
+		fprintf(stderr, "GLFW Error: Failed to initialize\nQuitting...\n");
+		exit(-1);
+	}
+
+	// Context creation. the window is never shown, it only provides the context
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+
+	window = glfwCreateWindow(512, 512, "Batch 2D Benchmark", NULL, NULL);
+	if (!window) {
+		glfwTerminate();
+		exit(-1);
+	}
+	glfwMakeContextCurrent(window);
+
+	glewExperimental = GL_TRUE;
+	GLenum err = glewInit();
+	if(err != GLEW_OK) {
+		fprintf(stderr, "GLEW Error: %s\nQuitting...\n", glewGetErrorString(err));
+		shutdown_glfw_and_exit(-1);
+	}
+	printf("Using OpenGL %s on %s\n", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+
+	// never wait for vsync, we want to know how fast it goes
+	glfwSwapInterval(0);
+}
+
+// main
+
+int main(int argc, char** argv)
+{
+	int i;
+	for(i = 1; i < argc; i++) {
+		if(!strcmp(argv[i], "--quads") && i+1 < argc) num_quads = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--frames") && i+1 < argc) num_frames = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--textures") && i+1 < argc) num_textures = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--no-sort")) sort_enabled = false;
+		else if(!strcmp(argv[i], "--headless")) use_headless = true;
+		else {
+			fprintf(stderr, "Usage: %s [--quads N] [--frames N] [--textures N] [--no-sort] [--headless]\n", argv[0]);
+			exit(-1);
+		}
+	}
+	if(num_quads < 1 || num_frames < 1 || num_textures < 1) {
+		fprintf(stderr, "--quads, --frames and --textures must be positive\n");
+		exit(-1);
+	}
+
+	create_context();
+
+	glClearColor(0.0, 0.0, 0.0, 0.0);
+	create_textures();
+	// small enough that large runs exercise the region round robin
+	if(!batch2d_init(&batch, 16384)) {
+		shutdown_glfw_and_exit(-1);
+	}
+	batch.sort_enabled = sort_enabled;
+	printf("Vertex buffer: %s\n", batch.mapped ? "persistently mapped" : "orphaned and mapped per flush");
+
+	// one warmup frame, so shader compilation and first allocations are not measured
+	display();
+	glFinish();
+
+	long long total_draw_calls = 0;
+	double start = now();
+	for(i = 0; i < num_frames; i++) {
+		display();
+		if(use_headless) glFlush();
+		else glfwSwapBuffers(window);
+		total_draw_calls += batch.stats.draw_calls;
+	}
+	glFinish(); // count the time the GPU takes to catch up
+	double elapsed = now() - start;
+
+	printf("%d frames of %d quads, %d textures, sorting %s\n", num_frames, num_quads, num_textures, sort_enabled ? "on" : "off");
+	printf("quads per second: %.0f\n", (double) num_quads * num_frames / elapsed);
+	printf("draw calls per frame: %.1f\n", (double) total_draw_calls / num_frames);
+	printf("ms per frame: %.3f\n", elapsed * 1000.0 / num_frames);
+	gl_state_print_stats();
+
+	batch2d_free(&batch);
+	glDeleteTextures(num_textures, textures);
+	free(textures);
+	shutdown_glfw_and_exit(0);
+}
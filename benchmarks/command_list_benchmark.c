@@ -0,0 +1,396 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Benchmark of recorded command lists
+ *
+ * Every frame, a few threads each record their share of small quads into a command list of their
+ * own, as separate UI, icon and text passes would. The lists are merged, radix sorted by key and
+ * submitted (see ../common/command_list.h). The quads use a few programs and textures in random
+ * order, so the sort decides how many state changes are left.
+ * Reports the time spent recording, merging, sorting and submitting, and compares the radix sort
+ * with qsort on the same keys. With --no-sort the commands are submitted in recorded order.
+ *
+ * Usage: command_list_benchmark [--commands N] [--frames N] [--threads N] [--programs N] [--textures N] [--no-sort] [--headless]
+ *
+ * To run it without a GPU, under Mesa's software rasterizer:
+ *   LIBGL_ALWAYS_SOFTWARE=1 GALLIUM_DRIVER=llvmpipe ./command_list_benchmark
+ * and without a display, with an EGL context instead of a window (see ../common/headless.h):
+ *   ./command_list_benchmark --headless
+ *
+ * Compiling this benchmark:
+ * Linux: gcc ../common/shader.c ../common/gl_state.c ../common/command_list.c ../common/headless.c ../common/worker_pool.c command_list_benchmark.c -lGL -lGLEW -lglfw -lEGL -lpthread -o command_list_benchmark
+ *
+ * Requires OpenGL 3.3 and that GLEW and GLFW are installed or provided as includes for compilation
+ */
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/shader.h"
+#include "../common/command_list.h"
+#include "../common/gl_state.h"
+#include "../common/headless.h"
+#include "../common/worker_pool.h"
+
+typedef enum { false, true } bool;
+
+#define GRID 256 // quads are placed on a GRID x GRID grid, by the uniform of each command
+
+typedef struct {
+	int index;
+	CommandList list;
+} Recorder;
+
+GLFWwindow* window;
+HeadlessContext headless;
+bool use_headless = false;
+
+int num_commands = 20000;
+int num_frames = 50;
+int num_threads = 0; // all cores
+int num_programs = 4;
+int num_textures = 8;
+bool sort_enabled = true;
+
+GLuint* programs;
+GLuint* textures;
+GLuint vao;
+CommandList frame;
+RenderCommand quad;
+
+// one per worker of the pool, the calling thread records the first share itself
+Recorder* recorders;
+WorkerPool* pool;
+
+// seconds, from the same clock with or without GLFW
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// the same pseudo random draws every frame and whichever thread records them
+static unsigned int hash(unsigned int x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+	return x;
+}
+
+// no GL here, this runs on any thread
+static void record(Recorder* r)
+{
+	int first = (long long) num_commands * r->index / num_threads;
+	int last = (long long) num_commands * (r->index + 1) / num_threads;
+	int i;
+
+	command_list_reset(&r->list);
+	for(i = first; i < last; i++) {
+		unsigned int h = hash(i);
+		RenderCommand command = quad;
+		command.program = programs[h % num_programs];
+		command.texture = textures[(h >> 8) % num_textures];
+		command.uniform_value = i % (GRID * GRID);
+		float depth = (float) (h >> 20) / (1 << 12);
+		// each thread is a pass of its own, drawn over the previous ones
+		command_list_push(&r->list, command_key(r->index, command.program, command.texture, depth), &command);
+	}
+}
+
+static void record_job(void* arg, int worker)
+{
+	(void) arg;
+	record(&recorders[worker]);
+}
+
+static void record_all()
+{
+	worker_pool_run(pool);
+}
+
+static bool start_recorders()
+{
+	int i;
+	if(num_threads <= 0) num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if(num_threads <= 0) num_threads = 1;
+	if(num_threads > COMMAND_KEY_LAYERS) num_threads = COMMAND_KEY_LAYERS;
+	pool = worker_pool_create(num_threads, record_job, NULL);
+	if(!pool) return false;
+	if(worker_pool_size(pool) < num_threads) {
+		fprintf(stderr, "Could only start %d of %d recording threads\n", worker_pool_size(pool), num_threads);
+		num_threads = worker_pool_size(pool);
+	}
+	recorders = calloc(num_threads, sizeof(Recorder));
+	if(!recorders) return false;
+
+	for(i = 0; i < num_threads; i++) {
+		recorders[i].index = i;
+		command_list_init(&recorders[i].list);
+	}
+	return true;
+}
+
+static void stop_recorders()
+{
+	int i;
+	worker_pool_destroy(pool);
+	for(i = 0; recorders && i < num_threads; i++) command_list_free(&recorders[i].list);
+	free(recorders);
+}
+
+static int compare_keys(const void* a, const void* b)
+{
+	uint64_t ka = *(const uint64_t*) a, kb = *(const uint64_t*) b;
+	return ka < kb ? -1 : ka > kb;
+}
+
+static bool create_scene()
+{
+	const char* vs_source =
+	"#version 330\n"
+	"uniform uint cell;\n"
+	"out vec2 vs_tex_coord;\n"
+	"void main(void) {\n"
+	"  vec2 corner = vec2(gl_VertexID == 1 || gl_VertexID == 2, gl_VertexID >= 2);\n"
+	"  vec2 pos = (vec2(cell % 256u, cell / 256u) + corner) / 128.0 - 1.0;\n"
+	"  gl_Position = vec4(pos, 0.0, 1.0);\n"
+	"  vs_tex_coord = corner;\n"
+	"}\n";
+	int i;
+
+	programs = malloc(num_programs * sizeof(GLuint));
+	textures = malloc(num_textures * sizeof(GLuint));
+	if(!programs || !textures) return false;
+
+	// the programs only differ by a tint, enough to be different programs
+	for(i = 0; i < num_programs; i++) {
+		char fs_source[512];
+		snprintf(fs_source, sizeof(fs_source),
+		         "#version 330\n"
+		         "uniform sampler2D tex;\n"
+		         "in vec2 vs_tex_coord;\n"
+		         "layout (location = 0) out vec4 color;\n"
+		         "void main(void) {\n"
+		         "  color = texture(tex, vs_tex_coord) * vec4(%f, 1.0, 1.0, 0.75);\n"
+		         "}\n", 1.0 - (double) i / num_programs);
+		programs[i] = create_program(vs_source, fs_source);
+		if(!programs[i]) return false;
+	}
+
+	glGenTextures(num_textures, textures);
+	for(i = 0; i < num_textures; i++) {
+		// 2x2 of a different color each, the content does not matter for the benchmark
+		GLubyte data[16];
+		int j;
+		for(j = 0; j < 4; j++) {
+			data[j*4 + 0] = (i * 50) & 0xFF;
+			data[j*4 + 1] = (i * 90) & 0xFF;
+			data[j*4 + 2] = (i * 130) & 0xFF;
+			data[j*4 + 3] = 0xFF;
+		}
+		gl_state_bind_texture(GL_TEXTURE_2D, textures[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	}
+
+	// the vertices come from gl_VertexID, the VAO has no attributes
+	glGenVertexArrays(1, &vao);
+
+	// the location is the same in every program, they share the vertex shader
+	quad.vao = vao;
+	quad.texture_target = GL_TEXTURE_2D;
+	quad.blend = GL_TRUE;
+	quad.blend_src = GL_SRC_ALPHA;
+	quad.blend_dst = GL_ONE_MINUS_SRC_ALPHA;
+	quad.uniform = glGetUniformLocation(programs[0], "cell");
+	quad.mode = GL_TRIANGLE_FAN;
+	quad.count = 4;
+	if(quad.uniform == -1) { fprintf(stderr, "Getting shader uniform 'cell' failed.\n"); return false; }
+	return true;
+}
+
+void shutdown_glfw_and_exit(int status_code)
+{
+	if(use_headless) {
+		headless_free(&headless);
+		exit(status_code);
+	}
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	exit(status_code);
+}
+
+static void error_cb(int error, const char* description)
+{
+	fprintf(stderr, "ERROR: %s\n", description);
+}
+
+// a hidden window when there is a display, an EGL context otherwise
+static void create_context()
+{
+	if(use_headless) {
+		if(!headless_init(&headless, 512, 512, 3, 3)) exit(-1);
+		return;
+	}
+
+	glfwSetErrorCallback(error_cb);
+
+	// GLFW init
+	if(!glfwInit()) {
+		fprintf(stderr, "GLFW Error: Failed to initialize\nQuitting...\n");
+		exit(-1);
+	}
+
+	// Context creation. the window is never shown, it only provides the context
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+
+	window = glfwCreateWindow(512, 512, "Command List Benchmark", NULL, NULL);
+	if (!window) {
+		glfwTerminate();
+		exit(-1);
+	}
+	glfwMakeContextCurrent(window);
+
+	glewExperimental = GL_TRUE;
+	GLenum err = glewInit();
+	if(err != GLEW_OK) {
+		fprintf(stderr, "GLEW Error: %s\nQuitting...\n", glewGetErrorString(err));
+		shutdown_glfw_and_exit(-1);
+	}
+	printf("Using OpenGL %s on %s\n", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+
+	// never wait for vsync, we want to know how fast it goes
+	glfwSwapInterval(0);
+}
+
+// main
+
+int main(int argc, char** argv)
+{
+	int i, j;
+	for(i = 1; i < argc; i++) {
+		if(!strcmp(argv[i], "--commands") && i+1 < argc) num_commands = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--frames") && i+1 < argc) num_frames = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--threads") && i+1 < argc) num_threads = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--programs") && i+1 < argc) num_programs = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--textures") && i+1 < argc) num_textures = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--no-sort")) sort_enabled = false;
+		else if(!strcmp(argv[i], "--headless")) use_headless = true;
+		else {
+			fprintf(stderr, "Usage: %s [--commands N] [--frames N] [--threads N] [--programs N] [--textures N] [--no-sort] [--headless]\n", argv[0]);
+			exit(-1);
+		}
+	}
+	if(num_commands < 1 || num_frames < 1 || num_programs < 1 || num_textures < 1) {
+		fprintf(stderr, "--commands, --frames, --programs and --textures must be positive\n");
+		exit(-1);
+	}
+
+	create_context();
+
+	glClearColor(0.0, 0.0, 0.0, 0.0);
+	if(!create_scene() || !start_recorders()) {
+		shutdown_glfw_and_exit(-1);
+	}
+	command_list_init(&frame);
+	frame.sort_enabled = sort_enabled;
+	uint64_t* qsort_keys = malloc(num_commands * sizeof(uint64_t));
+	if(!qsort_keys) shutdown_glfw_and_exit(-1);
+
+	double record_s = 0.0, merge_s = 0.0, sort_ms = 0.0, qsort_s = 0.0, submit_ms = 0.0;
+	int sort_passes = 0;
+	double start = now();
+	// one warmup frame first, so first allocations are not measured
+	for(i = -1; i < num_frames; i++) {
+		if(i == 0) {
+			glFinish();
+			start = now();
+		}
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		double t0 = now();
+		record_all();
+		double t1 = now();
+		command_list_reset(&frame);
+		for(j = 0; j < num_threads; j++) command_list_append(&frame, &recorders[j].list);
+		double t2 = now();
+
+		// the same keys through qsort, for comparison. not part of the frame time
+		for(j = 0; j < frame.count; j++) qsort_keys[j] = frame.commands[j].key;
+		double q0 = now();
+		qsort(qsort_keys, frame.count, sizeof(uint64_t), compare_keys);
+		double q1 = now();
+
+		command_list_submit(&frame);
+		gl_state_next_frame();
+		if(use_headless) glFlush();
+		else glfwSwapBuffers(window);
+
+		if(i < 0) continue;
+		record_s += t1 - t0;
+		merge_s += t2 - t1;
+		qsort_s += q1 - q0;
+		sort_ms += frame.stats.sort_ms;
+		submit_ms += frame.stats.submit_ms;
+		sort_passes = frame.stats.sort_passes;
+	}
+	glFinish(); // count the time the GPU takes to catch up
+	double elapsed = now() - start - qsort_s;
+
+	printf("%d frames of %d commands, %d programs, %d textures, %d recording threads, sorting %s\n",
+	       num_frames, num_commands, num_programs, num_textures, num_threads, sort_enabled ? "on" : "off");
+	printf("record ms per frame: %.3f\n", record_s * 1000.0 / num_frames);
+	printf("merge ms per frame: %.3f\n", merge_s * 1000.0 / num_frames);
+	if(sort_enabled) printf("radix sort ms per frame: %.3f (%d passes)\n", sort_ms / num_frames, sort_passes);
+	printf("qsort ms per frame: %.3f\n", qsort_s * 1000.0 / num_frames);
+	printf("submit ms per frame: %.3f\n", submit_ms / num_frames);
+	printf("ms per frame: %.3f\n", elapsed * 1000.0 / num_frames);
+	gl_state_print_stats();
+
+	stop_recorders();
+	command_list_free(&frame);
+	free(qsort_keys);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteTextures(num_textures, textures);
+	for(i = 0; i < num_programs; i++) glDeleteProgram(programs[i]);
+	free(textures);
+	free(programs);
+	shutdown_glfw_and_exit(0);
+}
@@ -0,0 +1,619 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Benchmark of PNG loading, stage by stage
+ *
+ * Generates a corpus of PNGs with LodePNG's encoder, covering every color type and bit depth,
+ * both interlace methods, sizes from 16x16 to 8192x8192 (with 17x17 and 255x255, whose rows are
+ * padded at sub-byte bit depths) and four classes of content:
+ *   flat      flat colored panels with thin borders, like UI assets
+ *   noise     smooth noise with grain, like photos
+ *   gradient  smooth ramps on every channel
+ *   checker   8x8 black and white squares, like checkerboard_texture.c
+ * and times each stage of decoding and encoding them on their own, with the functions LodePNG
+ * uses internally (this file includes ../textures/lodepng.c to reach them):
+ *   parse     walking the chunks and gathering the IDAT data, as lodepng_decode() does
+ *   crc       checking the CRC of every chunk
+ *   inflate   decompressing the IDAT data into filtered scanlines
+ *   adler     the Adler-32 of the scanlines
+ *   unfilter  unfiltering, removing the padding bits, and deinterlacing Adam7. in place over the
+ *             scanlines for non interlaced images, as decoding does
+ *   convert   converting to 8-bit RGBA, what the examples upload
+ *   decode    lodepng_decode32(), all of the above
+ *   filter    filtering, adding padding bits and interlacing, for encoding
+ *   deflate   compressing the filtered scanlines
+ *   encode    lodepng_encode(), all of the above
+ *
+ * Each stage runs until --min-ms have passed and reports its best time per run in nanoseconds,
+ * the bytes it processes (the inflated size for inflate, adler and unfilter, the RGBA output for
+ * convert and decode, the raw image for filter and encode, the file for parse and crc), and MB/s
+ * and Mpixels/s from those. The report is JSON, one entry per image and totals per stage, so that
+ * a change in lodepng.c can be compared against a saved baseline.
+ *
+ * Usage: png_benchmark [--min-size N] [--max-size N] [--content NAME] [--min-ms N] [--corpus-dir dir] [--report file.json]
+ *   --min-size, --max-size  side of the images, from 16, 17, 64, 255, 256, 1024, 4096 and 8192. up to 256 by default
+ *   --content               flat, noise, gradient or checker. all of them by default
+ *   --corpus-dir            also writes the corpus there, eg. for other decoders
+ *   --report                where the JSON goes, stdout by default. progress is printed to stderr
+ *
+ * Compiling this benchmark:
+ * Linux: gcc -O2 png_benchmark.c -DLODEPNG_NO_COMPILE_CPP -o png_benchmark
+ *
+ * Requires the included LodePNG library: http://lodev.org/lodepng/
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// the whole library, for the stages that are static in it
+#include "../textures/lodepng.c"
+
+typedef enum { false, true } bool;
+
+typedef enum { CONTENT_FLAT, CONTENT_NOISE, CONTENT_GRADIENT, CONTENT_CHECKER, CONTENTS } Content;
+static const char* content_names[CONTENTS] = { "flat", "noise", "gradient", "checker" };
+
+typedef struct {
+	LodePNGColorType type;
+	unsigned int bit_depth;
+	const char* name;
+} Format;
+
+// every color type and bit depth the PNG specification allows
+static const Format formats[] = {
+	{ LCT_GREY, 1, "grey" }, { LCT_GREY, 2, "grey" }, { LCT_GREY, 4, "grey" }, { LCT_GREY, 8, "grey" }, { LCT_GREY, 16, "grey" },
+	{ LCT_RGB, 8, "rgb" }, { LCT_RGB, 16, "rgb" },
+	{ LCT_PALETTE, 1, "palette" }, { LCT_PALETTE, 2, "palette" }, { LCT_PALETTE, 4, "palette" }, { LCT_PALETTE, 8, "palette" },
+	{ LCT_GREY_ALPHA, 8, "grey_alpha" }, { LCT_GREY_ALPHA, 16, "grey_alpha" },
+	{ LCT_RGBA, 8, "rgba" }, { LCT_RGBA, 16, "rgba" }
+};
+#define NUM_FORMATS (sizeof(formats) / sizeof(formats[0]))
+
+// 17 and 255 are not multiples of 8, so rows at 1, 2 and 4 bits per pixel end in padding bits
+static const unsigned int sizes[] = { 16, 17, 64, 255, 256, 1024, 4096, 8192 };
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+enum { STAGE_PARSE, STAGE_CRC, STAGE_INFLATE, STAGE_ADLER, STAGE_UNFILTER, STAGE_CONVERT, STAGE_DECODE,
+       STAGE_FILTER, STAGE_DEFLATE, STAGE_ENCODE, STAGES };
+
+// one corpus image and the intermediate buffers of its decoding
+typedef struct {
+	unsigned int size;
+	LodePNGState state;          // the encoder settings. info_png is also what the decoding stages expect
+	unsigned char* raw;          // the image in its PNG color mode, as encoded
+	size_t raw_size;
+	unsigned char* png;
+	size_t png_size;
+
+	unsigned char* idat;         // gathered by the parse stage
+	size_t idat_size;
+	unsigned char* scanlines;    // inflated, still filtered
+	size_t scanlines_size;
+	unsigned char* work;         // scanlines to unfilter, unfiltering overwrites them
+	unsigned char* image;        // unfiltered
+	unsigned char* rgba;         // converted
+	size_t rgba_size;
+	unsigned char* filtered;     // filtered for encoding
+	size_t filtered_size;
+	unsigned int error;          // the first error of a stage, which invalidates the image
+} Sample;
+
+typedef struct {
+	const char* name;
+	void (*setup)(Sample* s);    // before each run, not timed
+	void (*run)(Sample* s);
+} Stage;
+
+int min_size = 16;
+int max_size = 256;
+int only_content = -1;
+double min_ms = 5.0;
+const char* corpus_dir = NULL;
+const char* report = NULL;
+
+// totals per stage, over the whole corpus
+double total_ns[STAGES];
+double total_bytes[STAGES];
+double total_pixels[STAGES];
+
+static double now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// corpus
+
+static unsigned int hash(unsigned int x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+	return x;
+}
+
+// smooth noise, bilinear between random values on a 'cell' pixels grid. 0 to 65535
+static unsigned int value_noise(unsigned int x, unsigned int y, unsigned int cell, unsigned int seed)
+{
+	unsigned int cx = x / cell, cy = y / cell;
+	unsigned int fx = (x % cell) * 256 / cell, fy = (y % cell) * 256 / cell;
+	unsigned int v00 = hash(seed ^ hash(cx ^ hash(cy))) & 0xFFFF;
+	unsigned int v10 = hash(seed ^ hash((cx + 1) ^ hash(cy))) & 0xFFFF;
+	unsigned int v01 = hash(seed ^ hash(cx ^ hash(cy + 1))) & 0xFFFF;
+	unsigned int v11 = hash(seed ^ hash((cx + 1) ^ hash(cy + 1))) & 0xFFFF;
+	unsigned int top = (v00 * (256 - fx) + v10 * fx) / 256;
+	unsigned int bottom = (v01 * (256 - fx) + v11 * fx) / 256;
+	return (top * (256 - fy) + bottom * fy) / 256;
+}
+
+// RGBA of a pixel, 16 bits per channel
+static void content_pixel(Content content, unsigned int x, unsigned int y, unsigned int size, unsigned int rgba[4])
+{
+	int c;
+	switch(content) {
+	case CONTENT_FLAT: {
+		// 4x4 panels of a few colors, with 1 pixel borders
+		unsigned int panel = (x * 4 / size) + (y * 4 / size) * 4;
+		bool border = x % (size / 4 > 0 ? size / 4 : 1) == 0 || y % (size / 4 > 0 ? size / 4 : 1) == 0;
+		static const unsigned int palette[4][4] = {
+			{ 0xF0F0, 0xF0F0, 0xF0F0, 0xFFFF }, { 0x3030, 0x6060, 0xC0C0, 0xFFFF },
+			{ 0xE0E0, 0xE0E0, 0xE0E0, 0xFFFF }, { 0x2020, 0x2020, 0x2020, 0x8080 } };
+		for(c = 0; c < 4; c++) rgba[c] = border ? 0x4040 : palette[hash(panel) % 4][c];
+		if(border) rgba[3] = 0xFFFF;
+		break;
+	}
+	case CONTENT_NOISE: {
+		// smooth shapes and some grain
+		unsigned int cell = size / 8 > 4 ? size / 8 : 4;
+		for(c = 0; c < 3; c++) {
+			unsigned int grain = hash(x * 7919 + y * 104729 + c) & 0x1FFF;
+			unsigned int v = value_noise(x, y, cell, c) * 7 / 8 + grain;
+			rgba[c] = v > 0xFFFF ? 0xFFFF : v;
+		}
+		rgba[3] = 0xFFFF;
+		break;
+	}
+	case CONTENT_GRADIENT:
+		rgba[0] = x * 0xFFFF / (size - 1);
+		rgba[1] = y * 0xFFFF / (size - 1);
+		rgba[2] = (x + y) * 0xFFFF / (2 * (size - 1));
+		rgba[3] = 0xFFFF - rgba[1] / 2;
+		break;
+	default: {
+		unsigned int v = ((x * 8 / size) + (y * 8 / size)) % 2 ? 0x0000 : 0xFFFF;
+		rgba[0] = rgba[1] = rgba[2] = v;
+		rgba[3] = 0xFFFF;
+		break;
+	}
+	}
+}
+
+// writes 'value', 'bits' wide, at bit 'bit' of the image. most significant bit first, rows are not padded
+static void put_bits(unsigned char* raw, size_t bit, unsigned int value, unsigned int bits)
+{
+	if(bits == 16) {
+		raw[bit / 8] = value >> 8;
+		raw[bit / 8 + 1] = value & 0xFF;
+	}
+	else if(bits == 8) raw[bit / 8] = value;
+	else raw[bit / 8] |= value << (8 - bits - bit % 8);
+}
+
+// the raw image in the PNG's own color mode, and the color mode with its palette
+static bool generate(Sample* s, const Format* format, Content content, unsigned int size)
+{
+	LodePNGColorMode* mode = &s->state.info_raw;
+	unsigned int x, y, i;
+	mode->colortype = format->type;
+	mode->bitdepth = format->bit_depth;
+	if(format->type == LCT_PALETTE) {
+		// a grey ramp, with transparency in the last entry
+		unsigned int entries = 1u << format->bit_depth;
+		for(i = 0; i < entries; i++) {
+			unsigned char v = i * 255 / (entries - 1);
+			if(lodepng_palette_add(mode, v, v, v, i == entries - 1 ? 128 : 255)) return false;
+		}
+	}
+
+	unsigned int channels = lodepng_get_channels(mode);
+	s->raw_size = lodepng_get_raw_size(size, size, mode);
+	s->raw = calloc(s->raw_size, 1);
+	if(!s->raw) return false;
+
+	size_t bit = 0;
+	unsigned int shift = 16 - format->bit_depth;
+	for(y = 0; y < size; y++) {
+		for(x = 0; x < size; x++) {
+			unsigned int rgba[4], grey;
+			content_pixel(content, x, y, size, rgba);
+			grey = (rgba[0] * 2 + rgba[1] * 5 + rgba[2]) / 8;
+			switch(format->type) {
+			case LCT_GREY:
+			case LCT_PALETTE:
+				put_bits(s->raw, bit, grey >> shift, format->bit_depth);
+				bit += format->bit_depth;
+				break;
+			case LCT_GREY_ALPHA:
+				put_bits(s->raw, bit, grey >> shift, format->bit_depth);
+				put_bits(s->raw, bit + format->bit_depth, rgba[3] >> shift, format->bit_depth);
+				bit += 2 * format->bit_depth;
+				break;
+			default:
+				for(i = 0; i < channels; i++) {
+					put_bits(s->raw, bit, rgba[i] >> shift, format->bit_depth);
+					bit += format->bit_depth;
+				}
+				break;
+			}
+		}
+	}
+
+	// encoded as is, not in whatever color mode LodePNG would pick
+	s->state.encoder.auto_convert = 0;
+	s->state.encoder.add_id = 0;
+	s->size = size;
+	return lodepng_color_mode_copy(&s->state.info_png.color, mode) == 0;
+}
+
+// stages
+
+static void run_parse(Sample* s)
+{
+	// the chunks after the signature and IHDR, IDAT data concatenated like decodeGeneric() does
+	const unsigned char* chunk = s->png + 33;
+	const unsigned char* end = s->png + s->png_size;
+	size_t size = 0;
+	while(chunk + 12 <= end) {
+		unsigned int length = lodepng_chunk_length(chunk);
+		if(length > (size_t) (end - chunk) - 12) {
+			s->error = 64;
+			return;
+		}
+		if(lodepng_chunk_type_equals(chunk, "IDAT")) {
+			memcpy(s->idat + size, lodepng_chunk_data_const(chunk), length);
+			size += length;
+		}
+		else if(lodepng_chunk_type_equals(chunk, "IEND")) break;
+		chunk = lodepng_chunk_next_const(chunk);
+	}
+	s->idat_size = size;
+}
+
+static void run_crc(Sample* s)
+{
+	const unsigned char* chunk = s->png + 8;
+	const unsigned char* end = s->png + s->png_size;
+	while(chunk + 12 <= end) {
+		if(lodepng_chunk_check_crc(chunk)) s->error = 57;
+		if(lodepng_chunk_type_equals(chunk, "IEND")) break;
+		chunk = lodepng_chunk_next_const(chunk);
+	}
+}
+
+static void run_inflate(Sample* s)
+{
+	// the deflate stream, without the zlib header and the Adler-32 after it
+	unsigned char* out = NULL;
+	size_t size = 0;
+	unsigned int error = lodepng_inflate(&out, &size, s->idat + 2, s->idat_size - 6, &lodepng_default_decompress_settings);
+	if(error) s->error = error;
+	if(!s->scanlines) {
+		s->scanlines = out;
+		s->scanlines_size = size;
+	}
+	else free(out);
+}
+
+static volatile unsigned int adler_sink; // keeps the checksum from being optimized out
+
+static void run_adler(Sample* s)
+{
+	adler_sink = adler32(s->scanlines, s->scanlines_size);
+}
+
+static void setup_unfilter(Sample* s)
+{
+	memcpy(s->work, s->scanlines, s->scanlines_size);
+	// decodeGeneric() clears it too, Adam7 below 8 bits per pixel only sets bits
+	memset(s->image, 0, s->raw_size);
+}
+
+static void run_unfilter(Sample* s)
+{
+	unsigned int error;
+	if(s->state.info_png.interlace_method == 0)
+		error = postProcessScanlinesInPlace(s->work, s->size, s->size, &s->state.info_png, NULL);
+	else error = postProcessScanlines(s->image, s->work, s->size, s->size, &s->state.info_png, NULL);
+	if(error) s->error = error;
+}
+
+static void run_convert(Sample* s)
+{
+	LodePNGColorMode rgba8;
+	lodepng_color_mode_init(&rgba8); // 8-bit RGBA
+	unsigned int error = lodepng_convert(s->rgba, s->image, &rgba8, &s->state.info_png.color, s->size, s->size);
+	if(error) s->error = error;
+}
+
+static void run_decode(Sample* s)
+{
+	unsigned char* out;
+	unsigned int w, h;
+	unsigned int error = lodepng_decode32(&out, &w, &h, s->png, s->png_size);
+	if(error) s->error = error;
+	else free(out);
+}
+
+static void run_filter(Sample* s)
+{
+	unsigned char* out = NULL;
+	size_t size = 0;
+	unsigned int error = preProcessScanlines(&out, &size, s->raw, s->size, s->size, &s->state.info_png, &s->state.encoder, NULL);
+	if(error) s->error = error;
+	if(!s->filtered) {
+		s->filtered = out;
+		s->filtered_size = size;
+	}
+	else free(out);
+}
+
+static void run_deflate(Sample* s)
+{
+	unsigned char* out = NULL;
+	size_t size = 0;
+	unsigned int error = lodepng_zlib_compress(&out, &size, s->filtered, s->filtered_size, &s->state.encoder.zlibsettings);
+	if(error) s->error = error;
+	free(out);
+}
+
+static void run_encode(Sample* s)
+{
+	unsigned char* out = NULL;
+	size_t size = 0;
+	unsigned int error = lodepng_encode(&out, &size, s->raw, s->size, s->size, &s->state);
+	if(error) s->error = error;
+	free(out);
+}
+
+// in dependency order, each stage prepares what the next ones use
+static const Stage stages[STAGES] = {
+	{ "parse", NULL, run_parse },
+	{ "crc", NULL, run_crc },
+	{ "inflate", NULL, run_inflate },
+	{ "adler", NULL, run_adler },
+	{ "unfilter", setup_unfilter, run_unfilter },
+	{ "convert", NULL, run_convert },
+	{ "decode", NULL, run_decode },
+	{ "filter", NULL, run_filter },
+	{ "deflate", NULL, run_deflate },
+	{ "encode", NULL, run_encode }
+};
+
+static size_t stage_bytes(const Sample* s, int stage)
+{
+	switch(stage) {
+	case STAGE_PARSE: case STAGE_CRC: return s->png_size;
+	case STAGE_INFLATE: case STAGE_ADLER: case STAGE_UNFILTER: return s->scanlines_size;
+	case STAGE_CONVERT: case STAGE_DECODE: return s->rgba_size;
+	case STAGE_DEFLATE: return s->filtered_size;
+	default: return s->raw_size;
+	}
+}
+
+// total time of 'runs' runs, only the runs themselves
+static double time_runs(const Stage* stage, Sample* s, long runs)
+{
+	double total = 0.0;
+	long i;
+	if(!stage->setup) {
+		double start = now_ns();
+		for(i = 0; i < runs; i++) stage->run(s);
+		return now_ns() - start;
+	}
+	for(i = 0; i < runs; i++) {
+		stage->setup(s);
+		double start = now_ns();
+		stage->run(s);
+		total += now_ns() - start;
+	}
+	return total;
+}
+
+// best time per run, in nanoseconds
+static double time_stage(const Stage* stage, Sample* s)
+{
+	// runs per sample, so that a sample is long enough for the clock
+	long runs = 1;
+	double elapsed = time_runs(stage, s, runs);
+	while(elapsed < 200000.0 && !s->error) {
+		runs *= 2;
+		elapsed = time_runs(stage, s, runs);
+	}
+
+	double best = elapsed / runs, spent = elapsed;
+	while(spent < min_ms * 1e6 && !s->error) {
+		elapsed = time_runs(stage, s, runs);
+		if(elapsed / runs < best) best = elapsed / runs;
+		spent += elapsed;
+	}
+	return best;
+}
+
+static bool prepare(Sample* s)
+{
+	s->idat = malloc(s->png_size);
+	s->image = malloc(s->raw_size);
+	s->rgba_size = (size_t) s->size * s->size * 4;
+	s->rgba = malloc(s->rgba_size);
+	return s->idat && s->image && s->rgba;
+}
+
+static void free_sample(Sample* s)
+{
+	lodepng_state_cleanup(&s->state);
+	free(s->raw);
+	free(s->png);
+	free(s->idat);
+	free(s->scanlines);
+	free(s->work);
+	free(s->image);
+	free(s->rgba);
+	free(s->filtered);
+}
+
+static void write_corpus_file(const Sample* s, const char* name)
+{
+	char path[1024];
+	snprintf(path, sizeof(path), "%s/%s.png", corpus_dir, name);
+	if(lodepng_save_file(s->png, s->png_size, path)) fprintf(stderr, "Could not write '%s'\n", path);
+}
+
+// generates, encodes and times one image, and writes its JSON entry. returns 0 on failure
+static bool benchmark_image(FILE* file, bool first, const Format* format, bool adam7, Content content, unsigned int size)
+{
+	Sample s;
+	char name[128];
+	int i;
+	memset(&s, 0, sizeof(s));
+	lodepng_state_init(&s.state);
+	s.state.info_png.interlace_method = adam7;
+	snprintf(name, sizeof(name), "%s_%s%u_%u%s", content_names[content], format->name, format->bit_depth, size, adam7 ? "_adam7" : "");
+	fprintf(stderr, "%s\n", name);
+
+	unsigned int error = generate(&s, format, content, size) ? 0 : 83;
+	if(!error) error = lodepng_encode(&s.png, &s.png_size, s.raw, size, size, &s.state);
+	if(!error && !prepare(&s)) error = 83;
+	if(error) {
+		fprintf(stderr, "Could not generate '%s' %u: %s\n", name, error, lodepng_error_text(error));
+		free_sample(&s);
+		return false;
+	}
+	if(corpus_dir) write_corpus_file(&s, name);
+
+
+	double ns[STAGES];
+	for(i = 0; i < STAGES && !s.error; i++) {
+		if(i == STAGE_UNFILTER) {
+			s.work = malloc(s.scanlines_size);
+			if(!s.work) s.error = 83;
+		}
+		if(!s.error) ns[i] = time_stage(&stages[i], &s);
+		// the image unfiltered in place is what the convert stage starts from
+		if(i == STAGE_UNFILTER && !adam7) memcpy(s.image, s.work, s.raw_size);
+		// an optimization that breaks decoding must not show up as a speedup
+		if(i == STAGE_UNFILTER && !s.error && memcmp(s.image, s.raw, s.raw_size) != 0) s.error = 1000;
+	}
+	if(s.error) {
+		fprintf(stderr, "Stage %s failed on '%s' %u: %s\n", stages[i - 1].name, name, s.error,
+		        s.error == 1000 ? "the unfiltered image differs from the encoded one" : lodepng_error_text(s.error));
+		free_sample(&s);
+		return false;
+	}
+
+	double pixels = (double) size * size;
+	fprintf(file, "%s    {\"name\": \"%s\", \"content\": \"%s\", \"color_type\": \"%s\", \"bit_depth\": %u, \"interlace\": %s, \"size\": %u, \"file_bytes\": %lu,\n",
+	        first ? "" : ",\n", name, content_names[content], format->name, format->bit_depth, adam7 ? "true" : "false", size, (unsigned long) s.png_size);
+	fprintf(file, "     \"stages\": {");
+	for(i = 0; i < STAGES; i++) {
+		size_t bytes = stage_bytes(&s, i);
+		fprintf(file, "%s\n       \"%s\": {\"ns\": %.0f, \"bytes\": %lu, \"mb_per_s\": %.2f, \"mpixels_per_s\": %.2f}",
+		        i ? "," : "", stages[i].name, ns[i], (unsigned long) bytes, bytes / ns[i] * 1e3, pixels / ns[i] * 1e3);
+		total_ns[i] += ns[i];
+		total_bytes[i] += bytes;
+		total_pixels[i] += pixels;
+	}
+	fprintf(file, "\n     }}");
+
+	free_sample(&s);
+	return true;
+}
+
+// main
+
+int main(int argc, char** argv)
+{
+	int i;
+	for(i = 1; i < argc; i++) {
+		if(!strcmp(argv[i], "--min-size") && i+1 < argc) min_size = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--max-size") && i+1 < argc) max_size = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--min-ms") && i+1 < argc) min_ms = atof(argv[++i]);
+		else if(!strcmp(argv[i], "--corpus-dir") && i+1 < argc) corpus_dir = argv[++i];
+		else if(!strcmp(argv[i], "--report") && i+1 < argc) report = argv[++i];
+		else if(!strcmp(argv[i], "--content") && i+1 < argc) {
+			const char* name = argv[++i];
+			for(only_content = 0; only_content < CONTENTS && strcmp(content_names[only_content], name); only_content++);
+			if(only_content == CONTENTS) {
+				fprintf(stderr, "Unknown content '%s', it is flat, noise, gradient or checker\n", name);
+				exit(-1);
+			}
+		}
+		else {
+			fprintf(stderr, "Usage: %s [--min-size N] [--max-size N] [--content NAME] [--min-ms N] [--corpus-dir dir] [--report file.json]\n", argv[0]);
+			exit(-1);
+		}
+	}
+
+	FILE* file = report ? fopen(report, "w") : stdout;
+	if(!file) {
+		fprintf(stderr, "Could not write report '%s'\n", report);
+		exit(-1);
+	}
+
+	fprintf(file, "{\n  \"lodepng\": \"%s\",\n  \"min_ms\": %.1f,\n  \"images\": [\n", LODEPNG_VERSION_STRING, min_ms);
+	int images = 0, failed = 0;
+	unsigned int size_index, format_index;
+	int content, adam7;
+	for(size_index = 0; size_index < NUM_SIZES; size_index++) {
+		if((int) sizes[size_index] < min_size || (int) sizes[size_index] > max_size) continue;
+		for(content = 0; content < CONTENTS; content++) {
+			if(only_content >= 0 && content != only_content) continue;
+			for(format_index = 0; format_index < NUM_FORMATS; format_index++) {
+				for(adam7 = 0; adam7 < 2; adam7++) {
+					if(benchmark_image(file, images == 0, &formats[format_index], adam7, content, sizes[size_index])) images++;
+					else failed++;
+				}
+			}
+		}
+	}
+
+	// per stage over everything, weighted by time, so large images count the most
+	fprintf(file, "\n  ],\n  \"totals\": {");
+	for(i = 0; i < STAGES; i++) {
+		double ns = total_ns[i] > 0.0 ? total_ns[i] : 1.0;
+		fprintf(file, "%s\n    \"%s\": {\"ns\": %.0f, \"bytes\": %.0f, \"mb_per_s\": %.2f, \"mpixels_per_s\": %.2f}",
+		        i ? "," : "", stages[i].name, total_ns[i], total_bytes[i], total_bytes[i] / ns * 1e3, total_pixels[i] / ns * 1e3);
+	}
+	fprintf(file, "\n  },\n  \"images_failed\": %d\n}\n", failed);
+	if(report) {
+		fclose(file);
+		fprintf(stderr, "Wrote %d images to '%s'\n", images, report);
+	}
+	return failed ? -1 : 0;
+}
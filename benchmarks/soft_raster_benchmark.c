@@ -0,0 +1,307 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Benchmark of the software rasterizer on the example scenes
+ *
+ * Renders the scenes of the examples with ../common/soft_rasterizer.h instead of OpenGL:
+ * the triangle of minimal_glew_glfw, checkerboard_texture, image_texture, icons and the glyph of font_character.
+ * Needs no GL driver and no display, and reports frames per second and shaded Mpixels per second.
+ * With --output-dir, the last frame of every scene is saved, to compare against a driver's
+ * --headless --output frames with ../tools/compare_images.
+ *
+ * Usage: soft_raster_benchmark [--scene NAME] [--frames N] [--threads N] [--workload N] [--output-dir dir]
+ *   --scene     triangle, checkerboard, image, icons or glyph. all of them by default
+ *   --threads   rasterizer threads, one per CPU by default
+ *   --workload  draws the scene N times per frame, blended over itself
+ *
+ * Run it from this directory, the images are loaded from ../textures.
+ *
+ * Compiling this benchmark:
+ * Linux: gcc -O2 ../common/worker_pool.c ../common/soft_rasterizer.c ../textures/lodepng.c soft_raster_benchmark.c -I/usr/include/freetype2 -lfreetype -lpthread -lm -o soft_raster_benchmark
+ *
+ * Requires FreeType and the included LodePNG library: http://lodev.org/lodepng/
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "../common/soft_rasterizer.h"
+#include "../textures/lodepng.h"
+
+typedef enum { false, true } bool;
+
+#define FONT_FILE "/usr/share/fonts/TTF/LiberationSans-Regular.ttf"
+
+typedef struct {
+	const char* name;
+	int width, height;
+	SoftPrimitive primitive;
+	SoftVertex vertices[4];
+	int num_vertices;
+	SoftState state;
+	SoftTexture texture;
+	unsigned char* texture_data; // owned
+} Scene;
+
+int num_frames = 100;
+int num_threads = 0;
+int workload = 1;
+const char* output_dir = NULL;
+
+// the quad of the texture examples, with the texture upright
+static void textured_quad(Scene* scene)
+{
+	SoftVertex quad[4] = {
+		{-0.75, -0.75, 0.0, 1.0},
+		{ 0.75, -0.75, 1.0, 1.0},
+		{ 0.75,  0.75, 1.0, 0.0},
+		{-0.75,  0.75, 0.0, 0.0}
+	};
+	memcpy(scene->vertices, quad, sizeof(quad));
+	scene->num_vertices = 4;
+	scene->primitive = SOFT_TRIANGLE_FAN;
+	scene->state.texture = &scene->texture;
+	scene->state.blend = true;
+	float white[4] = {1.0, 1.0, 1.0, 1.0};
+	memcpy(scene->state.color, white, sizeof(white));
+}
+
+static bool load_png_texture(Scene* scene, const char* file, SoftFilter filter)
+{
+	unsigned int width, height;
+	unsigned int error = lodepng_decode32_file(&scene->texture_data, &width, &height, file);
+	if(error) {
+		fprintf(stderr, "Error loading image file '%s' %u: %s\n", file, error, lodepng_error_text(error));
+		return false;
+	}
+	SoftTexture texture = {width, height, 4, width * 4, filter, scene->texture_data};
+	scene->texture = texture;
+	return true;
+}
+
+// scenes, as the examples draw them
+
+static bool triangle_scene(Scene* scene)
+{
+	SoftVertex triangle[3] = {
+		{-0.75, -0.75, 0.0, 0.0},
+		{ 0.00,  0.75, 0.0, 0.0},
+		{ 0.75, -0.75, 0.0, 0.0}
+	};
+	memcpy(scene->vertices, triangle, sizeof(triangle));
+	scene->num_vertices = 3;
+	scene->primitive = SOFT_TRIANGLES;
+	scene->width = scene->height = 250;
+	float green[4] = {0.0, 1.0, 0.0, 1.0};
+	memcpy(scene->state.color, green, sizeof(green));
+	return true;
+}
+
+static bool checkerboard_scene(Scene* scene)
+{
+	textured_quad(scene);
+	scene->width = scene->height = 350;
+	scene->texture_data = malloc(8 * 8);
+	if(!scene->texture_data) return false;
+	int x, y;
+	for(y = 0; y < 8; y++) {
+		for(x = 0; x < 8; x++) scene->texture_data[y * 8 + x] = (x + y) % 2 ? 0x00 : 0xFF;
+	}
+	SoftTexture texture = {8, 8, 1, 8, SOFT_NEAREST, scene->texture_data};
+	scene->texture = texture;
+	scene->state.texture_mode = SOFT_TEXTURE_ALPHA;
+	return true;
+}
+
+static bool image_scene(Scene* scene)
+{
+	textured_quad(scene);
+	scene->width = scene->height = 350;
+	return load_png_texture(scene, "../textures/image.png", SOFT_LINEAR);
+}
+
+static bool icons_scene(Scene* scene)
+{
+	textured_quad(scene);
+	scene->width = scene->height = 350;
+	// icon 0 of the 4x4 set, picked like the vertex shader of icons.c does
+	int i;
+	for(i = 0; i < 4; i++) {
+		scene->vertices[i].u = scene->vertices[i].u * 0.25;
+		scene->vertices[i].v = 0.75 + scene->vertices[i].v * 0.25;
+	}
+	return load_png_texture(scene, "../textures/icons.png", SOFT_LINEAR);
+}
+
+static bool glyph_scene(Scene* scene)
+{
+	textured_quad(scene);
+	scene->width = scene->height = 350;
+
+	// the 'a' of font_character, 46 pixels high
+	FT_Library library;
+	FT_Face face;
+	if(FT_Init_FreeType(&library)) {
+		fprintf(stderr, "Freetype Error!\n");
+		return false;
+	}
+	if(FT_New_Face(library, FONT_FILE, 0, &face)) {
+		fprintf(stderr, "Freetype could not load face '%s'\n", FONT_FILE);
+		FT_Done_FreeType(library);
+		return false;
+	}
+	FT_Set_Pixel_Sizes(face, 0, 46);
+	bool ok = !FT_Load_Char(face, 'a', FT_LOAD_RENDER) && face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_GRAY;
+	if(ok) {
+		FT_Bitmap* bmp = &face->glyph->bitmap;
+		scene->texture_data = malloc((size_t) bmp->width * bmp->rows);
+		ok = scene->texture_data != NULL;
+		unsigned int row;
+		for(row = 0; ok && row < bmp->rows; row++) {
+			memcpy(scene->texture_data + row * bmp->width, bmp->buffer + row * bmp->pitch, bmp->width);
+		}
+		SoftTexture texture = {bmp->width, bmp->rows, 1, bmp->width, SOFT_NEAREST, scene->texture_data};
+		scene->texture = texture;
+		scene->state.texture_mode = SOFT_TEXTURE_ALPHA;
+	}
+	else fprintf(stderr, "Freetype could not render the glyph\n");
+	FT_Done_FreeType(library); // also releases the face
+	return ok;
+}
+
+static struct {
+	const char* name;
+	bool (*create)(Scene* scene);
+} scenes[] = {
+	{"triangle", triangle_scene},
+	{"checkerboard", checkerboard_scene},
+	{"image", image_scene},
+	{"icons", icons_scene},
+	{"glyph", glyph_scene}
+};
+#define NUM_SCENES (sizeof(scenes) / sizeof(scenes[0]))
+
+// seconds
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void draw(SoftRasterizer* raster, const Scene* scene)
+{
+	soft_clear(raster, 0.0, 0.0, 0.0, 0.0);
+	int i;
+	for(i = 0; i < workload; i++) {
+		soft_draw(raster, scene->primitive, scene->vertices, scene->num_vertices, &scene->state);
+	}
+	soft_flush(raster);
+}
+
+static bool run_scene(const char* name, bool (*create)(Scene* scene))
+{
+	Scene scene;
+	memset(&scene, 0, sizeof(Scene));
+	scene.name = name;
+	if(!create(&scene)) {
+		free(scene.texture_data);
+		return false;
+	}
+	SoftRasterizer* raster = soft_rasterizer_create(scene.width, scene.height, num_threads);
+	if(!raster) {
+		free(scene.texture_data);
+		return false;
+	}
+
+	// one warmup frame, for first allocations
+	draw(raster, &scene);
+	unsigned long long fragments = soft_fragments(raster);
+
+	double start = now();
+	int i;
+	for(i = 0; i < num_frames; i++) draw(raster, &scene);
+	double elapsed = now() - start;
+	fragments = soft_fragments(raster) - fragments;
+
+	printf("%-13s %dx%d  %8.3f ms per frame  %8.1f frames per second  %8.1f Mpixels/s\n", name, scene.width, scene.height,
+		elapsed * 1000.0 / num_frames, num_frames / elapsed, fragments / elapsed / 1e6);
+
+	bool ok = true;
+	if(output_dir) {
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/%s.png", output_dir, name);
+		unsigned int error = lodepng_encode32_file(path, soft_pixels(raster), scene.width, scene.height);
+		if(error) {
+			fprintf(stderr, "Error saving image file '%s' %u: %s\n", path, error, lodepng_error_text(error));
+			ok = false;
+		}
+	}
+
+	soft_rasterizer_destroy(raster);
+	free(scene.texture_data);
+	return ok;
+}
+
+// main
+
+int main(int argc, char** argv)
+{
+	const char* only = NULL;
+	int i;
+	for(i = 1; i < argc; i++) {
+		if(!strcmp(argv[i], "--scene") && i+1 < argc) only = argv[++i];
+		else if(!strcmp(argv[i], "--frames") && i+1 < argc) num_frames = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--threads") && i+1 < argc) num_threads = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--workload") && i+1 < argc) workload = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--output-dir") && i+1 < argc) output_dir = argv[++i];
+		else {
+			fprintf(stderr, "Usage: %s [--scene NAME] [--frames N] [--threads N] [--workload N] [--output-dir dir]\n", argv[0]);
+			exit(-1);
+		}
+	}
+	if(num_frames < 1 || workload < 1) {
+		fprintf(stderr, "--frames and --workload must be positive\n");
+		exit(-1);
+	}
+
+	bool ok = true, found = false;
+	unsigned int s;
+	for(s = 0; s < NUM_SCENES; s++) {
+		if(only && strcmp(only, scenes[s].name) != 0) continue;
+		found = true;
+		ok = run_scene(scenes[s].name, scenes[s].create) && ok;
+	}
+	if(!found) {
+		fprintf(stderr, "Unknown scene '%s'\n", only);
+		exit(-1);
+	}
+	exit(ok ? 0 : -1);
+}
@@ -0,0 +1,340 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Hot reload of changed assets
+ *
+ * See asset_watch.h for usage.
+ */
+
+#include "asset_watch.h"
+#include "gl_state.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+typedef enum { false, true } bool;
+
+#define EVENT_BUFFER_SIZE 4096
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO) // the file is complete, whether written or renamed in place
+
+typedef struct {
+	char* path;
+	const char* name;            // file name part of 'path'
+	int wd;                      // inotify watch of its directory
+	const AssetHandler* handler;
+	void* data;
+
+	bool changed;                // written since it was last loaded
+	bool pending;                // 'loaded' waits for asset_watch_apply()
+	void* loaded;
+} Asset;
+
+struct AssetWatch {
+	int inotify_fd;
+	int wake_fds[2];             // a pipe, wakes the thread to quit or to load changes made while pending
+	pthread_t thread;
+	bool thread_started;
+
+	pthread_mutex_t mutex;
+	Asset* assets;
+	int count, capacity;
+	bool quit;
+
+	void (*callback)(void* data);
+	void* callback_data;
+
+	// statistics
+	unsigned long loads, failed, applied;
+	double load_ms, apply_ms;
+};
+
+static double now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int asset_watch_parse_args(int argc, char** argv)
+{
+	int i;
+	for(i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--watch") == 0) return true;
+	}
+	return false;
+}
+
+// flags the assets a batch of inotify events is about, under the mutex
+static void mark_changed(AssetWatch* watch, const char* buffer, ssize_t size)
+{
+	const char* p = buffer;
+	while(p < buffer + size) {
+		const struct inotify_event* event = (const struct inotify_event*) p;
+		int i;
+		if(event->len && (event->mask & WATCH_MASK)) {
+			for(i = 0; i < watch->count; i++) {
+				Asset* asset = &watch->assets[i];
+				if(asset->wd == event->wd && strcmp(asset->name, event->name) == 0) asset->changed = true;
+			}
+		}
+		p += sizeof(struct inotify_event) + event->len;
+	}
+}
+
+// loads every changed asset that is not waiting to be applied. called and returns with the mutex locked
+static bool load_changed(AssetWatch* watch)
+{
+	bool loaded_any = false;
+	int i;
+	for(i = 0; i < watch->count && !watch->quit; i++) {
+		Asset* asset = &watch->assets[i];
+		if(!asset->changed || asset->pending) continue;
+		asset->changed = false;
+
+		// the array may grow while the mutex is released, only copies are used
+		char* path = asset->path;
+		const AssetHandler* handler = asset->handler;
+		void* data = asset->data;
+		pthread_mutex_unlock(&watch->mutex);
+		double start = now_ms();
+		void* loaded = handler->load(path, data);
+		double elapsed = now_ms() - start;
+		pthread_mutex_lock(&watch->mutex);
+
+		asset = &watch->assets[i];
+		watch->loads++;
+		watch->load_ms += elapsed;
+		if(!loaded) {
+			// eg. a half written file, the next write tries again
+			watch->failed++;
+			continue;
+		}
+		asset->loaded = loaded;
+		asset->pending = true;
+		loaded_any = true;
+	}
+	return loaded_any;
+}
+
+static void* watch_main(void* arg)
+{
+	AssetWatch* watch = arg;
+	char buffer[EVENT_BUFFER_SIZE] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+	for(;;) {
+		struct pollfd fds[2] = { { watch->inotify_fd, POLLIN, 0 }, { watch->wake_fds[0], POLLIN, 0 } };
+		if(poll(fds, 2, -1) < 0 && errno != EINTR) {
+			fprintf(stderr, "Asset watch: poll failed, %s\n", strerror(errno));
+			return NULL;
+		}
+
+		if(fds[1].revents & POLLIN) {
+			char wake[16];
+			if(read(watch->wake_fds[0], wake, sizeof(wake)) < 0) { /* nothing to do, poll again */ }
+		}
+		ssize_t size = 0;
+		if(fds[0].revents & POLLIN) size = read(watch->inotify_fd, buffer, sizeof(buffer));
+
+		pthread_mutex_lock(&watch->mutex);
+		if(watch->quit) {
+			pthread_mutex_unlock(&watch->mutex);
+			return NULL;
+		}
+		if(size > 0) mark_changed(watch, buffer, size);
+		bool loaded = load_changed(watch);
+		void (*callback)(void*) = watch->callback;
+		void* callback_data = watch->callback_data;
+		pthread_mutex_unlock(&watch->mutex);
+
+		if(loaded && callback) callback(callback_data);
+	}
+}
+
+AssetWatch* asset_watch_create()
+{
+	AssetWatch* watch = calloc(1, sizeof(AssetWatch));
+	if(!watch) return NULL;
+	watch->wake_fds[0] = watch->wake_fds[1] = -1;
+	pthread_mutex_init(&watch->mutex, NULL);
+
+	watch->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(watch->inotify_fd < 0 || pipe(watch->wake_fds) != 0
+	   || fcntl(watch->wake_fds[0], F_SETFL, O_NONBLOCK) != 0 || fcntl(watch->wake_fds[1], F_SETFL, O_NONBLOCK) != 0) {
+		fprintf(stderr, "Asset watch: could not create the inotify instance, %s\n", strerror(errno));
+		asset_watch_destroy(watch);
+		return NULL;
+	}
+	if(pthread_create(&watch->thread, NULL, watch_main, watch) != 0) {
+		fprintf(stderr, "Asset watch: could not start the watch thread\n");
+		asset_watch_destroy(watch);
+		return NULL;
+	}
+	watch->thread_started = true;
+	return watch;
+}
+
+static void wake(AssetWatch* watch)
+{
+	if(write(watch->wake_fds[1], "w", 1) < 0) { /* the pipe is full, it is awake already */ }
+}
+
+void asset_watch_destroy(AssetWatch* watch)
+{
+	int i;
+	if(!watch) return;
+
+	if(watch->thread_started) {
+		pthread_mutex_lock(&watch->mutex);
+		watch->quit = true;
+		pthread_mutex_unlock(&watch->mutex);
+		wake(watch);
+		pthread_join(watch->thread, NULL);
+	}
+
+	for(i = 0; i < watch->count; i++) {
+		Asset* asset = &watch->assets[i];
+		if(asset->pending) {
+			if(asset->handler->discard) asset->handler->discard(asset->loaded, asset->data);
+			else free(asset->loaded);
+		}
+		free(asset->path);
+	}
+	free(watch->assets);
+	if(watch->inotify_fd >= 0) close(watch->inotify_fd); // also removes the watches
+	if(watch->wake_fds[0] >= 0) close(watch->wake_fds[0]);
+	if(watch->wake_fds[1] >= 0) close(watch->wake_fds[1]);
+	pthread_mutex_destroy(&watch->mutex);
+	free(watch);
+}
+
+void asset_watch_set_callback(AssetWatch* watch, void (*callback)(void* data), void* data)
+{
+	pthread_mutex_lock(&watch->mutex);
+	watch->callback = callback;
+	watch->callback_data = data;
+	pthread_mutex_unlock(&watch->mutex);
+}
+
+int asset_watch_add(AssetWatch* watch, const char* path, const AssetHandler* handler, void* data)
+{
+	char* copy = strdup(path);
+	char* dir = strdup(path);
+	if(!copy || !dir) {
+		free(copy);
+		free(dir);
+		return false;
+	}
+
+	// the directory, "." for a bare file name
+	char* slash = strrchr(dir, '/');
+	const char* name = strrchr(copy, '/') ? strrchr(copy, '/') + 1 : copy;
+	if(slash == dir) slash[1] = '\0';
+	else if(slash) *slash = '\0';
+	else strcpy(dir, ".");
+
+	int wd = inotify_add_watch(watch->inotify_fd, dir, WATCH_MASK | IN_ONLYDIR);
+	if(wd < 0) {
+		fprintf(stderr, "Asset watch: could not watch '%s', %s\n", dir, strerror(errno));
+		free(copy);
+		free(dir);
+		return false;
+	}
+	free(dir);
+
+	pthread_mutex_lock(&watch->mutex);
+	if(watch->count == watch->capacity) {
+		int capacity = watch->capacity ? watch->capacity * 2 : 8;
+		Asset* assets = realloc(watch->assets, capacity * sizeof(Asset));
+		if(!assets) {
+			pthread_mutex_unlock(&watch->mutex);
+			free(copy);
+			return false;
+		}
+		watch->assets = assets;
+		watch->capacity = capacity;
+	}
+	Asset* asset = &watch->assets[watch->count++];
+	memset(asset, 0, sizeof(Asset));
+	asset->path = copy;
+	asset->name = name;
+	asset->wd = wd;
+	asset->handler = handler;
+	asset->data = data;
+	pthread_mutex_unlock(&watch->mutex);
+	return true;
+}
+
+int asset_watch_apply(AssetWatch* watch)
+{
+	int i, applied = 0;
+	bool changed_since = false;
+
+	pthread_mutex_lock(&watch->mutex);
+	for(i = 0; i < watch->count; i++) {
+		Asset* asset = &watch->assets[i];
+		if(!asset->pending) continue;
+		void* loaded = asset->loaded;
+		char* path = asset->path;
+		const AssetHandler* handler = asset->handler;
+		void* data = asset->data;
+		asset->pending = false;
+		asset->loaded = NULL;
+		pthread_mutex_unlock(&watch->mutex);
+
+		double start = now_ms();
+		handler->apply(path, loaded, data);
+		double elapsed = now_ms() - start;
+
+		pthread_mutex_lock(&watch->mutex);
+		watch->applied++;
+		watch->apply_ms += elapsed;
+		if(watch->assets[i].changed) changed_since = true;
+		applied++;
+	}
+	pthread_mutex_unlock(&watch->mutex);
+
+	// written again while it was waiting, the thread loads it now that it is free
+	if(changed_since) wake(watch);
+	if(applied) gl_state_invalidate();
+	return applied;
+}
+
+void asset_watch_print_stats(AssetWatch* watch)
+{
+	pthread_mutex_lock(&watch->mutex);
+	printf("Asset watch: %lu reloads applied, %lu loads failed, %.3f ms loading and %.3f ms applying per reload\n",
+	       watch->applied, watch->failed,
+	       watch->loads ? watch->load_ms / watch->loads : 0.0,
+	       watch->applied ? watch->apply_ms / watch->applied : 0.0);
+	pthread_mutex_unlock(&watch->mutex);
+}
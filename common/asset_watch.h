@@ -0,0 +1,89 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Hot reload of changed assets
+ *
+ * Watches asset files with inotify, so that an edited PNG or shader shows up in the running
+ * example instead of after a restart. A background thread waits for the files to be written,
+ * and loads what changed right away, eg. decodes the PNG, off the render loop. Nothing touches
+ * GL there: the loaded assets wait until the GL thread calls asset_watch_apply() between
+ * frames, which hands each one to its handler to re-upload or relink:
+ *
+ *   static void* load_image(const char* path, void* data);                  // watch thread
+ *   static void apply_image(const char* path, void* loaded, void* data);    // GL thread
+ *   static const AssetHandler image_handler = { load_image, apply_image, NULL };
+ *
+ *   if(asset_watch_parse_args(argc, argv)) watch = asset_watch_create();
+ *   asset_watch_set_callback(watch, asset_changed_cb, NULL); // eg. redraw_post()
+ *   asset_watch_add(watch, "image.png", &image_handler, texture);
+ *   ...
+ *   // every frame, before display()
+ *   asset_watch_apply(watch);
+ *
+ * Only the assets whose files changed are loaded and applied again, each on its own: a texture
+ * keeps its name and is updated in place, a program is relinked from its own sources only.
+ * Changes made while an asset waits to be applied are loaded again after it is.
+ *
+ * The directory of each file is watched, not the file itself, so that editors saving through a
+ * new file and a rename are seen too. Files are picked up when they are closed after writing,
+ * or moved in place. Appliers may bind anything, the state cache (gl_state.h) is invalidated
+ * after them.
+ *
+ * Linux only, inotify.
+ */
+
+#ifndef OPENGL_PLAYGROUND_ASSET_WATCH_H
+#define OPENGL_PLAYGROUND_ASSET_WATCH_H
+
+typedef struct AssetWatch AssetWatch;
+
+typedef struct {
+	// on the watch thread, when the file changed. returns the loaded asset, NULL if it could not be loaded
+	void* (*load)(const char* path, void* data);
+	// on the GL thread, in asset_watch_apply(). 'loaded' belongs to it from then on
+	void (*apply)(const char* path, void* loaded, void* data);
+	// releases a loaded asset that was never applied, when the watch is destroyed. NULL uses free()
+	void (*discard)(void* loaded, void* data);
+} AssetHandler;
+
+// returns true when --watch was given, ignoring any other flags
+int asset_watch_parse_args(int argc, char** argv);
+
+// starts the watch thread. returns NULL on failure
+AssetWatch* asset_watch_create();
+void asset_watch_destroy(AssetWatch* watch);
+// 'callback' is called on the watch thread when a loaded asset is waiting to be applied, eg. to wake the render loop
+void asset_watch_set_callback(AssetWatch* watch, void (*callback)(void* data), void* data);
+
+// watches 'path', loading and applying it with 'handler' when it changes. 'handler' and 'data' must outlive
+// the watch. the same handler can be added for several files, eg. both shaders of a program. returns 0 on failure
+int asset_watch_add(AssetWatch* watch, const char* path, const AssetHandler* handler, void* data);
+
+// applies the assets loaded since the last call, on the GL thread between frames. returns how many
+int asset_watch_apply(AssetWatch* watch);
+// prints the assets reloaded, and the time spent loading and applying them
+void asset_watch_print_stats(AssetWatch* watch);
+
+#endif // OPENGL_PLAYGROUND_ASSET_WATCH_H
@@ -0,0 +1,362 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Batched 2D quad renderer
+ *
+ * See batch2d.h for usage.
+ */
+
+#include "batch2d.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "shader.h"
+#include "gl_state.h"
+
+typedef enum { false, true } bool;
+
+#define BATCH2D_NUM_REGIONS 3 // enough for the GPU to be working on a region while we write the next one
+
+// attribute locations, fixed in the shader
+enum {
+	ATTR_VPOS = 0,
+	ATTR_VTEX = 1,
+	ATTR_VCOLOR = 2
+};
+
+// sort key, most significant first: layer (8 bits), program (20 bits), texture (28 bits), blend (8 bits).
+// names that don't fit only make the grouping less effective, the draw loop compares the real state
+static uint64_t sort_key(int layer, GLuint program, GLuint texture, Batch2DBlend blend)
+{
+	return ((uint64_t) (layer & 0xFF) << 56)
+	     | ((uint64_t) (program & 0xFFFFF) << 36)
+	     | ((uint64_t) (texture & 0xFFFFFFF) << 8)
+	     | (uint64_t) (blend & 0xFF);
+}
+
+static int compare_sort_entries(const void* a, const void* b)
+{
+	const Batch2DSortEntry* ea = a;
+	const Batch2DSortEntry* eb = b;
+	if(ea->key != eb->key) return ea->key < eb->key ? -1 : 1;
+	// qsort is not stable, the submission order breaks ties
+	return (ea->quad > eb->quad) - (ea->quad < eb->quad);
+}
+
+static void apply_blend(Batch2DBlend blend)
+{
+	switch(blend) {
+		case BATCH2D_BLEND_NONE:
+			gl_state_blend(false);
+			return;
+		case BATCH2D_BLEND_ALPHA:
+			gl_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			break;
+		case BATCH2D_BLEND_PREMULTIPLIED:
+			gl_state_blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+			break;
+		case BATCH2D_BLEND_ADDITIVE:
+			gl_state_blend_func(GL_SRC_ALPHA, GL_ONE);
+			break;
+	}
+	gl_state_blend(true);
+}
+
+int batch2d_init(Batch2D* b, int max_quads)
+{
+	memset(b, 0, sizeof(*b));
+	b->region_quads = max_quads;
+	b->sort_enabled = true;
+
+	const char *vs_source =
+	"#version 330\n"
+	"layout (location = 0) in vec2 v_pos;\n"
+	"layout (location = 1) in vec2 v_tex;\n"
+	"layout (location = 2) in vec4 v_color;\n"
+	"out vec2 vs_tex_coord;\n"
+	"out vec4 vs_color;\n"
+	"void main(void) {\n"
+	"  gl_Position = vec4(v_pos, 0.0, 1.0);\n"
+	"  vs_tex_coord = v_tex;\n"
+	"  vs_color = v_color;\n"
+	"}\n";
+
+	const char *fs_source =
+	"#version 330\n"
+	"uniform sampler2D tex;\n"
+	"in vec2 vs_tex_coord;\n"
+	"in vec4 vs_color;\n"
+	"layout (location = 0) out vec4 color;\n"
+	"void main(void) {\n"
+	"  color = texture(tex, vs_tex_coord) * vs_color;\n"
+	"}\n";
+
+	b->default_program = create_program(vs_source, fs_source);
+	if(!b->default_program) return false;
+
+	// 1x1 white texture, so that untextured quads are just their color
+	static const GLubyte white[] = { 0xFF, 0xFF, 0xFF, 0xFF };
+	glGenTextures(1, &b->white_texture);
+	gl_state_bind_texture(GL_TEXTURE_2D, b->white_texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+
+	glGenVertexArrays(1, &b->vao);
+	gl_state_bind_vertex_array(b->vao);
+
+	// vertex buffer, interleaved. persistently mapped if we can
+	bool persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+	b->num_regions = persistent ? BATCH2D_NUM_REGIONS : 1;
+	GLsizeiptr buffer_size = (GLsizeiptr) b->num_regions * b->region_quads * 4 * sizeof(Batch2DVertex);
+
+	glGenBuffers(1, &b->vertex_buffer);
+	gl_state_bind_buffer(GL_ARRAY_BUFFER, b->vertex_buffer);
+	if(persistent) {
+		// coherent: writes become visible to the GPU without explicit flushes, the fences do the rest
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, buffer_size, NULL, flags);
+		b->mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, buffer_size, flags);
+		if(!b->mapped) {
+			fprintf(stderr, "Could not map the batch vertex buffer persistently\n");
+			return false;
+		}
+	}
+	else {
+		glBufferData(GL_ARRAY_BUFFER, buffer_size, NULL, GL_STREAM_DRAW);
+	}
+	b->fences = calloc(b->num_regions, sizeof(GLsync));
+
+	glEnableVertexAttribArray(ATTR_VPOS);
+	glVertexAttribPointer(ATTR_VPOS, 2, GL_FLOAT, GL_FALSE, sizeof(Batch2DVertex), (GLvoid*) offsetof(Batch2DVertex, x));
+	glEnableVertexAttribArray(ATTR_VTEX);
+	glVertexAttribPointer(ATTR_VTEX, 2, GL_FLOAT, GL_FALSE, sizeof(Batch2DVertex), (GLvoid*) offsetof(Batch2DVertex, u));
+	glEnableVertexAttribArray(ATTR_VCOLOR);
+	glVertexAttribPointer(ATTR_VCOLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Batch2DVertex), (GLvoid*) offsetof(Batch2DVertex, color));
+
+	// one index buffer for every quad the vertex buffer can hold, written once.
+	// each quad is 2 triangles: 0 1 2, 2 3 0
+	int total_quads = b->num_regions * b->region_quads;
+	GLuint* indices = malloc(total_quads * 6 * sizeof(GLuint));
+	if(!indices || !b->fences) {
+		free(indices);
+		fprintf(stderr, "Out of memory creating the batch buffers\n");
+		return false;
+	}
+	int q;
+	for(q = 0; q < total_quads; q++) {
+		GLuint v = q * 4;
+		GLuint* i = &indices[q * 6];
+		i[0] = v; i[1] = v + 1; i[2] = v + 2;
+		i[3] = v + 2; i[4] = v + 3; i[5] = v;
+	}
+	glGenBuffers(1, &b->index_buffer);
+	gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, b->index_buffer); // element buffer binding is part of the VAO state
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, total_quads * 6 * sizeof(GLuint), indices, GL_STATIC_DRAW);
+	free(indices);
+
+	return true;
+}
+
+void batch2d_free(Batch2D* b)
+{
+	int i;
+	for(i = 0; i < b->num_regions; i++) {
+		if(b->fences && b->fences[i]) glDeleteSync(b->fences[i]);
+	}
+	if(b->mapped) {
+		gl_state_bind_buffer(GL_ARRAY_BUFFER, b->vertex_buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	glDeleteBuffers(1, &b->vertex_buffer);
+	glDeleteBuffers(1, &b->index_buffer);
+	glDeleteVertexArrays(1, &b->vao);
+	glDeleteTextures(1, &b->white_texture);
+	glDeleteProgram(b->default_program);
+	gl_state_invalidate(); // some of these may still be bound
+
+	free(b->fences);
+	free(b->vertices);
+	free(b->programs);
+	free(b->textures);
+	free(b->blends);
+	free(b->sort);
+	memset(b, 0, sizeof(*b));
+}
+
+void batch2d_begin(Batch2D* b)
+{
+	b->count = 0;
+	b->layer = 0;
+}
+
+void batch2d_set_layer(Batch2D* b, int layer)
+{
+	b->layer = layer;
+}
+
+static bool grow(Batch2D* b)
+{
+	int capacity = b->capacity ? b->capacity * 2 : 1024;
+	Batch2DVertex* vertices = realloc(b->vertices, capacity * 4 * sizeof(Batch2DVertex));
+	if(vertices) b->vertices = vertices;
+	GLuint* programs = realloc(b->programs, capacity * sizeof(GLuint));
+	if(programs) b->programs = programs;
+	GLuint* textures = realloc(b->textures, capacity * sizeof(GLuint));
+	if(textures) b->textures = textures;
+	Batch2DBlend* blends = realloc(b->blends, capacity * sizeof(Batch2DBlend));
+	if(blends) b->blends = blends;
+	Batch2DSortEntry* sort = realloc(b->sort, capacity * sizeof(Batch2DSortEntry));
+	if(sort) b->sort = sort;
+
+	if(!vertices || !programs || !textures || !blends || !sort) return false;
+	b->capacity = capacity;
+	return true;
+}
+
+void batch2d_quad(Batch2D* b, GLuint program, GLuint texture, Batch2DBlend blend,
+                  GLfloat x0, GLfloat y0, GLfloat x1, GLfloat y1,
+                  GLfloat u0, GLfloat v0, GLfloat u1, GLfloat v1, GLuint color)
+{
+	if(b->count == b->capacity && !grow(b)) {
+		fprintf(stderr, "Out of memory for batched quads, dropping quad\n");
+		return;
+	}
+
+	if(!program) program = b->default_program;
+	if(!texture) texture = b->white_texture;
+
+	int q = b->count++;
+	b->programs[q] = program;
+	b->textures[q] = texture;
+	b->blends[q] = blend;
+	b->sort[q].key = sort_key(b->layer, program, texture, blend);
+	b->sort[q].quad = q;
+
+	GLubyte c[4] = { (color >> 24) & 0xFF, (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF };
+	Batch2DVertex* v = &b->vertices[q * 4];
+	v[0].x = x0; v[0].y = y0; v[0].u = u0; v[0].v = v0;
+	v[1].x = x1; v[1].y = y0; v[1].u = u1; v[1].v = v0;
+	v[2].x = x1; v[2].y = y1; v[2].u = u1; v[2].v = v1;
+	v[3].x = x0; v[3].y = y1; v[3].u = u0; v[3].v = v1;
+	memcpy(v[0].color, c, 4);
+	memcpy(v[1].color, c, 4);
+	memcpy(v[2].color, c, 4);
+	memcpy(v[3].color, c, 4);
+}
+
+// returns where to write the next 'num_quads' quads, and the index of the first of them in the vertex buffer
+static Batch2DVertex* map_region(Batch2D* b, int num_quads, int* first_quad)
+{
+	if(!b->mapped) {
+		// orphan the buffer so the driver can hand us fresh memory instead of waiting for the GPU
+		*first_quad = 0;
+		return glMapBufferRange(GL_ARRAY_BUFFER, 0, num_quads * 4 * sizeof(Batch2DVertex),
+		                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	}
+
+	GLsync fence = b->fences[b->region];
+	if(fence) {
+		// only blocks if the GPU is still reading this region, num_regions flushes ago
+		while(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+		glDeleteSync(fence);
+		b->fences[b->region] = NULL;
+	}
+	*first_quad = b->region * b->region_quads;
+	return b->mapped + *first_quad * 4;
+}
+
+// fences the region just drawn from and moves on to the next one
+static void release_region(Batch2D* b)
+{
+	b->fences[b->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	b->region = (b->region + 1) % b->num_regions;
+}
+
+void batch2d_flush(Batch2D* b)
+{
+	memset(&b->stats, 0, sizeof(b->stats));
+	if(b->count == 0) return;
+	b->stats.quads = b->count;
+
+	if(b->sort_enabled) {
+		qsort(b->sort, b->count, sizeof(Batch2DSortEntry), compare_sort_entries);
+	}
+	else {
+		int q;
+		for(q = 0; q < b->count; q++) b->sort[q].quad = q;
+	}
+
+	// bindings go through the state cache, so consecutive flushes do not bind them again
+	gl_state_bind_vertex_array(b->vao);
+	gl_state_bind_buffer(GL_ARRAY_BUFFER, b->vertex_buffer);
+	gl_state_active_texture(GL_TEXTURE0);
+
+	GLuint current_program = 0, current_texture = 0;
+	int current_blend = -1;
+	int done = 0;
+	while(done < b->count) {
+		int num_quads = b->count - done;
+		if(num_quads > b->region_quads) num_quads = b->region_quads;
+
+		int first_quad, i;
+		Batch2DVertex* dst = map_region(b, num_quads, &first_quad);
+		if(!dst) {
+			fprintf(stderr, "Could not map the batch vertex buffer\n");
+			break;
+		}
+		for(i = 0; i < num_quads; i++) {
+			memcpy(&dst[i * 4], &b->vertices[b->sort[done + i].quad * 4], 4 * sizeof(Batch2DVertex));
+		}
+		if(!b->mapped) glUnmapBuffer(GL_ARRAY_BUFFER);
+
+		// one draw call per run of quads with the same state
+		int run_start = 0;
+		for(i = 0; i < num_quads; i++) {
+			int q = b->sort[done + i].quad;
+			if(b->programs[q] != current_program || b->textures[q] != current_texture || (int) b->blends[q] != current_blend) {
+				if(i > run_start) {
+					glDrawElements(GL_TRIANGLES, (i - run_start) * 6, GL_UNSIGNED_INT,
+					               (GLvoid*) ((size_t) (first_quad + run_start) * 6 * sizeof(GLuint)));
+					b->stats.draw_calls++;
+					b->stats.state_changes++;
+				}
+				run_start = i;
+				if(b->programs[q] != current_program) gl_state_use_program(current_program = b->programs[q]);
+				if(b->textures[q] != current_texture) gl_state_bind_texture(GL_TEXTURE_2D, current_texture = b->textures[q]);
+				if((int) b->blends[q] != current_blend) apply_blend(current_blend = b->blends[q]);
+			}
+		}
+		glDrawElements(GL_TRIANGLES, (num_quads - run_start) * 6, GL_UNSIGNED_INT,
+		               (GLvoid*) ((size_t) (first_quad + run_start) * 6 * sizeof(GLuint)));
+		b->stats.draw_calls++;
+
+		if(b->mapped) release_region(b);
+		done += num_quads;
+	}
+}
@@ -0,0 +1,128 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Batched 2D quad renderer
+ *
+ * Quads are queued with the program, texture and blend mode they need. On flush, they are
+ * sorted by that state, written interleaved (position, texture coords, color) into one vertex
+ * buffer, and drawn with one glDrawElements per run of quads that share the same state.
+ * All draws use the same static index buffer, so only 4 vertices are written per quad.
+ *
+ * With OpenGL 4.4 or ARB_buffer_storage the vertex buffer is persistently mapped and split
+ * in regions that are reused round robin, each guarded by a fence, so writing never waits on the GPU.
+ * Otherwise the buffer is orphaned and mapped again for every flush.
+ *
+ * Sorting reorders quads with different state. Quads that must be drawn on top of others
+ * go in a higher layer with batch2d_set_layer(), the layer is the most significant part of the sort key.
+ * Quads with the same key keep the order in which they were queued.
+ *
+ * Custom programs must use the same attribute locations as the default program:
+ *   layout (location = 0) in vec2 v_pos;
+ *   layout (location = 1) in vec2 v_tex;
+ *   layout (location = 2) in vec4 v_color;
+ * and sample the texture from texture unit 0.
+ *
+ * Bindings go through the state cache (gl_state.h) and are left in place after a flush, so that
+ * the next flush does not bind them again.
+ *
+ * Requires OpenGL 3.3.
+ */
+
+#ifndef OPENGL_PLAYGROUND_BATCH2D_H
+#define OPENGL_PLAYGROUND_BATCH2D_H
+
+#include <GL/glew.h>
+#include <stdint.h>
+
+typedef enum {
+	BATCH2D_BLEND_NONE,
+	BATCH2D_BLEND_ALPHA,         // GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, like the examples
+	BATCH2D_BLEND_PREMULTIPLIED, // GL_ONE, GL_ONE_MINUS_SRC_ALPHA
+	BATCH2D_BLEND_ADDITIVE       // GL_SRC_ALPHA, GL_ONE
+} Batch2DBlend;
+
+// interleaved vertex, as laid out in the vertex buffer
+typedef struct {
+	GLfloat x, y;
+	GLfloat u, v;
+	GLubyte color[4];
+} Batch2DVertex;
+
+typedef struct {
+	uint64_t key;
+	uint32_t quad; // index in the queued quads, keeps the submission order for equal keys
+	uint32_t pad;
+} Batch2DSortEntry;
+
+// counters of the last flush
+typedef struct {
+	int quads;
+	int draw_calls;
+	int state_changes; // program, texture or blend changes between consecutive draw calls
+} Batch2DStats;
+
+typedef struct {
+	GLuint default_program;
+	GLuint white_texture;    // bound for quads without a texture
+	GLuint vao, vertex_buffer, index_buffer;
+
+	// GPU side: 'num_regions' regions of 'region_quads' quads each
+	int region_quads;
+	int num_regions;
+	int region;              // region written by the next flush
+	GLsync* fences;          // one per region, NULL when the region is free
+	Batch2DVertex* mapped;   // persistent mapping of the whole vertex buffer, NULL when not supported
+
+	// CPU side: quads queued since batch2d_begin()
+	Batch2DVertex* vertices; // 4 per quad
+	GLuint* programs;        // state of each quad, to undo the key packing
+	GLuint* textures;
+	Batch2DBlend* blends;
+	Batch2DSortEntry* sort;
+	int count, capacity;
+	int layer;
+	int sort_enabled;        // on by default. off draws in submission order, to compare
+
+	Batch2DStats stats;
+} Batch2D;
+
+// 'max_quads' is how many quads are written to the GPU at once. returns 0 on failure
+int batch2d_init(Batch2D* b, int max_quads);
+void batch2d_free(Batch2D* b);
+
+// starts a new batch, forgetting the queued quads
+void batch2d_begin(Batch2D* b);
+// quads queued after this are drawn after quads in lower layers, regardless of their state. 0 to 255
+void batch2d_set_layer(Batch2D* b, int layer);
+// queues an axis aligned quad from (x0, y0) to (x1, y1) in normalized device coordinates.
+// 'program' 0 uses the default program, 'texture' 0 a white texture. 'color' is 0xRRGGBBAA and is multiplied with the texture
+void batch2d_quad(Batch2D* b, GLuint program, GLuint texture, Batch2DBlend blend,
+                  GLfloat x0, GLfloat y0, GLfloat x1, GLfloat y1,
+                  GLfloat u0, GLfloat v0, GLfloat u1, GLfloat v1, GLuint color);
+// sorts and draws everything queued since batch2d_begin(), and updates 'stats'.
+// leaves the blend state as needed by the last quad drawn
+void batch2d_flush(Batch2D* b);
+
+#endif // OPENGL_PLAYGROUND_BATCH2D_H
@@ -0,0 +1,152 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Fixed workload benchmark mode for the examples
+ *
+ * See benchmark.h for usage.
+ */
+
+#include "benchmark.h"
+#include "gl_state.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+typedef enum { false, true } bool;
+
+static double now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+void benchmark_parse_args(BenchmarkOptions* options, int argc, char** argv)
+{
+	options->start_ms = now_ms();
+	options->enabled = false;
+	options->warmup_frames = 10;
+	options->frames = 100;
+	options->workload = 1;
+	options->report = NULL;
+
+	int i;
+	for(i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--benchmark") == 0) options->enabled = true;
+		else if(strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) options->warmup_frames = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc) options->frames = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--workload") == 0 && i + 1 < argc) options->workload = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--report") == 0 && i + 1 < argc) options->report = argv[++i];
+	}
+	if(options->warmup_frames < 0) options->warmup_frames = 0;
+	if(options->frames < 1) options->frames = 1;
+	if(options->workload < 1) options->workload = 1;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+	double x = *(const double*) a, y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+// prints a JSON string, escaping what GL_RENDERER strings may contain
+static void write_json_string(FILE* file, const char* s)
+{
+	fputc('"', file);
+	for(; s && *s; s++) {
+		if(*s == '"' || *s == '\\') fprintf(file, "\\%c", *s);
+		else if((unsigned char) *s < 0x20) fprintf(file, "\\u%04x", *s);
+		else fputc(*s, file);
+	}
+	fputc('"', file);
+}
+
+int benchmark_run(const BenchmarkOptions* options, const char* name, void (*display)(), void (*present)())
+{
+	double* times = malloc(options->frames * sizeof(double));
+	if(!times) return false;
+
+	double startup_ms = now_ms() - options->start_ms;
+	double first_frame_ms = 0;
+	int i;
+	GLStateStats before = gl_state_stats();
+	for(i = -options->warmup_frames; i < options->frames; i++) {
+		if(i == 0) before = gl_state_stats();
+		double start = now_ms();
+		display();
+		if(present) present();
+		else glFinish(); // nothing to wait on offscreen, time the rendering itself
+		double elapsed = now_ms() - start;
+
+		if(i == -options->warmup_frames) first_frame_ms = elapsed; // shader compiles, first uploads...
+		if(i >= 0) times[i] = elapsed;
+	}
+	GLStateStats after = gl_state_stats();
+	unsigned long state_frames = after.frames - before.frames;
+
+	double total = 0;
+	for(i = 0; i < options->frames; i++) total += times[i];
+	qsort(times, options->frames, sizeof(double), compare_doubles);
+	double median = options->frames % 2 ? times[options->frames / 2]
+	                : (times[options->frames / 2 - 1] + times[options->frames / 2]) / 2;
+	double p99 = times[(options->frames - 1) * 99 / 100];
+
+	FILE* file = options->report ? fopen(options->report, "w") : stdout;
+	if(!file) {
+		fprintf(stderr, "Could not write benchmark report '%s'\n", options->report);
+		free(times);
+		return false;
+	}
+	fprintf(file, "{\n  \"example\": ");
+	write_json_string(file, name);
+	fprintf(file, ",\n  \"renderer\": ");
+	write_json_string(file, (const char*) glGetString(GL_RENDERER));
+	fprintf(file, ",\n  \"gl_version\": ");
+	write_json_string(file, (const char*) glGetString(GL_VERSION));
+	fprintf(file, ",\n  \"offscreen\": %s,\n", present ? "false" : "true");
+	fprintf(file, "  \"workload\": %d,\n  \"warmup_frames\": %d,\n  \"frames\": %d,\n",
+	        options->workload, options->warmup_frames, options->frames);
+	fprintf(file, "  \"startup_ms\": %.3f,\n  \"first_frame_ms\": %.3f,\n", startup_ms, first_frame_ms);
+	fprintf(file, "  \"frame_ms\": {\"min\": %.4f, \"median\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"mean\": %.4f}",
+	        times[0], median, p99, times[options->frames - 1], total / options->frames);
+	if(state_frames) {
+		// only for examples that count their GL calls with gl_state_next_frame()
+		fprintf(file, ",\n  \"gl_state\": {\"issued_per_frame\": %.1f, \"skipped_per_frame\": %.1f, "
+		        "\"frame_issued\": %lu, \"frame_skipped\": %lu}",
+		        (double) (after.issued - before.issued) / state_frames, (double) (after.skipped - before.skipped) / state_frames,
+		        after.frame_issued, after.frame_skipped);
+	}
+	fprintf(file, "\n}\n");
+	free(times);
+
+	bool ok = true;
+	if(options->report) {
+		ok = fclose(file) == 0;
+		if(ok) printf("Wrote benchmark report to '%s'\n", options->report);
+	}
+	return ok;
+}
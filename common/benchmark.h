@@ -0,0 +1,72 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Fixed workload benchmark mode for the examples
+ *
+ * Runs a fixed number of frames as fast as possible instead of looping until the window closes,
+ * and reports frame times in JSON so that runs can be compared, eg. to catch regressions:
+ *   --benchmark         benchmark instead of running interactively
+ *   --warmup N          frames drawn before measuring, 10 by default
+ *   --frames N          measured frames, 100 by default
+ *   --workload N        multiplies the work of each frame (draw calls, quads, glyphs), 1 by default
+ *   --report file.json  where the report goes, stdout by default
+ *
+ * The report has the startup time (from benchmark_parse_args() to the first frame), the time
+ * of the first frame, and the min, median, p99 and max frame times. Each frame is timed from
+ * the start of 'display' to the end of 'present': the swap for a window, which must not wait
+ * for vsync (glfwSwapInterval(0)), or glFinish() when 'present' is NULL, eg. with --headless.
+ * Examples that call gl_state_next_frame() also get the GL calls issued and skipped by gl_state.c,
+ * per measured frame on average and in the last frame.
+ *
+ *   BenchmarkOptions benchmark;
+ *   benchmark_parse_args(&benchmark, argc, argv);  // first thing in main()
+ *   ... create the context, init()
+ *   if(benchmark.enabled) exit(benchmark_run(&benchmark, "minimal", display, present) ? 0 : -1);
+ *
+ * Requires a current OpenGL context when running.
+ */
+
+#ifndef OPENGL_PLAYGROUND_BENCHMARK_H
+#define OPENGL_PLAYGROUND_BENCHMARK_H
+
+#include <GL/glew.h>
+
+typedef struct {
+	int enabled;             // --benchmark was given
+	int warmup_frames;
+	int frames;
+	int workload;            // always at least 1, examples can read it without checking 'enabled'
+	const char* report;      // NULL for stdout
+	double start_ms;         // when the arguments were parsed, the startup time is measured from here
+} BenchmarkOptions;
+
+// reads the flags above, ignoring any others, and starts the startup clock
+void benchmark_parse_args(BenchmarkOptions* options, int argc, char** argv);
+
+// draws the warmup and measured frames, then writes the report. 'name' identifies the example in it.
+// returns 0 if the report could not be written
+int benchmark_run(const BenchmarkOptions* options, const char* name, void (*display)(), void (*present)());
+
+#endif // OPENGL_PLAYGROUND_BENCHMARK_H
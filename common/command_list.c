@@ -0,0 +1,230 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Recorded command lists with sort keys
+ *
+ * See command_list.h for usage.
+ */
+
+#include "command_list.h"
+#include "gl_state.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef enum { false, true } bool;
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+static double now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+uint64_t command_key(unsigned int layer, GLuint program, GLuint texture, float depth)
+{
+	uint64_t quantized;
+	if(depth < 0.0f) depth = 0.0f;
+	if(depth > 1.0f) depth = 1.0f;
+	quantized = (uint64_t)(depth * COMMAND_KEY_DEPTH_MAX + 0.5f);
+
+	return ((uint64_t)(layer & 0xFF) << 56) |
+	       ((uint64_t)(program & 0xFFFF) << 40) |
+	       ((uint64_t)(texture & 0xFFFF) << 24) |
+	       quantized;
+}
+
+void command_list_init(CommandList* list)
+{
+	memset(list, 0, sizeof(CommandList));
+	list->sort_enabled = true;
+}
+
+void command_list_free(CommandList* list)
+{
+	free(list->commands);
+	free(list->keys);
+	free(list->order);
+	command_list_init(list);
+}
+
+void command_list_reset(CommandList* list)
+{
+	list->count = 0;
+	list->sorted = false;
+}
+
+static bool reserve(CommandList* list, int count)
+{
+	int capacity = list->capacity ? list->capacity : 64;
+	RenderCommand* commands;
+	if(count <= list->capacity) return true;
+
+	while(capacity < count) capacity *= 2;
+	commands = realloc(list->commands, capacity * sizeof(RenderCommand));
+	if(!commands) return false;
+	list->commands = commands;
+	list->capacity = capacity;
+	return true;
+}
+
+RenderCommand* command_list_push(CommandList* list, uint64_t key, const RenderCommand* command)
+{
+	RenderCommand* copy;
+	if(!reserve(list, list->count + 1)) return NULL;
+
+	copy = &list->commands[list->count++];
+	*copy = *command;
+	copy->key = key;
+	list->sorted = false;
+	return copy;
+}
+
+int command_list_append(CommandList* dst, const CommandList* src)
+{
+	if(!src->count) return true;
+	if(!reserve(dst, dst->count + src->count)) return false;
+
+	memcpy(dst->commands + dst->count, src->commands, src->count * sizeof(RenderCommand));
+	dst->count += src->count;
+	dst->sorted = false;
+	return true;
+}
+
+// lsd radix sort of the keys, carrying the command indices along. the keys are copied out so
+// the passes only move 12 bytes per command instead of whole commands
+int command_list_sort(CommandList* list)
+{
+	int n = list->count, pass, i, bucket;
+	uint64_t *keys, *keys_tmp, differing = 0;
+	uint32_t *order, *order_tmp;
+	double start = now_ms();
+
+	if(list->sorted) return true;
+
+	if(n > list->sort_capacity) {
+		uint64_t* new_keys = realloc(list->keys, 2 * n * sizeof(uint64_t));
+		uint32_t* new_order;
+		if(!new_keys) return false;
+		list->keys = new_keys;
+		new_order = realloc(list->order, 2 * n * sizeof(uint32_t));
+		if(!new_order) return false;
+		list->order = new_order;
+		list->sort_capacity = n;
+	}
+	keys = list->keys;
+	keys_tmp = list->keys + n;
+	order = list->order;
+	order_tmp = list->order + n;
+
+	for(i = 0; i < n; i++) {
+		keys[i] = list->commands[i].key;
+		order[i] = i;
+		differing |= keys[i] ^ keys[0];
+	}
+
+	list->stats.sort_passes = 0;
+	for(pass = 0; pass < RADIX_PASSES; pass++) {
+		int shift = pass * RADIX_BITS;
+		int offsets[RADIX_BUCKETS] = { 0 };
+		int sum = 0;
+		uint64_t* swap_keys;
+		uint32_t* swap_order;
+
+		// the same byte in every key, this pass would not move anything
+		if(!((differing >> shift) & (RADIX_BUCKETS - 1))) continue;
+
+		for(i = 0; i < n; i++) offsets[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+		for(bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+			int size = offsets[bucket];
+			offsets[bucket] = sum;
+			sum += size;
+		}
+		for(i = 0; i < n; i++) {
+			int to = offsets[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+			keys_tmp[to] = keys[i];
+			order_tmp[to] = order[i];
+		}
+
+		swap_keys = keys; keys = keys_tmp; keys_tmp = swap_keys;
+		swap_order = order; order = order_tmp; order_tmp = swap_order;
+		list->stats.sort_passes++;
+	}
+
+	// the result ended up in the second half after an odd number of passes
+	if(order != list->order) memcpy(list->order, order, n * sizeof(uint32_t));
+
+	list->sorted = true;
+	list->stats.sort_ms = now_ms() - start;
+	return true;
+}
+
+static void submit_command(const RenderCommand* command)
+{
+	gl_state_use_program(command->program);
+	gl_state_bind_vertex_array(command->vao);
+	if(command->texture_target) {
+		gl_state_active_texture(GL_TEXTURE0);
+		gl_state_bind_texture(command->texture_target, command->texture);
+	}
+	gl_state_blend(command->blend);
+	if(command->blend) gl_state_blend_func(command->blend_src, command->blend_dst);
+	if(command->uniform >= 0) glUniform1ui(command->uniform, command->uniform_value);
+
+	if(command->index_type) {
+		int index_size = command->index_type == GL_UNSIGNED_BYTE ? 1 : command->index_type == GL_UNSIGNED_SHORT ? 2 : 4;
+		const void* offset = (const void*)(intptr_t)(command->first * index_size);
+		if(command->instances > 1) glDrawElementsInstanced(command->mode, command->count, command->index_type, offset, command->instances);
+		else glDrawElements(command->mode, command->count, command->index_type, offset);
+	}
+	else {
+		if(command->instances > 1) glDrawArraysInstanced(command->mode, command->first, command->count, command->instances);
+		else glDrawArrays(command->mode, command->first, command->count);
+	}
+}
+
+void command_list_submit(CommandList* list)
+{
+	int i;
+	double start;
+	bool sorted = list->sort_enabled && command_list_sort(list);
+
+	if(!list->sort_enabled) {
+		list->stats.sort_passes = 0;
+		list->stats.sort_ms = 0.0;
+	}
+	start = now_ms();
+	for(i = 0; i < list->count; i++) {
+		// unsorted, or out of memory for sorting, the commands go out in recorded order
+		submit_command(&list->commands[sorted ? (int) list->order[i] : i]);
+	}
+	list->stats.commands = list->count;
+	list->stats.submit_ms = now_ms() - start;
+}
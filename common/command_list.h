@@ -0,0 +1,125 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Recorded command lists with sort keys
+ *
+ * Instead of making GL calls as it goes, a pass records each draw as a small plain struct:
+ * everything the draw needs bound, and a 64-bit sort key. Recording touches no GL at all, so any
+ * thread can record into a list of its own. Once per frame, the GL thread merges the lists,
+ * radix sorts the commands by key, and replays them in one submission loop, whose bindings go
+ * through the state cache (gl_state.h) so that draws sharing state only bind it once.
+ *
+ * The key sorts by layer first, then program, texture and depth, see command_key(). Layers keep
+ * passes in order, eg. the scene under the UI; within a layer, draws are grouped by state.
+ * The sort is stable: commands with the same key are replayed in the order they were recorded,
+ * and merged lists in the order they were appended.
+ *
+ *   // init, the draw is described once
+ *   RenderCommand quad = { 0 };
+ *   quad.program = program; quad.vao = vao; quad.uniform = -1;
+ *   quad.texture_target = GL_TEXTURE_2D; quad.texture = tex;
+ *   quad.mode = GL_TRIANGLE_FAN; quad.count = 4;
+ *
+ *   // every frame
+ *   command_list_reset(&commands);
+ *   command_list_push(&commands, command_key(0, program, tex, 0.0), &quad);
+ *   ...
+ *   command_list_submit(&commands);
+ *
+ * From several threads, each records into its own list, then on the GL thread:
+ *   command_list_reset(&frame);
+ *   for(i = 0; i < threads; i++) command_list_append(&frame, &thread_lists[i]);
+ *   command_list_submit(&frame);
+ *
+ * Requires OpenGL 3.1 for instanced draws, and GLEW to be initialized before command_list_submit().
+ */
+
+#ifndef OPENGL_PLAYGROUND_COMMAND_LIST_H
+#define OPENGL_PLAYGROUND_COMMAND_LIST_H
+
+#include <GL/glew.h>
+#include <stdint.h>
+
+#define COMMAND_KEY_LAYERS 256           // layer bits 63-56
+#define COMMAND_KEY_DEPTH_MAX 0xFFFFFF   // depth bits 23-0
+
+// one draw and the state it needs
+typedef struct {
+	uint64_t key;            // set by command_list_push()
+	GLuint program;
+	GLuint vao;
+	GLenum texture_target;   // GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY..., 0 when nothing is bound
+	GLuint texture;          // bound on texture unit 0
+	GLboolean blend;
+	GLenum blend_src, blend_dst;
+	GLint uniform;           // location of a uint uniform set before the draw, eg. an icon id. -1 for none
+	GLuint uniform_value;
+	GLenum mode;             // primitive, GL_TRIANGLES, GL_TRIANGLE_FAN...
+	GLenum index_type;       // 0 for glDrawArrays, otherwise glDrawElements with GL_UNSIGNED_INT...
+	GLint first;             // first vertex, or first index
+	GLsizei count;
+	GLsizei instances;       // more than 1 draws instanced
+} RenderCommand;
+
+// counters of the last submit
+typedef struct {
+	int commands;
+	int sort_passes;         // radix passes actually made, bytes that are the same in every key are skipped
+	double sort_ms, submit_ms;
+} CommandListStats;
+
+typedef struct {
+	RenderCommand* commands;
+	int count, capacity;
+	int sorted;              // 'order' is up to date
+	int sort_enabled;        // on by default. off replays in recorded order, to compare
+
+	// radix sort, keys and command indices ping pong between the two halves
+	uint64_t* keys;
+	uint32_t* order;
+	int sort_capacity;
+
+	CommandListStats stats;
+} CommandList;
+
+// 'depth' in [0, 1], larger is sorted later. programs and textures are grouped by their low 16 bits
+uint64_t command_key(unsigned int layer, GLuint program, GLuint texture, float depth);
+
+void command_list_init(CommandList* list);
+void command_list_free(CommandList* list);
+// forgets the commands, keeping the memory for the next frame
+void command_list_reset(CommandList* list);
+
+// copies 'command' into the list with 'key'. returns the copy, or NULL if out of memory
+RenderCommand* command_list_push(CommandList* list, uint64_t key, const RenderCommand* command);
+// appends every command of 'src', eg. a list recorded by another thread. returns 0 if out of memory
+int command_list_append(CommandList* dst, const CommandList* src);
+
+// sorts by key, stable. called by command_list_submit() when needed. returns 0 if out of memory
+int command_list_sort(CommandList* list);
+// replays the commands in key order, on the GL thread
+void command_list_submit(CommandList* list);
+
+#endif // OPENGL_PLAYGROUND_COMMAND_LIST_H
@@ -0,0 +1,176 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Frame pacing with fences, N frames in flight
+ *
+ * See frame_pacer.h
+ */
+
+#include "frame_pacer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+typedef enum { false, true } bool;
+
+#define FENCE_TIMEOUT_NS 1000000000ull // waits are retried, this only keeps a lost GPU from hanging silently
+#define VERTEX_REGION_ALIGNMENT 16
+
+static double now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// pacer
+
+int frame_pacer_init(FramePacer* pacer, int frames_in_flight)
+{
+	memset(pacer, 0, sizeof(FramePacer));
+	if(!GLEW_VERSION_3_2 && !GLEW_ARB_sync) {
+		fprintf(stderr, "Frame pacing needs OpenGL 3.2 or ARB_sync\n");
+		return false;
+	}
+	if(frames_in_flight < 1) frames_in_flight = 1;
+	if(frames_in_flight > FRAME_PACER_MAX_FRAMES) frames_in_flight = FRAME_PACER_MAX_FRAMES;
+	pacer->frames_in_flight = frames_in_flight;
+	return true;
+}
+
+// waits for the fence of a slot and deletes it. returns the time spent blocked
+static double wait_fence(FramePacer* pacer, int slot, bool record)
+{
+	GLsync fence = pacer->fences[slot];
+	if(!fence) return 0;
+
+	double start = now_ms();
+	// the first wait flushes, in case the fence has not been sent to the GPU yet
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	bool waited = result == GL_TIMEOUT_EXPIRED;
+	while(result == GL_TIMEOUT_EXPIRED) {
+		result = glClientWaitSync(fence, 0, FENCE_TIMEOUT_NS);
+		if(result == GL_TIMEOUT_EXPIRED) fprintf(stderr, "Still waiting for frame %d on the GPU\n", slot);
+	}
+	if(result == GL_WAIT_FAILED) fprintf(stderr, "Waiting for a frame fence failed\n");
+	double end = now_ms();
+
+	glDeleteSync(fence);
+	pacer->fences[slot] = 0;
+	if(!record) return end - start;
+	pacer->latency_ms = end - pacer->submit_ms[slot];
+	pacer->total_latency_ms += pacer->latency_ms;
+	if(pacer->latency_ms > pacer->max_latency_ms) pacer->max_latency_ms = pacer->latency_ms;
+	pacer->completed_frames++;
+	if(waited) pacer->waited_frames++;
+	return end - start;
+}
+
+void frame_pacer_free(FramePacer* pacer)
+{
+	int i;
+	for(i = 0; i < pacer->frames_in_flight; i++) {
+		// the time since the last frames includes however long the application idled, it is no latency
+		wait_fence(pacer, i, false);
+	}
+}
+
+int frame_pacer_begin(FramePacer* pacer)
+{
+	pacer->slot = pacer->frame % pacer->frames_in_flight;
+	pacer->wait_ms = wait_fence(pacer, pacer->slot, true);
+	pacer->total_wait_ms += pacer->wait_ms;
+	if(pacer->wait_ms > pacer->max_wait_ms) pacer->max_wait_ms = pacer->wait_ms;
+	pacer->frame++;
+	return pacer->slot;
+}
+
+void frame_pacer_end(FramePacer* pacer)
+{
+	pacer->fences[pacer->slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	pacer->submit_ms[pacer->slot] = now_ms();
+}
+
+void frame_pacer_print_stats(const FramePacer* pacer)
+{
+	if(pacer->frame == 0 || pacer->completed_frames == 0) return;
+	printf("Frame pacing: %lu frames, up to %d in flight, waited on the GPU in %lu of them\n",
+		pacer->frame, pacer->frames_in_flight, pacer->waited_frames);
+	printf("  wait    avg %.3f ms, max %.3f ms\n", pacer->total_wait_ms / pacer->frame, pacer->max_wait_ms);
+	printf("  latency avg %.3f ms, max %.3f ms\n", pacer->total_latency_ms / pacer->completed_frames, pacer->max_latency_ms);
+}
+
+// rings
+
+int frame_ring_init(FrameRing* ring, GLenum target, GLsizeiptr region_size, int regions)
+{
+	memset(ring, 0, sizeof(FrameRing));
+	GLint alignment = VERTEX_REGION_ALIGNMENT;
+	if(target == GL_UNIFORM_BUFFER) glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if(alignment < 1) alignment = 1;
+
+	ring->target = target;
+	ring->region_size = (region_size + alignment - 1) / alignment * alignment;
+	ring->regions = regions;
+
+	glGenBuffers(1, &ring->buffer);
+	glBindBuffer(target, ring->buffer);
+	glBufferData(target, ring->region_size * regions, NULL, GL_STREAM_DRAW);
+	if(glGetError() != GL_NO_ERROR) {
+		fprintf(stderr, "Creating a frame ring of %d x %ld bytes failed\n", regions, (long)ring->region_size);
+		frame_ring_free(ring);
+		return false;
+	}
+	return true;
+}
+
+void frame_ring_free(FrameRing* ring)
+{
+	glDeleteBuffers(1, &ring->buffer);
+	ring->buffer = 0;
+}
+
+GLintptr frame_ring_write(FrameRing* ring, int slot, const void* data, GLsizeiptr size)
+{
+	if(size > ring->region_size || slot < 0 || slot >= ring->regions) return -1;
+	GLintptr offset = slot * ring->region_size;
+
+	glBindBuffer(ring->target, ring->buffer);
+	// the pacer made sure the GPU is done with this region, the driver does not need to check
+	void* dst = glMapBufferRange(ring->target, offset, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if(!dst) {
+		fprintf(stderr, "Mapping frame ring region %d failed\n", slot);
+		return -1;
+	}
+	memcpy(dst, data, size);
+	if(!glUnmapBuffer(ring->target)) {
+		// the contents were lost, eg. on a mode switch. the next frame writes them again
+		fprintf(stderr, "Frame ring region %d was corrupted\n", slot);
+		return -1;
+	}
+	return offset;
+}
@@ -0,0 +1,102 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Frame pacing with fences, N frames in flight
+ *
+ * Lets the CPU record frame N+1 while the GPU is still drawing frame N, but never more than
+ * 'frames_in_flight' frames ahead: frame_pacer_end() puts a fence after the frame's commands,
+ * and frame_pacer_begin() of the frame that reuses the same slot waits on it. This bounds latency
+ * and makes it safe to overwrite per-frame data the GPU read N frames ago, without any glFinish().
+ *
+ * Per-frame data goes through rings: one buffer split into one region per frame in flight.
+ * Each frame writes its own region, unsynchronized, and draws from the offset it gets back:
+ *
+ *   FramePacer pacer;
+ *   FrameRing vertices;
+ *   frame_pacer_init(&pacer, 2);
+ *   frame_ring_init(&vertices, GL_ARRAY_BUFFER, sizeof(data), pacer.frames_in_flight);
+ *   ...
+ *   int slot = frame_pacer_begin(&pacer);
+ *   GLintptr offset = frame_ring_write(&vertices, slot, data, sizeof(data));
+ *   ... draw from 'offset'
+ *   frame_pacer_end(&pacer);
+ *   glfwSwapBuffers(window);
+ *
+ * The pacer also measures how long the CPU waited for the GPU, and the latency of each frame:
+ * from its fence being queued to the CPU seeing it signaled (an upper bound when it did not wait).
+ *
+ * Requires OpenGL 3.2 or ARB_sync, and GLEW to be initialized before use.
+ */
+
+#ifndef OPENGL_PLAYGROUND_FRAME_PACER_H
+#define OPENGL_PLAYGROUND_FRAME_PACER_H
+
+#include <GL/glew.h>
+
+#define FRAME_PACER_MAX_FRAMES 4
+
+typedef struct {
+	int frames_in_flight;
+	int slot;                             // slot of the frame being recorded
+	unsigned long frame;                  // frames begun so far
+	GLsync fences[FRAME_PACER_MAX_FRAMES];
+	double submit_ms[FRAME_PACER_MAX_FRAMES];
+
+	// statistics, over every frame since frame_pacer_init()
+	double wait_ms;                       // time the last frame_pacer_begin() blocked
+	double latency_ms;                    // of the frame whose fence was last waited on
+	double total_wait_ms, max_wait_ms;
+	double total_latency_ms, max_latency_ms;
+	unsigned long completed_frames;       // frames whose fence was seen signaled
+	unsigned long waited_frames;          // frames that found their slot still in use by the GPU
+} FramePacer;
+
+typedef struct {
+	GLuint buffer;
+	GLenum target;
+	GLsizeiptr region_size;               // rounded up to the alignment of the target
+	int regions;
+} FrameRing;
+
+// 'frames_in_flight' is clamped to 1..FRAME_PACER_MAX_FRAMES. returns 0 without fence support
+int frame_pacer_init(FramePacer* pacer, int frames_in_flight);
+// waits for the frames still in flight, then deletes the fences
+void frame_pacer_free(FramePacer* pacer);
+// waits until the GPU is done with the frame that last used this slot. returns the slot
+int frame_pacer_begin(FramePacer* pacer);
+// queues the fence of the frame after its commands. call it before the swap, which sends it to the GPU
+void frame_pacer_end(FramePacer* pacer);
+// prints the wait and latency statistics to stdout
+void frame_pacer_print_stats(const FramePacer* pacer);
+
+// creates a buffer with 'regions' regions of at least 'region_size' bytes. returns 0 on failure.
+// uniform buffer regions are aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT so they can be bound with glBindBufferRange
+int frame_ring_init(FrameRing* ring, GLenum target, GLsizeiptr region_size, int regions);
+void frame_ring_free(FrameRing* ring);
+// copies 'size' bytes to the start of the region of 'slot' and returns its offset in the buffer.
+// the buffer is left bound to the ring's target. returns -1 when 'size' does not fit
+GLintptr frame_ring_write(FrameRing* ring, int slot, const void* data, GLsizeiptr size);
+
+#endif // OPENGL_PLAYGROUND_FRAME_PACER_H
@@ -0,0 +1,210 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Redundant state change elimination
+ *
+ * See gl_state.h for usage.
+ */
+
+#include "gl_state.h"
+
+#include <stdio.h>
+
+typedef enum { false, true } bool;
+
+#define UNKNOWN 0xFFFFFFFFu  // not a valid name or enum, so it never matches
+
+enum { TEXTURE_TARGET_2D, TEXTURE_TARGET_2D_ARRAY, TEXTURE_TARGET_3D, TEXTURE_TARGET_CUBE_MAP, TEXTURE_TARGETS };
+enum { BUFFER_TARGET_ARRAY, BUFFER_TARGET_ELEMENT_ARRAY, BUFFER_TARGET_UNIFORM,
+       BUFFER_TARGET_PIXEL_PACK, BUFFER_TARGET_PIXEL_UNPACK, BUFFER_TARGETS };
+
+static struct {
+	GLuint program;
+	GLuint vao;
+	GLenum active_unit;
+	GLuint textures[GL_STATE_TEXTURE_UNITS][TEXTURE_TARGETS];
+	GLuint buffers[BUFFER_TARGETS];
+	GLuint blend;                        // UNKNOWN, false or true
+	GLenum blend_src, blend_dst;
+
+	GLStateStats stats;
+} state;
+static bool known = false; // gl_state_invalidate() runs on first use
+
+
+void gl_state_invalidate()
+{
+	int unit, target;
+	state.program = UNKNOWN;
+	state.vao = UNKNOWN;
+	state.active_unit = UNKNOWN;
+	for(unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++) {
+		for(target = 0; target < TEXTURE_TARGETS; target++) state.textures[unit][target] = UNKNOWN;
+	}
+	for(target = 0; target < BUFFER_TARGETS; target++) state.buffers[target] = UNKNOWN;
+	state.blend = UNKNOWN;
+	state.blend_src = state.blend_dst = UNKNOWN;
+	known = true;
+}
+
+// counts the call, returns whether it has to be made
+static bool changes(GLuint* cached, GLuint value)
+{
+	if(!known) gl_state_invalidate();
+	if(*cached == value) {
+		state.stats.skipped++;
+		return false;
+	}
+	*cached = value;
+	state.stats.issued++;
+	return true;
+}
+
+static void pass_through()
+{
+	state.stats.issued++;
+}
+
+void gl_state_use_program(GLuint program)
+{
+	if(changes(&state.program, program)) glUseProgram(program);
+}
+
+void gl_state_bind_vertex_array(GLuint vao)
+{
+	if(changes(&state.vao, vao)) {
+		glBindVertexArray(vao);
+		state.buffers[BUFFER_TARGET_ELEMENT_ARRAY] = UNKNOWN;
+	}
+}
+
+void gl_state_active_texture(GLenum unit)
+{
+	if(changes(&state.active_unit, unit)) glActiveTexture(unit);
+}
+
+static int texture_target_index(GLenum target)
+{
+	switch(target) {
+		case GL_TEXTURE_2D: return TEXTURE_TARGET_2D;
+		case GL_TEXTURE_2D_ARRAY: return TEXTURE_TARGET_2D_ARRAY;
+		case GL_TEXTURE_3D: return TEXTURE_TARGET_3D;
+		case GL_TEXTURE_CUBE_MAP: return TEXTURE_TARGET_CUBE_MAP;
+	}
+	return -1;
+}
+
+void gl_state_bind_texture(GLenum target, GLuint texture)
+{
+	if(!known) gl_state_invalidate();
+	int index = texture_target_index(target);
+	// the unit is unknown until a gl_state_active_texture() call
+	GLuint unit = state.active_unit - GL_TEXTURE0;
+	if(index < 0 || state.active_unit == UNKNOWN || unit >= GL_STATE_TEXTURE_UNITS) {
+		pass_through();
+		glBindTexture(target, texture);
+		return;
+	}
+	if(changes(&state.textures[unit][index], texture)) glBindTexture(target, texture);
+}
+
+static int buffer_target_index(GLenum target)
+{
+	switch(target) {
+		case GL_ARRAY_BUFFER: return BUFFER_TARGET_ARRAY;
+		case GL_ELEMENT_ARRAY_BUFFER: return BUFFER_TARGET_ELEMENT_ARRAY;
+		case GL_UNIFORM_BUFFER: return BUFFER_TARGET_UNIFORM;
+		case GL_PIXEL_PACK_BUFFER: return BUFFER_TARGET_PIXEL_PACK;
+		case GL_PIXEL_UNPACK_BUFFER: return BUFFER_TARGET_PIXEL_UNPACK;
+	}
+	return -1;
+}
+
+void gl_state_bind_buffer(GLenum target, GLuint buffer)
+{
+	if(!known) gl_state_invalidate();
+	int index = buffer_target_index(target);
+	if(index < 0) {
+		pass_through();
+		glBindBuffer(target, buffer);
+		return;
+	}
+	// without a vertex array, the element array binding is not kept anywhere to cache it in
+	if(index == BUFFER_TARGET_ELEMENT_ARRAY && (state.vao == UNKNOWN || state.vao == 0)) {
+		pass_through();
+		glBindBuffer(target, buffer);
+		return;
+	}
+	if(changes(&state.buffers[index], buffer)) glBindBuffer(target, buffer);
+}
+
+void gl_state_blend(int enabled)
+{
+	if(changes(&state.blend, enabled ? true : false)) {
+		if(enabled) glEnable(GL_BLEND);
+		else glDisable(GL_BLEND);
+	}
+}
+
+void gl_state_blend_func(GLenum src, GLenum dst)
+{
+	if(!known) gl_state_invalidate();
+	if(state.blend_src == src && state.blend_dst == dst) {
+		state.stats.skipped++;
+		return;
+	}
+	state.blend_src = src;
+	state.blend_dst = dst;
+	state.stats.issued++;
+	glBlendFunc(src, dst);
+}
+
+// statistics
+
+static unsigned long frame_start_issued, frame_start_skipped;
+
+void gl_state_next_frame()
+{
+	state.stats.frames++;
+	state.stats.frame_issued = state.stats.issued - frame_start_issued;
+	state.stats.frame_skipped = state.stats.skipped - frame_start_skipped;
+	frame_start_issued = state.stats.issued;
+	frame_start_skipped = state.stats.skipped;
+}
+
+GLStateStats gl_state_stats()
+{
+	return state.stats;
+}
+
+void gl_state_print_stats()
+{
+	const GLStateStats* s = &state.stats;
+	if(s->frames == 0) return;
+	unsigned long total = s->issued + s->skipped;
+	printf("GL state: %.1f calls issued and %.1f skipped per frame (%.0f%% skipped) over %lu frames, last frame %lu issued, %lu skipped\n",
+	       (double) s->issued / s->frames, (double) s->skipped / s->frames,
+	       total ? 100.0 * s->skipped / total : 0.0, s->frames, s->frame_issued, s->frame_skipped);
+}
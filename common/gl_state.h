@@ -0,0 +1,93 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Redundant state change elimination
+ *
+ * A thin cache in front of the GL binding calls the examples make every frame: the program,
+ * the vertex array, the active texture unit and the textures bound to each unit, blending and
+ * the blend function, and buffer bindings. A call that would set what is already set is skipped,
+ * so draw code can state everything it needs for each draw, without resetting it to 0 afterwards
+ * and without paying the driver for it:
+ *
+ *   gl_state_use_program(program);
+ *   gl_state_bind_vertex_array(vao);
+ *   gl_state_active_texture(GL_TEXTURE0);
+ *   gl_state_bind_texture(GL_TEXTURE_2D, tex);   // on the active unit
+ *   glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+ *   ...
+ *   gl_state_next_frame();                       // once per frame, closes the frame's counters
+ *
+ * The cache only knows what went through it. It starts out unknown, so the first call of each
+ * kind is always made, and code that changes any of this state behind its back after that
+ * (eg. a library) must call gl_state_invalidate(). State that is restored before returning, like
+ * the profiler overlay does, is fine. Deleting a bound object unbinds it, and its name may come back
+ * from the next glGen*, so that needs gl_state_invalidate() too. The element array buffer
+ * binding belongs to the vertex array, so it is forgotten whenever another vertex array is bound.
+ *
+ * Every call is counted as issued or skipped, per frame and in total. gl_state_print_stats()
+ * prints both per frame, gl_state_stats() gives them to whoever reports frame statistics.
+ *
+ * There is one cache, for the context current on the thread that draws. Contexts of other threads,
+ * like the texture loader's, bind what they need directly.
+ * Requires OpenGL 3.0 and GLEW to be initialized before use.
+ */
+
+#ifndef OPENGL_PLAYGROUND_GL_STATE_H
+#define OPENGL_PLAYGROUND_GL_STATE_H
+
+#include <GL/glew.h>
+
+#define GL_STATE_TEXTURE_UNITS 16 // units cached, calls on higher units are always made
+
+typedef struct {
+	unsigned long frames;             // gl_state_next_frame() calls
+	unsigned long issued, skipped;    // calls in the frames so far
+	unsigned long frame_issued, frame_skipped; // calls in the last closed frame
+} GLStateStats;
+
+// forgets everything, the next call of each kind is made
+void gl_state_invalidate();
+
+void gl_state_use_program(GLuint program);
+void gl_state_bind_vertex_array(GLuint vao);
+// 'unit' is GL_TEXTURE0 + n
+void gl_state_active_texture(GLenum unit);
+// on the active texture unit, cached once it was set with gl_state_active_texture(). GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D and GL_TEXTURE_CUBE_MAP
+// are cached, other targets are passed through
+void gl_state_bind_texture(GLenum target, GLuint texture);
+// GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_PIXEL_PACK_BUFFER and
+// GL_PIXEL_UNPACK_BUFFER are cached, other targets are passed through
+void gl_state_bind_buffer(GLenum target, GLuint buffer);
+// glEnable(GL_BLEND) or glDisable(GL_BLEND)
+void gl_state_blend(int enabled);
+void gl_state_blend_func(GLenum src, GLenum dst);
+
+// closes the counters of the current frame
+void gl_state_next_frame();
+GLStateStats gl_state_stats();
+// prints the calls issued and skipped per frame, on average and in the last frame
+void gl_state_print_stats();
+
+#endif // OPENGL_PLAYGROUND_GL_STATE_H
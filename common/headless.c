@@ -0,0 +1,429 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Headless rendering without a window
+ *
+ * See headless.h for usage.
+ */
+
+#include "headless.h"
+
+#include <EGL/eglext.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef enum { false, true } bool;
+
+// options
+
+void headless_parse_args(HeadlessOptions* options, int argc, char** argv)
+{
+	options->enabled = false;
+	options->frames = 1;
+	options->output = NULL;
+
+	int i;
+	for(i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--headless") == 0) options->enabled = true;
+		else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc) options->frames = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--output") == 0 && i + 1 < argc) options->output = argv[++i];
+	}
+	if(options->frames < 1) options->frames = 1;
+}
+
+// context
+
+static bool has_extension(const char* extensions, const char* name)
+{
+	size_t length = strlen(name);
+	const char* p = extensions;
+	while(p && (p = strstr(p, name))) {
+		if((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) return true;
+		p += length;
+	}
+	return false;
+}
+
+// the surfaceless platform if the EGL implementation has it, the default display otherwise
+static EGLDisplay open_display(bool* surfaceless)
+{
+	const char* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	*surfaceless = false;
+
+	if(has_extension(client_extensions, "EGL_MESA_platform_surfaceless")
+	   && has_extension(client_extensions, "EGL_EXT_platform_base")) {
+		PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+		EGLDisplay display = get_platform_display
+			? get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL) : EGL_NO_DISPLAY;
+		if(display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) {
+			*surfaceless = true;
+			return display;
+		}
+	}
+
+	EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if(display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) return display;
+	return EGL_NO_DISPLAY;
+}
+
+static EGLContext create_context(EGLDisplay display, EGLConfig config, EGLContext share, int gl_major, int gl_minor)
+{
+	EGLint context_attribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, gl_major,
+		EGL_CONTEXT_MINOR_VERSION, gl_minor,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE, EGL_TRUE,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, config, share, context_attribs);
+	if(context == EGL_NO_CONTEXT) {
+		fprintf(stderr, "EGL Error: could not create an OpenGL %d.%d context (0x%x)\n", gl_major, gl_minor, eglGetError());
+	}
+	return context;
+}
+
+int headless_init(HeadlessContext* ctx, int width, int height, int gl_major, int gl_minor)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->width = width;
+	ctx->height = height;
+	ctx->surface = EGL_NO_SURFACE;
+	ctx->context = EGL_NO_CONTEXT;
+
+	bool surfaceless;
+	ctx->display = open_display(&surfaceless);
+	if(ctx->display == EGL_NO_DISPLAY) {
+		fprintf(stderr, "EGL Error: no display available (0x%x)\n", eglGetError());
+		return false;
+	}
+	if(!eglBindAPI(EGL_OPENGL_API)) {
+		fprintf(stderr, "EGL Error: desktop OpenGL is not supported\n");
+		headless_free(ctx);
+		return false;
+	}
+
+	// the config is only used for the pbuffer, drawing goes to the FBO
+	EGLint config_attribs[] = {
+		EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint num_configs = 0;
+	if(!eglChooseConfig(ctx->display, config_attribs, &config, 1, &num_configs) || num_configs == 0) {
+		fprintf(stderr, "EGL Error: no suitable config\n");
+		headless_free(ctx);
+		return false;
+	}
+
+	ctx->config = config;
+	ctx->gl_major = gl_major;
+	ctx->gl_minor = gl_minor;
+	ctx->context = create_context(ctx->display, config, EGL_NO_CONTEXT, gl_major, gl_minor);
+	if(ctx->context == EGL_NO_CONTEXT) {
+		headless_free(ctx);
+		return false;
+	}
+
+	if(!surfaceless) {
+		EGLint pbuffer_attribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		ctx->surface = eglCreatePbufferSurface(ctx->display, config, pbuffer_attribs);
+		if(ctx->surface == EGL_NO_SURFACE) {
+			fprintf(stderr, "EGL Error: could not create a pbuffer (0x%x)\n", eglGetError());
+			headless_free(ctx);
+			return false;
+		}
+	}
+	if(!eglMakeCurrent(ctx->display, ctx->surface, ctx->surface, ctx->context)) {
+		fprintf(stderr, "EGL Error: could not make the context current (0x%x)\n", eglGetError());
+		headless_free(ctx);
+		return false;
+	}
+
+	glewExperimental = GL_TRUE;
+	GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// GLEW built for GLX complains that there is no X display, but loads the entry points anyway
+	if(err == GLEW_ERROR_NO_GLX_DISPLAY) err = GLEW_OK;
+#endif
+	if(err != GLEW_OK) {
+		fprintf(stderr, "GLEW Error: %s\n", glewGetErrorString(err));
+		headless_free(ctx);
+		return false;
+	}
+	printf("Using OpenGL %s (%s, headless)\n", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+
+	// the FBO stands in for the window framebuffer
+	glGenRenderbuffers(1, &ctx->color_rb);
+	glBindRenderbuffer(GL_RENDERBUFFER, ctx->color_rb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &ctx->depth_rb);
+	glBindRenderbuffer(GL_RENDERBUFFER, ctx->depth_rb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &ctx->fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, ctx->fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ctx->color_rb);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, ctx->depth_rb);
+	if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "Headless framebuffer is incomplete\n");
+		headless_free(ctx);
+		return false;
+	}
+	glViewport(0, 0, width, height);
+	return true;
+}
+
+void headless_free(HeadlessContext* ctx)
+{
+	if(ctx->context != EGL_NO_CONTEXT && eglGetCurrentContext() == ctx->context) {
+		glDeleteFramebuffers(1, &ctx->fbo);
+		glDeleteRenderbuffers(1, &ctx->color_rb);
+		glDeleteRenderbuffers(1, &ctx->depth_rb);
+		eglMakeCurrent(ctx->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	}
+	if(ctx->surface != EGL_NO_SURFACE) eglDestroySurface(ctx->display, ctx->surface);
+	if(ctx->context != EGL_NO_CONTEXT) eglDestroyContext(ctx->display, ctx->context);
+	if(ctx->display != EGL_NO_DISPLAY) eglTerminate(ctx->display);
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+// shared contexts
+
+int headless_create_shared(HeadlessContext* ctx, HeadlessSharedContext* shared)
+{
+	shared->display = ctx->display;
+	shared->surface = EGL_NO_SURFACE;
+	shared->context = create_context(ctx->display, ctx->config, ctx->context, ctx->gl_major, ctx->gl_minor);
+	if(shared->context == EGL_NO_CONTEXT) return false;
+
+	// a pbuffer can only be current on one thread at a time, so each context gets its own
+	if(ctx->surface != EGL_NO_SURFACE) {
+		EGLint pbuffer_attribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		shared->surface = eglCreatePbufferSurface(ctx->display, ctx->config, pbuffer_attribs);
+		if(shared->surface == EGL_NO_SURFACE) {
+			fprintf(stderr, "EGL Error: could not create a pbuffer (0x%x)\n", eglGetError());
+			headless_free_shared(shared);
+			return false;
+		}
+	}
+	return true;
+}
+
+int headless_make_shared_current(HeadlessSharedContext* shared)
+{
+	// the API is bound per thread
+	if(!eglBindAPI(EGL_OPENGL_API) || !eglMakeCurrent(shared->display, shared->surface, shared->surface, shared->context)) {
+		fprintf(stderr, "EGL Error: could not make the shared context current (0x%x)\n", eglGetError());
+		return false;
+	}
+	return true;
+}
+
+void headless_release_shared(HeadlessSharedContext* shared)
+{
+	eglMakeCurrent(shared->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglReleaseThread();
+}
+
+void headless_free_shared(HeadlessSharedContext* shared)
+{
+	if(shared->surface != EGL_NO_SURFACE) eglDestroySurface(shared->display, shared->surface);
+	if(shared->context != EGL_NO_CONTEXT) eglDestroyContext(shared->display, shared->context);
+	shared->surface = EGL_NO_SURFACE;
+	shared->context = EGL_NO_CONTEXT;
+}
+
+// frames
+
+static double now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int headless_run(HeadlessContext* ctx, const HeadlessOptions* options, void (*display)())
+{
+	double total = 0, slowest = 0;
+	int i;
+	for(i = 0; i < options->frames; i++) {
+		double start = now_ms();
+		display();
+		glFinish(); // there is no swap to wait on, make the time cover the rendering
+		double elapsed = now_ms() - start;
+		total += elapsed;
+		if(elapsed > slowest) slowest = elapsed;
+	}
+	printf("Rendered %d frames of %dx%d, %.3f ms per frame, slowest %.3f ms\n",
+	       options->frames, ctx->width, ctx->height, total / options->frames, slowest);
+
+	if(options->output) {
+		if(!headless_save_png(ctx, options->output)) return false;
+		printf("Saved frame to '%s'\n", options->output);
+	}
+	return true;
+}
+
+void headless_read_pixels(HeadlessContext* ctx, unsigned char* rgba)
+{
+	size_t row_size = (size_t) ctx->width * 4;
+	GLint alignment;
+	glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, ctx->fbo);
+	glReadPixels(0, 0, ctx->width, ctx->height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+
+	// OpenGL has the bottom row first, flip it in place
+	unsigned char tmp[4096];
+	int y;
+	for(y = 0; y < ctx->height / 2; y++) {
+		unsigned char* top = rgba + y * row_size;
+		unsigned char* bottom = rgba + (ctx->height - 1 - y) * row_size;
+		size_t done;
+		for(done = 0; done < row_size; done += sizeof(tmp)) {
+			size_t n = row_size - done < sizeof(tmp) ? row_size - done : sizeof(tmp);
+			memcpy(tmp, top + done, n);
+			memcpy(top + done, bottom + done, n);
+			memcpy(bottom + done, tmp, n);
+		}
+	}
+}
+
+// png
+
+// the frames are only written for comparisons, so the PNG uses stored (uncompressed) deflate
+// blocks: no zlib needed, and any decoder (eg. lodepng) reads it
+
+static uint32_t crc_table[256];
+
+static void init_crc_table()
+{
+	uint32_t n, k;
+	for(n = 0; n < 256; n++) {
+		uint32_t c = n;
+		for(k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		crc_table[n] = c;
+	}
+}
+
+static uint32_t update_crc(uint32_t crc, const unsigned char* data, size_t size)
+{
+	size_t i;
+	for(i = 0; i < size; i++) crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc;
+}
+
+static void put_u32(unsigned char* p, uint32_t v)
+{
+	p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static bool write_chunk(FILE* file, const char* type, const unsigned char* data, size_t size)
+{
+	unsigned char header[8], footer[4];
+	put_u32(header, size);
+	memcpy(header + 4, type, 4);
+	uint32_t crc = update_crc(0xFFFFFFFFu, header + 4, 4);
+	crc = update_crc(crc, data, size) ^ 0xFFFFFFFFu;
+	put_u32(footer, crc);
+	return fwrite(header, 8, 1, file) == 1
+	       && (size == 0 || fwrite(data, size, 1, file) == 1)
+	       && fwrite(footer, 4, 1, file) == 1;
+}
+
+int headless_save_png(HeadlessContext* ctx, const char* path)
+{
+	size_t row_size = (size_t) ctx->width * 4;
+	size_t raw_size = (row_size + 1) * ctx->height; // each row starts with its filter type, 0 for none
+	size_t num_blocks = raw_size / 65535 + 1;
+	size_t zlib_size = 2 + raw_size + num_blocks * 5 + 4;
+
+	unsigned char* pixels = malloc(row_size * ctx->height);
+	unsigned char* zlib = malloc(zlib_size);
+	if(!pixels || !zlib) {
+		free(pixels);
+		free(zlib);
+		return false;
+	}
+	headless_read_pixels(ctx, pixels);
+
+	// zlib stream of stored blocks, with the adler32 of the raw data at the end
+	unsigned char* out = zlib;
+	*out++ = 0x78;
+	*out++ = 0x01;
+	uint32_t a = 1, b = 0;
+	size_t raw_pos = 0, block_left = 0;
+	int y;
+	for(y = 0; y < ctx->height; y++) {
+		size_t x;
+		for(x = 0; x <= row_size; x++) {
+			if(block_left == 0) {
+				size_t length = raw_size - raw_pos < 65535 ? raw_size - raw_pos : 65535;
+				*out++ = (raw_pos + length == raw_size); // BFINAL on the last block, BTYPE 00
+				out[0] = length; out[1] = length >> 8;
+				out[2] = ~length; out[3] = ~length >> 8;
+				out += 4;
+				block_left = length;
+			}
+			unsigned char byte = x == 0 ? 0 : pixels[y * row_size + x - 1];
+			*out++ = byte;
+			a = (a + byte) % 65521;
+			b = (b + a) % 65521;
+			raw_pos++;
+			block_left--;
+		}
+	}
+	put_u32(out, b << 16 | a);
+	out += 4;
+	free(pixels);
+
+	unsigned char ihdr[13];
+	put_u32(ihdr, ctx->width);
+	put_u32(ihdr + 4, ctx->height);
+	ihdr[8] = 8;  // bit depth
+	ihdr[9] = 6;  // RGBA
+	ihdr[10] = ihdr[11] = ihdr[12] = 0; // deflate, adaptive filtering, no interlace
+
+	init_crc_table();
+	FILE* file = fopen(path, "wb");
+	bool ok = file
+	          && fwrite("\x89PNG\r\n\x1A\n", 8, 1, file) == 1
+	          && write_chunk(file, "IHDR", ihdr, sizeof(ihdr))
+	          && write_chunk(file, "IDAT", zlib, out - zlib)
+	          && write_chunk(file, "IEND", NULL, 0);
+	if(file) ok = (fclose(file) == 0) && ok;
+	if(!ok) fprintf(stderr, "Could not write PNG '%s'\n", path);
+	free(zlib);
+	return ok;
+}
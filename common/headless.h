@@ -0,0 +1,106 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Headless rendering without a window
+ *
+ * Creates an OpenGL context with EGL instead of GLFW or freeGLUT, so that examples run on
+ * machines without a display or a GPU, eg. with Mesa llvmpipe on a build server.
+ * The EGL_MESA_platform_surfaceless display is used when available, with no surface at all;
+ * otherwise the default display with a small pbuffer. Either way, frames are drawn into
+ * an FBO that stands in for the window, so code drawing to framebuffer 0 needs no change.
+ *
+ * Examples switch to it with command line flags:
+ *   --headless          render without a window
+ *   --frames N          frames to render before exiting, 1 by default
+ *   --output file.png   saves the last frame, eg. to compare against a golden image
+ *
+ *   HeadlessOptions headless;
+ *   headless_parse_args(&headless, argc, argv);
+ *   if(headless.enabled) {
+ *       HeadlessContext ctx;
+ *       if(!headless_init(&ctx, 250, 250, 3, 2) || !init()) exit(-1);
+ *       exit(headless_run(&ctx, &headless, display) ? 0 : -1);
+ *   }
+ *
+ * headless_run() prints the time per frame, waiting for the GPU with glFinish() after each one.
+ * headless_create_shared() makes a second context in the same share group, for a loader thread.
+ *
+ * Requires EGL and GLEW.
+ */
+
+#ifndef OPENGL_PLAYGROUND_HEADLESS_H
+#define OPENGL_PLAYGROUND_HEADLESS_H
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+
+typedef struct {
+	int enabled;             // --headless was given
+	int frames;
+	const char* output;      // PNG path for the last frame, NULL for none
+} HeadlessOptions;
+
+typedef struct {
+	EGLDisplay display;
+	EGLSurface surface;      // EGL_NO_SURFACE with the surfaceless platform
+	EGLContext context;
+	EGLConfig config;
+	int gl_major, gl_minor;
+	GLuint fbo, color_rb, depth_rb;
+	int width, height;
+} HeadlessContext;
+
+// a context sharing textures, buffers and sync objects with a HeadlessContext
+typedef struct {
+	EGLDisplay display;
+	EGLSurface surface;      // a 1x1 pbuffer of its own, EGL_NO_SURFACE with the surfaceless platform
+	EGLContext context;
+} HeadlessSharedContext;
+
+// reads the flags above, ignoring any others
+void headless_parse_args(HeadlessOptions* options, int argc, char** argv);
+
+// creates a core profile context of at least version gl_major.gl_minor, makes it current,
+// initializes GLEW and binds a width x height FBO with color and depth. returns 0 on failure
+int headless_init(HeadlessContext* ctx, int width, int height, int gl_major, int gl_minor);
+void headless_free(HeadlessContext* ctx);
+
+// creates a context sharing objects with 'ctx', without making it current. returns 0 on failure
+int headless_create_shared(HeadlessContext* ctx, HeadlessSharedContext* shared);
+// makes 'shared' current on the calling thread, or releases it from the calling thread
+int headless_make_shared_current(HeadlessSharedContext* shared);
+void headless_release_shared(HeadlessSharedContext* shared);
+// must not be current on any thread
+void headless_free_shared(HeadlessSharedContext* shared);
+
+// calls 'display' for each frame. returns 0 if the output image could not be written
+int headless_run(HeadlessContext* ctx, const HeadlessOptions* options, void (*display)());
+
+// copies the current frame into 'rgba', width * height * 4 bytes, top row first
+void headless_read_pixels(HeadlessContext* ctx, unsigned char* rgba);
+// writes the current frame as an RGBA PNG. returns 0 on failure
+int headless_save_png(HeadlessContext* ctx, const char* path);
+
+#endif // OPENGL_PLAYGROUND_HEADLESS_H
@@ -0,0 +1,538 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - CPU and GPU frame profiler
+ *
+ * See profiler.h for usage.
+ */
+
+#include "profiler.h"
+#include "shader.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+
+typedef enum { false, true } bool;
+
+#define FRAME_SCOPE 0
+#define OVERLAY_ROW_HEIGHT 4                 // pixels per bar, CPU and GPU bars stacked
+#define OVERLAY_WIDTH 240                    // pixels for OVERLAY_RANGE_MS
+#define OVERLAY_RANGE_MS (2 * 1000.0 / 60.0) // two frames at 60 Hz
+#define OVERLAY_SMOOTHING 0.1f               // weight of a new sample in the displayed times
+
+typedef struct {
+	const char* name;
+	double cpu_start;
+	float cpu_ms[PROFILER_QUERY_BUFFERS];
+	bool recorded[PROFILER_QUERY_BUFFERS];          // begun and ended in the frame of that buffer
+	GLuint queries[PROFILER_QUERY_BUFFERS][2];     // GL_TIMESTAMP at begin and end
+	float shown_cpu_ms, shown_gpu_ms;              // smoothed, for the overlay
+} Scope;
+
+#define SAMPLE_WORDS (sizeof(ProfilerSample) / sizeof(uint32_t))
+
+typedef struct {
+	atomic_uint seq;          // ring index + 1 of the sample in the slot, 0 while it is being written
+	atomic_uint words[SAMPLE_WORDS]; // the sample, word by word so that readers never see a torn word
+} RingSlot;
+
+static struct {
+	bool initialized;
+	bool timer_queries;
+	bool overlay;
+	bool legend_printed;
+	const char* output;
+
+	Scope scopes[PROFILER_MAX_SCOPES];
+	int num_scopes;
+
+	int buffer;               // query buffer of the frame being recorded
+	uint32_t frame;
+	uint32_t frame_numbers[PROFILER_QUERY_BUFFERS];
+	GLuint frame_queries[PROFILER_QUERY_BUFFERS]; // GL_TIME_ELAPSED over the whole frame
+
+	// single producer: only the render thread writes, readers check the slot sequence numbers
+	RingSlot ring[PROFILER_RING_SIZE];
+	atomic_uint head;         // index of the next sample written
+	unsigned int frames_without_gpu; // recorded before their GPU times were ready
+
+	GLuint program, vao, vbo;
+} prof;
+
+static double now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+void profiler_parse_args(int argc, char** argv)
+{
+	int i;
+	for(i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--profile") == 0 && i + 1 < argc) prof.output = argv[++i];
+		else if(strcmp(argv[i], "--overlay") == 0) prof.overlay = true;
+	}
+}
+
+int profiler_scope(const char* name)
+{
+	if(prof.num_scopes == 0) prof.scopes[prof.num_scopes++].name = "frame";
+
+	int i;
+	for(i = 0; i < prof.num_scopes; i++) {
+		if(strcmp(prof.scopes[i].name, name) == 0) return i;
+	}
+	if(prof.num_scopes == PROFILER_MAX_SCOPES) {
+		fprintf(stderr, "Too many profiler scopes, not timing '%s'\n", name);
+		return -1;
+	}
+	prof.scopes[prof.num_scopes].name = name;
+	return prof.num_scopes++;
+}
+
+// ring buffer
+
+static void push_sample(const ProfilerSample* sample)
+{
+	unsigned int index = atomic_load_explicit(&prof.head, memory_order_relaxed);
+	RingSlot* slot = &prof.ring[index & (PROFILER_RING_SIZE - 1)];
+
+	// a reader that sees seq change while copying throws the copy away
+	uint32_t words[SAMPLE_WORDS];
+	memcpy(words, sample, sizeof(words));
+	atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	unsigned int w;
+	for(w = 0; w < SAMPLE_WORDS; w++) atomic_store_explicit(&slot->words[w], words[w], memory_order_relaxed);
+	atomic_store_explicit(&slot->seq, index + 1, memory_order_release);
+	atomic_store_explicit(&prof.head, index + 1, memory_order_release);
+
+	Scope* s = &prof.scopes[sample->scope];
+	s->shown_cpu_ms += (sample->cpu_ms - s->shown_cpu_ms) * OVERLAY_SMOOTHING;
+	if(sample->gpu_ms >= 0) s->shown_gpu_ms += (sample->gpu_ms - s->shown_gpu_ms) * OVERLAY_SMOOTHING;
+}
+
+int profiler_read_samples(ProfilerSample* out, int max)
+{
+	unsigned int head = atomic_load_explicit(&prof.head, memory_order_acquire);
+	unsigned int count = head < PROFILER_RING_SIZE ? head : PROFILER_RING_SIZE;
+	if(max < 0) max = 0;
+	if(count > (unsigned int) max) count = max;
+
+	unsigned int i, w;
+	int n = 0;
+	for(i = head - count; i != head; i++) {
+		RingSlot* slot = &prof.ring[i & (PROFILER_RING_SIZE - 1)];
+		if(atomic_load_explicit(&slot->seq, memory_order_acquire) != i + 1) continue; // already overwritten
+		uint32_t words[SAMPLE_WORDS];
+		for(w = 0; w < SAMPLE_WORDS; w++) words[w] = atomic_load_explicit(&slot->words[w], memory_order_relaxed);
+		atomic_thread_fence(memory_order_acquire);
+		if(atomic_load_explicit(&slot->seq, memory_order_relaxed) != i + 1) continue; // overwritten while copying
+		memcpy(&out[n++], words, sizeof(words));
+	}
+	return n;
+}
+
+// recording
+
+static const char* overlay_vs_source =
+	"#version 330\n"
+	"layout (location = 0) in vec2 v_pos;\n"
+	"layout (location = 1) in vec4 v_color;\n"
+	"out vec4 vs_color;\n"
+	"void main(void) {\n"
+	"  gl_Position = vec4(v_pos, 0.0, 1.0);\n"
+	"  vs_color = v_color;\n"
+	"}\n";
+
+static const char* overlay_fs_source =
+	"#version 330\n"
+	"in vec4 vs_color;\n"
+	"layout (location = 0) out vec4 color;\n"
+	"void main(void) {\n"
+	"  color = vs_color;\n"
+	"}\n";
+
+int profiler_init()
+{
+	profiler_scope("frame"); // makes sure the frame scope exists
+	prof.timer_queries = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+	if(!prof.timer_queries) fprintf(stderr, "No timer queries, the profiler only records CPU times\n");
+
+	if(prof.timer_queries) {
+		int i;
+		for(i = 0; i < PROFILER_MAX_SCOPES; i++) {
+			glGenQueries(2 * PROFILER_QUERY_BUFFERS, &prof.scopes[i].queries[0][0]);
+		}
+		glGenQueries(PROFILER_QUERY_BUFFERS, prof.frame_queries);
+	}
+
+	if(prof.overlay) {
+		prof.program = create_program(overlay_vs_source, overlay_fs_source);
+		if(!prof.program) return false;
+		glGenVertexArrays(1, &prof.vao);
+		glGenBuffers(1, &prof.vbo);
+	}
+
+	prof.initialized = true;
+	prof.buffer = 0;
+	prof.frame_numbers[0] = prof.frame;
+	prof.scopes[FRAME_SCOPE].cpu_start = now_ms();
+	if(prof.timer_queries) glBeginQuery(GL_TIME_ELAPSED, prof.frame_queries[0]);
+	return true;
+}
+
+void profiler_begin(int scope)
+{
+	if(!prof.initialized || scope <= FRAME_SCOPE) return;
+	Scope* s = &prof.scopes[scope];
+	if(prof.timer_queries) glQueryCounter(s->queries[prof.buffer][0], GL_TIMESTAMP);
+	s->cpu_start = now_ms();
+}
+
+void profiler_end(int scope)
+{
+	if(!prof.initialized || scope <= FRAME_SCOPE) return;
+	Scope* s = &prof.scopes[scope];
+	s->cpu_ms[prof.buffer] = now_ms() - s->cpu_start;
+	if(prof.timer_queries) glQueryCounter(s->queries[prof.buffer][1], GL_TIMESTAMP);
+	s->recorded[prof.buffer] = true;
+}
+
+static bool query_ready(GLuint query)
+{
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+	return available == GL_TRUE;
+}
+
+// the frame query ends after every scope of the frame, when it is ready they all are
+static bool frame_ready(int buffer)
+{
+	return !prof.timer_queries || query_ready(prof.frame_queries[buffer]);
+}
+
+// turns a finished frame into samples, with the GPU times if 'gpu' is set
+static void collect(int buffer, bool gpu)
+{
+	int i;
+	if(!prof.scopes[FRAME_SCOPE].recorded[buffer]) return;
+	if(prof.timer_queries && !gpu) prof.frames_without_gpu++;
+
+	for(i = 0; i < prof.num_scopes; i++) {
+		Scope* s = &prof.scopes[i];
+		if(!s->recorded[buffer]) continue;
+		s->recorded[buffer] = false;
+
+		ProfilerSample sample = { prof.frame_numbers[buffer], i, s->cpu_ms[buffer], -1 };
+		if(prof.timer_queries && gpu) {
+			GLuint64 begin, end;
+			if(i == FRAME_SCOPE) {
+				glGetQueryObjectui64v(prof.frame_queries[buffer], GL_QUERY_RESULT, &end);
+				sample.gpu_ms = end / 1000000.0;
+			}
+			else {
+				glGetQueryObjectui64v(s->queries[buffer][0], GL_QUERY_RESULT, &begin);
+				glGetQueryObjectui64v(s->queries[buffer][1], GL_QUERY_RESULT, &end);
+				sample.gpu_ms = (end - begin) / 1000000.0;
+			}
+		}
+		push_sample(&sample);
+	}
+}
+
+void profiler_next_frame()
+{
+	if(!prof.initialized) return;
+
+	// close the frame
+	Scope* frame = &prof.scopes[FRAME_SCOPE];
+	double now = now_ms();
+	frame->cpu_ms[prof.buffer] = now - frame->cpu_start;
+	frame->recorded[prof.buffer] = true;
+	if(prof.timer_queries) glEndQuery(GL_TIME_ELAPSED);
+
+	// oldest first, so that samples stay in frame order. the next buffer is the oldest
+	int i;
+	for(i = 1; i < PROFILER_QUERY_BUFFERS; i++) {
+		int buffer = (prof.buffer + i) % PROFILER_QUERY_BUFFERS;
+		if(!prof.scopes[FRAME_SCOPE].recorded[buffer]) continue;
+		if(!frame_ready(buffer)) break;
+		collect(buffer, true);
+	}
+
+	// a frame still waiting on the GPU after PROFILER_QUERY_BUFFERS - 1 others gives up its GPU times
+	prof.buffer = (prof.buffer + 1) % PROFILER_QUERY_BUFFERS;
+	collect(prof.buffer, false);
+
+	prof.frame++;
+	prof.frame_numbers[prof.buffer] = prof.frame;
+	frame->cpu_start = now;
+	if(prof.timer_queries) glBeginQuery(GL_TIME_ELAPSED, prof.frame_queries[prof.buffer]);
+}
+
+void profiler_shutdown()
+{
+	if(!prof.initialized) return;
+	if(prof.timer_queries) glEndQuery(GL_TIME_ELAPSED);
+
+	// the frames still pending, waiting for their results is fine at exit. the open frame is not counted
+	int i;
+	for(i = 1; i < PROFILER_QUERY_BUFFERS; i++) {
+		collect((prof.buffer + i) % PROFILER_QUERY_BUFFERS, true);
+	}
+
+	if(prof.output) {
+		size_t length = strlen(prof.output);
+		bool csv = length >= 4 && strcmp(prof.output + length - 4, ".csv") == 0;
+		if(csv ? profiler_write_csv(prof.output) : profiler_write_json(prof.output)) {
+			printf("Wrote frame times to '%s'\n", prof.output);
+		}
+	}
+	if(prof.frames_without_gpu) {
+		printf("Profiler recorded %u frames without GPU times, they were not ready in time\n", prof.frames_without_gpu);
+	}
+
+	if(prof.timer_queries) {
+		for(i = 0; i < PROFILER_MAX_SCOPES; i++) {
+			glDeleteQueries(2 * PROFILER_QUERY_BUFFERS, &prof.scopes[i].queries[0][0]);
+		}
+		glDeleteQueries(PROFILER_QUERY_BUFFERS, prof.frame_queries);
+	}
+	if(prof.program) {
+		glDeleteProgram(prof.program);
+		glDeleteVertexArrays(1, &prof.vao);
+		glDeleteBuffers(1, &prof.vbo);
+	}
+	prof.initialized = false;
+}
+
+// export
+
+typedef struct {
+	int count;
+	float p50, p90, p99, max;
+} Percentiles;
+
+static int compare_floats(const void* a, const void* b)
+{
+	float x = *(const float*) a, y = *(const float*) b;
+	return (x > y) - (x < y);
+}
+
+// nearest rank percentiles, sorts 'values'
+static Percentiles percentiles(float* values, int count)
+{
+	Percentiles p = { count, 0, 0, 0, 0 };
+	if(count == 0) return p;
+	qsort(values, count, sizeof(float), compare_floats);
+	p.p50 = values[(count - 1) * 50 / 100];
+	p.p90 = values[(count - 1) * 90 / 100];
+	p.p99 = values[(count - 1) * 99 / 100];
+	p.max = values[count - 1];
+	return p;
+}
+
+// cpu and gpu percentiles of every scope. returns false when out of memory
+static bool scope_percentiles(Percentiles* cpu, Percentiles* gpu)
+{
+	ProfilerSample* samples = malloc(PROFILER_RING_SIZE * sizeof(ProfilerSample));
+	float* values = malloc(PROFILER_RING_SIZE * sizeof(float));
+	if(!samples || !values) {
+		free(samples);
+		free(values);
+		return false;
+	}
+	int num_samples = profiler_read_samples(samples, PROFILER_RING_SIZE);
+
+	int scope, i, n;
+	for(scope = 0; scope < prof.num_scopes; scope++) {
+		for(i = 0, n = 0; i < num_samples; i++) {
+			if(samples[i].scope == (uint32_t) scope) values[n++] = samples[i].cpu_ms;
+		}
+		cpu[scope] = percentiles(values, n);
+		for(i = 0, n = 0; i < num_samples; i++) {
+			if(samples[i].scope == (uint32_t) scope && samples[i].gpu_ms >= 0) values[n++] = samples[i].gpu_ms;
+		}
+		gpu[scope] = percentiles(values, n);
+	}
+	free(samples);
+	free(values);
+	return true;
+}
+
+int profiler_write_csv(const char* path)
+{
+	Percentiles cpu[PROFILER_MAX_SCOPES], gpu[PROFILER_MAX_SCOPES];
+	if(!scope_percentiles(cpu, gpu)) return false;
+
+	FILE* file = fopen(path, "w");
+	if(!file) {
+		fprintf(stderr, "Could not write '%s'\n", path);
+		return false;
+	}
+	fprintf(file, "scope,samples,cpu_p50_ms,cpu_p90_ms,cpu_p99_ms,cpu_max_ms,gpu_samples,gpu_p50_ms,gpu_p90_ms,gpu_p99_ms,gpu_max_ms\n");
+	int i;
+	for(i = 0; i < prof.num_scopes; i++) {
+		fprintf(file, "%s,%d,%.4f,%.4f,%.4f,%.4f,%d,%.4f,%.4f,%.4f,%.4f\n", prof.scopes[i].name,
+		        cpu[i].count, cpu[i].p50, cpu[i].p90, cpu[i].p99, cpu[i].max,
+		        gpu[i].count, gpu[i].p50, gpu[i].p90, gpu[i].p99, gpu[i].max);
+	}
+	return fclose(file) == 0;
+}
+
+static void write_json_percentiles(FILE* file, const char* name, const Percentiles* p)
+{
+	fprintf(file, "\"%s\": {\"samples\": %d, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+	        name, p->count, p->p50, p->p90, p->p99, p->max);
+}
+
+int profiler_write_json(const char* path)
+{
+	Percentiles cpu[PROFILER_MAX_SCOPES], gpu[PROFILER_MAX_SCOPES];
+	if(!scope_percentiles(cpu, gpu)) return false;
+
+	FILE* file = fopen(path, "w");
+	if(!file) {
+		fprintf(stderr, "Could not write '%s'\n", path);
+		return false;
+	}
+	// scope names are plain identifiers, no escaping needed
+	fprintf(file, "{\n  \"frames\": %u,\n  \"frames_without_gpu\": %u,\n  \"scopes\": [\n", prof.frame, prof.frames_without_gpu);
+	int i;
+	for(i = 0; i < prof.num_scopes; i++) {
+		fprintf(file, "    {\"name\": \"%s\", ", prof.scopes[i].name);
+		write_json_percentiles(file, "cpu_ms", &cpu[i]);
+		fprintf(file, ", ");
+		write_json_percentiles(file, "gpu_ms", &gpu[i]);
+		fprintf(file, "}%s\n", i + 1 < prof.num_scopes ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+	return fclose(file) == 0;
+}
+
+// overlay
+
+typedef struct {
+	GLfloat x, y;
+	GLubyte color[4];
+} OverlayVertex;
+
+static OverlayVertex* add_rect(OverlayVertex* v, const GLint* viewport, float x0, float y0, float x1, float y1, const GLubyte* color)
+{
+	// pixels from the top left of the viewport to NDC
+	float l = x0 / viewport[2] * 2 - 1, r = x1 / viewport[2] * 2 - 1;
+	float t = 1 - y0 / viewport[3] * 2, b = 1 - y1 / viewport[3] * 2;
+	OverlayVertex corners[6] = {
+		{ l, b, { color[0], color[1], color[2], color[3] } }, { r, b, { color[0], color[1], color[2], color[3] } },
+		{ r, t, { color[0], color[1], color[2], color[3] } }, { l, b, { color[0], color[1], color[2], color[3] } },
+		{ r, t, { color[0], color[1], color[2], color[3] } }, { l, t, { color[0], color[1], color[2], color[3] } }
+	};
+	memcpy(v, corners, sizeof(corners));
+	return v + 6;
+}
+
+void profiler_show_overlay(int show)
+{
+	prof.overlay = show;
+	if(show && prof.initialized && !prof.program) {
+		prof.program = create_program(overlay_vs_source, overlay_fs_source);
+		if(!prof.program) return;
+		glGenVertexArrays(1, &prof.vao);
+		glGenBuffers(1, &prof.vbo);
+	}
+}
+
+void profiler_draw_overlay()
+{
+	if(!prof.initialized || !prof.overlay || !prof.program) return;
+
+	static const GLubyte palette[][4] = {
+		{ 255, 255, 255, 255 }, { 90, 200, 90, 255 }, { 90, 150, 240, 255 }, { 240, 180, 60, 255 },
+		{ 220, 90, 200, 255 }, { 80, 210, 210, 255 }, { 240, 100, 90, 255 }, { 180, 180, 100, 255 }
+	};
+	static const GLubyte background[4] = { 0, 0, 0, 160 };
+	static const GLubyte mark[4] = { 255, 255, 255, 96 };
+
+	if(!prof.legend_printed) {
+		int i;
+		printf("Profiler overlay rows:");
+		for(i = 0; i < prof.num_scopes; i++) printf(" %s%s", prof.scopes[i].name, i + 1 < prof.num_scopes ? "," : "\n");
+		prof.legend_printed = true;
+	}
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	// background, one frame mark, and two bars per scope
+	OverlayVertex vertices[6 * (2 + 2 * PROFILER_MAX_SCOPES)];
+	OverlayVertex* v = vertices;
+	float scale = OVERLAY_WIDTH / OVERLAY_RANGE_MS;
+	float height = prof.num_scopes * 2 * OVERLAY_ROW_HEIGHT + (prof.num_scopes + 1) * 2;
+	v = add_rect(v, viewport, 0, 0, OVERLAY_WIDTH + 4, height, background);
+	v = add_rect(v, viewport, 2 + OVERLAY_WIDTH / 2, 0, 3 + OVERLAY_WIDTH / 2, height, mark);
+
+	int i;
+	for(i = 0; i < prof.num_scopes; i++) {
+		Scope* s = &prof.scopes[i];
+		const GLubyte* color = palette[i % (sizeof(palette) / sizeof(palette[0]))];
+		GLubyte dim[4] = { color[0] / 2, color[1] / 2, color[2] / 2, 255 };
+		float y = 2 + i * (2 * OVERLAY_ROW_HEIGHT + 2);
+		float cpu = s->shown_cpu_ms * scale, gpu = s->shown_gpu_ms * scale;
+		v = add_rect(v, viewport, 2, y, 2 + (cpu < OVERLAY_WIDTH ? cpu : OVERLAY_WIDTH), y + OVERLAY_ROW_HEIGHT, color);
+		v = add_rect(v, viewport, 2, y + OVERLAY_ROW_HEIGHT, 2 + (gpu < OVERLAY_WIDTH ? gpu : OVERLAY_WIDTH), y + 2 * OVERLAY_ROW_HEIGHT, dim);
+	}
+
+	// the examples keep their state bound across frames, put it back afterwards
+	GLint program, vao, array_buffer, blend_src, blend_dst;
+	GLboolean blend = glIsEnabled(GL_BLEND);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vao);
+	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &array_buffer);
+	glGetIntegerv(GL_BLEND_SRC_ALPHA, &blend_src);
+	glGetIntegerv(GL_BLEND_DST_ALPHA, &blend_dst);
+
+	glUseProgram(prof.program);
+	glBindVertexArray(prof.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, prof.vbo);
+	glBufferData(GL_ARRAY_BUFFER, (v - vertices) * sizeof(OverlayVertex), vertices, GL_STREAM_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex), (GLvoid*) 0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(OverlayVertex), (GLvoid*) (2 * sizeof(GLfloat)));
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawArrays(GL_TRIANGLES, 0, v - vertices);
+
+	glBlendFunc(blend_src, blend_dst);
+	if(!blend) glDisable(GL_BLEND);
+	glBindBuffer(GL_ARRAY_BUFFER, array_buffer);
+	glBindVertexArray(vao);
+	glUseProgram(program);
+}
@@ -0,0 +1,104 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - CPU and GPU frame profiler
+ *
+ * Times named scopes of a frame on the CPU with a monotonic clock, and on the GPU with
+ * GL_TIMESTAMP queries around the same scope (they nest, unlike GL_TIME_ELAPSED, which
+ * times the whole frame instead). Query results arrive a few frames late: each frame has its own set
+ * of queries in a ring, and a frame is only read once GL_QUERY_RESULT_AVAILABLE says its results are
+ * there, so reading them never stalls the pipeline. A frame whose results are still not ready when
+ * its queries are needed again keeps its CPU times and gets no GPU times, it is never dropped.
+ *
+ * Samples go to a fixed size lock-free ring buffer, written by the render thread only.
+ * They can be read from any thread while frames are being recorded, eg. to stream them.
+ * At exit, per scope percentiles (p50, p90, p99, max) of what is in the ring are exported
+ * to CSV or JSON, and an overlay draws the last times as bars over the frame.
+ *
+ *   int scope_display = profiler_scope("display");
+ *   while(...) {
+ *       profiler_begin(scope_display);
+ *       display();
+ *       profiler_end(scope_display);
+ *       profiler_draw_overlay();
+ *       glfwSwapBuffers(window);
+ *       profiler_next_frame();
+ *   }
+ *   profiler_shutdown();
+ *
+ * Examples enable it from the command line:
+ *   --profile times.json   writes the percentiles at exit, CSV if the file name ends in .csv
+ *   --overlay              draws the overlay: one row per scope, the CPU time above the GPU time,
+ *                          with a mark every 1/60 s. The frame is the first row
+ *
+ * Without OpenGL 3.3 or ARB_timer_query, only CPU times are recorded.
+ * Requires a current OpenGL context and GLEW to be initialized before profiler_init().
+ */
+
+#ifndef OPENGL_PLAYGROUND_PROFILER_H
+#define OPENGL_PLAYGROUND_PROFILER_H
+
+#include <GL/glew.h>
+#include <stdint.h>
+
+#define PROFILER_MAX_SCOPES 32
+#define PROFILER_RING_SIZE 8192  // samples kept, power of 2
+#define PROFILER_QUERY_BUFFERS 4 // frames of queries in flight
+
+typedef struct {
+	uint32_t frame;
+	uint32_t scope;          // 0 is the whole frame
+	float cpu_ms;
+	float gpu_ms;            // negative when the GPU time is unknown
+} ProfilerSample;
+
+// reads --profile and --overlay, ignoring any other flags
+void profiler_parse_args(int argc, char** argv);
+// creates the queries and overlay resources. returns 0 on failure
+int profiler_init();
+// exports the percentiles if --profile was given, and releases everything
+void profiler_shutdown();
+
+// the id of the scope with this name, registering it on first use. -1 when there are too many.
+// the name must stay valid
+int profiler_scope(const char* name);
+// each scope can be timed once per frame, scopes may nest
+void profiler_begin(int scope);
+void profiler_end(int scope);
+// closes the frame, after the swap. collects the results of the previous frame
+void profiler_next_frame();
+
+// copies up to 'max' of the most recent samples into 'out', oldest first. returns how many.
+// safe to call from another thread than the one recording
+int profiler_read_samples(ProfilerSample* out, int max);
+// writes per scope percentiles of the samples in the ring. returns 0 on failure
+int profiler_write_csv(const char* path);
+int profiler_write_json(const char* path);
+
+// draws the overlay if --overlay was given (or profiler_show_overlay()), in the top left corner of the viewport
+void profiler_draw_overlay();
+void profiler_show_overlay(int show);
+
+#endif // OPENGL_PLAYGROUND_PROFILER_H
@@ -0,0 +1,245 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - On demand redraw with damage tracking
+ *
+ * See redraw.h
+ */
+
+#include "redraw.h"
+
+#include <stdio.h>
+#include <string.h>
+
+typedef enum { false, true } bool;
+
+#define DAMAGE_MARGIN 1 // pixels around a damaged rectangle, for edges that rasterize or filter into a neighbour
+
+void redraw_parse_args(RedrawScheduler* redraw, int argc, char** argv)
+{
+	memset(redraw, 0, sizeof(RedrawScheduler));
+	atomic_init(&redraw->posted, false);
+	redraw->timeout = REDRAW_DEFAULT_TIMEOUT;
+	int i;
+	for(i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--continuous") == 0 || strcmp(argv[i], "--overlay") == 0) redraw->continuous = true;
+	}
+}
+
+// canvas
+
+static bool resize_canvas(RedrawScheduler* redraw, int width, int height)
+{
+	if(width < 1) width = 1; // minimized
+	if(height < 1) height = 1;
+	glBindRenderbuffer(GL_RENDERBUFFER, redraw->color_rb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	redraw->width = width;
+	redraw->height = height;
+	redraw_damage_all(redraw);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, redraw->fbo);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if(status != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "Redraw canvas of %dx%d is incomplete (0x%x)\n", width, height, status);
+		return false;
+	}
+	return true;
+}
+
+// callbacks
+
+static void framebuffer_size_cb(GLFWwindow* window, int width, int height)
+{
+	RedrawScheduler* redraw = glfwGetWindowUserPointer(window);
+	resize_canvas(redraw, width, height);
+}
+
+static void refresh_cb(GLFWwindow* window)
+{
+	// the canvas still has the last frame, it only has to be shown again
+	RedrawScheduler* redraw = glfwGetWindowUserPointer(window);
+	redraw->present = true;
+}
+
+int redraw_init(RedrawScheduler* redraw, GLFWwindow* window)
+{
+	redraw->window = window;
+	if(redraw->timeout <= 0) redraw->timeout = REDRAW_DEFAULT_TIMEOUT;
+
+	glGenFramebuffers(1, &redraw->fbo);
+	glGenRenderbuffers(1, &redraw->color_rb);
+	glBindRenderbuffer(GL_RENDERBUFFER, redraw->color_rb); // names only become renderbuffers once bound
+	glBindFramebuffer(GL_FRAMEBUFFER, redraw->fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, redraw->color_rb);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+	if(!resize_canvas(redraw, width, height)) {
+		redraw_free(redraw);
+		return false;
+	}
+
+	glfwSetWindowUserPointer(window, redraw);
+	glfwSetFramebufferSizeCallback(window, framebuffer_size_cb);
+	glfwSetWindowRefreshCallback(window, refresh_cb);
+	return true;
+}
+
+void redraw_free(RedrawScheduler* redraw)
+{
+	if(redraw->window) {
+		glfwSetFramebufferSizeCallback(redraw->window, NULL);
+		glfwSetWindowRefreshCallback(redraw->window, NULL);
+	}
+	glDeleteFramebuffers(1, &redraw->fbo);
+	glDeleteRenderbuffers(1, &redraw->color_rb);
+	redraw->fbo = redraw->color_rb = 0;
+}
+
+// damage
+
+void redraw_damage_all(RedrawScheduler* redraw)
+{
+	redraw_damage_rect(redraw, 0, 0, redraw->width, redraw->height);
+}
+
+void redraw_post(RedrawScheduler* redraw)
+{
+	// the damage itself is only touched by the loop's thread, in has_work()
+	atomic_store(&redraw->posted, true);
+	glfwPostEmptyEvent();
+}
+
+void redraw_damage_rect(RedrawScheduler* redraw, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	// clip to the canvas
+	GLint x0 = x < 0 ? 0 : x;
+	GLint y0 = y < 0 ? 0 : y;
+	GLint x1 = x + width > redraw->width ? redraw->width : x + width;
+	GLint y1 = y + height > redraw->height ? redraw->height : y + height;
+	if(x1 <= x0 || y1 <= y0) return;
+
+	if(redraw->damaged) {
+		DamageRect* d = &redraw->damage;
+		if(d->x < x0) x0 = d->x;
+		if(d->y < y0) y0 = d->y;
+		if(d->x + d->width > x1) x1 = d->x + d->width;
+		if(d->y + d->height > y1) y1 = d->y + d->height;
+	}
+	redraw->damage.x = x0;
+	redraw->damage.y = y0;
+	redraw->damage.width = x1 - x0;
+	redraw->damage.height = y1 - y0;
+	redraw->damaged = true;
+}
+
+void redraw_damage_ndc(RedrawScheduler* redraw, float x0, float y0, float x1, float y1)
+{
+	// the viewport maps normalized device coordinates to pixels
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	float left = viewport[0] + (x0 + 1.0f) * 0.5f * viewport[2];
+	float right = viewport[0] + (x1 + 1.0f) * 0.5f * viewport[2];
+	float bottom = viewport[1] + (y0 + 1.0f) * 0.5f * viewport[3];
+	float top = viewport[1] + (y1 + 1.0f) * 0.5f * viewport[3];
+	GLint x = (GLint)left - DAMAGE_MARGIN;
+	GLint y = (GLint)bottom - DAMAGE_MARGIN;
+	redraw_damage_rect(redraw, x, y, (GLint)right + 1 + DAMAGE_MARGIN - x, (GLint)top + 1 + DAMAGE_MARGIN - y);
+}
+
+// frames
+
+// picks up what other threads posted
+static bool has_work(RedrawScheduler* redraw)
+{
+	if(atomic_exchange(&redraw->posted, false)) redraw_damage_all(redraw);
+	return redraw->damaged || redraw->present;
+}
+
+int redraw_wait(RedrawScheduler* redraw)
+{
+	if(redraw->continuous) {
+		glfwPollEvents();
+		redraw_damage_all(redraw);
+		return !glfwWindowShouldClose(redraw->window);
+	}
+
+	// already damaged: handle what is queued, but do not wait
+	if(has_work(redraw)) glfwPollEvents();
+	while(!has_work(redraw)) {
+		if(glfwWindowShouldClose(redraw->window)) return false;
+		glfwWaitEventsTimeout(redraw->timeout);
+		redraw->wakeups++;
+	}
+	return !glfwWindowShouldClose(redraw->window);
+}
+
+static bool is_partial(const RedrawScheduler* redraw)
+{
+	const DamageRect* d = &redraw->damage;
+	return d->x > 0 || d->y > 0 || d->width < redraw->width || d->height < redraw->height;
+}
+
+int redraw_begin(RedrawScheduler* redraw)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, redraw->fbo);
+	if(!redraw->damaged) return false;
+
+	if(is_partial(redraw)) {
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(redraw->damage.x, redraw->damage.y, redraw->damage.width, redraw->damage.height);
+	}
+	return true;
+}
+
+void redraw_end(RedrawScheduler* redraw)
+{
+	if(redraw->damaged) {
+		redraw->frames++;
+		if(is_partial(redraw)) {
+			redraw->partial_frames++;
+			glDisable(GL_SCISSOR_TEST);
+		}
+	}
+
+	// the back buffer is undefined after a swap, the whole canvas goes to it
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, redraw->fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, redraw->width, redraw->height, 0, 0, redraw->width, redraw->height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	redraw->damaged = false;
+	redraw->present = false;
+}
+
+void redraw_print_stats(const RedrawScheduler* redraw)
+{
+	printf("Redraw: %lu frames drawn, %lu of them partial, after %lu waits for events\n",
+		redraw->frames, redraw->partial_frames, redraw->wakeups);
+}
@@ -0,0 +1,113 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - On demand redraw with damage tracking
+ *
+ * Static scenes do not need to be drawn 60 times a second. The scheduler blocks in
+ * glfwWaitEventsTimeout() until something changes, and only then draws a frame:
+ * input handlers mark what they changed as damaged, and a resized or exposed window damages
+ * (or just presents) the whole of it.
+ *
+ * Frames are drawn into a persistent offscreen canvas, not into the back buffer, whose contents
+ * are undefined after a swap. Only the damaged rectangle is drawn, with the scissor test on
+ * (glClear() also respects it), then the whole canvas is blitted to the back buffer and swapped:
+ *
+ *   RedrawScheduler redraw;
+ *   redraw_parse_args(&redraw, argc, argv);
+ *   redraw_init(&redraw, window);        // after the context is current
+ *   while(redraw_wait(&redraw)) {        // returns 0 when the window should close
+ *       if(redraw_begin(&redraw)) display();
+ *       redraw_end(&redraw);
+ *       glfwSwapBuffers(window);
+ *   }
+ *
+ * and from a key callback: redraw_damage_ndc(&redraw, -0.75, -0.75, 0.75, 0.75);
+ *
+ * Other threads changing the scene call redraw_post(), the only function safe to call from them,
+ * which damages everything and wakes the loop.
+ * '--continuous' draws every frame as before, it is also turned on by the profiler's '--overlay',
+ * which needs a frame to update its bars.
+ *
+ * The canvas only has a color buffer. Requires OpenGL 3.0, GLFW 3.2 and GLEW to be initialized before use.
+ */
+
+#ifndef OPENGL_PLAYGROUND_REDRAW_H
+#define OPENGL_PLAYGROUND_REDRAW_H
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <stdatomic.h>
+
+#define REDRAW_DEFAULT_TIMEOUT 1.0 // seconds between checks when nothing wakes the loop
+
+typedef struct {
+	GLint x, y;                    // bottom left corner, in framebuffer pixels like glScissor
+	GLsizei width, height;
+} DamageRect;
+
+typedef struct {
+	GLFWwindow* window;
+	int continuous;                // --continuous: every frame is fully damaged
+	double timeout;
+
+	int damaged;                   // 'damage' must be drawn
+	int present;                   // the canvas must be shown again, eg. the window was exposed
+	DamageRect damage;             // union of everything damaged since the last frame
+	atomic_int posted;             // redraw_post() was called from another thread
+
+	GLuint fbo, color_rb;          // canvas
+	int width, height;
+
+	// statistics
+	unsigned long frames, partial_frames, wakeups;
+} RedrawScheduler;
+
+// reads --continuous (and --overlay), ignoring any other flags
+void redraw_parse_args(RedrawScheduler* redraw, int argc, char** argv);
+// creates the canvas and hooks the window's framebuffer size and refresh callbacks.
+// damages everything so the first frame is drawn. returns 0 on failure
+int redraw_init(RedrawScheduler* redraw, GLFWwindow* window);
+void redraw_free(RedrawScheduler* redraw);
+
+// everything must be drawn again
+void redraw_damage_all(RedrawScheduler* redraw);
+// damages a rectangle in framebuffer pixels, bottom left origin
+void redraw_damage_rect(RedrawScheduler* redraw, GLint x, GLint y, GLsizei width, GLsizei height);
+// damages a rectangle in normalized device coordinates, the coordinates the examples draw in
+void redraw_damage_ndc(RedrawScheduler* redraw, float x0, float y0, float x1, float y1);
+// damages everything and wakes redraw_wait(), from any thread
+void redraw_post(RedrawScheduler* redraw);
+
+// handles events, blocking until there is a frame to draw. returns 0 when the window should close
+int redraw_wait(RedrawScheduler* redraw);
+// binds the canvas and scissors to the damage. returns 0 when nothing has to be drawn, only presented
+int redraw_begin(RedrawScheduler* redraw);
+// copies the canvas to the back buffer and clears the damage. the swap is left to the caller
+void redraw_end(RedrawScheduler* redraw);
+// prints how many frames were drawn, and how often the loop waited for events
+void redraw_print_stats(const RedrawScheduler* redraw);
+
+#endif // OPENGL_PLAYGROUND_REDRAW_H
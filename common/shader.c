@@ -0,0 +1,504 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Shared shader compilation with a program binary cache
+ *
+ * See shader.h for usage.
+ */
+
+#include "shader.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+typedef enum { false, true } bool;
+
+// on-disk layout of a cache entry: header followed by 'length' bytes of driver binary
+#define SHADER_CACHE_MAGIC 0x42504C47 // "GLPB"
+#define SHADER_CACHE_VERSION 1
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t format; // GLenum given by glGetProgramBinary
+	uint32_t length;
+} ShaderCacheHeader;
+
+static const char* shader_cache_dir = SHADER_CACHE_DEFAULT_DIR;
+
+void shader_cache_set_dir(const char* dir)
+{
+	shader_cache_dir = dir;
+}
+
+// hashing
+
+// 64 bit FNV-1a. not cryptographic, only needs to tell sources and drivers apart
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = data;
+	size_t i;
+	for(i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+static uint64_t hash_string(uint64_t hash, const char* str)
+{
+	// include the terminator so that ("ab", "c") and ("a", "bc") differ
+	return hash_bytes(hash, str ? str : "", str ? strlen(str) + 1 : 1);
+}
+
+static uint64_t program_cache_key(const char* vs_source, const char* fs_source)
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	hash = hash_string(hash, (const char*) glGetString(GL_VENDOR));
+	hash = hash_string(hash, (const char*) glGetString(GL_RENDERER));
+	hash = hash_string(hash, (const char*) glGetString(GL_VERSION));
+	hash = hash_string(hash, vs_source);
+	hash = hash_string(hash, fs_source);
+	return hash;
+}
+
+// binary cache
+
+static bool program_binary_supported()
+{
+	if(!shader_cache_dir) return false;
+	if(!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) return false;
+
+	// some drivers expose the entry points but no formats at all
+	GLint num_formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+	return num_formats > 0;
+}
+
+static void program_cache_path(char* path, size_t size, uint64_t key)
+{
+	snprintf(path, size, "%s/%016llx.bin", shader_cache_dir, (unsigned long long) key);
+}
+
+static bool load_program_binary(GLuint program, uint64_t key)
+{
+	char path[1024];
+	program_cache_path(path, sizeof(path), key);
+
+	FILE* file = fopen(path, "rb");
+	if(!file) return false; // not cached yet
+
+	ShaderCacheHeader header;
+	void* binary = NULL;
+	GLint is_link_ok = GL_FALSE;
+
+	if(fread(&header, sizeof(header), 1, file) != 1
+	   || header.magic != SHADER_CACHE_MAGIC
+	   || header.version != SHADER_CACHE_VERSION
+	   || header.key != key
+	   || header.length == 0) {
+		fprintf(stderr, "Ignoring invalid shader cache entry '%s'\n", path);
+		fclose(file);
+		return false;
+	}
+
+	binary = malloc(header.length);
+	if(binary && fread(binary, 1, header.length, file) == header.length) {
+		glProgramBinary(program, header.format, binary, header.length);
+		// the driver may reject a binary that it produced itself, eg. after an update with the same version string
+		glGetProgramiv(program, GL_LINK_STATUS, &is_link_ok);
+	}
+	free(binary);
+	fclose(file);
+
+	if(!is_link_ok) {
+		fprintf(stderr, "Shader cache entry '%s' was rejected by the driver, recompiling\n", path);
+	}
+	return is_link_ok;
+}
+
+static void save_program_binary(GLuint program, uint64_t key)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0) return;
+
+	ShaderCacheHeader header = { SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, key, 0, 0 };
+	void* binary = malloc(length);
+	if(!binary) return;
+
+	GLsizei written = 0;
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &written, &format, binary);
+	header.format = format;
+	header.length = written;
+
+	char path[1024], tmp_path[1040];
+	program_cache_path(path, sizeof(path), key);
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+	mkdir(shader_cache_dir, 0755); // fails harmlessly if it already exists
+
+	// write to a temporary file first so that a concurrent start never reads a partial entry
+	FILE* file = fopen(tmp_path, "wb");
+	if(file) {
+		bool ok = written > 0
+		          && fwrite(&header, sizeof(header), 1, file) == 1
+		          && fwrite(binary, 1, written, file) == (size_t) written;
+		ok = (fclose(file) == 0) && ok;
+		if(!ok || rename(tmp_path, path) != 0) {
+			fprintf(stderr, "Could not write shader cache entry '%s'\n", path);
+			remove(tmp_path);
+		}
+	}
+	free(binary);
+}
+
+// batched compilation
+
+typedef enum {
+	SHADER_ENTRY_QUEUED,    // added, nothing sent to the driver yet
+	SHADER_ENTRY_SUBMITTED, // compile and link issued, status not queried yet
+	SHADER_ENTRY_OK,
+	SHADER_ENTRY_FAILED
+} ShaderEntryState;
+
+typedef struct {
+	const char* vs_source;
+	const char* fs_source;
+	GLuint vs, fs, program;
+	GLuint fallback;
+	uint64_t key;
+	ShaderEntryState state;
+} ShaderBatchEntry;
+
+struct ShaderBatch {
+	ShaderBatchEntry* entries;
+	int count, capacity;
+	bool use_cache;
+	bool parallel; // KHR_parallel_shader_compile is available
+};
+
+ShaderBatch* shader_batch_create()
+{
+	ShaderBatch* batch = calloc(1, sizeof(ShaderBatch));
+	if(!batch) return NULL;
+	batch->use_cache = program_binary_supported();
+	batch->parallel = GLEW_KHR_parallel_shader_compile;
+	return batch;
+}
+
+void shader_batch_destroy(ShaderBatch* batch)
+{
+	if(!batch) return;
+	// programs that were handed out belong to the caller, only release what never finished
+	int i;
+	for(i = 0; i < batch->count; i++) {
+		ShaderBatchEntry* e = &batch->entries[i];
+		if(e->state == SHADER_ENTRY_SUBMITTED) {
+			glDeleteShader(e->vs);
+			glDeleteShader(e->fs);
+			glDeleteProgram(e->program);
+		}
+	}
+	free(batch->entries);
+	free(batch);
+}
+
+int shader_batch_add(ShaderBatch* batch, const char* vs_source, const char* fs_source, GLuint fallback)
+{
+	if(batch->count == batch->capacity) {
+		int capacity = batch->capacity ? batch->capacity * 2 : 16;
+		ShaderBatchEntry* entries = realloc(batch->entries, capacity * sizeof(ShaderBatchEntry));
+		if(!entries) return -1;
+		batch->entries = entries;
+		batch->capacity = capacity;
+	}
+
+	ShaderBatchEntry* e = &batch->entries[batch->count];
+	memset(e, 0, sizeof(*e));
+	e->vs_source = vs_source;
+	e->fs_source = fs_source;
+	e->fallback = fallback;
+	e->state = SHADER_ENTRY_QUEUED;
+	return batch->count++;
+}
+
+static void print_info_log(GLuint object, bool is_program)
+{
+	GLint written = 0, logSize = 0;
+	if(is_program) glGetProgramiv(object, GL_INFO_LOG_LENGTH, &logSize);
+	else glGetShaderiv(object, GL_INFO_LOG_LENGTH, &logSize);
+	if(logSize <= 0) return;
+
+	GLchar buf[logSize];
+	if(is_program) glGetProgramInfoLog(object, logSize, &written, buf);
+	else glGetShaderInfoLog(object, logSize, &written, buf);
+	if(written) {
+		fprintf(stderr, "%s", buf);
+		if(logSize != written+1) { // +1 for NULL terminating character
+			fprintf(stderr, "... missing %d characters!\n", logSize-written+1);
+		}
+	}
+}
+
+static bool shader_compiled(GLuint shader, GLenum shader_type)
+{
+	GLint is_compile_ok = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compile_ok);
+	fprintf(stdout, "Compiling %s Shader...  %s!\n", shader_type==GL_VERTEX_SHADER? "Vertex" : "Fragment", is_compile_ok? "OK" : "FAILED");
+	print_info_log(shader, false);
+	return is_compile_ok;
+}
+
+// queries the results of a submitted entry. blocks if the driver is still compiling it
+static void collect_entry(ShaderBatch* batch, ShaderBatchEntry* e)
+{
+	GLint is_link_ok = GL_FALSE;
+	glGetProgramiv(e->program, GL_LINK_STATUS, &is_link_ok);
+
+	// report each shader, so that warnings in their logs show up even when everything linked
+	bool vs_ok = shader_compiled(e->vs, GL_VERTEX_SHADER);
+	bool fs_ok = shader_compiled(e->fs, GL_FRAGMENT_SHADER);
+	if(vs_ok && fs_ok && !is_link_ok) {
+		fprintf(stderr, "Program didn't link\n");
+		print_info_log(e->program, true);
+	}
+
+	glDetachShader(e->program, e->vs);
+	glDetachShader(e->program, e->fs);
+	glDeleteShader(e->vs);
+	glDeleteShader(e->fs);
+	e->vs = e->fs = 0;
+
+	if(!is_link_ok) {
+		glDeleteProgram(e->program);
+		e->program = 0;
+		e->state = SHADER_ENTRY_FAILED;
+		return;
+	}
+
+	if(batch->use_cache) {
+		save_program_binary(e->program, e->key);
+	}
+	e->state = SHADER_ENTRY_OK;
+}
+
+void shader_batch_submit(ShaderBatch* batch)
+{
+	int i;
+
+	if(batch->parallel) {
+		// let the driver pick how many compiler threads to use
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+
+	// programs in the binary cache are ready right away, the others get their shaders compiled.
+	// no status is queried in between, so the driver is free to work on all of them at once
+	for(i = 0; i < batch->count; i++) {
+		ShaderBatchEntry* e = &batch->entries[i];
+		if(e->state != SHADER_ENTRY_QUEUED) continue;
+
+		if(batch->use_cache) {
+			e->key = program_cache_key(e->vs_source, e->fs_source);
+			e->program = glCreateProgram();
+			if(load_program_binary(e->program, e->key)) {
+				fprintf(stdout, "Loaded program from shader cache (%016llx)\n", (unsigned long long) e->key);
+				e->state = SHADER_ENTRY_OK;
+				continue;
+			}
+			// start over with a fresh program object instead of relinking one that holds a rejected binary
+			glDeleteProgram(e->program);
+		}
+
+		e->vs = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(e->vs, 1, &e->vs_source, NULL);
+		glCompileShader(e->vs);
+		e->fs = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(e->fs, 1, &e->fs_source, NULL);
+		glCompileShader(e->fs);
+		e->state = SHADER_ENTRY_SUBMITTED;
+	}
+
+	// linking does not need the compile status, a failed shader simply makes the link fail
+	for(i = 0; i < batch->count; i++) {
+		ShaderBatchEntry* e = &batch->entries[i];
+		if(e->state != SHADER_ENTRY_SUBMITTED) continue;
+
+		e->program = glCreateProgram();
+		if(batch->use_cache) {
+			// hint to the driver that we will ask for the binary, so it keeps it around
+			glProgramParameteri(e->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+		glAttachShader(e->program, e->vs);
+		glAttachShader(e->program, e->fs);
+		glLinkProgram(e->program);
+	}
+}
+
+int shader_batch_is_ready(ShaderBatch* batch, int index)
+{
+	ShaderBatchEntry* e = &batch->entries[index];
+	if(e->state == SHADER_ENTRY_QUEUED) return false;
+
+	if(e->state == SHADER_ENTRY_SUBMITTED) {
+		if(batch->parallel) {
+			GLint is_complete = GL_FALSE;
+			glGetProgramiv(e->program, GL_COMPLETION_STATUS_KHR, &is_complete);
+			if(!is_complete) return false;
+		}
+		// without the extension there is no way to ask without waiting, so this blocks
+		collect_entry(batch, e);
+	}
+	return true;
+}
+
+GLuint shader_batch_program(ShaderBatch* batch, int index)
+{
+	ShaderBatchEntry* e = &batch->entries[index];
+	return e->state == SHADER_ENTRY_OK ? e->program : e->fallback;
+}
+
+int shader_batch_wait(ShaderBatch* batch, int index)
+{
+	ShaderBatchEntry* e = &batch->entries[index];
+	if(e->state == SHADER_ENTRY_SUBMITTED) collect_entry(batch, e);
+	return e->state == SHADER_ENTRY_OK;
+}
+
+int shader_batch_finish(ShaderBatch* batch)
+{
+	int i, failed = 0;
+	for(i = 0; i < batch->count; i++) {
+		if(!shader_batch_wait(batch, i)) failed++;
+	}
+	return failed == 0;
+}
+
+GLuint create_program(const char* vs_source, const char* fs_source)
+{
+	ShaderBatch* batch = shader_batch_create();
+	if(!batch) return 0;
+
+	int index = shader_batch_add(batch, vs_source, fs_source, 0);
+	shader_batch_submit(batch);
+	shader_batch_finish(batch);
+	GLuint program = shader_batch_program(batch, index);
+
+	shader_batch_destroy(batch);
+	return program;
+}
+
+// source files
+
+// the whole file as a string to free(), with its length. NULL if it cannot be read
+static char* read_text_file(const char* path, size_t* length)
+{
+	FILE* file = fopen(path, "rb");
+	if(!file) return NULL;
+	char* text = NULL;
+	long size = -1;
+	if(fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+	if(size >= 0 && fseek(file, 0, SEEK_SET) == 0) text = malloc(size + 1);
+	if(text && fread(text, 1, size, file) != (size_t) size) {
+		free(text);
+		text = NULL;
+	}
+	fclose(file);
+	if(!text) return NULL;
+	text[size] = '\0';
+	*length = size;
+	return text;
+}
+
+// writes 'text' to 'path' if there is no such file yet, creating its directory
+static void create_text_file(const char* path, const char* text)
+{
+	FILE* file = fopen(path, "rb");
+	if(file) {
+		fclose(file);
+		return;
+	}
+
+	char dir[1024];
+	snprintf(dir, sizeof(dir), "%s", path);
+	char* slash = strrchr(dir, '/');
+	if(slash && slash != dir) {
+		*slash = '\0';
+		mkdir(dir, 0755); // fails harmlessly if it already exists
+	}
+
+	file = fopen(path, "wb");
+	if(!file || fputs(text, file) < 0 || fclose(file) != 0) {
+		fprintf(stderr, "Could not write shader source file '%s'\n", path);
+		return;
+	}
+	printf("Wrote shader source file '%s'\n", path);
+}
+
+char* shader_files_read(const ShaderFiles* files)
+{
+	size_t vs_length, fs_length;
+	char* vs = read_text_file(files->vs_path, &vs_length);
+	char* fs = read_text_file(files->fs_path, &fs_length);
+	char* sources = vs && fs ? realloc(vs, vs_length + 1 + fs_length + 1) : NULL;
+	if(!sources) {
+		fprintf(stderr, "Could not read shader source files '%s' and '%s'\n", files->vs_path, files->fs_path);
+		free(vs);
+		free(fs);
+		return NULL;
+	}
+	memcpy(sources + vs_length + 1, fs, fs_length + 1);
+	free(fs);
+	return sources;
+}
+
+int shader_files_relink(ShaderFiles* files, char* sources)
+{
+	GLuint program = create_program(sources, sources + strlen(sources) + 1);
+	free(sources);
+	if(!program) {
+		fprintf(stderr, "Shaders '%s' and '%s' did not link, keeping the last program\n", files->vs_path, files->fs_path);
+		return false;
+	}
+	if(files->program) glDeleteProgram(files->program);
+	files->program = program;
+	return true;
+}
+
+GLuint shader_files_load(ShaderFiles* files, const char* vs_fallback, const char* fs_fallback)
+{
+	files->program = 0;
+	if(vs_fallback) create_text_file(files->vs_path, vs_fallback);
+	if(fs_fallback) create_text_file(files->fs_path, fs_fallback);
+
+	char* sources = shader_files_read(files);
+	if(!sources) return 0;
+	shader_files_relink(files, sources);
+	return files->program;
+}
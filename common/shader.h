@@ -0,0 +1,117 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Shared shader compilation with a program binary cache
+ *
+ * Compiles and links a vertex + fragment shader pair into a program.
+ * When the driver supports program binaries (OpenGL 4.1 or ARB_get_program_binary),
+ * the linked program is saved to disk with glGetProgramBinary and loaded back with
+ * glProgramBinary on the next start, skipping the GLSL compiler entirely.
+ *
+ * Cache entries are keyed by a hash of the shader sources and the driver identity
+ * (GL_VENDOR, GL_RENDERER and GL_VERSION), so a driver update invalidates them.
+ * A binary rejected by the driver falls back to compiling from source and is then replaced.
+ *
+ * Programs can be compiled in batches: shader_batch_submit() issues every compile and link
+ * without asking the driver for any status, so it can compile them in parallel.
+ * With KHR_parallel_shader_compile, shader_batch_is_ready() polls GL_COMPLETION_STATUS_KHR
+ * without blocking, and shader_batch_program() hands out a fallback program until the real one is ready:
+ *
+ *   ShaderBatch* batch = shader_batch_create();
+ *   int fancy = shader_batch_add(batch, fancy_vs, fancy_fs, plain_program);
+ *   shader_batch_submit(batch);
+ *   ...
+ *   // every frame
+ *   shader_batch_is_ready(batch, fancy);
+ *   glUseProgram(shader_batch_program(batch, fancy));
+ *
+ * Without the extension, checking readiness waits for the compiler, like a plain glGetProgramiv.
+ *
+ * For editing shaders while an example runs, their sources can be read from files instead
+ * (see asset_watch.h). shader_files_load() first writes the embedded sources to the files if they
+ * do not exist yet; afterwards the watch thread reads them with shader_files_read(), and the GL
+ * thread relinks with shader_files_relink(), which keeps the last program that linked when an
+ * edit does not compile.
+ *
+ * Requires a current OpenGL context and GLEW to be initialized before use.
+ */
+
+#ifndef OPENGL_PLAYGROUND_SHADER_H
+#define OPENGL_PLAYGROUND_SHADER_H
+
+#include <GL/glew.h>
+
+// default directory for cached program binaries, relative to the working directory
+#define SHADER_CACHE_DEFAULT_DIR ".shader_cache"
+
+// sets the directory where program binaries are stored. NULL disables the cache
+void shader_cache_set_dir(const char* dir);
+
+// returns a linked program for the given sources, from the binary cache if possible. returns 0 on failure.
+// blocks until the program is linked, it is a batch of a single program
+GLuint create_program(const char* vs_source, const char* fs_source);
+
+// batched compilation
+
+typedef struct ShaderBatch ShaderBatch;
+
+// needs the GL context to be current, it checks for cache and extension support
+ShaderBatch* shader_batch_create();
+// releases the batch and anything still compiling. finished programs belong to the caller
+void shader_batch_destroy(ShaderBatch* batch);
+
+// queues a program and returns its index in the batch, or -1 when out of memory.
+// the sources must stay valid until shader_batch_submit(). 'fallback' is returned until the program is ready
+int shader_batch_add(ShaderBatch* batch, const char* vs_source, const char* fs_source, GLuint fallback);
+// sends all queued programs to the driver without waiting on any of them
+void shader_batch_submit(ShaderBatch* batch);
+
+// true when the program finished compiling, successfully or not. collects its info logs when it does
+int shader_batch_is_ready(ShaderBatch* batch, int index);
+// waits for one submitted program, leaving the others compiling. returns true if it compiled and linked
+int shader_batch_wait(ShaderBatch* batch, int index);
+// the linked program if it is ready and compiled fine, otherwise the fallback given to shader_batch_add()
+GLuint shader_batch_program(ShaderBatch* batch, int index);
+// waits for every submitted program. returns true if all of them compiled and linked
+int shader_batch_finish(ShaderBatch* batch);
+
+// source files
+
+typedef struct {
+	const char* vs_path;
+	const char* fs_path;
+	GLuint program;          // the last program that linked, 0 before
+} ShaderFiles;
+
+// creates missing files with the fallback sources, if given, then links them. returns the program or 0
+GLuint shader_files_load(ShaderFiles* files, const char* vs_fallback, const char* fs_fallback);
+// on any thread, no GL. both sources in one string to free(), the fragment shader after the first '\0'.
+// returns NULL if a file cannot be read
+char* shader_files_read(const ShaderFiles* files);
+// links sources from shader_files_read(), and frees them. replaces and deletes 'program' only if the new
+// one linked. returns whether it was replaced
+int shader_files_relink(ShaderFiles* files, char* sources);
+
+#endif // OPENGL_PLAYGROUND_SHADER_H
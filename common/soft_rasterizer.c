@@ -0,0 +1,428 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Multithreaded tile based software rasterizer
+ *
+ * See soft_rasterizer.h
+ */
+
+#include "soft_rasterizer.h"
+#include "worker_pool.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+
+typedef enum { false, true } bool;
+
+// 4 lanes, one per pixel or one per channel
+typedef float vec4 __attribute__((vector_size(16)));
+typedef int ivec4 __attribute__((vector_size(16)));
+
+typedef struct {
+	float a[3], b[3], c[3];      // edge functions a*x + b*y + c, positive inside
+	int top_left[3];             // pixel centers exactly on the edge belong to this triangle
+	float u0, dudx, dudy;        // u = u0 + dudx * x + dudy * y, in pixels
+	float v0, dvdx, dvdy;
+	int x0, y0, x1, y1;          // pixel bounds, clipped to the framebuffer, max exclusive
+	int state;
+} Triangle;
+
+typedef struct {
+	int* triangles;              // indices, in submission order
+	int count, capacity;
+} Bin;
+
+typedef struct {
+	SoftRasterizer* raster;
+	unsigned long long fragments;
+} Worker;
+
+struct SoftRasterizer {
+	int width, height;
+	unsigned char* pixels;
+	int tiles_x, tiles_y;
+
+	Triangle* triangles;
+	int num_triangles, triangles_capacity;
+	SoftState* states;
+	int num_states, states_capacity;
+	Bin* bins;
+
+	bool clear_pending;
+	unsigned char clear_color[4];
+	unsigned long long fragments;
+
+	WorkerPool* pool;
+	Worker* workers;             // one per worker of the pool
+	int num_workers;
+	atomic_int next_tile;
+};
+
+static unsigned char to_unorm8(float f)
+{
+	if(f <= 0) return 0;
+	if(f >= 1) return 255;
+	return (unsigned char) (f * 255.0f + 0.5f);
+}
+
+// shading
+
+static vec4 fetch(const SoftTexture* t, int x, int y)
+{
+	const unsigned char* p = t->pixels + (size_t) y * t->stride + x * t->channels;
+	if(t->channels == 1) return (vec4) {p[0] / 255.0f, 0, 0, 1};
+	return (vec4) {p[0], p[1], p[2], p[3]} * (1 / 255.0f);
+}
+
+static int clamp(int i, int max)
+{
+	return i < 0 ? 0 : i > max ? max : i;
+}
+
+// u and v in texels
+static vec4 sample(const SoftTexture* t, float u, float v)
+{
+	if(t->filter == SOFT_NEAREST) {
+		return fetch(t, clamp((int) floorf(u), t->width - 1), clamp((int) floorf(v), t->height - 1));
+	}
+	// texel centers are at +0.5, blend the 4 around the sample
+	float x = u - 0.5f, y = v - 0.5f;
+	float fx = floorf(x), fy = floorf(y);
+	float wx = x - fx, wy = y - fy;
+	int x0 = clamp((int) fx, t->width - 1), x1 = clamp((int) fx + 1, t->width - 1);
+	int y0 = clamp((int) fy, t->height - 1), y1 = clamp((int) fy + 1, t->height - 1);
+	vec4 top = fetch(t, x0, y0) * (1 - wx) + fetch(t, x1, y0) * wx;
+	vec4 bottom = fetch(t, x0, y1) * (1 - wx) + fetch(t, x1, y1) * wx;
+	return top * (1 - wy) + bottom * wy;
+}
+
+static void shade(const SoftState* state, vec4 color, float u, float v, unsigned char* dst)
+{
+	if(state->texture) {
+		vec4 texel = sample(state->texture, u, v);
+		if(state->texture_mode == SOFT_TEXTURE_ALPHA) color[3] *= texel[0];
+		else color *= texel;
+	}
+	if(state->blend) {
+		vec4 under = (vec4) {dst[0], dst[1], dst[2], dst[3]} * (1 / 255.0f);
+		float alpha = color[3];
+		color = color * alpha + under * (1 - alpha);
+	}
+	int i;
+	for(i = 0; i < 4; i++) dst[i] = to_unorm8(color[i]);
+}
+
+// tiles
+
+static void draw_triangle(Worker* w, const Triangle* tri, int tx0, int ty0, int tx1, int ty1)
+{
+	SoftRasterizer* raster = w->raster;
+	const SoftState* state = &raster->states[tri->state];
+	const vec4 color = {state->color[0], state->color[1], state->color[2], state->color[3]};
+	int x0 = tri->x0 > tx0 ? tri->x0 : tx0, x1 = tri->x1 < tx1 ? tri->x1 : tx1;
+	int y0 = tri->y0 > ty0 ? tri->y0 : ty0, y1 = tri->y1 < ty1 ? tri->y1 : ty1;
+	float tex_width = state->texture ? state->texture->width : 0;
+	float tex_height = state->texture ? state->texture->height : 0;
+
+	const vec4 lane = {0.5f, 1.5f, 2.5f, 3.5f}; // pixel centers
+	const ivec4 zero = {0, 0, 0, 0};
+	ivec4 top_left[3];
+	int e;
+	for(e = 0; e < 3; e++) top_left[e] = tri->top_left[e] ? ~zero : zero;
+
+	int x, y;
+	for(y = y0; y < y1; y++) {
+		float cy = y + 0.5f;
+		unsigned char* row = raster->pixels + (size_t) y * raster->width * 4;
+		for(x = x0; x < x1; x += 4) {
+			vec4 cx = lane + (float) x;
+			// inside all three edges, on an edge only if it is a top or left one
+			ivec4 inside = ~zero;
+			for(e = 0; e < 3; e++) {
+				vec4 d = cx * tri->a[e] + (tri->b[e] * cy + tri->c[e]);
+				inside &= (d > 0) | ((d == 0) & top_left[e]);
+			}
+			vec4 u = (cx * tri->dudx + (tri->u0 + tri->dudy * cy)) * tex_width;
+			vec4 v = (cx * tri->dvdx + (tri->v0 + tri->dvdy * cy)) * tex_height;
+			int i;
+			for(i = 0; i < 4 && x + i < x1; i++) {
+				if(!inside[i]) continue;
+				shade(state, color, u[i], v[i], row + (x + i) * 4);
+				w->fragments++;
+			}
+		}
+	}
+}
+
+static void draw_tile(Worker* w, int tile)
+{
+	SoftRasterizer* raster = w->raster;
+	int tx0 = (tile % raster->tiles_x) * SOFT_TILE_SIZE;
+	int ty0 = (tile / raster->tiles_x) * SOFT_TILE_SIZE;
+	int tx1 = tx0 + SOFT_TILE_SIZE < raster->width ? tx0 + SOFT_TILE_SIZE : raster->width;
+	int ty1 = ty0 + SOFT_TILE_SIZE < raster->height ? ty0 + SOFT_TILE_SIZE : raster->height;
+
+	if(raster->clear_pending) {
+		int x, y;
+		for(y = ty0; y < ty1; y++) {
+			unsigned char* row = raster->pixels + (size_t) y * raster->width * 4;
+			for(x = tx0; x < tx1; x++) memcpy(row + x * 4, raster->clear_color, 4);
+		}
+	}
+
+	const Bin* bin = &raster->bins[tile];
+	int i;
+	for(i = 0; i < bin->count; i++) {
+		draw_triangle(w, &raster->triangles[bin->triangles[i]], tx0, ty0, tx1, ty1);
+	}
+}
+
+static void draw_tiles(Worker* w)
+{
+	SoftRasterizer* raster = w->raster;
+	int num_tiles = raster->tiles_x * raster->tiles_y;
+	for(;;) {
+		int tile = atomic_fetch_add(&raster->next_tile, 1);
+		if(tile >= num_tiles) return;
+		draw_tile(w, tile);
+	}
+}
+
+static void draw_tiles_job(void* arg, int worker)
+{
+	SoftRasterizer* raster = arg;
+	draw_tiles(&raster->workers[worker]);
+}
+
+SoftRasterizer* soft_rasterizer_create(int width, int height, int num_threads)
+{
+	if(width <= 0 || height <= 0) return NULL;
+	SoftRasterizer* raster = calloc(1, sizeof(SoftRasterizer));
+	if(!raster) return NULL;
+
+	raster->width = width;
+	raster->height = height;
+	raster->tiles_x = (width + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE;
+	raster->tiles_y = (height + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE;
+	raster->pixels = calloc((size_t) width * height, 4);
+	raster->bins = calloc(raster->tiles_x * raster->tiles_y, sizeof(Bin));
+
+	raster->pool = worker_pool_create(num_threads, draw_tiles_job, raster);
+	if(raster->pool) {
+		raster->num_workers = worker_pool_size(raster->pool);
+		raster->workers = calloc(raster->num_workers, sizeof(Worker));
+	}
+	if(!raster->pixels || !raster->bins || !raster->workers) {
+		fprintf(stderr, "Out of memory for a %dx%d software framebuffer\n", width, height);
+		soft_rasterizer_destroy(raster);
+		return NULL;
+	}
+
+	int i;
+	for(i = 0; i < raster->num_workers; i++) raster->workers[i].raster = raster;
+	return raster;
+}
+
+void soft_rasterizer_destroy(SoftRasterizer* raster)
+{
+	if(!raster) return;
+
+	worker_pool_destroy(raster->pool);
+	int i;
+	if(raster->bins) {
+		for(i = 0; i < raster->tiles_x * raster->tiles_y; i++) free(raster->bins[i].triangles);
+	}
+	free(raster->bins);
+	free(raster->workers);
+	free(raster->triangles);
+	free(raster->states);
+	free(raster->pixels);
+	free(raster);
+}
+
+// drawing
+
+static void drop_queued(SoftRasterizer* raster)
+{
+	int i;
+	for(i = 0; i < raster->tiles_x * raster->tiles_y; i++) raster->bins[i].count = 0;
+	raster->num_triangles = 0;
+	raster->num_states = 0;
+}
+
+void soft_clear(SoftRasterizer* raster, float r, float g, float b, float a)
+{
+	// whatever was queued would be covered anyway
+	drop_queued(raster);
+	raster->clear_pending = true;
+	raster->clear_color[0] = to_unorm8(r);
+	raster->clear_color[1] = to_unorm8(g);
+	raster->clear_color[2] = to_unorm8(b);
+	raster->clear_color[3] = to_unorm8(a);
+}
+
+static bool bin_triangle(SoftRasterizer* raster, int index)
+{
+	const Triangle* tri = &raster->triangles[index];
+	int tx, ty;
+	for(ty = tri->y0 / SOFT_TILE_SIZE; ty <= (tri->y1 - 1) / SOFT_TILE_SIZE; ty++) {
+		for(tx = tri->x0 / SOFT_TILE_SIZE; tx <= (tri->x1 - 1) / SOFT_TILE_SIZE; tx++) {
+			Bin* bin = &raster->bins[ty * raster->tiles_x + tx];
+			if(bin->count == bin->capacity) {
+				int capacity = bin->capacity ? bin->capacity * 2 : 16;
+				int* triangles = realloc(bin->triangles, capacity * sizeof(int));
+				if(!triangles) return false;
+				bin->triangles = triangles;
+				bin->capacity = capacity;
+			}
+			bin->triangles[bin->count++] = index;
+		}
+	}
+	return true;
+}
+
+static bool add_triangle(SoftRasterizer* raster, const SoftVertex* v0, const SoftVertex* v1, const SoftVertex* v2, int state)
+{
+	// to pixels, y down
+	const SoftVertex* v[3] = {v0, v1, v2};
+	float x[3], y[3];
+	int i;
+	for(i = 0; i < 3; i++) {
+		x[i] = (v[i]->x + 1.0f) * 0.5f * raster->width;
+		y[i] = (1.0f - v[i]->y) * 0.5f * raster->height;
+	}
+
+	float det = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if(det == 0) return true; // nothing to draw
+	if(det < 0) {
+		// both windings are drawn, flip to the one the edge functions expect
+		const SoftVertex* t = v[1]; v[1] = v[2]; v[2] = t;
+		float tx = x[1]; x[1] = x[2]; x[2] = tx;
+		float ty = y[1]; y[1] = y[2]; y[2] = ty;
+		det = -det;
+	}
+
+	int min_x = (int) floorf(fminf(x[0], fminf(x[1], x[2])));
+	int max_x = (int) ceilf(fmaxf(x[0], fmaxf(x[1], x[2])));
+	int min_y = (int) floorf(fminf(y[0], fminf(y[1], y[2])));
+	int max_y = (int) ceilf(fmaxf(y[0], fmaxf(y[1], y[2])));
+	if(min_x < 0) min_x = 0;
+	if(min_y < 0) min_y = 0;
+	if(max_x > raster->width) max_x = raster->width;
+	if(max_y > raster->height) max_y = raster->height;
+	if(min_x >= max_x || min_y >= max_y) return true; // off screen
+
+	if(raster->num_triangles == raster->triangles_capacity) {
+		int capacity = raster->triangles_capacity ? raster->triangles_capacity * 2 : 256;
+		Triangle* triangles = realloc(raster->triangles, capacity * sizeof(Triangle));
+		if(!triangles) return false;
+		raster->triangles = triangles;
+		raster->triangles_capacity = capacity;
+	}
+	Triangle* tri = &raster->triangles[raster->num_triangles];
+	tri->x0 = min_x; tri->x1 = max_x;
+	tri->y0 = min_y; tri->y1 = max_y;
+	tri->state = state;
+
+	for(i = 0; i < 3; i++) {
+		int j = (i + 1) % 3;
+		tri->a[i] = y[i] - y[j];
+		tri->b[i] = x[j] - x[i];
+		tri->c[i] = -(tri->a[i] * x[i] + tri->b[i] * y[i]);
+		// with y down, left edges have the inside to their right, top edges are horizontal with the inside below
+		tri->top_left[i] = tri->a[i] > 0 || (tri->a[i] == 0 && tri->b[i] > 0);
+	}
+
+	// attribute planes through the three vertices
+	float dx1 = x[1] - x[0], dy1 = y[1] - y[0], dx2 = x[2] - x[0], dy2 = y[2] - y[0];
+	float du1 = v[1]->u - v[0]->u, du2 = v[2]->u - v[0]->u;
+	float dv1 = v[1]->v - v[0]->v, dv2 = v[2]->v - v[0]->v;
+	tri->dudx = (du1 * dy2 - du2 * dy1) / det;
+	tri->dudy = (du2 * dx1 - du1 * dx2) / det;
+	tri->dvdx = (dv1 * dy2 - dv2 * dy1) / det;
+	tri->dvdy = (dv2 * dx1 - dv1 * dx2) / det;
+	tri->u0 = v[0]->u - tri->dudx * x[0] - tri->dudy * y[0];
+	tri->v0 = v[0]->v - tri->dvdx * x[0] - tri->dvdy * y[0];
+
+	if(!bin_triangle(raster, raster->num_triangles)) return false;
+	raster->num_triangles++;
+	return true;
+}
+
+int soft_draw(SoftRasterizer* raster, SoftPrimitive primitive, const SoftVertex* vertices, int count, const SoftState* state)
+{
+	if(raster->num_states == raster->states_capacity) {
+		int capacity = raster->states_capacity ? raster->states_capacity * 2 : 16;
+		SoftState* states = realloc(raster->states, capacity * sizeof(SoftState));
+		if(!states) return false;
+		raster->states = states;
+		raster->states_capacity = capacity;
+	}
+	int index = raster->num_states++;
+	raster->states[index] = *state;
+
+	int i;
+	if(primitive == SOFT_TRIANGLES) {
+		for(i = 0; i + 2 < count; i += 3) {
+			if(!add_triangle(raster, &vertices[i], &vertices[i + 1], &vertices[i + 2], index)) return false;
+		}
+	}
+	else {
+		for(i = 1; i + 1 < count; i++) {
+			if(!add_triangle(raster, &vertices[0], &vertices[i], &vertices[i + 1], index)) return false;
+		}
+	}
+	return true;
+}
+
+void soft_flush(SoftRasterizer* raster)
+{
+	if(raster->num_triangles == 0 && !raster->clear_pending) return;
+
+	atomic_store(&raster->next_tile, 0);
+	worker_pool_run(raster->pool);
+
+	int i;
+	for(i = 0; i < raster->num_workers; i++) {
+		raster->fragments += raster->workers[i].fragments;
+		raster->workers[i].fragments = 0;
+	}
+	raster->clear_pending = false;
+	drop_queued(raster);
+}
+
+const unsigned char* soft_pixels(SoftRasterizer* raster)
+{
+	soft_flush(raster);
+	return raster->pixels;
+}
+
+unsigned long long soft_fragments(const SoftRasterizer* raster)
+{
+	return raster->fragments;
+}
@@ -0,0 +1,104 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Multithreaded tile based software rasterizer
+ *
+ * Renders the subset of OpenGL the examples use, on the CPU, with no GL driver at all:
+ *   - GL_TRIANGLES and GL_TRIANGLE_FAN with 2D positions in normalized device coordinates
+ *   - one 2D texture, GL_RED or GL_RGBA, GL_NEAREST or GL_LINEAR filtering, GL_CLAMP_TO_EDGE
+ *   - a solid color, or the texture times a color: RGBA like texture(tex, uv), or its red channel
+ *     as alpha like the glyph and checkerboard shaders, vec4(1.0, 1.0, 1.0, texture(tex, uv).r)
+ *   - blending with glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA), or none
+ *
+ * Draws are only queued: each triangle is set up once and binned into the 64x64 tiles it touches.
+ * soft_flush() then has worker threads take whole tiles from a shared counter and draw the
+ * triangles of each tile in submission order, so blending is ordered like on a GPU without
+ * any locking. Edge functions are tested on 4 pixels at a time, and texels are filtered and
+ * blended as 4 channel vectors, with GCC and Clang vector extensions (SSE on x86, NEON on ARM).
+ *
+ * Pixel centers and the top-left fill rule follow OpenGL, so the result can be compared with a
+ * driver's frame (see ../tools/compare_images.c), up to rounding in filtering and blending:
+ *
+ *   SoftRasterizer* raster = soft_rasterizer_create(350, 350, 0);
+ *   SoftState state = { &texture, SOFT_TEXTURE_RGBA, {1, 1, 1, 1}, true };
+ *   soft_clear(raster, 0, 0, 0, 0);
+ *   soft_draw(raster, SOFT_TRIANGLE_FAN, quad, 4, &state);
+ *   const unsigned char* rgba = soft_pixels(raster);
+ *
+ * Requires POSIX threads.
+ */
+
+#ifndef OPENGL_PLAYGROUND_SOFT_RASTERIZER_H
+#define OPENGL_PLAYGROUND_SOFT_RASTERIZER_H
+
+#define SOFT_TILE_SIZE 64
+
+typedef enum { SOFT_TRIANGLES, SOFT_TRIANGLE_FAN } SoftPrimitive;
+typedef enum { SOFT_NEAREST, SOFT_LINEAR } SoftFilter;
+typedef enum {
+	SOFT_TEXTURE_RGBA,       // color * texel
+	SOFT_TEXTURE_ALPHA       // color, with its alpha multiplied by the texel's red channel
+} SoftTextureMode;
+
+typedef struct {
+	int width, height;
+	int channels;            // 1 (GL_RED) or 4 (GL_RGBA)
+	int stride;              // bytes per row
+	SoftFilter filter;
+	const unsigned char* pixels; // the first row is at t = 0, like glTexImage2D
+} SoftTexture;
+
+typedef struct {
+	const SoftTexture* texture;  // NULL for a solid color. must stay valid until the flush
+	SoftTextureMode texture_mode;
+	float color[4];
+	int blend;               // GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA when true
+} SoftState;
+
+typedef struct {
+	float x, y;              // normalized device coordinates
+	float u, v;              // texture coordinates
+} SoftVertex;
+
+typedef struct SoftRasterizer SoftRasterizer;
+
+// 'num_threads' draw tiles at the same time, counting the calling thread, 0 for one per CPU.
+// returns NULL on failure
+SoftRasterizer* soft_rasterizer_create(int width, int height, int num_threads);
+void soft_rasterizer_destroy(SoftRasterizer* raster);
+
+// fills the framebuffer, dropping anything still queued
+void soft_clear(SoftRasterizer* raster, float r, float g, float b, float a);
+// queues 'count' vertices of triangles. returns 0 when out of memory
+int soft_draw(SoftRasterizer* raster, SoftPrimitive primitive, const SoftVertex* vertices, int count, const SoftState* state);
+// draws everything queued and waits for it
+void soft_flush(SoftRasterizer* raster);
+
+// flushes and returns the framebuffer, RGBA with the top row first like headless_read_pixels()
+const unsigned char* soft_pixels(SoftRasterizer* raster);
+// pixels shaded since the rasterizer was created, to measure throughput
+unsigned long long soft_fragments(const SoftRasterizer* raster);
+
+#endif // OPENGL_PLAYGROUND_SOFT_RASTERIZER_H
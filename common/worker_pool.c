@@ -0,0 +1,158 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - A pool of worker threads that all run the same job
+ *
+ * See worker_pool.h
+ */
+
+#include "worker_pool.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+typedef enum { false, true } bool;
+
+typedef struct {
+	WorkerPool* pool;
+	int index;
+	pthread_t thread;
+} Worker;
+
+struct WorkerPool {
+	WorkerPoolJob job;
+	void* arg;
+	Worker* workers;             // the first one is the calling thread, it has no thread of its own
+	int num_workers;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cond, done_cond;
+	unsigned int generation;     // bumped for every run, wakes the workers
+	int workers_busy;
+	bool quit;
+};
+
+static void* worker_main(void* arg)
+{
+	Worker* w = arg;
+	WorkerPool* pool = w->pool;
+	unsigned int seen_generation = 0;
+
+	for(;;) {
+		pthread_mutex_lock(&pool->mutex);
+		while(pool->generation == seen_generation && !pool->quit) {
+			pthread_cond_wait(&pool->work_cond, &pool->mutex);
+		}
+		if(pool->quit) {
+			pthread_mutex_unlock(&pool->mutex);
+			return NULL;
+		}
+		seen_generation = pool->generation;
+		pthread_mutex_unlock(&pool->mutex);
+
+		pool->job(pool->arg, w->index);
+
+		pthread_mutex_lock(&pool->mutex);
+		if(--pool->workers_busy == 0) pthread_cond_signal(&pool->done_cond);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+}
+
+WorkerPool* worker_pool_create(int num_threads, WorkerPoolJob job, void* arg)
+{
+	WorkerPool* pool = calloc(1, sizeof(WorkerPool));
+	if(!pool) return NULL;
+	pool->job = job;
+	pool->arg = arg;
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->work_cond, NULL);
+	pthread_cond_init(&pool->done_cond, NULL);
+
+	if(num_threads <= 0) num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if(num_threads <= 0) num_threads = 1;
+	pool->workers = calloc(num_threads, sizeof(Worker));
+	if(!pool->workers) {
+		worker_pool_destroy(pool);
+		return NULL;
+	}
+
+	pool->workers[0].pool = pool;
+	pool->num_workers = 1;
+	int i;
+	for(i = 1; i < num_threads; i++) {
+		Worker* w = &pool->workers[i];
+		w->pool = pool;
+		w->index = i;
+		if(pthread_create(&w->thread, NULL, worker_main, w) != 0) break;
+		pool->num_workers++;
+	}
+	return pool;
+}
+
+void worker_pool_destroy(WorkerPool* pool)
+{
+	if(!pool) return;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->work_cond);
+	pthread_mutex_unlock(&pool->mutex);
+
+	int i;
+	for(i = 1; i < pool->num_workers; i++) {
+		pthread_join(pool->workers[i].thread, NULL);
+	}
+	free(pool->workers);
+
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->work_cond);
+	pthread_mutex_destroy(&pool->mutex);
+	free(pool);
+}
+
+int worker_pool_size(const WorkerPool* pool)
+{
+	return pool->num_workers;
+}
+
+void worker_pool_run(WorkerPool* pool)
+{
+	if(pool->num_workers > 1) {
+		pthread_mutex_lock(&pool->mutex);
+		pool->workers_busy = pool->num_workers - 1;
+		pool->generation++;
+		pthread_cond_broadcast(&pool->work_cond);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+	pool->job(pool->arg, 0);
+	if(pool->num_workers > 1) {
+		pthread_mutex_lock(&pool->mutex);
+		while(pool->workers_busy > 0) {
+			pthread_cond_wait(&pool->done_cond, &pool->mutex);
+		}
+		pthread_mutex_unlock(&pool->mutex);
+	}
+}
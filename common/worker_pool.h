@@ -0,0 +1,62 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - A pool of worker threads that all run the same job
+ *
+ * For work split into many small pieces taken from a shared counter: every run wakes all workers,
+ * each calls the job with its index and returns once it finds no more pieces, and the run returns
+ * when they all have. Threads are kept between runs, so a run only costs a wakeup.
+ * The calling thread is worker 0 and takes part in each run, 'num_threads' counts it:
+ *
+ *   static void process(void* arg, int worker) { ...take items from a shared counter until none are left... }
+ *
+ *   WorkerPool* pool = worker_pool_create(0, process, batch);
+ *   atomic_store(&batch->next_item, 0);
+ *   worker_pool_run(pool);               // process(batch, 0), (batch, 1)... at the same time
+ *   worker_pool_destroy(pool);
+ *
+ * Requires POSIX threads.
+ */
+
+#ifndef OPENGL_PLAYGROUND_WORKER_POOL_H
+#define OPENGL_PLAYGROUND_WORKER_POOL_H
+
+// 'worker' is 0 on the calling thread, up to worker_pool_size() - 1
+typedef void (*WorkerPoolJob)(void* arg, int worker);
+
+typedef struct WorkerPool WorkerPool;
+
+// starts 'num_threads' - 1 threads running 'job' with 'arg', 0 for one worker per CPU.
+// fewer may start, see worker_pool_size(). returns NULL on failure
+WorkerPool* worker_pool_create(int num_threads, WorkerPoolJob job, void* arg);
+// stops and joins the threads, which must not be in a run
+void worker_pool_destroy(WorkerPool* pool);
+
+// number of workers, counting the calling thread
+int worker_pool_size(const WorkerPool* pool);
+// runs the job on every worker and waits for all of them
+void worker_pool_run(WorkerPool* pool);
+
+#endif // OPENGL_PLAYGROUND_WORKER_POOL_H
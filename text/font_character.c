@@ -26,7 +26,7 @@ SOFTWARE.
  * OpenGL Playground - Example of loading and rendering a glyph
  *
  * Compiling this example:
- * Linux: gcc font_character.c -I/usr/include/freetype2 -lGL -lGLEW -lglfw -lfreetype -o font_character
+ * Linux: gcc ../common/shader.c ../common/gl_state.c ../common/command_list.c ../common/headless.c ../common/benchmark.c ../common/profiler.c font_character.c -I/usr/include/freetype2 -lGL -lGLEW -lglfw -lfreetype -lEGL -o font_character
  *
  * Requires OpenGL 3.2, GLEW and GLFW to be installed or provided as includes for compilation.
  * Requires FreeType for font loading: https://www.freetype.org/
@@ -41,11 +41,22 @@ SOFTWARE.
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+#include "../common/shader.h"
+#include "../common/gl_state.h"
+#include "../common/command_list.h"
+#include "../common/headless.h"
+#include "../common/benchmark.h"
+#include "../common/profiler.h"
+
 GLuint program;
 GLint attr_vpos, attr_vtex;
+GLuint vao;
+RenderCommand quad; // the textured quad, recorded for every draw
+CommandList commands;
 GLuint tex;
 
 GLFWwindow* window;
+BenchmarkOptions benchmark;
 
 FT_Library ft_library;
 FT_Face ft_face;
@@ -61,70 +72,26 @@ void display()
 {
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	glUseProgram(program);
-	glEnableVertexAttribArray(attr_vpos);
-	glVertexAttribPointer(
-		attr_vpos, // shader attribute index
-		2,         // number of elements per vertex
-		GL_FLOAT,  // data type of each element
-		GL_FALSE,  // normalized?
-		0,         // stride if data is interleaved
-		0          // pointer offset to start of data
-	);
-	glEnableVertexAttribArray(attr_vtex);
-	glVertexAttribPointer(attr_vtex, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*) (2 * 4 * sizeof(float)));
-	glBindTexture(GL_TEXTURE_2D, tex);
-
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glDisableVertexAttribArray(attr_vpos);
-	glDisableVertexAttribArray(attr_vtex);
-	glUseProgram(0);
-
-	glFlush();
-}
-
-int compile_shader(GLuint shader, const char* source, GLenum shader_type)
-{
-	GLint is_compile_ok = GL_FALSE;
-
-	fprintf(stdout, "Compiling %s Shader...  ", shader_type==GL_VERTEX_SHADER? "Vertex" : "Fragment");
-
-	glShaderSource(shader, 1, &source, NULL);
-	glCompileShader(shader);
-
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compile_ok);
-	fprintf(stdout, "%s!\n", is_compile_ok? "OK" : "FAILED");
-
-	GLint written, logSize = 0;
-	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize);
-	GLchar buf[logSize];
-	glGetShaderInfoLog(shader, logSize, &written, buf);
-	if(written) {
-		fprintf(stderr, "%s", buf);
-		if(logSize != written+1) { // +1 for NULL terminating character
-			fprintf(stderr, "... missing %d characters!\n", logSize-written+1);
-		}
-	}
-
-	if(!is_compile_ok) {
-		glDeleteShader(shader);
-		return false;
+	// recorded, then replayed in key order with only the state changes needed, see ../common/command_list.h
+	command_list_reset(&commands);
+	uint64_t key = command_key(0, quad.program, quad.texture, 0.0f);
+	// the same quad again for heavier benchmark workloads
+	int i;
+	for(i = 0; i < benchmark.workload; i++) {
+		command_list_push(&commands, key, &quad);
 	}
+	command_list_submit(&commands);
 
-	return true;
+	gl_state_next_frame();
+	glFlush();
 }
 
 int init()
 {
 	// global state
 	glClearColor(0.0, 0.0, 0.0, 0.0);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_BLEND);
 
-	// compiling shaders
-	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+	// shader sources
 	const char *vs_source =
 	"#version 330                      \n"
 	"layout (location = 0) in vec2 v_pos;"
@@ -134,9 +101,7 @@ int init()
 	"  gl_Position = vec4(v_pos, 0.0, 1.0);"
 	"  vs_tex_coord = v_tex;"
 	"}";
-	if(!compile_shader(vs, vs_source, GL_VERTEX_SHADER)) return false;
 
-	GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
 	const char *fs_source =
 	"#version 330                         \n"
 	"uniform sampler2D tex;"
@@ -145,23 +110,10 @@ int init()
 	"void main(void) {"
 	"  color = vec4(1.0, 1.0, 1.0, texture(tex, vs_tex_coord).r);"
 	"}";
-	if(!compile_shader(fs, fs_source, GL_FRAGMENT_SHADER)) return false;
-
-	// linking into a program
-	GLint is_link_ok = GL_FALSE;
-	program = glCreateProgram();
-	glAttachShader(program, vs);
-	glAttachShader(program, fs);
-	glLinkProgram(program);
-	glGetProgramiv(program, GL_LINK_STATUS, &is_link_ok);
-	glDetachShader(program, vs);
-	glDetachShader(program, fs);
-	glDeleteShader(vs);
-	glDeleteShader(fs);
-	if(!is_link_ok) {
-		fprintf(stderr, "Program didn't link\n");
-		return false;
-	}
+
+	// compiling and linking into a program, or loading it from the shader cache
+	program = create_program(vs_source, fs_source);
+	if(!program) return false;
 
 	// setting attributes from the application to the vertex shader
 	attr_vpos = glGetAttribLocation(program, "v_pos");
@@ -198,12 +150,37 @@ int init()
 		1.0, 0.0,
 		0.0, 0.0
 	};
-	GLuint vao, buffer;
+	GLuint buffer;
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao); // binds to the current context
 	glGenBuffers(1, &buffer); // generate ID
 	glBindBuffer(GL_ARRAY_BUFFER, buffer); // connects the buffer to the context target
 	glBufferData(GL_ARRAY_BUFFER, sizeof(quad_data), quad_data, GL_STATIC_DRAW); // transfer data to target
+	// the attribute layout is part of the VAO state, so it is set once here rather than every frame
+	glEnableVertexAttribArray(attr_vpos);
+	glVertexAttribPointer(
+		attr_vpos, // shader attribute index
+		2,         // number of elements per vertex
+		GL_FLOAT,  // data type of each element
+		GL_FALSE,  // normalized?
+		0,         // stride if data is interleaved
+		0          // pointer offset to start of data
+	);
+	glEnableVertexAttribArray(attr_vtex);
+	glVertexAttribPointer(attr_vtex, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*) (2 * 4 * sizeof(float)));
+
+	// what every draw of the quad needs bound, recorded as is each frame
+	quad.program = program;
+	quad.vao = vao;
+	quad.texture_target = GL_TEXTURE_2D;
+	quad.texture = tex;
+	quad.blend = GL_TRUE;
+	quad.blend_src = GL_SRC_ALPHA;
+	quad.blend_dst = GL_ONE_MINUS_SRC_ALPHA;
+	quad.uniform = -1;
+	quad.mode = GL_TRIANGLE_FAN;
+	quad.count = 4;
+	command_list_init(&commands);
 
 	return true;
 }
@@ -215,6 +192,11 @@ void shutdown_glfw_and_exit(int status_code)
 	exit(status_code);
 }
 
+static void swap_buffers()
+{
+	glfwSwapBuffers(window);
+}
+
 // callbacks
 
 static void key_cb(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -295,6 +277,22 @@ void load_char_texture()
 
 int main(int argc, char** argv)
 {
+	benchmark_parse_args(&benchmark, argc, argv);
+	HeadlessOptions headless;
+	headless_parse_args(&headless, argc, argv);
+	profiler_parse_args(argc, argv);
+	if(headless.enabled) {
+		// no window, frames go to an offscreen framebuffer
+		HeadlessContext ctx;
+		if(!headless_init(&ctx, 350, 350, 3, 2) || !init()) exit(-1);
+		init_freetype();
+		load_char_texture();
+		bool ok = benchmark.enabled ? benchmark_run(&benchmark, "font_character", display, NULL) : headless_run(&ctx, &headless, display);
+		if(!benchmark.enabled) gl_state_print_stats();
+		headless_free(&ctx);
+		exit(ok ? 0 : -1);
+	}
+
 	glfwSetErrorCallback(error_cb);
 
 	// GLFW init
@@ -328,7 +326,8 @@ int main(int argc, char** argv)
 	}
 	printf("Using OpenGL %s\n", glGetString(GL_VERSION));
 
-	glfwSwapInterval(1);
+	// benchmarks must not wait for vsync
+	glfwSwapInterval(benchmark.enabled ? 0 : 1);
 
 	if(!init()) {
 		shutdown_glfw_and_exit(-1);
@@ -338,13 +337,37 @@ int main(int argc, char** argv)
 	init_freetype();
 	load_char_texture();
 
+	if(benchmark.enabled) {
+		shutdown_glfw_and_exit(benchmark_run(&benchmark, "font_character", display, swap_buffers) ? 0 : -1);
+	}
+
+	// frame timing, see --profile and --overlay in ../common/profiler.h
+	if(!profiler_init()) {
+		shutdown_glfw_and_exit(-1);
+	}
+	int scope_display = profiler_scope("display");
+	int scope_swap = profiler_scope("swap");
+	int scope_events = profiler_scope("events");
+
 	// main loop
 	while (!glfwWindowShouldClose(window))
 	{
+		profiler_begin(scope_display);
 		display();
+		profiler_end(scope_display);
+		profiler_draw_overlay();
+
+		profiler_begin(scope_swap);
 		glfwSwapBuffers(window);
+		profiler_end(scope_swap);
+
+		profiler_begin(scope_events);
 		glfwPollEvents();
+		profiler_end(scope_events);
+		profiler_next_frame();
 	}
+	profiler_shutdown();
+	gl_state_print_stats();
 
 	// shut down
 	shutdown_glfw_and_exit(0);
@@ -0,0 +1,600 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Glyph cache packed into shared atlas textures
+ *
+ * See glyph_cache.h for usage.
+ */
+
+#include "glyph_cache.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../common/gl_state.h"
+
+typedef enum { false, true } bool;
+
+#define GLYPH_PADDING 1        // empty pixels right and below each glyph, so linear filtering doesn't bleed
+#define SHELF_ROUNDING 4       // shelf heights are rounded up to this, so similar glyphs share shelves
+#define INITIAL_BUCKETS 1024
+
+typedef struct {
+	unsigned char* pixels;     // CPU copy of the page, page_size * page_size bytes
+	GLuint tex;
+	int shelf_bottom;          // where the next shelf of this page starts
+	int dirty_x0, dirty_y0, dirty_x1, dirty_y1; // changed since the last upload, empty when x0 >= x1
+} AtlasPage;
+
+typedef struct {
+	int page;
+	int y, height;
+	int x;                     // next free position on the shelf
+	unsigned int last_used;    // frame number
+	int first_entry;           // glyphs on this shelf, linked through next_in_shelf
+} Shelf;
+
+typedef struct {
+	GlyphKey key;
+	GlyphInfo info;
+	int shelf;
+	int next_in_bucket;        // hash chain, or free list when the entry is unused
+	int next_in_shelf;
+} GlyphEntry;
+
+struct GlyphCache {
+	int page_size, max_pages;
+	AtlasPage* pages;
+	int num_pages;
+
+	Shelf* shelves;
+	int num_shelves, shelves_capacity;
+
+	GlyphEntry* entries;
+	int num_entries, entries_capacity;
+	int free_entry;            // head of the list of evicted entries, -1 when empty
+	int live_entries;
+
+	int* buckets;              // heads of the hash chains, -1 when empty
+	int num_buckets;           // power of 2
+
+	unsigned int frame;
+};
+
+// hashing
+
+static uint32_t hash_key(const GlyphKey* key)
+{
+	uint64_t h = (uint64_t) (uintptr_t) key->face;
+	h ^= (uint64_t) key->pixel_size * 0x9E3779B97F4A7C15ULL;
+	h ^= ((uint64_t) key->glyph_index << 8 | key->subpixel) * 0xC2B2AE3D27D4EB4FULL;
+	h ^= h >> 29;
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 32;
+	return (uint32_t) h;
+}
+
+static bool same_key(const GlyphKey* a, const GlyphKey* b)
+{
+	return a->face == b->face && a->pixel_size == b->pixel_size
+	    && a->glyph_index == b->glyph_index && a->subpixel == b->subpixel;
+}
+
+static bool rehash(GlyphCache* cache, int num_buckets)
+{
+	int* buckets = malloc(num_buckets * sizeof(int));
+	if(!buckets) return false;
+	memset(buckets, 0xFF, num_buckets * sizeof(int)); // all -1
+
+	// only live entries are in the old chains, walk those
+	int b, i;
+	for(b = 0; b < cache->num_buckets; b++) {
+		i = cache->buckets[b];
+		while(i != -1) {
+			GlyphEntry* e = &cache->entries[i];
+			int next = e->next_in_bucket;
+			int nb = hash_key(&e->key) & (num_buckets - 1);
+			e->next_in_bucket = buckets[nb];
+			buckets[nb] = i;
+			i = next;
+		}
+	}
+	free(cache->buckets);
+	cache->buckets = buckets;
+	cache->num_buckets = num_buckets;
+	return true;
+}
+
+static void unlink_entry(GlyphCache* cache, int index)
+{
+	int* link = &cache->buckets[hash_key(&cache->entries[index].key) & (cache->num_buckets - 1)];
+	while(*link != index) link = &cache->entries[*link].next_in_bucket;
+	*link = cache->entries[index].next_in_bucket;
+
+	cache->entries[index].next_in_bucket = cache->free_entry;
+	cache->free_entry = index;
+	cache->live_entries--;
+}
+
+// creation
+
+GlyphCache* glyph_cache_create(int page_size, int max_pages)
+{
+	GlyphCache* cache = calloc(1, sizeof(GlyphCache));
+	if(!cache) return NULL;
+	cache->page_size = page_size;
+	cache->max_pages = max_pages;
+	cache->free_entry = -1;
+	cache->pages = calloc(max_pages, sizeof(AtlasPage));
+	if(!cache->pages || !rehash(cache, INITIAL_BUCKETS)) {
+		glyph_cache_destroy(cache);
+		return NULL;
+	}
+	return cache;
+}
+
+void glyph_cache_destroy(GlyphCache* cache)
+{
+	if(!cache) return;
+	int p;
+	for(p = 0; p < cache->num_pages; p++) {
+		glDeleteTextures(1, &cache->pages[p].tex);
+		free(cache->pages[p].pixels);
+	}
+	gl_state_invalidate(); // a page may still be bound
+	free(cache->pages);
+	free(cache->shelves);
+	free(cache->entries);
+	free(cache->buckets);
+	free(cache);
+}
+
+static void mark_dirty(AtlasPage* page, int x0, int y0, int x1, int y1)
+{
+	if(page->dirty_x0 >= page->dirty_x1) {
+		page->dirty_x0 = x0; page->dirty_y0 = y0;
+		page->dirty_x1 = x1; page->dirty_y1 = y1;
+		return;
+	}
+	if(x0 < page->dirty_x0) page->dirty_x0 = x0;
+	if(y0 < page->dirty_y0) page->dirty_y0 = y0;
+	if(x1 > page->dirty_x1) page->dirty_x1 = x1;
+	if(y1 > page->dirty_y1) page->dirty_y1 = y1;
+}
+
+// 'pixels' is the initial content of the page, NULL for an empty one
+static bool add_page(GlyphCache* cache, const unsigned char* pixels)
+{
+	if(cache->num_pages == cache->max_pages) return false;
+
+	AtlasPage* page = &cache->pages[cache->num_pages];
+	size_t size = (size_t) cache->page_size * cache->page_size;
+	page->pixels = pixels ? malloc(size) : calloc(size, 1);
+	if(!page->pixels) return false;
+	if(pixels) memcpy(page->pixels, pixels, size);
+	page->shelf_bottom = 0;
+	page->dirty_x0 = page->dirty_x1 = 0;
+
+	glGenTextures(1, &page->tex);
+	gl_state_bind_texture(GL_TEXTURE_2D, page->tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	// the padding around glyphs keeps linear filtering from picking up the neighbors
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	GLint alignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	// start from the CPU copy, or straight from the given pixels, after this only dirty rectangles are uploaded
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, cache->page_size, cache->page_size, 0, GL_RED, GL_UNSIGNED_BYTE, pixels ? pixels : page->pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+
+	cache->num_pages++;
+	return true;
+}
+
+// shelf packing
+
+static int add_shelf(GlyphCache* cache, int page, int height)
+{
+	if(cache->num_shelves == cache->shelves_capacity) {
+		int capacity = cache->shelves_capacity ? cache->shelves_capacity * 2 : 64;
+		Shelf* shelves = realloc(cache->shelves, capacity * sizeof(Shelf));
+		if(!shelves) return -1;
+		cache->shelves = shelves;
+		cache->shelves_capacity = capacity;
+	}
+	Shelf* s = &cache->shelves[cache->num_shelves];
+	s->page = page;
+	s->y = cache->pages[page].shelf_bottom;
+	s->height = height;
+	s->x = 0;
+	s->last_used = cache->frame;
+	s->first_entry = -1;
+	cache->pages[page].shelf_bottom += height;
+	return cache->num_shelves++;
+}
+
+static void evict_shelf(GlyphCache* cache, int shelf)
+{
+	Shelf* s = &cache->shelves[shelf];
+	int i = s->first_entry;
+	while(i != -1) {
+		int next = cache->entries[i].next_in_shelf;
+		unlink_entry(cache, i);
+		i = next;
+	}
+	s->first_entry = -1;
+	s->x = 0;
+
+	// clear the old glyphs, new ones may not cover them and they'd bleed through the padding
+	AtlasPage* page = &cache->pages[s->page];
+	memset(page->pixels + (size_t) s->y * cache->page_size, 0, (size_t) s->height * cache->page_size);
+	mark_dirty(page, 0, s->y, cache->page_size, s->y + s->height);
+}
+
+// finds room for a w x h slot (padding included). returns the shelf, or -1 if there is none
+static int allocate(GlyphCache* cache, int w, int h)
+{
+	int i, best = -1;
+	if(w > cache->page_size || h > cache->page_size) return -1;
+
+	// best fit among the open shelves, not much taller than needed
+	for(i = 0; i < cache->num_shelves; i++) {
+		Shelf* s = &cache->shelves[i];
+		if(s->height < h || s->height > h + h / 4 + SHELF_ROUNDING) continue;
+		if(s->x + w > cache->page_size) continue;
+		if(best == -1 || s->height < cache->shelves[best].height) best = i;
+	}
+	if(best != -1) return best;
+
+	// a new shelf in a page with room left, or in a new page
+	int height = (h + SHELF_ROUNDING - 1) / SHELF_ROUNDING * SHELF_ROUNDING;
+	if(height > cache->page_size) height = h;
+	for(i = 0; i < cache->num_pages; i++) {
+		if(cache->pages[i].shelf_bottom + height <= cache->page_size) return add_shelf(cache, i, height);
+	}
+	if(add_page(cache, NULL)) return add_shelf(cache, cache->num_pages - 1, height);
+
+	// full: evict the least recently used shelf the glyph fits in, never one used this frame
+	for(i = 0; i < cache->num_shelves; i++) {
+		Shelf* s = &cache->shelves[i];
+		if(s->height < h || s->last_used == cache->frame) continue;
+		if(best == -1 || s->last_used < cache->shelves[best].last_used) best = i;
+	}
+	if(best != -1) evict_shelf(cache, best);
+	return best;
+}
+
+// lookup
+
+const GlyphInfo* glyph_cache_find(GlyphCache* cache, const GlyphKey* key)
+{
+	int i = cache->buckets[hash_key(key) & (cache->num_buckets - 1)];
+	while(i != -1) {
+		GlyphEntry* e = &cache->entries[i];
+		if(same_key(&e->key, key)) {
+			cache->shelves[e->shelf].last_used = cache->frame;
+			return &e->info;
+		}
+		i = e->next_in_bucket;
+	}
+	return NULL;
+}
+
+static int new_entry(GlyphCache* cache)
+{
+	if(cache->free_entry != -1) {
+		int i = cache->free_entry;
+		cache->free_entry = cache->entries[i].next_in_bucket;
+		return i;
+	}
+	if(cache->num_entries == cache->entries_capacity) {
+		int capacity = cache->entries_capacity ? cache->entries_capacity * 2 : 256;
+		GlyphEntry* entries = realloc(cache->entries, capacity * sizeof(GlyphEntry));
+		if(!entries) return -1;
+		cache->entries = entries;
+		cache->entries_capacity = capacity;
+	}
+	return cache->num_entries++;
+}
+
+// fills entry 'index' for a glyph at (x, y) on 'shelf' and makes it findable
+static const GlyphInfo* link_entry(GlyphCache* cache, int index, const GlyphKey* key, int shelf, int x, int y,
+                                   int width, int height, int bearing_x, int bearing_y, FT_Pos advance)
+{
+	Shelf* s = &cache->shelves[shelf];
+	GlyphEntry* e = &cache->entries[index];
+	e->key = *key;
+	e->shelf = shelf;
+	e->next_in_shelf = s->first_entry;
+	s->first_entry = index;
+	int bucket = hash_key(key) & (cache->num_buckets - 1);
+	e->next_in_bucket = cache->buckets[bucket];
+	cache->buckets[bucket] = index;
+	cache->live_entries++;
+
+	GlyphInfo* info = &e->info;
+	float size = (float) cache->page_size;
+	info->page = s->page;
+	info->u0 = x / size;
+	info->v0 = y / size;
+	info->u1 = (x + width) / size;
+	info->v1 = (y + height) / size;
+	info->width = width;
+	info->height = height;
+	info->bearing_x = bearing_x;
+	info->bearing_y = bearing_y;
+	info->advance = advance;
+	return info;
+}
+
+const GlyphInfo* glyph_cache_insert(GlyphCache* cache, const GlyphKey* key,
+                                    const unsigned char* bitmap, int width, int height, int pitch,
+                                    int bearing_x, int bearing_y, FT_Pos advance)
+{
+	// keep the chains short, there is one lookup per glyph drawn
+	if(cache->live_entries >= cache->num_buckets && !rehash(cache, cache->num_buckets * 2)) return NULL;
+
+	int shelf = allocate(cache, width + GLYPH_PADDING, height + GLYPH_PADDING);
+	if(shelf == -1) {
+		fprintf(stderr, "Glyph cache is full, can't fit glyph %u (%dx%d)\n", key->glyph_index, width, height);
+		return NULL;
+	}
+	int index = new_entry(cache);
+	if(index == -1) return NULL;
+
+	Shelf* s = &cache->shelves[shelf];
+	AtlasPage* page = &cache->pages[s->page];
+	int x = s->x, y = s->y, row;
+	for(row = 0; row < height; row++) {
+		memcpy(page->pixels + (size_t) (y + row) * cache->page_size + x, bitmap + (ptrdiff_t) row * pitch, width);
+	}
+	if(width > 0 && height > 0) mark_dirty(page, x, y, x + width, y + height);
+	s->x += width + GLYPH_PADDING;
+	s->last_used = cache->frame;
+
+	return link_entry(cache, index, key, shelf, x, y, width, height, bearing_x, bearing_y, advance);
+}
+
+unsigned int glyph_cache_subpixel(float pen_x)
+{
+	float fraction = pen_x - (float) (int) pen_x;
+	if(fraction < 0) fraction += 1.0;
+	unsigned int step = (unsigned int) (fraction * GLYPH_CACHE_SUBPIXEL_STEPS + 0.5);
+	return step % GLYPH_CACHE_SUBPIXEL_STEPS; // rounding up to a whole pixel is step 0 of the next one
+}
+
+const GlyphInfo* glyph_cache_get(GlyphCache* cache, FT_Face face, unsigned int pixel_size, FT_UInt glyph_index, float pen_x)
+{
+	GlyphKey key = { face, pixel_size, glyph_index, glyph_cache_subpixel(pen_x) };
+	const GlyphInfo* info = glyph_cache_find(cache, &key);
+	if(info) return info;
+
+	// rasterize, shifted right by the subpixel offset
+	FT_Vector delta = { (FT_Pos) key.subpixel * 64 / GLYPH_CACHE_SUBPIXEL_STEPS, 0 };
+	FT_Set_Pixel_Sizes(face, 0, pixel_size);
+	FT_Set_Transform(face, NULL, &delta);
+	FT_Error error = FT_Load_Glyph(face, glyph_index, FT_LOAD_RENDER);
+	FT_Set_Transform(face, NULL, NULL);
+	if(error) {
+		fprintf(stderr, "Freetype could not load glyph %u (error %d)\n", glyph_index, error);
+		return NULL;
+	}
+
+	FT_GlyphSlot slot = face->glyph;
+	FT_Bitmap* bmp = &slot->bitmap;
+	if(bmp->pixel_mode != FT_PIXEL_MODE_GRAY && bmp->rows > 0) {
+		fprintf(stderr, "Glyph %u is not an 8 bit gray bitmap\n", glyph_index);
+		return NULL;
+	}
+	// with a negative pitch FreeType stores the rows bottom up, start from the top one
+	const unsigned char* top_row = bmp->buffer;
+	if(bmp->pitch < 0) top_row += (ptrdiff_t) (bmp->rows - 1) * -bmp->pitch;
+
+	return glyph_cache_insert(cache, &key, top_row, bmp->width, bmp->rows, bmp->pitch,
+	                          slot->bitmap_left, slot->bitmap_top, slot->advance.x);
+}
+
+// GPU
+
+void glyph_cache_upload(GlyphCache* cache)
+{
+	int p;
+	GLint alignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	// the dirty rectangle is read straight out of the page copy
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, cache->page_size);
+
+	for(p = 0; p < cache->num_pages; p++) {
+		AtlasPage* page = &cache->pages[p];
+		if(page->dirty_x0 >= page->dirty_x1) continue;
+
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS, page->dirty_x0);
+		glPixelStorei(GL_UNPACK_SKIP_ROWS, page->dirty_y0);
+		gl_state_bind_texture(GL_TEXTURE_2D, page->tex);
+		glTexSubImage2D(GL_TEXTURE_2D, 0,
+			page->dirty_x0, page->dirty_y0,
+			page->dirty_x1 - page->dirty_x0, page->dirty_y1 - page->dirty_y0,
+			GL_RED, GL_UNSIGNED_BYTE, page->pixels);
+		page->dirty_x0 = page->dirty_x1 = 0;
+	}
+
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+}
+
+void glyph_cache_next_frame(GlyphCache* cache)
+{
+	cache->frame++;
+}
+
+int glyph_cache_num_pages(GlyphCache* cache)
+{
+	return cache->num_pages;
+}
+
+GLuint glyph_cache_page_texture(GlyphCache* cache, int page)
+{
+	return cache->pages[page].tex;
+}
+
+int glyph_cache_page_size(GlyphCache* cache)
+{
+	return cache->page_size;
+}
+
+// serialization
+
+// on-disk layout: GlyphCacheFileHeader, then for each page its shelf_bottom (int32) and pixels,
+// then the shelves and the glyphs as arrays of the records below
+typedef struct {
+	uint32_t page_size;
+	uint32_t num_pages, num_shelves, num_glyphs;
+} GlyphCacheFileHeader;
+
+typedef struct {
+	int32_t page, y, height, x;
+} ShelfRecord;
+
+typedef struct {
+	uint32_t pixel_size, glyph_index, subpixel;
+	int32_t shelf, x, y;
+	int32_t width, height, bearing_x, bearing_y;
+	int64_t advance;
+} GlyphRecord;
+
+int glyph_cache_write(GlyphCache* cache, FT_Face face, FILE* file)
+{
+	// only live entries are in the hash chains
+	uint32_t num_glyphs = 0;
+	int b, i;
+	for(b = 0; b < cache->num_buckets; b++) {
+		for(i = cache->buckets[b]; i != -1; i = cache->entries[i].next_in_bucket) {
+			if(cache->entries[i].key.face == face) num_glyphs++;
+		}
+	}
+
+	GlyphCacheFileHeader header = { cache->page_size, cache->num_pages, cache->num_shelves, num_glyphs };
+	if(fwrite(&header, sizeof(header), 1, file) != 1) return false;
+
+	size_t page_bytes = (size_t) cache->page_size * cache->page_size;
+	for(i = 0; i < cache->num_pages; i++) {
+		int32_t shelf_bottom = cache->pages[i].shelf_bottom;
+		if(fwrite(&shelf_bottom, sizeof(shelf_bottom), 1, file) != 1
+		   || fwrite(cache->pages[i].pixels, 1, page_bytes, file) != page_bytes) return false;
+	}
+
+	// glyphs of other faces are left out, but their shelves are kept so the space stays taken
+	for(i = 0; i < cache->num_shelves; i++) {
+		Shelf* s = &cache->shelves[i];
+		ShelfRecord record = { s->page, s->y, s->height, s->x };
+		if(fwrite(&record, sizeof(record), 1, file) != 1) return false;
+	}
+
+	float size = (float) cache->page_size;
+	for(b = 0; b < cache->num_buckets; b++) {
+		for(i = cache->buckets[b]; i != -1; i = cache->entries[i].next_in_bucket) {
+			GlyphEntry* e = &cache->entries[i];
+			if(e->key.face != face) continue;
+			GlyphRecord record = {
+				e->key.pixel_size, e->key.glyph_index, e->key.subpixel,
+				e->shelf, (int32_t) (e->info.u0 * size + 0.5), (int32_t) (e->info.v0 * size + 0.5),
+				e->info.width, e->info.height, e->info.bearing_x, e->info.bearing_y,
+				e->info.advance
+			};
+			if(fwrite(&record, sizeof(record), 1, file) != 1) return false;
+		}
+	}
+	return true;
+}
+
+int glyph_cache_read_bytes(const unsigned char** data, const unsigned char* end, void* out, size_t size)
+{
+	if((size_t) (end - *data) < size) return false;
+	memcpy(out, *data, size);
+	*data += size;
+	return true;
+}
+
+const unsigned char* glyph_cache_read(GlyphCache* cache, FT_Face face, const unsigned char* data, const unsigned char* end)
+{
+	if(cache->num_pages || cache->num_shelves || cache->live_entries) return NULL; // only into an empty cache
+
+	GlyphCacheFileHeader header;
+	if(!glyph_cache_read_bytes(&data, end, &header, sizeof(header))
+	   || header.page_size != (uint32_t) cache->page_size
+	   || header.num_pages > (uint32_t) cache->max_pages) return NULL;
+
+	size_t page_bytes = (size_t) cache->page_size * cache->page_size;
+	uint32_t i;
+	for(i = 0; i < header.num_pages; i++) {
+		int32_t shelf_bottom;
+		if(!glyph_cache_read_bytes(&data, end, &shelf_bottom, sizeof(shelf_bottom))
+		   || shelf_bottom < 0 || shelf_bottom > cache->page_size
+		   || (size_t) (end - data) < page_bytes) return NULL;
+		// uploaded from the file data, no intermediate copy
+		if(!add_page(cache, data)) return NULL;
+		cache->pages[i].shelf_bottom = shelf_bottom;
+		data += page_bytes;
+	}
+
+	for(i = 0; i < header.num_shelves; i++) {
+		ShelfRecord record;
+		if(!glyph_cache_read_bytes(&data, end, &record, sizeof(record))
+		   || record.page < 0 || (uint32_t) record.page >= header.num_pages
+		   || record.y < 0 || record.height <= 0 || record.y + record.height > cache->page_size
+		   || record.x < 0 || record.x > cache->page_size) return NULL;
+		int shelf = add_shelf(cache, record.page, record.height);
+		if(shelf == -1) return NULL;
+		// add_shelf() stacks shelves at the bottom of the page, put it back where it was
+		cache->pages[record.page].shelf_bottom -= record.height;
+		cache->shelves[shelf].y = record.y;
+		cache->shelves[shelf].x = record.x;
+	}
+
+	for(i = 0; i < header.num_glyphs; i++) {
+		GlyphRecord record;
+		if(!glyph_cache_read_bytes(&data, end, &record, sizeof(record))
+		   || record.shelf < 0 || (uint32_t) record.shelf >= header.num_shelves
+		   || record.subpixel >= GLYPH_CACHE_SUBPIXEL_STEPS
+		   || record.x < 0 || record.width < 0 || record.x + record.width > cache->page_size
+		   || record.y < 0 || record.height < 0 || record.y + record.height > cache->page_size) return NULL;
+
+		if(cache->live_entries >= cache->num_buckets && !rehash(cache, cache->num_buckets * 2)) return NULL;
+		int index = new_entry(cache);
+		if(index == -1) return NULL;
+		GlyphKey key = { face, record.pixel_size, record.glyph_index, record.subpixel };
+		link_entry(cache, index, &key, record.shelf, record.x, record.y,
+		           record.width, record.height, record.bearing_x, record.bearing_y, record.advance);
+	}
+	return data;
+}
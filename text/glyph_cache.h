@@ -0,0 +1,116 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Glyph cache packed into shared atlas textures
+ *
+ * Instead of one texture per glyph (see font_character.c), glyphs are rasterized once with
+ * FreeType and packed into a few large GL_RED atlas pages with a shelf packer:
+ * each page is split in horizontal shelves, and glyphs are placed left to right on the
+ * first shelf tall enough for them (but not much taller), opening a new shelf when needed.
+ *
+ * Glyphs are keyed by (face, pixel size, glyph index, subpixel offset). The subpixel offset
+ * is the fractional horizontal pen position quantized to GLYPH_CACHE_SUBPIXEL_STEPS,
+ * so that glyphs placed at fractional positions stay crisp.
+ *
+ * Pages keep a CPU copy of their pixels. New glyphs only mark a dirty rectangle, and
+ * glyph_cache_upload() sends just that rectangle with glTexSubImage2D.
+ *
+ * When every page is full, the least recently used shelf is evicted to make room,
+ * never one with glyphs used in the current frame (see glyph_cache_next_frame()).
+ *
+ * Requires FreeType and OpenGL 3.2.
+ */
+
+#ifndef OPENGL_PLAYGROUND_GLYPH_CACHE_H
+#define OPENGL_PLAYGROUND_GLYPH_CACHE_H
+
+#include <GL/glew.h>
+
+#include <stdio.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#define GLYPH_CACHE_SUBPIXEL_STEPS 4
+
+typedef struct {
+	FT_Face face;
+	unsigned int pixel_size;
+	FT_UInt glyph_index;
+	unsigned int subpixel; // 0 to GLYPH_CACHE_SUBPIXEL_STEPS-1
+} GlyphKey;
+
+typedef struct {
+	int page;                // atlas page holding the glyph
+	GLfloat u0, v0, u1, v1;  // texture coords of the glyph in the page, v0 is the top row
+	int width, height;       // bitmap size in pixels
+	int bearing_x;           // from the pen position to the left of the bitmap, in pixels
+	int bearing_y;           // from the baseline to the top of the bitmap, in pixels, up is positive
+	FT_Pos advance;          // horizontal pen advance, in 26.6 fixed point
+} GlyphInfo;
+
+typedef struct GlyphCache GlyphCache;
+
+// 'page_size' is the side of each square atlas page in pixels. returns NULL on failure
+GlyphCache* glyph_cache_create(int page_size, int max_pages);
+void glyph_cache_destroy(GlyphCache* cache);
+
+// returns the glyph, rasterizing it with FreeType on a miss. 'pen_x' is the pen position in pixels,
+// only its fractional part matters. NULL if the glyph can't be loaded or there is no room for it.
+// the returned pointer is valid until the next call that adds glyphs to the cache
+const GlyphInfo* glyph_cache_get(GlyphCache* cache, FT_Face face, unsigned int pixel_size, FT_UInt glyph_index, float pen_x);
+
+// lookup without rasterizing. NULL on a miss
+const GlyphInfo* glyph_cache_find(GlyphCache* cache, const GlyphKey* key);
+// adds an already rasterized 8 bit coverage bitmap. 'pitch' is the bytes between rows
+const GlyphInfo* glyph_cache_insert(GlyphCache* cache, const GlyphKey* key,
+                                    const unsigned char* bitmap, int width, int height, int pitch,
+                                    int bearing_x, int bearing_y, FT_Pos advance);
+
+// uploads the parts of the atlas pages changed since the last upload. call before drawing
+void glyph_cache_upload(GlyphCache* cache);
+// marks the start of a new frame. glyphs used since the previous call become evictable
+void glyph_cache_next_frame(GlyphCache* cache);
+
+int glyph_cache_num_pages(GlyphCache* cache);
+GLuint glyph_cache_page_texture(GlyphCache* cache, int page);
+int glyph_cache_page_size(GlyphCache* cache);
+
+// subpixel bucket of a pen position
+unsigned int glyph_cache_subpixel(float pen_x);
+
+// serialization, used for the text renderer cache file (see text_renderer_save_cache())
+
+// writes the atlas pages and the glyphs of 'face', without the face itself. returns 0 on failure
+int glyph_cache_write(GlyphCache* cache, FT_Face face, FILE* file);
+// restores what glyph_cache_write() wrote into an empty cache with the same page size, keying the glyphs by 'face'.
+// pages are uploaded straight from 'data', eg. a mapped file. returns the end of what was read,
+// or NULL if the data is invalid, in which case the cache is left half filled and should be recreated
+const unsigned char* glyph_cache_read(GlyphCache* cache, FT_Face face, const unsigned char* data, const unsigned char* end);
+// copies the next 'size' bytes out of [*data, end) and advances *data, the file may not be aligned for
+// direct access. returns 0 if fewer than 'size' bytes are left. shared with the text renderer's records
+int glyph_cache_read_bytes(const unsigned char** data, const unsigned char* end, void* out, size_t size);
+
+#endif // OPENGL_PLAYGROUND_GLYPH_CACHE_H
@@ -0,0 +1,320 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Multithreaded glyph rasterization
+ *
+ * See glyph_raster_pool.h for usage.
+ */
+
+#include "glyph_raster_pool.h"
+#include "../common/worker_pool.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+typedef enum { false, true } bool;
+
+#define REQUESTS_PER_GRAB 16 // requests a worker takes at once, fewer trips to the shared counter
+
+typedef struct {
+	GlyphRasterPool* pool;
+	FT_Library library;
+	FT_Face face;
+	unsigned int pixel_size;     // last size set on the face, setting it is not free
+
+	// bitmaps of the current run, packed one after the other
+	unsigned char* staging;
+	size_t staging_size, staging_capacity;
+} Worker;
+
+struct GlyphRasterPool {
+	void* font_data;             // the mmap'ed font file, shared by all faces
+	size_t font_size;
+
+	WorkerPool* threads;
+	Worker* workers;             // one per worker of the thread pool, each with its own face
+	int num_workers;
+
+	// the current run
+	const GlyphRequest* requests;
+	RasterizedGlyph* results;
+	size_t* offsets;             // of each bitmap in its worker staging, pointers are fixed up at the end
+	int* owners;                 // worker that rasterized each request
+	int offsets_capacity;
+	int count;
+	atomic_int next_request;
+};
+
+static bool stage_bitmap(Worker* w, const FT_Bitmap* bmp, size_t* offset)
+{
+	size_t size = (size_t) bmp->width * bmp->rows;
+	if(w->staging_size + size > w->staging_capacity) {
+		size_t capacity = w->staging_capacity ? w->staging_capacity * 2 : 64 * 1024;
+		while(capacity < w->staging_size + size) capacity *= 2;
+		unsigned char* staging = realloc(w->staging, capacity);
+		if(!staging) return false;
+		w->staging = staging;
+		w->staging_capacity = capacity;
+	}
+
+	// repack tightly, top row first, whatever the FreeType pitch
+	unsigned char* dst = w->staging + w->staging_size;
+	const unsigned char* src = bmp->buffer;
+	if(bmp->pitch < 0) src += (ptrdiff_t) (bmp->rows - 1) * -bmp->pitch;
+	unsigned int row;
+	for(row = 0; row < bmp->rows; row++) {
+		memcpy(dst + (size_t) row * bmp->width, src + (ptrdiff_t) row * bmp->pitch, bmp->width);
+	}
+
+	*offset = w->staging_size;
+	w->staging_size += size;
+	return true;
+}
+
+static void rasterize(Worker* w, int index)
+{
+	GlyphRasterPool* pool = w->pool;
+	const GlyphRequest* request = &pool->requests[index];
+	RasterizedGlyph* result = &pool->results[index];
+	memset(result, 0, sizeof(*result));
+	pool->owners[index] = w - pool->workers;
+
+	if(request->pixel_size != w->pixel_size) {
+		FT_Set_Pixel_Sizes(w->face, 0, request->pixel_size);
+		w->pixel_size = request->pixel_size;
+	}
+	// same subpixel shift as glyph_cache_get()
+	FT_Vector delta = { (FT_Pos) request->subpixel * 64 / GLYPH_CACHE_SUBPIXEL_STEPS, 0 };
+	FT_Set_Transform(w->face, NULL, &delta);
+	FT_Error error = FT_Load_Glyph(w->face, request->glyph_index, FT_LOAD_RENDER);
+	FT_Set_Transform(w->face, NULL, NULL);
+	if(error) return;
+
+	FT_GlyphSlot slot = w->face->glyph;
+	if(slot->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY && slot->bitmap.rows > 0) return;
+	if(!stage_bitmap(w, &slot->bitmap, &pool->offsets[index])) return;
+
+	result->ok = true;
+	result->width = slot->bitmap.width;
+	result->height = slot->bitmap.rows;
+	result->pitch = slot->bitmap.width;
+	result->bearing_x = slot->bitmap_left;
+	result->bearing_y = slot->bitmap_top;
+	result->advance = slot->advance.x;
+}
+
+static void rasterize_job(void* arg, int worker)
+{
+	GlyphRasterPool* pool = arg;
+	Worker* w = &pool->workers[worker];
+	w->staging_size = 0;
+	for(;;) {
+		int first = atomic_fetch_add(&pool->next_request, REQUESTS_PER_GRAB);
+		if(first >= pool->count) return;
+		int last = first + REQUESTS_PER_GRAB < pool->count ? first + REQUESTS_PER_GRAB : pool->count;
+		int i;
+		for(i = first; i < last; i++) rasterize(w, i);
+	}
+}
+
+GlyphRasterPool* glyph_raster_pool_create(const char* font_file, int face_index, int num_threads)
+{
+	GlyphRasterPool* pool = calloc(1, sizeof(GlyphRasterPool));
+	if(!pool) return NULL;
+
+	// map the font once, the faces only read from it
+	int fd = open(font_file, O_RDONLY);
+	struct stat st;
+	if(fd < 0 || fstat(fd, &st) != 0) {
+		fprintf(stderr, "Could not open font file '%s'\n", font_file);
+		if(fd >= 0) close(fd);
+		glyph_raster_pool_destroy(pool);
+		return NULL;
+	}
+	pool->font_size = st.st_size;
+	pool->font_data = mmap(NULL, pool->font_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping stays valid
+	if(pool->font_data == MAP_FAILED) {
+		pool->font_data = NULL;
+		fprintf(stderr, "Could not map font file '%s'\n", font_file);
+		glyph_raster_pool_destroy(pool);
+		return NULL;
+	}
+
+	if(num_threads <= 0) num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if(num_threads <= 0) num_threads = 1;
+	pool->workers = calloc(num_threads, sizeof(Worker));
+	if(!pool->workers) {
+		glyph_raster_pool_destroy(pool);
+		return NULL;
+	}
+
+	int i;
+	for(i = 0; i < num_threads; i++) {
+		Worker* w = &pool->workers[i];
+		w->pool = pool;
+		if(FT_Init_FreeType(&w->library)
+		   || FT_New_Memory_Face(w->library, pool->font_data, pool->font_size, face_index, &w->face)) {
+			fprintf(stderr, "Freetype could not load face for rasterization thread %d\n", i);
+			if(w->library) FT_Done_FreeType(w->library);
+			w->library = NULL;
+			break;
+		}
+		pool->num_workers++;
+	}
+	if(pool->num_workers > 0) pool->threads = worker_pool_create(pool->num_workers, rasterize_job, pool);
+	if(!pool->threads) {
+		glyph_raster_pool_destroy(pool);
+		return NULL;
+	}
+	// fewer threads may have started, their faces are not needed
+	while(pool->num_workers > worker_pool_size(pool->threads)) {
+		FT_Done_FreeType(pool->workers[--pool->num_workers].library);
+	}
+	return pool;
+}
+
+void glyph_raster_pool_destroy(GlyphRasterPool* pool)
+{
+	if(!pool) return;
+
+	worker_pool_destroy(pool->threads);
+	int i;
+	for(i = 0; i < pool->num_workers; i++) {
+		Worker* w = &pool->workers[i];
+		FT_Done_FreeType(w->library); // also releases the face
+		free(w->staging);
+	}
+	free(pool->workers);
+	free(pool->offsets);
+	free(pool->owners);
+	if(pool->font_data) munmap(pool->font_data, pool->font_size);
+	free(pool);
+}
+
+int glyph_raster_pool_run(GlyphRasterPool* pool, const GlyphRequest* requests, int count, RasterizedGlyph* results)
+{
+	if(count <= 0) return 0;
+	if(count > pool->offsets_capacity) {
+		size_t* offsets = realloc(pool->offsets, count * sizeof(size_t));
+		if(offsets) pool->offsets = offsets;
+		int* owners = realloc(pool->owners, count * sizeof(int));
+		if(owners) pool->owners = owners;
+		if(!offsets || !owners) return 0;
+		pool->offsets_capacity = count;
+	}
+
+	pool->requests = requests;
+	pool->results = results;
+	pool->count = count;
+	atomic_store(&pool->next_request, 0);
+	worker_pool_run(pool->threads);
+
+	// staging buffers may have moved while growing, point into them only now
+	int i, done = 0;
+	for(i = 0; i < count; i++) {
+		if(!results[i].ok) continue;
+		results[i].bitmap = pool->workers[pool->owners[i]].staging + pool->offsets[i];
+		done++;
+	}
+	return done;
+}
+
+typedef struct {
+	GlyphRequest request;
+	int index;
+} SortedRequest;
+
+static int compare_requests(const void* a, const void* b)
+{
+	const SortedRequest* ra = a;
+	const SortedRequest* rb = b;
+	if(ra->request.pixel_size != rb->request.pixel_size) return ra->request.pixel_size < rb->request.pixel_size ? -1 : 1;
+	if(ra->request.glyph_index != rb->request.glyph_index) return ra->request.glyph_index < rb->request.glyph_index ? -1 : 1;
+	if(ra->request.subpixel != rb->request.subpixel) return ra->request.subpixel < rb->request.subpixel ? -1 : 1;
+	return ra->index - rb->index;
+}
+
+int glyph_raster_pool_warm(GlyphRasterPool* pool, GlyphCache* cache, FT_Face face, const GlyphRequest* requests, int count)
+{
+	// only rasterize what is missing, and each glyph once: text repeats glyphs, and the cache does not
+	// check for keys it already has when inserting
+	GlyphRequest* missing = malloc(count * sizeof(GlyphRequest));
+	RasterizedGlyph* results = malloc(count * sizeof(RasterizedGlyph));
+	SortedRequest* sorted = malloc(count * sizeof(SortedRequest));
+	bool* repeated = calloc(count, sizeof(bool));
+	int i, num_missing = 0, added = 0;
+	if(!missing || !results || !sorted || !repeated) {
+		free(missing);
+		free(results);
+		free(sorted);
+		free(repeated);
+		return 0;
+	}
+	for(i = 0; i < count; i++) {
+		sorted[i].request = requests[i];
+		sorted[i].index = i;
+	}
+	// equal requests end up next to each other, the first one in request order before the others
+	qsort(sorted, count, sizeof(SortedRequest), compare_requests);
+	for(i = 1; i < count; i++) {
+		const GlyphRequest* a = &sorted[i - 1].request;
+		const GlyphRequest* b = &sorted[i].request;
+		if(a->pixel_size == b->pixel_size && a->glyph_index == b->glyph_index && a->subpixel == b->subpixel) {
+			repeated[sorted[i].index] = true;
+		}
+	}
+	// in request order, which is the order they are packed in
+	for(i = 0; i < count; i++) {
+		if(repeated[i]) continue;
+		GlyphKey key = { face, requests[i].pixel_size, requests[i].glyph_index, requests[i].subpixel };
+		if(!glyph_cache_find(cache, &key)) missing[num_missing++] = requests[i];
+	}
+	free(sorted);
+	free(repeated);
+
+	glyph_raster_pool_run(pool, missing, num_missing, results);
+
+	// packing touches the cache and the atlas, it stays on this thread
+	for(i = 0; i < num_missing; i++) {
+		RasterizedGlyph* r = &results[i];
+		if(!r->ok) continue;
+		GlyphKey key = { face, missing[i].pixel_size, missing[i].glyph_index, missing[i].subpixel };
+		if(glyph_cache_insert(cache, &key, r->bitmap, r->width, r->height, r->pitch, r->bearing_x, r->bearing_y, r->advance)) {
+			added++;
+		}
+	}
+
+	free(missing);
+	free(results);
+	return added;
+}
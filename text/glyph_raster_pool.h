@@ -0,0 +1,83 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Multithreaded glyph rasterization
+ *
+ * FreeType faces can't be used from more than one thread at a time, so a single face serializes
+ * all rasterization. This pool runs a few workers (see ../common/worker_pool.h), the calling thread
+ * and worker threads, each with its own FT_Library and FT_Face.
+ * The font file is mapped into memory once with mmap and every worker opens its face over
+ * that same memory with FT_New_Memory_Face, so the font data is not duplicated per thread.
+ *
+ * A batch of glyph requests is split between the workers, which rasterize into their own
+ * staging buffers. The results can then be packed into the glyph cache (see glyph_cache.h)
+ * and uploaded on the GL thread, eg. to warm a large glyph set at startup:
+ *
+ *   GlyphRasterPool* pool = glyph_raster_pool_create(FONT_FILE, 0, 0);
+ *   glyph_raster_pool_warm(pool, cache, ft_face, requests, num_requests);
+ *   glyph_cache_upload(cache);
+ *
+ * Requires FreeType and POSIX threads.
+ */
+
+#ifndef OPENGL_PLAYGROUND_GLYPH_RASTER_POOL_H
+#define OPENGL_PLAYGROUND_GLYPH_RASTER_POOL_H
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "glyph_cache.h"
+
+typedef struct {
+	FT_UInt glyph_index;
+	unsigned int pixel_size;
+	unsigned int subpixel;       // 0 to GLYPH_CACHE_SUBPIXEL_STEPS-1
+} GlyphRequest;
+
+typedef struct {
+	int ok;                      // 0 if FreeType failed on this glyph
+	const unsigned char* bitmap; // top row first, in the pool staging area
+	int width, height, pitch;
+	int bearing_x, bearing_y;
+	FT_Pos advance;              // 26.6
+} RasterizedGlyph;
+
+typedef struct GlyphRasterPool GlyphRasterPool;
+
+// maps 'font_file' and opens face 'face_index' of it for 'num_threads' workers, counting the calling
+// thread, 0 for one per CPU. returns NULL on failure
+GlyphRasterPool* glyph_raster_pool_create(const char* font_file, int face_index, int num_threads);
+void glyph_raster_pool_destroy(GlyphRasterPool* pool);
+
+// rasterizes all requests in parallel and waits for them. results[i] is the glyph of requests[i],
+// its bitmap is valid until the next run. returns how many glyphs were rasterized
+int glyph_raster_pool_run(GlyphRasterPool* pool, const GlyphRequest* requests, int count, RasterizedGlyph* results);
+
+// rasterizes the requests that are not in 'cache' yet and adds them, keyed by 'face'. repeated requests are rasterized once.
+// 'face' must be a face of the same font, the one used to look the glyphs up later.
+// returns how many glyphs were added
+int glyph_raster_pool_warm(GlyphRasterPool* pool, GlyphCache* cache, FT_Face face, const GlyphRequest* requests, int count);
+
+#endif // OPENGL_PLAYGROUND_GLYPH_RASTER_POOL_H
@@ -0,0 +1,193 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Signed distance field glyphs
+ *
+ * See sdf_glyph.h for usage.
+ */
+
+#include "sdf_glyph.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define EDT_INF 1e20f
+
+const char* sdf_text_fs_source =
+	"#version 330\n"
+	"uniform sampler2D tex;\n"
+	"in vec2 vs_tex_coord;\n"
+	"in vec4 vs_color;\n"
+	"layout (location = 0) out vec4 color;\n"
+	"void main(void) {\n"
+	// 0.5 is the outline. fwidth is how much the distance changes over one screen pixel,
+	// so the edge is antialiased over about a pixel whatever the magnification
+	"  float distance = texture(tex, vs_tex_coord).r;\n"
+	"  float width = fwidth(distance) * 0.75;\n"
+	"  float alpha = smoothstep(0.5 - width, 0.5 + width, distance);\n"
+	"  color = vec4(vs_color.rgb, vs_color.a * alpha);\n"
+	"}\n";
+
+// 1D squared distance transform of 'f' (n samples 'stride' apart), written in place.
+// 'v', 'z' and 'd' are scratch space of n, n+1 and n elements
+static void edt_1d(float* f, int n, int stride, int* v, float* z, float* d)
+{
+	int q, k = 0;
+	v[0] = 0;
+	z[0] = -EDT_INF;
+	z[1] = EDT_INF;
+
+	// lower envelope of the parabolas rooted at each sample
+	for(q = 1; q < n; q++) {
+		float fq = f[q * stride] + q*q;
+		float s = (fq - (f[v[k] * stride] + v[k]*v[k])) / (2*q - 2*v[k]);
+		// z[0] is -inf, so this never walks past the first parabola
+		while(s <= z[k]) {
+			k--;
+			s = (fq - (f[v[k] * stride] + v[k]*v[k])) / (2*q - 2*v[k]);
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k+1] = EDT_INF;
+	}
+
+	for(k = 0, q = 0; q < n; q++) {
+		while(z[k+1] < q) k++;
+		int p = v[k];
+		d[q] = (q - p) * (q - p) + f[p * stride];
+	}
+	for(q = 0; q < n; q++) f[q * stride] = d[q];
+}
+
+// squared distance from every cell to the closest cell that is 0 in 'grid', in place
+static void edt_2d(float* grid, int w, int h, int* v, float* z, float* d)
+{
+	int x, y;
+	for(x = 0; x < w; x++) edt_1d(grid + x, h, w, v, z, d);
+	for(y = 0; y < h; y++) edt_1d(grid + y * w, w, 1, v, z, d);
+}
+
+unsigned char* sdf_glyph_render(FT_Face face, FT_UInt glyph_index, unsigned int sdf_size, int spread,
+                                int* width, int* height, int* bearing_x, int* bearing_y)
+{
+	const int U = SDF_GLYPH_UPSCALE;
+
+	FT_Set_Pixel_Sizes(face, 0, sdf_size * U);
+	if(FT_Load_Glyph(face, glyph_index, FT_LOAD_RENDER)) {
+		fprintf(stderr, "Freetype could not load glyph %u\n", glyph_index);
+		return NULL;
+	}
+	FT_Bitmap* bmp = &face->glyph->bitmap;
+	if(bmp->pixel_mode != FT_PIXEL_MODE_GRAY && bmp->rows > 0) {
+		fprintf(stderr, "Glyph %u is not an 8 bit gray bitmap\n", glyph_index);
+		return NULL;
+	}
+
+	if(bmp->width == 0 || bmp->rows == 0) {
+		// nothing to draw, eg. a space. still cached so that it is not rendered again
+		*width = *height = *bearing_x = *bearing_y = 0;
+		return malloc(1);
+	}
+
+	// place the high resolution bitmap in a grid of whole SDF texels, aligned to the pen position,
+	// with 'spread' texels of margin all around for the field to fade out
+	int left = face->glyph->bitmap_left, top = face->glyph->bitmap_top;
+	int texel_left = (int) floorf((float) left / U);
+	int texel_top = (int) ceilf((float) top / U);
+	int margin = spread * U;
+	int offset_x = margin + (left - texel_left * U);
+	int offset_y = margin + (texel_top * U - top);
+	int out_w = (offset_x + (int) bmp->width + margin + U - 1) / U;
+	int out_h = (offset_y + (int) bmp->rows + margin + U - 1) / U;
+	int grid_w = out_w * U, grid_h = out_h * U;
+	int grid_max = grid_w > grid_h ? grid_w : grid_h;
+
+	float* outside = malloc((size_t) grid_w * grid_h * sizeof(float));
+	float* inside = malloc((size_t) grid_w * grid_h * sizeof(float));
+	int* v = malloc(grid_max * sizeof(int));
+	float* z = malloc((grid_max + 1) * sizeof(float));
+	float* d = malloc(grid_max * sizeof(float));
+	unsigned char* out = malloc((size_t) out_w * out_h);
+	if(!outside || !inside || !v || !z || !d || !out) {
+		free(outside); free(inside); free(v); free(z); free(d); free(out);
+		return NULL;
+	}
+
+	// 'outside' measures the distance to the glyph, 'inside' the distance to the background
+	int x, y;
+	for(y = 0; y < grid_h; y++) {
+		int by = y - offset_y;
+		for(x = 0; x < grid_w; x++) {
+			int bx = x - offset_x;
+			int covered = bx >= 0 && by >= 0 && bx < (int) bmp->width && by < (int) bmp->rows
+			              && bmp->buffer[by * bmp->pitch + bx] >= 128;
+			outside[y * grid_w + x] = covered ? 0 : EDT_INF;
+			inside[y * grid_w + x] = covered ? EDT_INF : 0;
+		}
+	}
+	edt_2d(outside, grid_w, grid_h, v, z, d);
+	edt_2d(inside, grid_w, grid_h, v, z, d);
+
+	// sample at the center of each SDF texel. positive distances are inside the glyph
+	float scale = 0.5f / margin;
+	for(y = 0; y < out_h; y++) {
+		for(x = 0; x < out_w; x++) {
+			int cell = (y * U + U/2) * grid_w + x * U + U/2;
+			float distance = sqrtf(inside[cell]) - sqrtf(outside[cell]);
+			float value = 0.5f + distance * scale;
+			if(value < 0) value = 0;
+			if(value > 1) value = 1;
+			out[y * out_w + x] = (unsigned char) (value * 255.0f + 0.5f);
+		}
+	}
+
+	free(outside); free(inside); free(v); free(z); free(d);
+
+	*width = out_w;
+	*height = out_h;
+	*bearing_x = texel_left - spread;
+	*bearing_y = texel_top + spread;
+	return out;
+}
+
+const GlyphInfo* glyph_cache_get_sdf(GlyphCache* cache, FT_Face face, FT_UInt glyph_index, unsigned int sdf_size, int spread)
+{
+	GlyphKey key = { face, GLYPH_KEY_SDF | (unsigned int) spread << 16 | sdf_size, glyph_index, 0 };
+	const GlyphInfo* info = glyph_cache_find(cache, &key);
+	if(info) return info;
+
+	int width, height, bearing_x, bearing_y;
+	unsigned char* sdf = sdf_glyph_render(face, glyph_index, sdf_size, spread, &width, &height, &bearing_x, &bearing_y);
+	if(!sdf) return NULL;
+
+	// rendered U times larger, bring the advance back to SDF texels
+	FT_Pos advance = face->glyph->advance.x / SDF_GLYPH_UPSCALE;
+	info = glyph_cache_insert(cache, &key, sdf, width, height, width, bearing_x, bearing_y, advance);
+	free(sdf);
+	return info;
+}
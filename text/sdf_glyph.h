@@ -0,0 +1,71 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Signed distance field glyphs
+ *
+ * A glyph bitmap only looks right at the size it was rasterized for. A signed distance field (SDF)
+ * stores, for every texel, the distance to the glyph outline instead: 0.5 (128) on the outline,
+ * more inside and less outside, falling off linearly over 'spread' texels.
+ * Bilinear filtering of distances gives distances again, so the fragment shader can find the
+ * outline at any magnification and antialias it with smoothstep. One small SDF per glyph then
+ * serves every text size and zoom level.
+ *
+ * The field is computed from a FreeType bitmap rendered SDF_GLYPH_UPSCALE times larger than the
+ * SDF, with an exact Euclidean distance transform (Felzenszwalb and Huttenlocher's separable
+ * lower envelope of parabolas), run for the distance to the inside and to the outside of the glyph.
+ *
+ * SDF glyphs go in the same glyph cache as bitmaps (see glyph_cache.h), under their own keys.
+ * Draw them with sdf_text_fs_source as the fragment shader, the text renderer does this with
+ * text_renderer_use_sdf().
+ *
+ * Requires FreeType.
+ */
+
+#ifndef OPENGL_PLAYGROUND_SDF_GLYPH_H
+#define OPENGL_PLAYGROUND_SDF_GLYPH_H
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "glyph_cache.h"
+
+#define SDF_GLYPH_UPSCALE 8
+
+// set in the pixel size of SDF glyph keys, so that they never collide with bitmap glyphs.
+// the key pixel size is GLYPH_KEY_SDF | spread << 16 | sdf_size
+#define GLYPH_KEY_SDF 0x80000000u
+
+// fragment shader for SDF glyphs, with the batch attributes. reads the distance from 'tex'
+extern const char* sdf_text_fs_source;
+
+// computes the SDF of a glyph, 'sdf_size' pixels per em with the outline fading over 'spread' texels.
+// returns a malloc'ed 8 bit image, or NULL on failure. the bearings include the spread
+unsigned char* sdf_glyph_render(FT_Face face, FT_UInt glyph_index, unsigned int sdf_size, int spread,
+                                int* width, int* height, int* bearing_x, int* bearing_y);
+
+// returns the SDF of a glyph from the cache, computing it on a miss. its metrics are in SDF texels
+const GlyphInfo* glyph_cache_get_sdf(GlyphCache* cache, FT_Face face, FT_UInt glyph_index, unsigned int sdf_size, int spread);
+
+#endif // OPENGL_PLAYGROUND_SDF_GLYPH_H
@@ -0,0 +1,313 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Example of laying out and rendering paragraphs of text
+ *
+ * Builds on font_character.c: instead of one texture per glyph, glyphs are packed in atlas
+ * textures by the glyph cache, and whole paragraphs are laid out with kerning and line wrapping
+ * by the text renderer and drawn in one batch. See text_renderer.h.
+ *
+ * The text wraps to the window width. The up and down arrow keys change the font size.
+ * The S key switches between bitmap glyphs, rasterized for each size, and signed distance field
+ * glyphs, computed once at 32 pixels and scaled to every size (see sdf_glyph.h).
+ *
+ * Compiling this example:
+ * Linux: gcc ../common/shader.c ../common/gl_state.c ../common/batch2d.c ../common/headless.c ../common/benchmark.c ../common/worker_pool.c glyph_cache.c glyph_raster_pool.c sdf_glyph.c text_renderer.c text_paragraph.c -I/usr/include/freetype2 -lGL -lGLEW -lglfw -lfreetype -lm -lpthread -lEGL -o text_paragraph
+ *
+ * Requires OpenGL 3.3, GLEW and GLFW to be installed or provided as includes for compilation.
+ * Requires FreeType for font loading: https://www.freetype.org/
+ */
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "text_renderer.h"
+#include "glyph_raster_pool.h"
+#include "../common/gl_state.h"
+#include "../common/headless.h"
+#include "../common/benchmark.h"
+
+typedef enum { false, true } bool;
+
+GLFWwindow* window;
+BenchmarkOptions benchmark;
+int window_width = 600, window_height = 400;
+
+FT_Library ft_library;
+FT_Face ft_face;
+unsigned int pt = 18;
+bool use_sdf = false;
+#define FONT_FILE "/usr/share/fonts/TTF/LiberationSans-Regular.ttf"
+
+TextRenderer text;
+
+const char* paragraph =
+	"OpenGL Playground\n"
+	"A collection of examples and techniques using modern pipeline OpenGL. "
+	"This paragraph is laid out once per frame: every glyph is looked up in the metrics cache, "
+	"kerned against the previous one (AV, To, Wa), and placed as a quad textured from the glyph atlas. "
+	"Non-ASCII text goes through the same path: àéîõü, ñ, ß, æøå, Ελληνικά, Кириллица.\n"
+	"\n"
+	"All of it is a single draw call.";
+
+
+void display()
+{
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	text_renderer_begin(&text);
+	float margin = 10;
+	float height = 0;
+	int i;
+	// benchmark workloads lay out the paragraph more times, on top of itself
+	for(i = 0; i < benchmark.workload; i++) {
+		height = text_draw(&text, ft_face, pt, paragraph, margin, margin, window_width - 2*margin, 0xFFFFFFFF);
+	}
+	// a second, smaller block right under the first one, in another color
+	text_draw(&text, ft_face, pt * 2 / 3, "Up and down arrows change the size, S toggles SDF glyphs.", margin, margin + height + pt, 0, 0x80C0FFFF);
+	text_renderer_flush(&text);
+
+	gl_state_next_frame();
+	glFlush();
+}
+
+int init()
+{
+	// global state
+	glClearColor(0.0, 0.0, 0.0, 0.0);
+
+	if(!text_renderer_init(&text, window_width, window_height)) return false;
+
+	return true;
+}
+
+void shutdown_glfw_and_exit(int status_code)
+{
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	exit(status_code);
+}
+
+static void swap_buffers()
+{
+	glfwSwapBuffers(window);
+}
+
+// callbacks
+
+static void key_cb(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if(key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
+		glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+	else if(key == GLFW_KEY_UP && action == GLFW_PRESS) {
+		pt += 2;
+	}
+	else if(key == GLFW_KEY_DOWN && action == GLFW_PRESS && pt > 6) {
+		pt -= 2;
+	}
+	else if(key == GLFW_KEY_S && action == GLFW_PRESS) {
+		use_sdf = !use_sdf;
+		text_renderer_use_sdf(&text, use_sdf ? 32 : 0);
+		printf("Drawing %s glyphs\n", use_sdf ? "SDF" : "bitmap");
+	}
+}
+
+static void framebuffer_size_cb(GLFWwindow* window, int width, int height)
+{
+	window_width = width;
+	window_height = height;
+	glViewport(0, 0, width, height);
+	text_renderer_set_viewport(&text, width, height);
+}
+
+static void error_cb(int error, const char* description)
+{
+	fprintf(stderr, "ERROR: %s\n", description);
+}
+
+// freetype
+
+void init_freetype()
+{
+	if(FT_Init_FreeType(&ft_library)) {
+		fprintf(stderr, "Freetype Error! Quitting...\n");
+		shutdown_glfw_and_exit(-1);
+	}
+	if(FT_New_Face(ft_library, FONT_FILE, 0, &ft_face)) {
+		fprintf(stderr, "Freetype could not load face! Quitting...\n");
+		shutdown_glfw_and_exit(-1);
+	}
+	// sizes are set per glyph by the text renderer, they can change between strings
+}
+
+// rasterizes Latin-1 at both text sizes and every subpixel position on all CPUs,
+// so the first frames don't stall on FreeType
+void warm_glyph_cache()
+{
+	GlyphRasterPool* pool = glyph_raster_pool_create(FONT_FILE, 0, 0);
+	if(!pool) return; // glyphs are still rasterized on demand
+
+	unsigned int sizes[] = { pt, pt * 2 / 3 };
+	GlyphRequest requests[2 * (256 - 32) * GLYPH_CACHE_SUBPIXEL_STEPS];
+	int count = 0;
+	unsigned int s, c, subpixel;
+	for(s = 0; s < 2; s++) {
+		for(c = 32; c < 256; c++) {
+			FT_UInt glyph_index = FT_Get_Char_Index(ft_face, c);
+			if(!glyph_index) continue;
+			for(subpixel = 0; subpixel < GLYPH_CACHE_SUBPIXEL_STEPS; subpixel++) {
+				GlyphRequest r = { glyph_index, sizes[s], subpixel };
+				requests[count++] = r;
+			}
+		}
+	}
+
+	// not glfwGetTime(), GLFW is not initialized when running headless
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int added = glyph_raster_pool_warm(pool, text.glyphs, ft_face, requests, count);
+	glyph_cache_upload(text.glyphs);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Warmed %d glyphs in %.1f ms\n", added,
+	       (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0);
+	glyph_raster_pool_destroy(pool);
+}
+
+// glyphs from the previous run come from the cache file, only new ones are rasterized
+int load_glyphs()
+{
+	int loaded = text_renderer_load_cache(&text, ft_face, FONT_FILE, TEXT_CACHE_DEFAULT_DIR);
+	if(loaded < 0) return false;
+	if(loaded) {
+		printf("Loaded glyph cache\n");
+	}
+	else {
+		warm_glyph_cache();
+	}
+	return true;
+}
+
+// main
+
+int main(int argc, char** argv)
+{
+	benchmark_parse_args(&benchmark, argc, argv);
+	HeadlessOptions headless;
+	headless_parse_args(&headless, argc, argv);
+	if(headless.enabled) {
+		// no window, frames go to an offscreen framebuffer
+		HeadlessContext ctx;
+		if(!headless_init(&ctx, window_width, window_height, 3, 3) || !init()) exit(-1);
+		init_freetype();
+		if(!load_glyphs()) {
+			text_renderer_free(&text);
+			headless_free(&ctx);
+			exit(-1);
+		}
+		bool ok = benchmark.enabled ? benchmark_run(&benchmark, "text_paragraph", display, NULL) : headless_run(&ctx, &headless, display);
+		if(!benchmark.enabled) gl_state_print_stats();
+		text_renderer_save_cache(&text, ft_face, FONT_FILE, TEXT_CACHE_DEFAULT_DIR);
+		text_renderer_free(&text);
+		headless_free(&ctx);
+		exit(ok ? 0 : -1);
+	}
+
+	glfwSetErrorCallback(error_cb);
+
+	// GLFW init
+	if(!glfwInit()) {
+		fprintf(stderr, "GLFW Error: Failed to initialize\nQuitting...\n");
+		exit(-1);
+	}
+	printf("Using GLFW %s\n", glfwGetVersionString());
+
+	// Context creation
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+
+	window = glfwCreateWindow(window_width, window_height, "Text Layout", NULL, NULL);
+	if (!window) {
+		glfwTerminate();
+		exit(-1);
+	}
+
+	glfwSetKeyCallback(window, key_cb);
+	glfwSetFramebufferSizeCallback(window, framebuffer_size_cb);
+
+	glfwMakeContextCurrent(window);
+
+	glewExperimental = GL_TRUE;
+	GLenum err = glewInit();
+	if(err != GLEW_OK) {
+		fprintf(stderr, "GLEW Error: %s\nQuitting...\n", glewGetErrorString(err));
+		shutdown_glfw_and_exit(-1);
+	}
+	printf("Using OpenGL %s\n", glGetString(GL_VERSION));
+
+	// benchmarks must not wait for vsync
+	glfwSwapInterval(benchmark.enabled ? 0 : 1);
+
+	if(!init()) {
+		shutdown_glfw_and_exit(-1);
+	}
+	// the window may have a different framebuffer size than asked for, eg. on high dpi screens
+	glfwGetFramebufferSize(window, &window_width, &window_height);
+	framebuffer_size_cb(window, window_width, window_height);
+
+	// freetype
+	init_freetype();
+	if(!load_glyphs()) {
+		text_renderer_free(&text);
+		shutdown_glfw_and_exit(-1);
+	}
+
+	if(benchmark.enabled) {
+		shutdown_glfw_and_exit(benchmark_run(&benchmark, "text_paragraph", display, swap_buffers) ? 0 : -1);
+	}
+
+	// main loop
+	while (!glfwWindowShouldClose(window))
+	{
+		display();
+		glfwSwapBuffers(window);
+		glfwPollEvents();
+	}
+	gl_state_print_stats();
+
+	// shut down
+	text_renderer_save_cache(&text, ft_face, FONT_FILE, TEXT_CACHE_DEFAULT_DIR);
+	text_renderer_free(&text);
+	shutdown_glfw_and_exit(0);
+}
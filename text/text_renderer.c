@@ -0,0 +1,716 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Batched text layout and rendering
+ *
+ * See text_renderer.h for usage.
+ */
+
+#include "text_renderer.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include FT_ADVANCES_H
+
+#include "sdf_glyph.h"
+#include "../common/shader.h"
+
+typedef enum { false, true } bool;
+
+// same attribute layout as the batch default program
+static const char *text_vs_source =
+	"#version 330\n"
+	"layout (location = 0) in vec2 v_pos;\n"
+	"layout (location = 1) in vec2 v_tex;\n"
+	"layout (location = 2) in vec4 v_color;\n"
+	"out vec2 vs_tex_coord;\n"
+	"out vec4 vs_color;\n"
+	"void main(void) {\n"
+	"  gl_Position = vec4(v_pos, 0.0, 1.0);\n"
+	"  vs_tex_coord = v_tex;\n"
+	"  vs_color = v_color;\n"
+	"}\n";
+
+#define ATLAS_PAGE_SIZE 1024
+#define ATLAS_MAX_PAGES 4
+#define BATCH_MAX_QUADS 16384
+
+#define SDF_SPREAD 4 // texels over which the SDF outline fades, more allows more zoom out
+
+#define NO_CODEPOINT 0xFFFFFFFFu
+#define NO_PAIR UINT64_MAX
+
+// metrics cache
+
+typedef struct {
+	unsigned int codepoint;
+	FT_UInt glyph_index;
+	FT_Pos advance;           // 26.6
+} CodepointEntry;
+
+typedef struct {
+	uint64_t pair;            // left glyph index << 32 | right glyph index
+	FT_Pos kerning;           // 26.6
+} KerningEntry;
+
+struct FontMetrics {
+	FT_Face face;
+	unsigned int pixel_size;
+	float ascender, line_height; // in pixels
+	bool has_kerning;
+
+	CodepointEntry ascii[128];   // direct lookup for the common case, codepoint NO_CODEPOINT until loaded
+
+	// open addressing hash tables, capacities are powers of 2 and kept under half full
+	CodepointEntry* codepoints;
+	int codepoints_count, codepoints_capacity;
+	KerningEntry* kerning;
+	int kerning_count, kerning_capacity;
+};
+
+static uint32_t hash_u64(uint64_t x)
+{
+	x ^= x >> 33;
+	x *= 0xFF51AFD7ED558CCDULL;
+	x ^= x >> 33;
+	return (uint32_t) x;
+}
+
+static FontMetrics* alloc_metrics(FT_Face face, unsigned int pixel_size)
+{
+	FontMetrics* fm = calloc(1, sizeof(FontMetrics));
+	if(!fm) return NULL;
+	fm->face = face;
+	fm->pixel_size = pixel_size;
+
+	int i;
+	for(i = 0; i < 128; i++) fm->ascii[i].codepoint = NO_CODEPOINT;
+	return fm;
+}
+
+static FontMetrics* create_metrics(FT_Face face, unsigned int pixel_size)
+{
+	FontMetrics* fm = alloc_metrics(face, pixel_size);
+	if(!fm) return NULL;
+
+	FT_Set_Pixel_Sizes(face, 0, pixel_size);
+	fm->ascender = face->size->metrics.ascender / 64.0;
+	fm->line_height = face->size->metrics.height / 64.0;
+	fm->has_kerning = FT_HAS_KERNING(face);
+	return fm;
+}
+
+static void free_metrics(FontMetrics* fm)
+{
+	free(fm->codepoints);
+	free(fm->kerning);
+	free(fm);
+}
+
+static bool add_metrics(TextRenderer* t, FontMetrics* fm)
+{
+	if(t->num_fonts == t->fonts_capacity) {
+		int capacity = t->fonts_capacity ? t->fonts_capacity * 2 : 8;
+		FontMetrics** fonts = realloc(t->fonts, capacity * sizeof(FontMetrics*));
+		if(!fonts) return false;
+		t->fonts = fonts;
+		t->fonts_capacity = capacity;
+	}
+	t->fonts[t->num_fonts++] = fm;
+	return true;
+}
+
+static FontMetrics* find_metrics(TextRenderer* t, FT_Face face, unsigned int pixel_size)
+{
+	int i;
+	for(i = 0; i < t->num_fonts; i++) {
+		if(t->fonts[i]->face == face && t->fonts[i]->pixel_size == pixel_size) return t->fonts[i];
+	}
+
+	FontMetrics* fm = create_metrics(face, pixel_size);
+	if(fm && !add_metrics(t, fm)) {
+		free_metrics(fm);
+		return NULL;
+	}
+	return fm;
+}
+
+static void load_codepoint(FontMetrics* fm, CodepointEntry* entry, unsigned int codepoint)
+{
+	FT_Fixed advance = 0;
+	FT_Set_Pixel_Sizes(fm->face, 0, fm->pixel_size);
+	entry->codepoint = codepoint;
+	entry->glyph_index = FT_Get_Char_Index(fm->face, codepoint); // 0 is the missing glyph, drawn like any other
+	FT_Get_Advance(fm->face, entry->glyph_index, FT_LOAD_DEFAULT, &advance);
+	entry->advance = advance >> 10; // 16.16 to 26.6
+}
+
+static bool grow_codepoints(FontMetrics* fm)
+{
+	int capacity = fm->codepoints_capacity ? fm->codepoints_capacity * 2 : 256;
+	CodepointEntry* table = malloc(capacity * sizeof(CodepointEntry));
+	if(!table) return false;
+	int i;
+	for(i = 0; i < capacity; i++) table[i].codepoint = NO_CODEPOINT;
+	for(i = 0; i < fm->codepoints_capacity; i++) {
+		CodepointEntry* e = &fm->codepoints[i];
+		if(e->codepoint == NO_CODEPOINT) continue;
+		uint32_t slot = hash_u64(e->codepoint) & (capacity - 1);
+		while(table[slot].codepoint != NO_CODEPOINT) slot = (slot + 1) & (capacity - 1);
+		table[slot] = *e;
+	}
+	free(fm->codepoints);
+	fm->codepoints = table;
+	fm->codepoints_capacity = capacity;
+	return true;
+}
+
+static const CodepointEntry* font_glyph(FontMetrics* fm, unsigned int codepoint)
+{
+	static const CodepointEntry missing = { 0, 0, 0 };
+
+	if(codepoint < 128) {
+		CodepointEntry* entry = &fm->ascii[codepoint];
+		if(entry->codepoint == NO_CODEPOINT) load_codepoint(fm, entry, codepoint);
+		return entry;
+	}
+
+	if(fm->codepoints_count * 2 >= fm->codepoints_capacity && !grow_codepoints(fm)) return &missing;
+	uint32_t mask = fm->codepoints_capacity - 1;
+	uint32_t slot = hash_u64(codepoint) & mask;
+	while(fm->codepoints[slot].codepoint != NO_CODEPOINT) {
+		if(fm->codepoints[slot].codepoint == codepoint) return &fm->codepoints[slot];
+		slot = (slot + 1) & mask;
+	}
+	load_codepoint(fm, &fm->codepoints[slot], codepoint);
+	fm->codepoints_count++;
+	return &fm->codepoints[slot];
+}
+
+static bool grow_kerning(FontMetrics* fm)
+{
+	int capacity = fm->kerning_capacity ? fm->kerning_capacity * 2 : 256;
+	KerningEntry* table = malloc(capacity * sizeof(KerningEntry));
+	if(!table) return false;
+	int i;
+	for(i = 0; i < capacity; i++) table[i].pair = NO_PAIR;
+	for(i = 0; i < fm->kerning_capacity; i++) {
+		KerningEntry* e = &fm->kerning[i];
+		if(e->pair == NO_PAIR) continue;
+		uint32_t slot = hash_u64(e->pair) & (capacity - 1);
+		while(table[slot].pair != NO_PAIR) slot = (slot + 1) & (capacity - 1);
+		table[slot] = *e;
+	}
+	free(fm->kerning);
+	fm->kerning = table;
+	fm->kerning_capacity = capacity;
+	return true;
+}
+
+static FT_Pos font_kerning(FontMetrics* fm, FT_UInt left, FT_UInt right)
+{
+	if(!fm->has_kerning || !left || !right) return 0;
+
+	if(fm->kerning_count * 2 >= fm->kerning_capacity && !grow_kerning(fm)) return 0;
+	uint64_t pair = (uint64_t) left << 32 | right;
+	uint32_t mask = fm->kerning_capacity - 1;
+	uint32_t slot = hash_u64(pair) & mask;
+	while(fm->kerning[slot].pair != NO_PAIR) {
+		if(fm->kerning[slot].pair == pair) return fm->kerning[slot].kerning;
+		slot = (slot + 1) & mask;
+	}
+
+	// unfitted: glyphs are positioned with subpixel precision, so don't round the kerning to whole pixels
+	FT_Vector kerning = { 0, 0 };
+	FT_Set_Pixel_Sizes(fm->face, 0, fm->pixel_size);
+	FT_Get_Kerning(fm->face, left, right, FT_KERNING_UNFITTED, &kerning);
+	fm->kerning[slot].pair = pair;
+	fm->kerning[slot].kerning = kerning.x;
+	fm->kerning_count++;
+	return kerning.x;
+}
+
+// utf-8
+
+unsigned int utf8_next(const char** s)
+{
+	const unsigned char* p = (const unsigned char*) *s;
+	unsigned int c = p[0], min, length, i;
+
+	if(c < 0x80) { *s += 1; return c; }
+	else if((c & 0xE0) == 0xC0) { length = 2; min = 0x80; c &= 0x1F; }
+	else if((c & 0xF0) == 0xE0) { length = 3; min = 0x800; c &= 0x0F; }
+	else if((c & 0xF8) == 0xF0) { length = 4; min = 0x10000; c &= 0x07; }
+	else { *s += 1; return 0xFFFD; } // stray continuation byte or invalid lead byte
+
+	for(i = 1; i < length; i++) {
+		if((p[i] & 0xC0) != 0x80) { *s += i; return 0xFFFD; } // truncated, also stops at the terminator
+		c = (c << 6) | (p[i] & 0x3F);
+	}
+	*s += length;
+	// overlong encodings, surrogates and values past the last plane are not valid
+	if(c < min || (c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF) return 0xFFFD;
+	return c;
+}
+
+// layout
+
+// finds where the line starting at 's' ends: at a '\n', at the end of the text, or at the last space
+// before the line gets wider than 'max_width'. '*next' is set to the start of the following line
+static const char* line_end(FontMetrics* fm, const char* s, float max_width, const char** next, float* width)
+{
+	const char* p = s;
+	const char* last_space = NULL;
+	float pen = 0, width_at_space = 0;
+	FT_UInt previous = 0;
+
+	while(*p && *p != '\n') {
+		const char* start = p;
+		unsigned int codepoint = utf8_next(&p);
+		const CodepointEntry* glyph = font_glyph(fm, codepoint);
+		float advance = (font_kerning(fm, previous, glyph->glyph_index) + glyph->advance) / 64.0;
+
+		if(codepoint == ' ') {
+			last_space = start;
+			width_at_space = pen;
+		}
+		else if(max_width > 0 && pen + advance > max_width && last_space) {
+			*next = last_space + 1;
+			*width = width_at_space;
+			return last_space;
+		}
+		pen += advance;
+		previous = glyph->glyph_index;
+	}
+
+	*next = (*p == '\n') ? p + 1 : p;
+	*width = pen;
+	return p;
+}
+
+static void emit_line(TextRenderer* t, FontMetrics* fm, const char* s, const char* end, float x, float baseline, GLuint color)
+{
+	float pen = x;
+	FT_UInt previous = 0;
+	float to_ndc_x = 2.0 / t->viewport_width, to_ndc_y = 2.0 / t->viewport_height;
+
+	while(s < end) {
+		const CodepointEntry* glyph = font_glyph(fm, utf8_next(&s));
+		pen += font_kerning(fm, previous, glyph->glyph_index) / 64.0;
+		previous = glyph->glyph_index;
+
+		if(t->sdf_size && t->sdf_program) {
+			// the SDF is scaled to the text size, no need to snap it to whole pixels
+			const GlyphInfo* info = glyph_cache_get_sdf(t->glyphs, fm->face, glyph->glyph_index, t->sdf_size, SDF_SPREAD);
+			if(info && info->width > 0 && info->height > 0) {
+				float scale = (float) fm->pixel_size / t->sdf_size;
+				float left = pen + info->bearing_x * scale;
+				float top = baseline - info->bearing_y * scale;
+				batch2d_quad(&t->batch, t->sdf_program, glyph_cache_page_texture(t->glyphs, info->page), BATCH2D_BLEND_ALPHA,
+					left * to_ndc_x - 1.0, 1.0 - (top + info->height * scale) * to_ndc_y,  // bottom left
+					(left + info->width * scale) * to_ndc_x - 1.0, 1.0 - top * to_ndc_y,   // top right
+					info->u0, info->v1, info->u1, info->v0, color);
+				t->glyphs_drawn++;
+			}
+		}
+		else {
+			const GlyphInfo* info = glyph_cache_get(t->glyphs, fm->face, fm->pixel_size, glyph->glyph_index, pen);
+			if(info && info->width > 0 && info->height > 0) {
+				// the subpixel part of the pen is already in the bitmap, place it on a whole pixel
+				float left = floorf(pen) + info->bearing_x;
+				float top = baseline - info->bearing_y;
+				batch2d_quad(&t->batch, t->program, glyph_cache_page_texture(t->glyphs, info->page), BATCH2D_BLEND_ALPHA,
+					left * to_ndc_x - 1.0, 1.0 - (top + info->height) * to_ndc_y,  // bottom left
+					(left + info->width) * to_ndc_x - 1.0, 1.0 - top * to_ndc_y,   // top right
+					info->u0, info->v1, info->u1, info->v0, color);
+				t->glyphs_drawn++;
+			}
+		}
+		pen += glyph->advance / 64.0;
+	}
+}
+
+float text_draw(TextRenderer* t, FT_Face face, unsigned int pixel_size, const char* text,
+                float x, float y, float max_width, GLuint color)
+{
+	FontMetrics* fm = find_metrics(t, face, pixel_size);
+	if(!fm) return 0;
+
+	float line_y = y;
+	const char* s = text;
+	while(*s) {
+		const char* next;
+		float width;
+		const char* end = line_end(fm, s, max_width, &next, &width);
+		emit_line(t, fm, s, end, x, floorf(line_y + fm->ascender + 0.5), color);
+		line_y += fm->line_height;
+		s = next;
+	}
+	return line_y - y;
+}
+
+float text_measure(TextRenderer* t, FT_Face face, unsigned int pixel_size, const char* text)
+{
+	FontMetrics* fm = find_metrics(t, face, pixel_size);
+	if(!fm) return 0;
+
+	float widest = 0;
+	const char* s = text;
+	while(*s) {
+		float width;
+		line_end(fm, s, 0, &s, &width);
+		if(width > widest) widest = width;
+	}
+	return widest;
+}
+
+// renderer
+
+int text_renderer_init(TextRenderer* t, int viewport_width, int viewport_height)
+{
+	memset(t, 0, sizeof(*t));
+	t->viewport_width = viewport_width;
+	t->viewport_height = viewport_height;
+
+	const char *fs_source =
+	"#version 330\n"
+	"uniform sampler2D tex;\n"
+	"in vec2 vs_tex_coord;\n"
+	"in vec4 vs_color;\n"
+	"layout (location = 0) out vec4 color;\n"
+	"void main(void) {\n"
+	"  color = vec4(vs_color.rgb, vs_color.a * texture(tex, vs_tex_coord).r);\n"
+	"}\n";
+
+	// both programs compile at once, only the bitmap one is waited for. the glyph coverage is its alpha
+	t->shaders = shader_batch_create();
+	if(!t->shaders) return false;
+	int bitmap_shader = shader_batch_add(t->shaders, text_vs_source, fs_source, 0);
+	t->sdf_shader = shader_batch_add(t->shaders, text_vs_source, sdf_text_fs_source, 0);
+	if(bitmap_shader < 0 || t->sdf_shader < 0) return false;
+	shader_batch_submit(t->shaders);
+	if(!shader_batch_wait(t->shaders, bitmap_shader)) return false;
+	t->program = shader_batch_program(t->shaders, bitmap_shader);
+
+	t->glyphs = glyph_cache_create(ATLAS_PAGE_SIZE, ATLAS_MAX_PAGES);
+	if(!t->glyphs) return false;
+
+	return batch2d_init(&t->batch, BATCH_MAX_QUADS);
+}
+
+void text_renderer_free(TextRenderer* t)
+{
+	int i;
+	for(i = 0; i < t->num_fonts; i++) free_metrics(t->fonts[i]);
+	free(t->fonts);
+	batch2d_free(&t->batch);
+	glyph_cache_destroy(t->glyphs);
+	glDeleteProgram(t->program);
+	if(t->shaders) {
+		// a finished program that was never picked up belongs to us, one still compiling to the batch
+		glDeleteProgram(shader_batch_program(t->shaders, t->sdf_shader));
+		shader_batch_destroy(t->shaders);
+	}
+	if(t->sdf_program) glDeleteProgram(t->sdf_program);
+	memset(t, 0, sizeof(*t));
+}
+
+void text_renderer_set_viewport(TextRenderer* t, int width, int height)
+{
+	t->viewport_width = width;
+	t->viewport_height = height;
+}
+
+int text_renderer_use_sdf(TextRenderer* t, int sdf_size)
+{
+	if(sdf_size && !t->sdf_program && !t->shaders) return false; // it did not compile
+	t->sdf_size = sdf_size;
+	return true;
+}
+
+void text_renderer_begin(TextRenderer* t)
+{
+	// only asked for once SDF glyphs are wanted: without KHR_parallel_shader_compile, asking waits
+	if(t->sdf_size && t->shaders && shader_batch_is_ready(t->shaders, t->sdf_shader)) {
+		t->sdf_program = shader_batch_program(t->shaders, t->sdf_shader);
+		if(!t->sdf_program) fprintf(stderr, "The SDF text program did not compile, drawing bitmap glyphs\n");
+		shader_batch_destroy(t->shaders);
+		t->shaders = NULL;
+	}
+	t->glyphs_drawn = 0;
+	batch2d_begin(&t->batch);
+}
+
+void text_renderer_flush(TextRenderer* t)
+{
+	glyph_cache_upload(t->glyphs);
+	batch2d_flush(&t->batch);
+	glyph_cache_next_frame(t->glyphs);
+}
+
+// cache file
+
+// on-disk layout: TextCacheHeader, the glyph cache (see glyph_cache_write()), the number of
+// metrics caches (uint32), then each MetricsRecord followed by its codepoints and kerning pairs
+#define TEXT_CACHE_MAGIC 0x48504C47 // "GLPH"
+#define TEXT_CACHE_VERSION 1
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+} TextCacheHeader;
+
+typedef struct {
+	uint32_t pixel_size;
+	float ascender, line_height;
+	uint32_t has_kerning;
+	uint32_t num_codepoints, num_kerning_pairs;
+} MetricsRecord;
+
+typedef struct {
+	uint32_t codepoint, glyph_index;
+	int64_t advance;
+} CodepointRecord;
+
+typedef struct {
+	uint64_t pair;
+	int64_t kerning;
+} KerningRecord;
+
+// 64 bit FNV-1a, only needs to tell fonts apart
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = data;
+	size_t i;
+	for(i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+// the font contents and everything that changes how glyphs are rasterized. false if the font can't be read
+static bool text_cache_key(FT_Face face, const char* font_file, uint64_t* key)
+{
+	int fd = open(font_file, O_RDONLY);
+	struct stat st;
+	if(fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+		if(fd >= 0) close(fd);
+		return false;
+	}
+	void* font = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(font == MAP_FAILED) return false;
+
+	int32_t params[] = {
+		TEXT_CACHE_VERSION, face->face_index,
+		FREETYPE_MAJOR, FREETYPE_MINOR, FREETYPE_PATCH,
+		ATLAS_PAGE_SIZE, GLYPH_CACHE_SUBPIXEL_STEPS, SDF_GLYPH_UPSCALE
+	};
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	hash = hash_bytes(hash, font, st.st_size);
+	hash = hash_bytes(hash, params, sizeof(params));
+	munmap(font, st.st_size);
+	*key = hash;
+	return true;
+}
+
+static void text_cache_path(char* path, size_t size, const char* dir, uint64_t key)
+{
+	snprintf(path, size, "%s/%016llx.glyphs", dir, (unsigned long long) key);
+}
+
+static bool write_metrics(FontMetrics* fm, FILE* file)
+{
+	MetricsRecord record = { fm->pixel_size, fm->ascender, fm->line_height, fm->has_kerning, 0, fm->kerning_count };
+	int i;
+	for(i = 0; i < 128; i++) {
+		if(fm->ascii[i].codepoint != NO_CODEPOINT) record.num_codepoints++;
+	}
+	record.num_codepoints += fm->codepoints_count;
+	if(fwrite(&record, sizeof(record), 1, file) != 1) return false;
+
+	for(i = 0; i < 128 + fm->codepoints_capacity; i++) {
+		CodepointEntry* e = i < 128 ? &fm->ascii[i] : &fm->codepoints[i - 128];
+		if(e->codepoint == NO_CODEPOINT) continue;
+		CodepointRecord cr = { e->codepoint, e->glyph_index, e->advance };
+		if(fwrite(&cr, sizeof(cr), 1, file) != 1) return false;
+	}
+	for(i = 0; i < fm->kerning_capacity; i++) {
+		KerningEntry* e = &fm->kerning[i];
+		if(e->pair == NO_PAIR) continue;
+		KerningRecord kr = { e->pair, e->kerning };
+		if(fwrite(&kr, sizeof(kr), 1, file) != 1) return false;
+	}
+	return true;
+}
+
+int text_renderer_save_cache(TextRenderer* t, FT_Face face, const char* font_file, const char* dir)
+{
+	uint64_t key;
+	if(!dir || !text_cache_key(face, font_file, &key)) return 0;
+
+	char path[1024], tmp_path[1040];
+	text_cache_path(path, sizeof(path), dir, key);
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+	mkdir(dir, 0755); // fails harmlessly if it already exists
+
+	// write to a temporary file first so that a concurrent start never reads a partial cache
+	FILE* file = fopen(tmp_path, "wb");
+	if(!file) {
+		fprintf(stderr, "Could not write text cache file '%s'\n", path);
+		return false;
+	}
+	TextCacheHeader header = { TEXT_CACHE_MAGIC, TEXT_CACHE_VERSION, key };
+	uint32_t num_metrics = 0;
+	int i;
+	for(i = 0; i < t->num_fonts; i++) {
+		if(t->fonts[i]->face == face) num_metrics++;
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+	          && glyph_cache_write(t->glyphs, face, file)
+	          && fwrite(&num_metrics, sizeof(num_metrics), 1, file) == 1;
+	for(i = 0; ok && i < t->num_fonts; i++) {
+		if(t->fonts[i]->face == face) ok = write_metrics(t->fonts[i], file);
+	}
+	ok = (fclose(file) == 0) && ok;
+	if(!ok || rename(tmp_path, path) != 0) {
+		fprintf(stderr, "Could not write text cache file '%s'\n", path);
+		remove(tmp_path);
+		return false;
+	}
+	return true;
+}
+
+static bool restore_codepoint(FontMetrics* fm, const CodepointRecord* record)
+{
+	CodepointEntry entry = { record->codepoint, record->glyph_index, record->advance };
+	if(entry.codepoint == NO_CODEPOINT) return false;
+	if(entry.codepoint < 128) {
+		fm->ascii[entry.codepoint] = entry;
+		return true;
+	}
+
+	if(fm->codepoints_count * 2 >= fm->codepoints_capacity && !grow_codepoints(fm)) return false;
+	uint32_t mask = fm->codepoints_capacity - 1;
+	uint32_t slot = hash_u64(entry.codepoint) & mask;
+	while(fm->codepoints[slot].codepoint != NO_CODEPOINT) {
+		if(fm->codepoints[slot].codepoint == entry.codepoint) return false; // duplicate, the file is broken
+		slot = (slot + 1) & mask;
+	}
+	fm->codepoints[slot] = entry;
+	fm->codepoints_count++;
+	return true;
+}
+
+static bool restore_kerning(FontMetrics* fm, const KerningRecord* record)
+{
+	if(record->pair == NO_PAIR) return false;
+	if(fm->kerning_count * 2 >= fm->kerning_capacity && !grow_kerning(fm)) return false;
+	uint32_t mask = fm->kerning_capacity - 1;
+	uint32_t slot = hash_u64(record->pair) & mask;
+	while(fm->kerning[slot].pair != NO_PAIR) {
+		if(fm->kerning[slot].pair == record->pair) return false;
+		slot = (slot + 1) & mask;
+	}
+	fm->kerning[slot].pair = record->pair;
+	fm->kerning[slot].kerning = record->kerning;
+	fm->kerning_count++;
+	return true;
+}
+
+static bool read_metrics(TextRenderer* t, FT_Face face, const unsigned char** data, const unsigned char* end)
+{
+	MetricsRecord record;
+	if(!glyph_cache_read_bytes(data, end, &record, sizeof(record))) return false;
+	FontMetrics* fm = alloc_metrics(face, record.pixel_size);
+	if(!fm) return false;
+	fm->ascender = record.ascender;
+	fm->line_height = record.line_height;
+	fm->has_kerning = record.has_kerning != 0;
+	if(!add_metrics(t, fm)) {
+		free_metrics(fm);
+		return false;
+	}
+
+	uint32_t i;
+	for(i = 0; i < record.num_codepoints; i++) {
+		CodepointRecord cr;
+		if(!glyph_cache_read_bytes(data, end, &cr, sizeof(cr)) || !restore_codepoint(fm, &cr)) return false;
+	}
+	for(i = 0; i < record.num_kerning_pairs; i++) {
+		KerningRecord kr;
+		if(!glyph_cache_read_bytes(data, end, &kr, sizeof(kr)) || !restore_kerning(fm, &kr)) return false;
+	}
+	return true;
+}
+
+int text_renderer_load_cache(TextRenderer* t, FT_Face face, const char* font_file, const char* dir)
+{
+	uint64_t key;
+	if(!dir || !text_cache_key(face, font_file, &key)) return 0;
+
+	char path[1024];
+	text_cache_path(path, sizeof(path), dir, key);
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) return 0; // not cached yet
+	struct stat st;
+	void* map = MAP_FAILED;
+	if(fstat(fd, &st) == 0 && st.st_size > 0) map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED) return 0;
+
+	const unsigned char* data = map;
+	const unsigned char* end = data + st.st_size;
+	TextCacheHeader header;
+	uint32_t num_metrics = 0, i;
+	bool ok = glyph_cache_read_bytes(&data, end, &header, sizeof(header))
+	          && header.magic == TEXT_CACHE_MAGIC
+	          && header.version == TEXT_CACHE_VERSION
+	          && header.key == key
+	          && (data = glyph_cache_read(t->glyphs, face, data, end)) != NULL
+	          && glyph_cache_read_bytes(&data, end, &num_metrics, sizeof(num_metrics));
+	for(i = 0; ok && i < num_metrics; i++) {
+		ok = read_metrics(t, face, &data, end);
+	}
+	munmap(map, st.st_size);
+	if(ok) return 1;
+
+	// start over from empty caches, glyphs are rasterized as usual
+	fprintf(stderr, "Ignoring invalid text cache file '%s'\n", path);
+	for(i = 0; i < (uint32_t) t->num_fonts; i++) free_metrics(t->fonts[i]);
+	t->num_fonts = 0;
+	glyph_cache_destroy(t->glyphs);
+	t->glyphs = glyph_cache_create(ATLAS_PAGE_SIZE, ATLAS_MAX_PAGES);
+	return t->glyphs ? 0 : -1;
+}
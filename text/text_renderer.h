@@ -0,0 +1,127 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Batched text layout and rendering
+ *
+ * Lays out UTF-8 strings with FreeType metrics and kerning, and draws them as quads textured
+ * from the glyph cache atlas (see glyph_cache.h). All quads of a frame go into one 2D batch
+ * (see ../common/batch2d.h), so a whole paragraph is a single draw call per atlas page used.
+ *
+ * FreeType is only asked about a glyph once per (face, size): the glyph index and advance of
+ * each codepoint and the kerning of each pair are kept in a metrics cache, and the bitmaps
+ * in the glyph cache. Laying out a string seen before only does hash lookups.
+ *
+ * Usage, every frame:
+ *   text_renderer_begin(&text);
+ *   text_draw(&text, face, 16, "Hello, wörld", 10, 10, 0, 0xFFFFFFFF);
+ *   ...
+ *   text_renderer_flush(&text);
+ *
+ * Coordinates are in pixels from the top left corner of the viewport.
+ *
+ * The atlas and the metrics of a face can be saved to a cache file at exit and mapped back in
+ * at the next start, so text seen in a previous run is drawn without asking FreeType:
+ *
+ *   text_renderer_load_cache(&text, face, FONT_FILE, TEXT_CACHE_DEFAULT_DIR);
+ *   ...
+ *   text_renderer_save_cache(&text, face, FONT_FILE, TEXT_CACHE_DEFAULT_DIR);
+ *
+ * Cache files are keyed by a hash of the font file contents and of everything that changes
+ * the rasterized glyphs (FreeType version, atlas and subpixel settings). Sizes and SDF glyphs
+ * are part of each glyph key, one file holds every size of a face.
+ *
+ * With text_renderer_use_sdf(), glyphs are drawn from signed distance fields (see sdf_glyph.h)
+ * of a single size, scaled to each text size, instead of a bitmap per size. Their program is compiled
+ * in the same shader batch as the bitmap one (see shader.h), but only the bitmap program is waited for:
+ * bitmap glyphs stand in until the SDF program is ready.
+ *
+ * Requires FreeType and OpenGL 3.3.
+ */
+
+#ifndef OPENGL_PLAYGROUND_TEXT_RENDERER_H
+#define OPENGL_PLAYGROUND_TEXT_RENDERER_H
+
+#include <GL/glew.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "glyph_cache.h"
+#include "../common/batch2d.h"
+#include "../common/shader.h"
+
+typedef struct FontMetrics FontMetrics;
+
+typedef struct {
+	GlyphCache* glyphs;
+	Batch2D batch;
+	GLuint program;
+	GLuint sdf_program;       // 0 until it finished compiling, bitmap glyphs are drawn until then
+	ShaderBatch* shaders;     // holds the SDF program while it compiles
+	int sdf_shader;           // its index in 'shaders'
+	int sdf_size;             // 0 draws bitmap glyphs
+	int viewport_width, viewport_height;
+
+	FontMetrics** fonts;      // one metrics cache per (face, size) used so far
+	int num_fonts, fonts_capacity;
+
+	int glyphs_drawn;         // since text_renderer_begin()
+} TextRenderer;
+
+// returns 0 on failure
+int text_renderer_init(TextRenderer* t, int viewport_width, int viewport_height);
+void text_renderer_free(TextRenderer* t);
+void text_renderer_set_viewport(TextRenderer* t, int width, int height);
+// draws glyphs from SDFs of 'sdf_size' pixels per em from now on, or bitmaps again with 0.
+// until the SDF program is compiled, bitmap glyphs are drawn. returns 0 if it failed to compile
+int text_renderer_use_sdf(TextRenderer* t, int sdf_size);
+
+void text_renderer_begin(TextRenderer* t);
+// lays out 'text' with the top of its first line at (x, y), wrapping lines at spaces so that they
+// fit in 'max_width' (0 to only break at '\n'). 'color' is 0xRRGGBBAA. returns the height of the text
+float text_draw(TextRenderer* t, FT_Face face, unsigned int pixel_size, const char* text,
+                float x, float y, float max_width, GLuint color);
+// width of the widest line of 'text', without drawing it
+float text_measure(TextRenderer* t, FT_Face face, unsigned int pixel_size, const char* text);
+// uploads new glyphs and draws everything since text_renderer_begin()
+void text_renderer_flush(TextRenderer* t);
+
+// glyph cache files
+
+// default directory for cache files, relative to the working directory
+#define TEXT_CACHE_DEFAULT_DIR ".text_cache"
+
+// loads the glyphs and metrics saved for 'face' by a previous run. 'font_file' is the file the face was
+// loaded from. call before drawing anything, right after text_renderer_init().
+// returns 1 when loaded, 0 when there is no valid cache file (glyphs are then rasterized with FreeType as usual)
+// and -1 when the caches could not be recreated after an invalid file: the renderer is unusable, free it
+int text_renderer_load_cache(TextRenderer* t, FT_Face face, const char* font_file, const char* dir);
+// saves everything cached so far for 'face', for text_renderer_load_cache(). returns 0 on failure
+int text_renderer_save_cache(TextRenderer* t, FT_Face face, const char* font_file, const char* dir);
+
+// decodes the codepoint at 's' and advances it. invalid sequences give U+FFFD
+unsigned int utf8_next(const char** s);
+
+#endif // OPENGL_PLAYGROUND_TEXT_RENDERER_H
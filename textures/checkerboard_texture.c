@@ -28,7 +28,7 @@ SOFTWARE.
  * Draws 2 triangles with a checkerboard texture applied.
  *
  * Compiling this example:
- * Linux: gcc checkerboard_texture.c -lGL -lGLEW -lglfw -o checkerboard_texture
+ * Linux: gcc ../common/shader.c ../common/gl_state.c ../common/command_list.c ../common/headless.c ../common/benchmark.c ../common/profiler.c ../common/redraw.c checkerboard_texture.c -lGL -lGLEW -lglfw -lEGL -o checkerboard_texture
  *
  * Requires OpenGL 3.2 and that GLEW and GLFW are installed or provided as includes for compilation
  */
@@ -39,11 +39,24 @@ SOFTWARE.
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "../common/shader.h"
+#include "../common/gl_state.h"
+#include "../common/command_list.h"
+#include "../common/headless.h"
+#include "../common/benchmark.h"
+#include "../common/profiler.h"
+#include "../common/redraw.h"
+
 GLuint program;
 GLint attr_vpos, attr_vtex;
+GLuint vao;
+RenderCommand quad; // the textured quad, recorded for every draw
+CommandList commands;
 GLuint tex;
 
 GLFWwindow* window;
+BenchmarkOptions benchmark;
+RedrawScheduler redraw;
 
 typedef enum { false, true } bool;
 
@@ -51,70 +64,26 @@ void display()
 {
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	glUseProgram(program);
-	glEnableVertexAttribArray(attr_vpos);
-	glVertexAttribPointer(
-		attr_vpos, // shader attribute index
-		2,         // number of elements per vertex
-		GL_FLOAT,  // data type of each element
-		GL_FALSE,  // normalized?
-		0,         // stride if data is interleaved
-		0          // pointer offset to start of data
-	);
-	glEnableVertexAttribArray(attr_vtex);
-	glVertexAttribPointer(attr_vtex, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*) (2 * 4 * sizeof(float)));
-	glBindTexture(GL_TEXTURE_2D, tex);
-
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glDisableVertexAttribArray(attr_vpos);
-	glDisableVertexAttribArray(attr_vtex);
-	glUseProgram(0);
-
-	glFlush();
-}
-
-int compile_shader(GLuint shader, const char* source, GLenum shader_type)
-{
-	GLint is_compile_ok = GL_FALSE;
-
-	fprintf(stdout, "Compiling %s Shader...  ", shader_type==GL_VERTEX_SHADER? "Vertex" : "Fragment");
-
-	glShaderSource(shader, 1, &source, NULL);
-	glCompileShader(shader);
-
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compile_ok);
-	fprintf(stdout, "%s!\n", is_compile_ok? "OK" : "FAILED");
-
-	GLint written, logSize = 0;
-	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize);
-	GLchar buf[logSize];
-	glGetShaderInfoLog(shader, logSize, &written, buf);
-	if(written) {
-		fprintf(stderr, "%s", buf);
-		if(logSize != written+1) { // +1 for NULL terminating character
-			fprintf(stderr, "... missing %d characters!\n", logSize-written+1);
-		}
+	// recorded, then replayed in key order with only the state changes needed, see ../common/command_list.h
+	command_list_reset(&commands);
+	uint64_t key = command_key(0, quad.program, quad.texture, 0.0f);
+	// the same quad again for heavier benchmark workloads
+	int i;
+	for(i = 0; i < benchmark.workload; i++) {
+		command_list_push(&commands, key, &quad);
 	}
+	command_list_submit(&commands);
 
-	if(!is_compile_ok) {
-		glDeleteShader(shader);
-		return false;
-	}
-
-	return true;
+	gl_state_next_frame();
+	glFlush();
 }
 
 int init()
 {
 	// global state
 	glClearColor(0.0, 0.0, 0.0, 0.0);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_BLEND);
 
-	// compiling shaders
-	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+	// shader sources
 	const char *vs_source =
 	"#version 330\n"
 	"layout (location = 0) in vec2 v_pos;"
@@ -124,9 +93,7 @@ int init()
 	"  gl_Position = vec4(v_pos, 0.0, 1.0);"
 	"  vs_tex_coord = v_tex;"
 	"}";
-	if(!compile_shader(vs, vs_source, GL_VERTEX_SHADER)) return false;
 
-	GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
 	const char *fs_source =
 	"#version 330\n"
 	"uniform sampler2D tex;"
@@ -135,23 +102,10 @@ int init()
 	"void main(void) {"
 	"  color = vec4(1.0, 1.0, 1.0, texture(tex, vs_tex_coord).r);"
 	"}";
-	if(!compile_shader(fs, fs_source, GL_FRAGMENT_SHADER)) return false;
-
-	// linking into a program
-	GLint is_link_ok = GL_FALSE;
-	program = glCreateProgram();
-	glAttachShader(program, vs);
-	glAttachShader(program, fs);
-	glLinkProgram(program);
-	glGetProgramiv(program, GL_LINK_STATUS, &is_link_ok);
-	glDetachShader(program, vs);
-	glDetachShader(program, fs);
-	glDeleteShader(vs);
-	glDeleteShader(fs);
-	if(!is_link_ok) {
-		fprintf(stderr, "Program didn't link\n");
-		return false;
-	}
+
+	// compiling and linking into a program, or loading it from the shader cache
+	program = create_program(vs_source, fs_source);
+	if(!program) return false;
 
 	// setting attributes from the application to the vertex shader
 	attr_vpos = glGetAttribLocation(program, "v_pos");
@@ -209,12 +163,37 @@ int init()
 		1.0, 0.0,
 		0.0, 0.0
 	};
-	GLuint vao, buffer;
+	GLuint buffer;
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao); // binds to the current context
 	glGenBuffers(1, &buffer); // generate ID
 	glBindBuffer(GL_ARRAY_BUFFER, buffer); // connects the buffer to the context target
 	glBufferData(GL_ARRAY_BUFFER, sizeof(quad_data), quad_data, GL_STATIC_DRAW); // transfer data to target
+	// the attribute layout is part of the VAO state, so it is set once here rather than every frame
+	glEnableVertexAttribArray(attr_vpos);
+	glVertexAttribPointer(
+		attr_vpos, // shader attribute index
+		2,         // number of elements per vertex
+		GL_FLOAT,  // data type of each element
+		GL_FALSE,  // normalized?
+		0,         // stride if data is interleaved
+		0          // pointer offset to start of data
+	);
+	glEnableVertexAttribArray(attr_vtex);
+	glVertexAttribPointer(attr_vtex, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*) (2 * 4 * sizeof(float)));
+
+	// what every draw of the quad needs bound, recorded as is each frame
+	quad.program = program;
+	quad.vao = vao;
+	quad.texture_target = GL_TEXTURE_2D;
+	quad.texture = tex;
+	quad.blend = GL_TRUE;
+	quad.blend_src = GL_SRC_ALPHA;
+	quad.blend_dst = GL_ONE_MINUS_SRC_ALPHA;
+	quad.uniform = -1;
+	quad.mode = GL_TRIANGLE_FAN;
+	quad.count = 4;
+	command_list_init(&commands);
 
 	return true;
 }
@@ -226,6 +205,11 @@ void shutdown_glfw_and_exit(int status_code)
 	exit(status_code);
 }
 
+static void swap_buffers()
+{
+	glfwSwapBuffers(window);
+}
+
 // callbacks
 
 static void key_cb(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -244,6 +228,21 @@ static void error_cb(int error, const char* description)
 
 int main(int argc, char** argv)
 {
+	benchmark_parse_args(&benchmark, argc, argv);
+	HeadlessOptions headless;
+	headless_parse_args(&headless, argc, argv);
+	profiler_parse_args(argc, argv);
+	redraw_parse_args(&redraw, argc, argv);
+	if(headless.enabled) {
+		// no window, frames go to an offscreen framebuffer
+		HeadlessContext ctx;
+		if(!headless_init(&ctx, 350, 350, 3, 2) || !init()) exit(-1);
+		bool ok = benchmark.enabled ? benchmark_run(&benchmark, "checkerboard_texture", display, NULL) : headless_run(&ctx, &headless, display);
+		if(!benchmark.enabled) gl_state_print_stats();
+		headless_free(&ctx);
+		exit(ok ? 0 : -1);
+	}
+
 	glfwSetErrorCallback(error_cb);
 
 	// GLFW init
@@ -277,19 +276,52 @@ int main(int argc, char** argv)
 	}
 	printf("Using OpenGL %s\n", glGetString(GL_VERSION));
 
-	glfwSwapInterval(1);
+	// benchmarks must not wait for vsync
+	glfwSwapInterval(benchmark.enabled ? 0 : 1);
 
 	if(!init()) {
 		shutdown_glfw_and_exit(-1);
 	}
 
-	// main loop
-	while (!glfwWindowShouldClose(window))
+	if(benchmark.enabled) {
+		shutdown_glfw_and_exit(benchmark_run(&benchmark, "checkerboard_texture", display, swap_buffers) ? 0 : -1);
+	}
+
+	if(!redraw_init(&redraw, window)) {
+		shutdown_glfw_and_exit(-1);
+	}
+
+	// frame timing, see --profile and --overlay in ../common/profiler.h
+	if(!profiler_init()) {
+		shutdown_glfw_and_exit(-1);
+	}
+	int scope_display = profiler_scope("display");
+	int scope_swap = profiler_scope("swap");
+	int scope_events = profiler_scope("events");
+
+	// main loop, a frame is only drawn when something changed. see ../common/redraw.h
+	while(true)
 	{
-		display();
+		profiler_begin(scope_events);
+		bool running = redraw_wait(&redraw); // blocks while there is nothing to draw
+		profiler_end(scope_events);
+		if(!running) break;
+
+		profiler_begin(scope_display);
+		if(redraw_begin(&redraw)) display();
+		redraw_end(&redraw);
+		profiler_end(scope_display);
+		profiler_draw_overlay();
+
+		profiler_begin(scope_swap);
 		glfwSwapBuffers(window);
-		glfwPollEvents();
+		profiler_end(scope_swap);
+		profiler_next_frame();
 	}
+	profiler_shutdown();
+	redraw_print_stats(&redraw);
+	gl_state_print_stats();
+	redraw_free(&redraw);
 
 	// shutdown
 	shutdown_glfw_and_exit(0);
@@ -0,0 +1,193 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Instanced icon renderer
+ *
+ * See icon_renderer.h for usage.
+ */
+
+#include "icon_renderer.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#include "../common/shader.h"
+#include "../common/gl_state.h"
+
+typedef enum { false, true } bool;
+
+// attribute locations, fixed in the shader
+enum {
+	ATTR_VPOS = 0,
+	ATTR_VTEX = 1,
+	ATTR_INSTANCE_POS_SCALE = 2,
+	ATTR_INSTANCE_ICON_ID = 3,
+	ATTR_INSTANCE_TINT = 4
+};
+
+int icon_renderer_init(IconRenderer* r, const IconSet* set)
+{
+	const char *vs_source =
+	"#version 330\n"
+	"layout (location = 0) in vec2 v_pos;\n"
+	"layout (location = 1) in vec2 v_tex;\n"
+	// per instance
+	"layout (location = 2) in vec3 i_pos_scale;\n"
+	"layout (location = 3) in uint i_icon_id;\n"
+	"layout (location = 4) in vec4 i_tint;\n"
+	"out vec2 vs_tex_coord;\n"
+	"flat out float vs_layer;\n"
+	"out vec4 vs_tint;\n"
+	"void main(void) {\n"
+	"  gl_Position = vec4(i_pos_scale.xy + v_pos * i_pos_scale.z, 0.0, 1.0);\n"
+	// same as icons.c: the texture coordinates span the whole icon, in the layer of its id
+	"  vs_tex_coord = v_tex;\n"
+	"  vs_layer = float(i_icon_id);\n"
+	"  vs_tint = i_tint;\n"
+	"}\n";
+
+	const char *fs_source =
+	"#version 330\n"
+	"uniform sampler2DArray tex;\n"
+	"in vec2 vs_tex_coord;\n"
+	"flat in float vs_layer;\n"
+	"in vec4 vs_tint;\n"
+	"layout (location = 0) out vec4 color;\n"
+	"void main(void) {\n"
+	"  color = texture(tex, vec3(vs_tex_coord, vs_layer)) * vs_tint;\n"
+	"}\n";
+
+	r->program = create_program(vs_source, fs_source);
+	if(!r->program) return false;
+	r->tex = set->tex;
+
+	r->instances = NULL;
+	r->count = r->capacity = 0;
+	r->buffer_capacity = 0;
+
+	// the quad shared by all instances, a unit square around the icon center
+	GLfloat quad_data[] = {
+		// vertices
+		-1.0, -1.0,
+		 1.0, -1.0,
+		 1.0,  1.0,
+		-1.0,  1.0,
+		// texture coords
+		0.0, 1.0,
+		1.0, 1.0,
+		1.0, 0.0,
+		0.0, 0.0
+	};
+	glGenVertexArrays(1, &r->vao);
+	gl_state_bind_vertex_array(r->vao);
+	glGenBuffers(1, &r->quad_buffer);
+	gl_state_bind_buffer(GL_ARRAY_BUFFER, r->quad_buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad_data), quad_data, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(ATTR_VPOS);
+	glVertexAttribPointer(ATTR_VPOS, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(ATTR_VTEX);
+	glVertexAttribPointer(ATTR_VTEX, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*) (2 * 4 * sizeof(float)));
+
+	// the instance buffer is interleaved, one IconInstance per icon.
+	// a divisor of 1 advances these attributes once per instance instead of once per vertex
+	glGenBuffers(1, &r->instance_buffer);
+	gl_state_bind_buffer(GL_ARRAY_BUFFER, r->instance_buffer);
+	glEnableVertexAttribArray(ATTR_INSTANCE_POS_SCALE);
+	glVertexAttribPointer(ATTR_INSTANCE_POS_SCALE, 3, GL_FLOAT, GL_FALSE, sizeof(IconInstance), (GLvoid*) offsetof(IconInstance, x));
+	glVertexAttribDivisor(ATTR_INSTANCE_POS_SCALE, 1);
+	glEnableVertexAttribArray(ATTR_INSTANCE_ICON_ID);
+	// integer attributes need the I variant, otherwise they get converted to float
+	glVertexAttribIPointer(ATTR_INSTANCE_ICON_ID, 1, GL_UNSIGNED_INT, sizeof(IconInstance), (GLvoid*) offsetof(IconInstance, icon_id));
+	glVertexAttribDivisor(ATTR_INSTANCE_ICON_ID, 1);
+	glEnableVertexAttribArray(ATTR_INSTANCE_TINT);
+	glVertexAttribPointer(ATTR_INSTANCE_TINT, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(IconInstance), (GLvoid*) offsetof(IconInstance, tint));
+	glVertexAttribDivisor(ATTR_INSTANCE_TINT, 1);
+
+	return true;
+}
+
+void icon_renderer_free(IconRenderer* r)
+{
+	glDeleteBuffers(1, &r->instance_buffer);
+	glDeleteBuffers(1, &r->quad_buffer);
+	glDeleteVertexArrays(1, &r->vao);
+	glDeleteProgram(r->program);
+	gl_state_invalidate(); // some of these may still be bound
+	free(r->instances);
+	r->instances = NULL;
+	r->count = r->capacity = r->buffer_capacity = 0;
+}
+
+void icon_renderer_begin(IconRenderer* r)
+{
+	r->count = 0;
+}
+
+void icon_renderer_add(IconRenderer* r, GLfloat x, GLfloat y, GLfloat scale, GLuint icon_id, GLuint tint)
+{
+	if(r->count == r->capacity) {
+		int capacity = r->capacity ? r->capacity * 2 : 256;
+		IconInstance* instances = realloc(r->instances, capacity * sizeof(IconInstance));
+		if(!instances) {
+			fprintf(stderr, "Out of memory for icon instances, dropping icon %u\n", icon_id);
+			return;
+		}
+		r->instances = instances;
+		r->capacity = capacity;
+	}
+
+	IconInstance* icon = &r->instances[r->count++];
+	icon->x = x;
+	icon->y = y;
+	icon->scale = scale;
+	icon->icon_id = icon_id;
+	icon->tint[0] = (tint >> 24) & 0xFF;
+	icon->tint[1] = (tint >> 16) & 0xFF;
+	icon->tint[2] = (tint >> 8) & 0xFF;
+	icon->tint[3] = tint & 0xFF;
+}
+
+void icon_renderer_draw(IconRenderer* r)
+{
+	if(r->count == 0) return;
+
+	// bindings go through the state cache, frames after the first bind nothing again
+	gl_state_bind_buffer(GL_ARRAY_BUFFER, r->instance_buffer);
+	if(r->count > r->buffer_capacity) {
+		r->buffer_capacity = r->capacity;
+	}
+	// orphan the buffer before writing so the driver can hand us fresh memory
+	// instead of waiting for the GPU to finish drawing last frame's icons
+	glBufferData(GL_ARRAY_BUFFER, r->buffer_capacity * sizeof(IconInstance), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, r->count * sizeof(IconInstance), r->instances);
+
+	gl_state_use_program(r->program);
+	gl_state_active_texture(GL_TEXTURE0);
+	gl_state_bind_texture(GL_TEXTURE_2D_ARRAY, r->tex);
+	gl_state_bind_vertex_array(r->vao);
+
+	glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, r->count);
+}
@@ -0,0 +1,81 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Instanced icon renderer
+ *
+ * Draws any number of icons from an icon set texture (see icons.c) with a single draw call.
+ * Each icon is an instance of the same quad. Its position, scale, icon id and tint are
+ * per-instance vertex attributes (glVertexAttribDivisor), streamed to the GPU once per frame,
+ * instead of a uniform update and a glDrawArrays call per icon.
+ *
+ * The icon set is a texture array with one icon per layer (see icon_set.h): the FS samples the
+ * layer of the instance's icon id, like icons.c does with its uniform.
+ *
+ * Usage, every frame:
+ *   icon_renderer_begin(&icons);
+ *   icon_renderer_add(&icons, x, y, scale, ICON_OK, 0xFFFFFFFF);
+ *   ...
+ *   icon_renderer_draw(&icons);
+ *
+ * Requires OpenGL 3.3 for instanced attributes.
+ */
+
+#ifndef OPENGL_PLAYGROUND_ICON_RENDERER_H
+#define OPENGL_PLAYGROUND_ICON_RENDERER_H
+
+#include <GL/glew.h>
+
+#include "icon_set.h"
+
+// per-instance data, as laid out in the instance buffer
+typedef struct {
+	GLfloat x, y;     // center of the icon, in normalized device coordinates
+	GLfloat scale;    // half the side of the icon, in normalized device coordinates
+	GLuint icon_id;   // index in the icon set, starting at 0 from the bottom left corner
+	GLubyte tint[4];  // RGBA multiplied with the icon color
+} IconInstance;
+
+typedef struct {
+	GLuint program;
+	GLuint vao, quad_buffer, instance_buffer;
+	GLuint tex;               // icon set texture array, not owned
+
+	IconInstance* instances;  // CPU copy of this frame's icons
+	int count, capacity;
+	int buffer_capacity;      // size of the instance buffer on the GPU, in instances
+} IconRenderer;
+
+// draws icons from 'set', which must outlive the renderer. returns 0 on failure
+int icon_renderer_init(IconRenderer* r, const IconSet* set);
+void icon_renderer_free(IconRenderer* r);
+
+// starts a new frame, forgetting the icons of the previous one
+void icon_renderer_begin(IconRenderer* r);
+// queues an icon. 'tint' is 0xRRGGBBAA
+void icon_renderer_add(IconRenderer* r, GLfloat x, GLfloat y, GLfloat scale, GLuint icon_id, GLuint tint);
+// uploads the queued icons and draws all of them in one call
+void icon_renderer_draw(IconRenderer* r);
+
+#endif // OPENGL_PLAYGROUND_ICON_RENDERER_H
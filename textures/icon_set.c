@@ -0,0 +1,144 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Icon sets as texture arrays
+ *
+ * See icon_set.h for usage.
+ */
+
+#include "icon_set.h"
+#include "lodepng.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef enum { false, true } bool;
+
+// 'path' is NULL for an update
+static bool check_size(const char* path, unsigned int width, unsigned int height, GLuint icons_per_side)
+{
+	if(icons_per_side == 0 || width != height || width % icons_per_side != 0) {
+		fprintf(stderr, "Icon set '%s' is %ux%u, it must be square with %u icons of the same size per side\n",
+		        path ? path : "update", width, height, icons_per_side);
+		return false;
+	}
+	return true;
+}
+
+// every level of every layer, for the set's icon size, on the bound texture
+static void allocate_levels(IconSet* set)
+{
+	GLsizei size;
+	GLint level;
+	set->levels = 0;
+	for(size = set->icon_size; size > 0; size /= 2) set->levels++;
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, set->levels - 1);
+
+	// without glTexStorage3D which needs OpenGL 4.2, so it can also be reallocated
+	for(level = 0, size = set->icon_size; level < set->levels; level++, size /= 2) {
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, set->count, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+}
+
+// copies the icons of a 'width' pixels wide image into the layers of the bound texture, and computes their mips
+static void upload_icons(IconSet* set, const unsigned char* image_data, unsigned int width)
+{
+	// each icon is copied straight out of the image: the unpack state picks its region, no staging copy.
+	// the image has the top row first, and icon 0 is at the bottom left, so the rows count from the bottom
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+	GLuint icon;
+	for(icon = 0; icon < set->count; icon++) {
+		GLuint col = icon % set->icons_per_side;
+		GLuint row = set->icons_per_side - 1 - icon / set->icons_per_side;
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS, col * set->icon_size);
+		glPixelStorei(GL_UNPACK_SKIP_ROWS, row * set->icon_size);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, icon, set->icon_size, set->icon_size, 1,
+		                GL_RGBA, GL_UNSIGNED_BYTE, image_data);
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+	// mips are computed per layer
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+}
+
+int icon_set_load(IconSet* set, const char* path, GLuint icons_per_side)
+{
+	memset(set, 0, sizeof(*set));
+
+	// load png image from disk. uses lodepng
+	unsigned char* image_data;
+	unsigned int width, height;
+	unsigned int error = lodepng_decode32_file(&image_data, &width, &height, path);
+	if(error) {
+		fprintf(stderr, "Error loading image file %u: %s\n", error, lodepng_error_text(error));
+		return false;
+	}
+	if(!check_size(path, width, height, icons_per_side)) {
+		free(image_data);
+		return false;
+	}
+
+	set->icons_per_side = icons_per_side;
+	set->count = icons_per_side * icons_per_side;
+	set->icon_size = width / icons_per_side;
+
+	glGenTextures(1, &set->tex);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, set->tex);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	// layers are filtered on their own, so trilinear filtering never reaches into the next icon
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	allocate_levels(set);
+	upload_icons(set, image_data, width);
+	free(image_data);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	return true;
+}
+
+int icon_set_update(IconSet* set, const unsigned char* rgba, unsigned int width, unsigned int height)
+{
+	if(!check_size(NULL, width, height, set->icons_per_side)) return false;
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, set->tex);
+	// the layers only need new storage when the icons changed size
+	if((GLsizei) (width / set->icons_per_side) != set->icon_size) {
+		set->icon_size = width / set->icons_per_side;
+		allocate_levels(set);
+	}
+	upload_icons(set, rgba, width);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	return true;
+}
+
+void icon_set_free(IconSet* set)
+{
+	glDeleteTextures(1, &set->tex);
+	memset(set, 0, sizeof(*set));
+}
@@ -0,0 +1,66 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Icon sets as texture arrays
+ *
+ * An icon set image is square and divided into regions of the exact same size, one per icon,
+ * with icon 0 at the bottom left corner (see icons.c). Sampling those regions out of a single 2D
+ * texture bleeds neighboring icons into each other as soon as filtering reaches past a region's
+ * edge, which mipmaps always do, and every vertex has to work out the region's coordinates.
+ *
+ * icon_set_load() slices the image into the layers of a GL_TEXTURE_2D_ARRAY instead, one icon
+ * per layer, each with a full mip chain of its own. Shaders sample with the icon id as the layer:
+ *
+ *   uniform sampler2DArray icons;
+ *   ...
+ *   color = texture(icons, vec3(tex_coord, float(icon_id)));
+ *
+ * where tex_coord spans the whole icon, (0, 0) its top left corner. Layers past the last icon
+ * are clamped to it. Nothing is padded: the array holds exactly the icons, plus a third for mips.
+ *
+ * Requires OpenGL 3.0 and GLEW to be initialized before use.
+ */
+
+#ifndef OPENGL_PLAYGROUND_ICON_SET_H
+#define OPENGL_PLAYGROUND_ICON_SET_H
+
+#include <GL/glew.h>
+
+typedef struct {
+	GLuint tex;               // GL_TEXTURE_2D_ARRAY, one layer per icon
+	GLuint icons_per_side;
+	GLuint count;             // icons, and layers
+	GLsizei icon_size;        // side of an icon in pixels
+	GLint levels;             // mip levels, down to 1x1
+} IconSet;
+
+// loads a square PNG with 'icons_per_side' icons per side. returns 0 on failure
+int icon_set_load(IconSet* set, const char* path, GLuint icons_per_side);
+// replaces the icons with those of a new RGBA image of the set, with the same number of icons, eg. after
+// its file changed (see ../common/asset_watch.h). the layers are updated in place when the icons kept their size
+int icon_set_update(IconSet* set, const unsigned char* rgba, unsigned int width, unsigned int height);
+void icon_set_free(IconSet* set);
+
+#endif // OPENGL_PLAYGROUND_ICON_SET_H
@@ -0,0 +1,255 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Example of drawing thousands of icons from a set in a single draw call
+ *
+ * Same icon set texture 'icons.png' as icons.c, but instead of one icon per glDrawArrays
+ * with the id in a uniform, a whole grid of icons is drawn with one instanced draw call.
+ * See icon_renderer.h for how the per-instance data is laid out.
+ *
+ * The left and right arrow keys shift the icon ids of the whole grid.
+ * The up and down arrow keys change how many icons are in a row of the grid (100 by default, 10k icons).
+ *
+ * Compiling this example:
+ * Linux: gcc ../common/shader.c ../common/gl_state.c ../common/headless.c ../common/benchmark.c ../common/profiler.c lodepng.c icon_set.c icon_renderer.c icons_instanced.c -lGL -lGLEW -lglfw -DLODEPNG_NO_COMPILE_CPP -lEGL -o icons_instanced
+ *
+ * Requires OpenGL 3.3 and that GLEW and GLFW are installed or provided as includes for compilation
+ * Requires the included LodePNG library: http://lodev.org/lodepng/
+ */
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "icon_renderer.h"
+#include "../common/gl_state.h"
+#include "../common/headless.h"
+#include "../common/benchmark.h"
+#include "../common/profiler.h"
+
+IconSet icon_set;
+IconRenderer icons;
+
+GLFWwindow* window;
+BenchmarkOptions benchmark;
+
+typedef enum { false, true } bool;
+
+
+GLuint num_icons_per_side = 4; // there are '4' icons per side of the texture
+GLuint icon_offset = 0; // added to the icon id of every icon in the grid
+int icons_per_row = 100;
+
+int load_icons_texture()
+{
+	glActiveTexture(GL_TEXTURE0);
+	// one icon per layer of a texture array, with mipmaps, see icon_set.h
+	return icon_set_load(&icon_set, "icons.png", num_icons_per_side);
+}
+
+void display()
+{
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	// fill the screen with a grid of icons, all going through the same instance buffer
+	int row, col, layer;
+	GLfloat cell = 2.0 / icons_per_row; // side of a grid cell in normalized device coordinates
+	GLuint num_icons = num_icons_per_side * num_icons_per_side;
+	icon_renderer_begin(&icons);
+	// benchmark workloads stack more grids on top
+	for(layer = 0; layer < benchmark.workload; layer++) {
+		for(row = 0; row < icons_per_row; row++) {
+			for(col = 0; col < icons_per_row; col++) {
+				GLuint id = (row * icons_per_row + col + icon_offset) % num_icons;
+				// fade the tint from the top left to the bottom right corner to show it off
+				GLuint shade = 0x80 + (0x7F * (row + col)) / (2 * icons_per_row);
+				GLuint tint = (shade << 24) | (0xFF << 16) | (shade << 8) | 0xFF;
+				icon_renderer_add(&icons,
+					-1.0 + cell * (col + 0.5), // x
+					 1.0 - cell * (row + 0.5), // y
+					cell * 0.45,               // scale, leaves a small gap between icons
+					id, tint);
+			}
+		}
+	}
+	icon_renderer_draw(&icons);
+
+	gl_state_next_frame();
+	glFlush();
+}
+
+int init()
+{
+	// global state
+	glClearColor(0.0, 0.0, 0.0, 0.0);
+	gl_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state_blend(true);
+
+	// texture
+	if(!load_icons_texture()) return false;
+
+	// the renderer sets up its own shaders and buffers
+	if(!icon_renderer_init(&icons, &icon_set)) return false;
+
+	return true;
+}
+
+void shutdown_glfw_and_exit(int status_code)
+{
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	exit(status_code);
+}
+
+static void swap_buffers()
+{
+	glfwSwapBuffers(window);
+}
+
+// callbacks
+
+static void key_cb(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if(key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
+		glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
+	if(key == GLFW_KEY_RIGHT && action == GLFW_PRESS) {
+		icon_offset++;
+	}
+	else if(key == GLFW_KEY_LEFT && action == GLFW_PRESS) {
+		icon_offset--;
+	}
+	else if(key == GLFW_KEY_UP && action == GLFW_PRESS) {
+		icons_per_row *= 2;
+		printf("%d icons\n", icons_per_row * icons_per_row);
+	}
+	else if(key == GLFW_KEY_DOWN && action == GLFW_PRESS && icons_per_row > 1) {
+		icons_per_row /= 2;
+		printf("%d icons\n", icons_per_row * icons_per_row);
+	}
+}
+
+static void error_cb(int error, const char* description)
+{
+	fprintf(stderr, "ERROR: %s\n", description);
+}
+
+// main
+
+int main(int argc, char** argv)
+{
+	benchmark_parse_args(&benchmark, argc, argv);
+	HeadlessOptions headless;
+	headless_parse_args(&headless, argc, argv);
+	profiler_parse_args(argc, argv);
+	if(headless.enabled) {
+		// no window, frames go to an offscreen framebuffer
+		HeadlessContext ctx;
+		if(!headless_init(&ctx, 700, 700, 3, 3) || !init()) exit(-1);
+		bool ok = benchmark.enabled ? benchmark_run(&benchmark, "icons_instanced", display, NULL) : headless_run(&ctx, &headless, display);
+		if(!benchmark.enabled) gl_state_print_stats();
+		headless_free(&ctx);
+		exit(ok ? 0 : -1);
+	}
+
+	glfwSetErrorCallback(error_cb);
+
+	// GLFW init
+	if(!glfwInit()) {
+		fprintf(stderr, "GLFW Error: Failed to initialize\nQuitting...\n");
+		exit(-1);
+	}
+	printf("Using GLFW %s\n", glfwGetVersionString());
+
+	// Context creation
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+
+	window = glfwCreateWindow(700, 700, "Instanced Icons", NULL, NULL);
+	if (!window) {
+		glfwTerminate();
+		exit(-1);
+	}
+
+	glfwSetKeyCallback(window, key_cb);
+
+	glfwMakeContextCurrent(window);
+
+	glewExperimental = GL_TRUE;
+	GLenum err = glewInit();
+	if(err != GLEW_OK) {
+		fprintf(stderr, "GLEW Error: %s\nQuitting...\n", glewGetErrorString(err));
+		shutdown_glfw_and_exit(-1);
+	}
+	printf("Using OpenGL %s\n", glGetString(GL_VERSION));
+
+	// benchmarks must not wait for vsync
+	glfwSwapInterval(benchmark.enabled ? 0 : 1);
+
+	if(!init()) {
+		shutdown_glfw_and_exit(-1);
+	}
+
+	if(benchmark.enabled) {
+		shutdown_glfw_and_exit(benchmark_run(&benchmark, "icons_instanced", display, swap_buffers) ? 0 : -1);
+	}
+
+	// frame timing, see --profile and --overlay in ../common/profiler.h
+	if(!profiler_init()) {
+		shutdown_glfw_and_exit(-1);
+	}
+	int scope_display = profiler_scope("display");
+	int scope_swap = profiler_scope("swap");
+	int scope_events = profiler_scope("events");
+
+	// main loop
+	while (!glfwWindowShouldClose(window))
+	{
+		profiler_begin(scope_display);
+		display();
+		profiler_end(scope_display);
+		profiler_draw_overlay();
+
+		profiler_begin(scope_swap);
+		glfwSwapBuffers(window);
+		profiler_end(scope_swap);
+
+		profiler_begin(scope_events);
+		glfwPollEvents();
+		profiler_end(scope_events);
+		profiler_next_frame();
+	}
+	profiler_shutdown();
+	gl_state_print_stats();
+
+	// shutdown
+	icon_renderer_free(&icons);
+	shutdown_glfw_and_exit(0);
+}
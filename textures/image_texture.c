@@ -28,8 +28,15 @@ SOFTWARE.
  * Loads a PNG image 'image.png' from disk, decoded using LodePNG
  * Draws 2 triangles with the image applied as a texture
  *
+ * The image is decoded and uploaded on a background thread with a shared context, see texture_loader.h,
+ * so the window shows up and the main loop runs before it is ready. Only the black background is drawn
+ * until then, and the loader wakes the main loop when the texture can be used.
+ *
+ * With --watch, image.png and the shaders are reloaded when their files change, see ../common/asset_watch.h.
+ * The shaders are then read from shaders/image_texture.vert and .frag, written from the sources below if missing.
+ *
  * Compiling this example:
- * Linux: gcc lodepng.c image_texture.c -lGL -lGLEW -lglfw -DLODEPNG_NO_COMPILE_CPP -o image_texture
+ * Linux: gcc ../common/shader.c ../common/gl_state.c ../common/command_list.c ../common/headless.c ../common/benchmark.c ../common/profiler.c ../common/redraw.c ../common/asset_watch.c lodepng.c texture_loader.c image_texture.c -lGL -lGLEW -lglfw -DLODEPNG_NO_COMPILE_CPP -lEGL -lpthread -o image_texture
  *
  * Requires OpenGL 3.2, GLEW and GLFW to be installed or provided as includes for compilation.
  * Requires the included LodePNG library: http://lodev.org/lodepng/
@@ -41,13 +48,30 @@ SOFTWARE.
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "texture_loader.h"
 #include "lodepng.h"
+#include "../common/shader.h"
+#include "../common/gl_state.h"
+#include "../common/command_list.h"
+#include "../common/headless.h"
+#include "../common/benchmark.h"
+#include "../common/profiler.h"
+#include "../common/redraw.h"
+#include "../common/asset_watch.h"
 
 GLuint program;
 GLint attr_vpos, attr_vtex;
-GLuint tex;
+GLuint vao;
+RenderCommand quad; // the textured quad, recorded for every draw
+CommandList commands;
+TextureLoader* loader;
+TextureRequest* image;
 
 GLFWwindow* window;
+BenchmarkOptions benchmark;
+RedrawScheduler redraw;
+AssetWatch* watch; // --watch
+ShaderFiles shader_files = { "shaders/image_texture.vert", "shaders/image_texture.frag", 0 };
 
 typedef enum { false, true } bool;
 
@@ -55,70 +79,34 @@ void display()
 {
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	glUseProgram(program);
-	glEnableVertexAttribArray(attr_vpos);
-	glVertexAttribPointer(
-		attr_vpos, // shader attribute index
-		2,         // number of elements per vertex
-		GL_FLOAT,  // data type of each element
-		GL_FALSE,  // normalized?
-		0,         // stride if data is interleaved
-		0          // pointer offset to start of data
-	);
-	glEnableVertexAttribArray(attr_vtex);
-	glVertexAttribPointer(attr_vtex, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*) (2 * 4 * sizeof(float)));
-	glBindTexture(GL_TEXTURE_2D, tex);
-
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glDisableVertexAttribArray(attr_vpos);
-	glDisableVertexAttribArray(attr_vtex);
-	glUseProgram(0);
-
-	glFlush();
-}
-
-int compile_shader(GLuint shader, const char* source, GLenum shader_type)
-{
-	GLint is_compile_ok = GL_FALSE;
-
-	fprintf(stdout, "Compiling %s Shader...  ", shader_type==GL_VERTEX_SHADER? "Vertex" : "Fragment");
-
-	glShaderSource(shader, 1, &source, NULL);
-	glCompileShader(shader);
-
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compile_ok);
-	fprintf(stdout, "%s!\n", is_compile_ok? "OK" : "FAILED");
-
-	GLint written, logSize = 0;
-	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize);
-	GLchar buf[logSize];
-	glGetShaderInfoLog(shader, logSize, &written, buf);
-	if(written) {
-		fprintf(stderr, "%s", buf);
-		if(logSize != written+1) { // +1 for NULL terminating character
-			fprintf(stderr, "... missing %d characters!\n", logSize-written+1);
-		}
+	// the image is still on its way, the background stands in for it
+	if(texture_request_status(image) != TEXTURE_READY) {
+		gl_state_next_frame();
+		glFlush();
+		return;
 	}
 
-	if(!is_compile_ok) {
-		glDeleteShader(shader);
-		return false;
+	// recorded, then replayed in key order with only the state changes needed, see ../common/command_list.h
+	quad.texture = texture_request_texture(image);
+	command_list_reset(&commands);
+	uint64_t key = command_key(0, quad.program, quad.texture, 0.0f);
+	// the same quad again for heavier benchmark workloads
+	int i;
+	for(i = 0; i < benchmark.workload; i++) {
+		command_list_push(&commands, key, &quad);
 	}
+	command_list_submit(&commands);
 
-	return true;
+	gl_state_next_frame();
+	glFlush();
 }
 
 int init()
 {
 	// global state
 	glClearColor(0.0, 0.0, 0.0, 0.0);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_BLEND);
 
-	// compiling shaders
-	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+	// shader sources
 	const char *vs_source =
 	"#version 330                      \n"
 	"layout (location = 0) in vec2 v_pos;"
@@ -128,9 +116,7 @@ int init()
 	"  gl_Position = vec4(v_pos, 0.0, 1.0);"
 	"  vs_tex_coord = v_tex;"
 	"}";
-	if(!compile_shader(vs, vs_source, GL_VERTEX_SHADER)) return false;
 
-	GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
 	const char *fs_source =
 	"#version 330                         \n"
 	"uniform sampler2D tex;"
@@ -139,23 +125,11 @@ int init()
 	"void main(void) {"
 	"  color = texture(tex, vs_tex_coord);"
 	"}";
-	if(!compile_shader(fs, fs_source, GL_FRAGMENT_SHADER)) return false;
-
-	// linking into a program
-	GLint is_link_ok = GL_FALSE;
-	program = glCreateProgram();
-	glAttachShader(program, vs);
-	glAttachShader(program, fs);
-	glLinkProgram(program);
-	glGetProgramiv(program, GL_LINK_STATUS, &is_link_ok);
-	glDetachShader(program, vs);
-	glDetachShader(program, fs);
-	glDeleteShader(vs);
-	glDeleteShader(fs);
-	if(!is_link_ok) {
-		fprintf(stderr, "Program didn't link\n");
-		return false;
-	}
+
+	// compiling and linking into a program, or loading it from the shader cache.
+	// with --watch, from files that can be edited while it runs
+	program = watch ? shader_files_load(&shader_files, vs_source, fs_source) : create_program(vs_source, fs_source);
+	if(!program) return false;
 
 	// setting attributes from the application to the vertex shader
 	attr_vpos = glGetAttribLocation(program, "v_pos");
@@ -164,38 +138,6 @@ int init()
 	attr_vtex = glGetAttribLocation(program, "v_tex");
 	if(attr_vtex == -1) { fprintf(stderr, "Setting shader attribute 'v_tex' failed.\n"); return false; }
 
-	// texture
-	glActiveTexture(GL_TEXTURE0);
-	glGenTextures(1, &tex);
-	glBindTexture(GL_TEXTURE_2D, tex);
-	// if we access, from the shader, texture coordinates outside the [0.0 , 1.0] range we get the texel from the edge
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	// if it is determined that the texture needs to be 'scaled' when applied,
-	// GL_LINEAR gives an average of nearby pixels and GL_NEAREST just the closest one.
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// load png image from disk. uses lodepng
-	unsigned int error;
-	unsigned char* image_data;
-	GLuint width, height;
-	error = lodepng_decode32_file(&image_data, &width, &height, "image.png");
-	if(error) fprintf(stderr, "Error loading image file %u: %s\n", error, lodepng_error_text(error));
-
-	glTexImage2D(
-		GL_TEXTURE_2D,     // target
-		0,                 // mipmap level
-		GL_RGBA,           // internal format
-		width, height,     // width, height
-		0,                 // legacy border, must be 0
-		GL_RGBA,           // format of the pixel data
-		GL_UNSIGNED_BYTE,  // data type of the pixel data
-		image_data         // pointer to the data
-	);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	free(image_data);
-
 	// setting up buffers and copying vertex data to the GPU
 	// a VAO holds and manages other buffers for vertex data such as VBOs
 	GLfloat quad_data[] = {
@@ -210,23 +152,142 @@ int init()
 		1.0, 0.0,
 		0.0, 0.0
 	};
-	GLuint vao, buffer;
+	GLuint buffer;
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao); // binds to the current context
 	glGenBuffers(1, &buffer); // generate ID
 	glBindBuffer(GL_ARRAY_BUFFER, buffer); // connects the buffer to the context target
 	glBufferData(GL_ARRAY_BUFFER, sizeof(quad_data), quad_data, GL_STATIC_DRAW); // transfer data to target
+	// the attribute layout is part of the VAO state, so it is set once here rather than every frame
+	glEnableVertexAttribArray(attr_vpos);
+	glVertexAttribPointer(
+		attr_vpos, // shader attribute index
+		2,         // number of elements per vertex
+		GL_FLOAT,  // data type of each element
+		GL_FALSE,  // normalized?
+		0,         // stride if data is interleaved
+		0          // pointer offset to start of data
+	);
+	glEnableVertexAttribArray(attr_vtex);
+	glVertexAttribPointer(attr_vtex, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*) (2 * 4 * sizeof(float)));
+
+	// what every draw of the quad needs bound, recorded as is each frame
+	quad.program = program;
+	quad.vao = vao;
+	quad.texture_target = GL_TEXTURE_2D;
+	quad.blend = GL_TRUE;
+	quad.blend_src = GL_SRC_ALPHA;
+	quad.blend_dst = GL_ONE_MINUS_SRC_ALPHA;
+	quad.uniform = -1;
+	quad.mode = GL_TRIANGLE_FAN;
+	quad.count = 4;
+	command_list_init(&commands);
 
 	return true;
 }
 
+// queues the image on the loader thread. with 'wait' set, returns once it is ready
+int load_textures(bool wait)
+{
+	if(!loader) return false;
+	image = texture_loader_load(loader, "image.png", GL_LINEAR);
+	if(!image) return false;
+	return !wait || texture_request_wait(image) == TEXTURE_READY;
+}
+
+void shutdown_textures()
+{
+	if(!loader) return;
+	if(!benchmark.enabled) texture_loader_print_stats(loader);
+	texture_request_release(image);
+	texture_loader_destroy(loader);
+	loader = NULL;
+}
+
+// hot reload, see ../common/asset_watch.h
+
+typedef struct {
+	unsigned char* pixels;
+	unsigned int width, height;
+} DecodedImage;
+
+// on the watch thread
+static void* decode_image(const char* path, void* data)
+{
+	DecodedImage* decoded = malloc(sizeof(DecodedImage));
+	if(!decoded) return NULL;
+	unsigned int error = lodepng_decode32_file(&decoded->pixels, &decoded->width, &decoded->height, path);
+	if(error) {
+		fprintf(stderr, "Error reloading image file '%s' %u: %s\n", path, error, lodepng_error_text(error));
+		free(decoded);
+		return NULL;
+	}
+	return decoded;
+}
+
+static void discard_image(void* loaded, void* data)
+{
+	DecodedImage* decoded = loaded;
+	free(decoded->pixels);
+	free(decoded);
+}
+
+// between frames
+static void upload_image(const char* path, void* loaded, void* data)
+{
+	DecodedImage* decoded = loaded;
+	texture_request_update(image, decoded->pixels, decoded->width, decoded->height);
+	discard_image(loaded, data);
+}
+
+// on the watch thread
+static void* read_shaders(const char* path, void* data)
+{
+	return shader_files_read(&shader_files);
+}
+
+// between frames, only this program is relinked
+static void relink_shaders(const char* path, void* loaded, void* data)
+{
+	if(!shader_files_relink(&shader_files, loaded)) return;
+	program = quad.program = shader_files.program;
+}
+
+static const AssetHandler image_handler = { decode_image, upload_image, discard_image };
+static const AssetHandler shader_handler = { read_shaders, relink_shaders, NULL };
+
+// watches the files the example was loaded from
+static bool watch_assets()
+{
+	return asset_watch_add(watch, "image.png", &image_handler, NULL)
+	       && asset_watch_add(watch, shader_files.vs_path, &shader_handler, NULL)
+	       && asset_watch_add(watch, shader_files.fs_path, &shader_handler, NULL);
+}
+
+// on the watch thread, a reload is ready
+static void asset_changed_cb(void* data)
+{
+	redraw_post(&redraw);
+}
+
 void shutdown_glfw_and_exit(int status_code)
 {
+	if(watch) {
+		asset_watch_print_stats(watch);
+		asset_watch_destroy(watch);
+		watch = NULL;
+	}
+	shutdown_textures();
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	exit(status_code);
 }
 
+static void swap_buffers()
+{
+	glfwSwapBuffers(window);
+}
+
 // callbacks
 
 static void key_cb(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -236,6 +297,12 @@ static void key_cb(GLFWwindow* window, int key, int scancode, int action, int mo
 	}
 }
 
+// on the loader thread
+static void texture_loaded_cb(void* data)
+{
+	redraw_post(&redraw);
+}
+
 static void error_cb(int error, const char* description)
 {
 	fprintf(stderr, "ERROR: %s\n", description);
@@ -245,6 +312,32 @@ static void error_cb(int error, const char* description)
 
 int main(int argc, char** argv)
 {
+	benchmark_parse_args(&benchmark, argc, argv);
+	HeadlessOptions headless;
+	headless_parse_args(&headless, argc, argv);
+	profiler_parse_args(argc, argv);
+	redraw_parse_args(&redraw, argc, argv);
+	if(headless.enabled) {
+		// no window, frames go to an offscreen framebuffer
+		HeadlessContext ctx;
+		if(!headless_init(&ctx, 350, 350, 3, 2) || !init()) exit(-1);
+		// frames that must be reproducible wait for the image
+		loader = texture_loader_create_headless(&ctx);
+		if(!load_textures(true)) exit(-1);
+		bool ok = benchmark.enabled ? benchmark_run(&benchmark, "image_texture", display, NULL) : headless_run(&ctx, &headless, display);
+		if(!benchmark.enabled) gl_state_print_stats();
+		shutdown_textures();
+		headless_free(&ctx);
+		exit(ok ? 0 : -1);
+	}
+
+	// the watch thread starts first, init() reads the shaders from files with it
+	if(asset_watch_parse_args(argc, argv) && !benchmark.enabled) {
+		watch = asset_watch_create();
+		if(!watch) exit(-1);
+		asset_watch_set_callback(watch, asset_changed_cb, NULL);
+	}
+
 	glfwSetErrorCallback(error_cb);
 
 	// GLFW init
@@ -278,19 +371,65 @@ int main(int argc, char** argv)
 	}
 	printf("Using OpenGL %s\n", glGetString(GL_VERSION));
 
-	glfwSwapInterval(1);
+	// benchmarks must not wait for vsync
+	glfwSwapInterval(benchmark.enabled ? 0 : 1);
 
 	if(!init()) {
 		shutdown_glfw_and_exit(-1);
 	}
 
-	// main loop
-	while (!glfwWindowShouldClose(window))
+	// the hidden window of the loader is created with the hints above
+	loader = texture_loader_create_glfw(window);
+	if(loader) texture_loader_set_callback(loader, texture_loaded_cb, NULL);
+	if(!load_textures(benchmark.enabled)) {
+		shutdown_glfw_and_exit(-1);
+	}
+
+	if(benchmark.enabled) {
+		shutdown_glfw_and_exit(benchmark_run(&benchmark, "image_texture", display, swap_buffers) ? 0 : -1);
+	}
+
+	if(!redraw_init(&redraw, window)) {
+		shutdown_glfw_and_exit(-1);
+	}
+	if(watch && !watch_assets()) {
+		shutdown_glfw_and_exit(-1);
+	}
+
+	// frame timing, see --profile and --overlay in ../common/profiler.h
+	if(!profiler_init()) {
+		shutdown_glfw_and_exit(-1);
+	}
+	int scope_display = profiler_scope("display");
+	int scope_swap = profiler_scope("swap");
+	int scope_events = profiler_scope("events");
+
+	// main loop, a frame is only drawn when something changed. see ../common/redraw.h
+	while(true)
 	{
-		display();
+		profiler_begin(scope_events);
+		bool running = redraw_wait(&redraw); // blocks while there is nothing to draw
+		profiler_end(scope_events);
+		if(!running) break;
+
+		// what was reloaded goes to the GPU between frames, never during one
+		if(watch) asset_watch_apply(watch);
+
+		profiler_begin(scope_display);
+		if(redraw_begin(&redraw)) display();
+		redraw_end(&redraw);
+		profiler_end(scope_display);
+		profiler_draw_overlay();
+
+		profiler_begin(scope_swap);
 		glfwSwapBuffers(window);
-		glfwPollEvents();
+		profiler_end(scope_swap);
+		profiler_next_frame();
 	}
+	profiler_shutdown();
+	redraw_print_stats(&redraw);
+	gl_state_print_stats();
+	redraw_free(&redraw);
 
 	// shutdown
 	shutdown_glfw_and_exit(0);
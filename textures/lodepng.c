@@ -33,6 +33,9 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#ifdef LODEPNG_COMPILE_STATS
+#include <time.h>
+#endif /*LODEPNG_COMPILE_STATS*/
 
 #if defined(_MSC_VER) && (_MSC_VER >= 1310) /*Visual Studio: A few warning types are not desired here.*/
 #pragma warning( disable : 4244 ) /*implicit conversions: not warned by gcc -Wall -Wextra and requires too much casts*/
@@ -123,6 +126,93 @@ Example: if(!uivector_resizev(&frequencies_ll, 286, 0)) ERROR_BREAK(83);
   return;\
 }
 
+void lodepng_stats_init(LodePNGStats* stats)
+{
+  size_t i;
+  stats->chunk_ns = stats->zlib_ns = stats->filter_ns = 0;
+  stats->adam7_ns = stats->convert_ns = stats->checksum_ns = 0;
+  stats->bytes_in = stats->bytes_out = 0;
+  for(i = 0; i != 3; ++i) stats->deflate_blocks[i] = 0;
+  for(i = 0; i != 5; ++i) stats->filter_bytes[i] = 0;
+  stats->allocations = 0;
+  stats->live_bytes = stats->peak_bytes = 0;
+}
+
+/*
+The statistics hooks. Code that has a settings or state struct takes the stats pointer with
+STATS_OF, which is a constant NULL when LODEPNG_COMPILE_STATS is disabled, and every macro
+below then compiles to nothing. A stage is timed by declaring STATS_MARK(mark) at the end
+of the declarations and wrapping it in STATS_BEGIN and STATS_END. The time of the stages
+that were timed in between is subtracted, so that each stage only gets its own time.
+*/
+#ifdef LODEPNG_COMPILE_STATS
+
+typedef struct StatsMark
+{
+  double start; /*clock at STATS_BEGIN*/
+  double nested; /*sum of all stage times at STATS_BEGIN*/
+} StatsMark;
+
+static double stats_clock_ns(void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+#elif defined(TIME_UTC)
+  struct timespec ts; /*C11, not monotonic but still elapsed time, unlike clock()*/
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+#else /*no elapsed time clock: times stay 0*/
+  return 0;
+#endif
+}
+
+static double stats_total_ns(const LodePNGStats* stats)
+{
+  return stats->chunk_ns + stats->zlib_ns + stats->filter_ns
+       + stats->adam7_ns + stats->convert_ns + stats->checksum_ns;
+}
+
+static void stats_begin(const LodePNGStats* stats, StatsMark* mark)
+{
+  mark->nested = stats_total_ns(stats);
+  mark->start = stats_clock_ns();
+}
+
+static void stats_end(LodePNGStats* stats, double* stage, const StatsMark* mark)
+{
+  double elapsed = stats_clock_ns() - mark->start;
+  *stage += elapsed - (stats_total_ns(stats) - mark->nested);
+}
+
+static void stats_alloc(LodePNGStats* stats, size_t size)
+{
+  ++stats->allocations;
+  stats->live_bytes += size;
+  if(stats->live_bytes > stats->peak_bytes) stats->peak_bytes = stats->live_bytes;
+}
+
+#define STATS_OF(owner) ((owner)->stats)
+#define STATS_MARK(mark) StatsMark mark;
+#define STATS_BEGIN(stats, mark) { if(stats) stats_begin(stats, &mark); }
+#define STATS_END(stats, stage, mark) { if(stats) stats_end(stats, &(stats)->stage, &mark); }
+#define STATS_ADD(stats, counter, amount) { if(stats) (stats)->counter += (amount); }
+#define STATS_ALLOC(stats, size) { if(stats) stats_alloc(stats, size); }
+#define STATS_FREE(stats, size) { if(stats) (stats)->live_bytes -= (size); }
+
+#else /*LODEPNG_COMPILE_STATS*/
+
+#define STATS_OF(owner) ((LodePNGStats*)0)
+#define STATS_MARK(mark)
+#define STATS_BEGIN(stats, mark) { (void)(stats); }
+#define STATS_END(stats, stage, mark) { (void)(stats); }
+#define STATS_ADD(stats, counter, amount) { (void)(stats); }
+#define STATS_ALLOC(stats, size) { (void)(stats); (void)(size); }
+#define STATS_FREE(stats, size) { (void)(stats); (void)(size); }
+
+#endif /*LODEPNG_COMPILE_STATS*/
+
 /*
 About uivector, ucvector and string:
 -All of them wrap dynamic arrays or text strings in a similar way.
@@ -1128,8 +1218,17 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
 }
 
 /*inflate a block with dynamic of fixed Huffman tree*/
+/*grows the inflated data to size, but no further than the max_output_size of the settings*/
+static unsigned inflateResize(ucvector* out, size_t size, const LodePNGDecompressSettings* settings)
+{
+  if(size > out->allocsize && settings->max_output_size && size > settings->max_output_size) return 95;
+  if(!ucvector_resize(out, size)) return 83; /*alloc fail*/
+  return 0;
+}
+
 static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size_t* bp,
-                                    size_t* pos, size_t inlength, unsigned btype)
+                                    size_t* pos, size_t inlength, unsigned btype,
+                                    const LodePNGDecompressSettings* settings)
 {
   unsigned error = 0;
   HuffmanTree tree_ll; /*the huffman tree for literal and length codes*/
@@ -1149,7 +1248,8 @@ static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size
     if(code_ll <= 255) /*literal symbol*/
     {
       /*ucvector_push_back would do the same, but for some reason the two lines below run 10% faster*/
-      if(!ucvector_resize(out, (*pos) + 1)) ERROR_BREAK(83 /*alloc fail*/);
+      error = inflateResize(out, (*pos) + 1, settings);
+      if(error) break;
       out->data[*pos] = (unsigned char)code_ll;
       ++(*pos);
     }
@@ -1192,7 +1292,8 @@ static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size
       if(distance > start) ERROR_BREAK(52); /*too long backward distance*/
       backward = start - distance;
 
-      if(!ucvector_resize(out, (*pos) + length)) ERROR_BREAK(83 /*alloc fail*/);
+      error = inflateResize(out, (*pos) + length, settings);
+      if(error) break;
       if (distance < length) {
         for(forward = 0; forward < length; ++forward)
         {
@@ -1222,7 +1323,8 @@ static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size
   return error;
 }
 
-static unsigned inflateNoCompression(ucvector* out, const unsigned char* in, size_t* bp, size_t* pos, size_t inlength)
+static unsigned inflateNoCompression(ucvector* out, const unsigned char* in, size_t* bp, size_t* pos, size_t inlength,
+                                     const LodePNGDecompressSettings* settings)
 {
   size_t p;
   unsigned LEN, NLEN, n, error = 0;
@@ -1239,7 +1341,8 @@ static unsigned inflateNoCompression(ucvector* out, const unsigned char* in, siz
   /*check if 16-bit NLEN is really the one's complement of LEN*/
   if(LEN + NLEN != 65535) return 21; /*error: NLEN is not one's complement of LEN*/
 
-  if(!ucvector_resize(out, (*pos) + LEN)) return 83; /*alloc fail*/
+  error = inflateResize(out, (*pos) + LEN, settings);
+  if(error) return error;
 
   /*read the literal data: LEN bytes are now stored in the out buffer*/
   if(p + LEN > inlength) return 23; /*error: reading outside of in buffer*/
@@ -1260,8 +1363,6 @@ static unsigned lodepng_inflatev(ucvector* out,
   size_t pos = 0; /*byte position in the out buffer*/
   unsigned error = 0;
 
-  (void)settings;
-
   while(!BFINAL)
   {
     unsigned BTYPE;
@@ -1271,8 +1372,9 @@ static unsigned lodepng_inflatev(ucvector* out,
     BTYPE += 2u * readBitFromStream(&bp, in);
 
     if(BTYPE == 3) return 20; /*error: invalid BTYPE*/
-    else if(BTYPE == 0) error = inflateNoCompression(out, in, &bp, &pos, insize); /*no compression*/
-    else error = inflateHuffmanBlock(out, in, &bp, &pos, insize, BTYPE); /*compression, BTYPE 01 or 10*/
+    STATS_ADD(STATS_OF(settings), deflate_blocks[BTYPE], 1);
+    if(BTYPE == 0) error = inflateNoCompression(out, in, &bp, &pos, insize, settings); /*no compression*/
+    else error = inflateHuffmanBlock(out, in, &bp, &pos, insize, BTYPE, settings); /*compression, BTYPE 01 or 10*/
 
     if(error) return error;
   }
@@ -1293,17 +1395,20 @@ unsigned lodepng_inflate(unsigned char** out, size_t* outsize,
   return error;
 }
 
-static unsigned inflate(unsigned char** out, size_t* outsize,
-                        const unsigned char* in, size_t insize,
-                        const LodePNGDecompressSettings* settings)
+/*inflates into the vector, keeping the memory it already reserved*/
+static unsigned inflatev(ucvector* out,
+                         const unsigned char* in, size_t insize,
+                         const LodePNGDecompressSettings* settings)
 {
   if(settings->custom_inflate)
   {
-    return settings->custom_inflate(out, outsize, in, insize, settings);
+    unsigned error = settings->custom_inflate(&out->data, &out->size, in, insize, settings);
+    out->allocsize = out->size;
+    return error;
   }
   else
   {
-    return lodepng_inflate(out, outsize, in, insize, settings);
+    return lodepng_inflatev(out, in, insize, settings);
   }
 }
 
@@ -2023,7 +2128,11 @@ static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t
   Hash hash;
 
   if(settings->btype > 2) return 61;
-  else if(settings->btype == 0) return deflateNoCompression(out, in, insize);
+  else if(settings->btype == 0)
+  {
+    STATS_ADD(STATS_OF(settings), deflate_blocks[0], (unsigned)((insize + 65534) / 65535));
+    return deflateNoCompression(out, in, insize);
+  }
   else if(settings->btype == 1) blocksize = insize;
   else /*if(settings->btype == 2)*/
   {
@@ -2035,6 +2144,7 @@ static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t
 
   numdeflateblocks = (insize + blocksize - 1) / blocksize;
   if(numdeflateblocks == 0) numdeflateblocks = 1;
+  STATS_ADD(STATS_OF(settings), deflate_blocks[settings->btype], (unsigned)numdeflateblocks);
 
   error = hash_init(&hash, settings->windowsize);
   if(error) return error;
@@ -2123,11 +2233,13 @@ static unsigned adler32(const unsigned char* data, unsigned len)
 
 #ifdef LODEPNG_COMPILE_DECODER
 
-unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
-                                 size_t insize, const LodePNGDecompressSettings* settings)
+static unsigned lodepng_zlib_decompressv(ucvector* out, const unsigned char* in,
+                                         size_t insize, const LodePNGDecompressSettings* settings)
 {
   unsigned error = 0;
   unsigned CM, CINFO, FDICT;
+  LodePNGStats* stats = STATS_OF(settings);
+  STATS_MARK(mark)
 
   if(insize < 2) return 53; /*error, size of zlib data too small*/
   /*read information from zlib header*/
@@ -2155,19 +2267,34 @@ unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const uns
     return 26;
   }
 
-  error = inflate(out, outsize, in + 2, insize - 2, settings);
+  error = inflatev(out, in + 2, insize - 2, settings);
   if(error) return error;
 
   if(!settings->ignore_adler32)
   {
     unsigned ADLER32 = lodepng_read32bitInt(&in[insize - 4]);
-    unsigned checksum = adler32(*out, (unsigned)(*outsize));
+    unsigned checksum;
+    STATS_BEGIN(stats, mark);
+    checksum = adler32(out->data, (unsigned)out->size);
+    STATS_END(stats, checksum_ns, mark);
     if(checksum != ADLER32) return 58; /*error, adler checksum not correct, data must be corrupted*/
   }
 
   return 0; /*no error*/
 }
 
+unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
+                                 size_t insize, const LodePNGDecompressSettings* settings)
+{
+  unsigned error;
+  ucvector v;
+  ucvector_init_buffer(&v, *out, *outsize);
+  error = lodepng_zlib_decompressv(&v, in, insize, settings);
+  *out = v.data;
+  *outsize = v.size;
+  return error;
+}
+
 static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
                                 size_t insize, const LodePNGDecompressSettings* settings)
 {
@@ -2181,6 +2308,23 @@ static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsi
   }
 }
 
+/*zlib_decompress into a vector, so that the built in decoder fills the memory reserved in it
+instead of growing a new buffer*/
+static unsigned zlib_decompressv(ucvector* out, const unsigned char* in,
+                                 size_t insize, const LodePNGDecompressSettings* settings)
+{
+  if(settings->custom_zlib)
+  {
+    unsigned error = settings->custom_zlib(&out->data, &out->size, in, insize, settings);
+    out->allocsize = out->size;
+    return error;
+  }
+  else
+  {
+    return lodepng_zlib_decompressv(out, in, insize, settings);
+  }
+}
+
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_ENCODER
@@ -2195,6 +2339,7 @@ unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsig
   unsigned error;
   unsigned char* deflatedata = 0;
   size_t deflatesize = 0;
+  LodePNGStats* stats = STATS_OF(settings);
 
   /*zlib data: 1 byte CMF (CM+CINFO), 1 byte FLG, deflate data, 4 byte ADLER32 checksum of the Decompressed data*/
   unsigned CMF = 120; /*0b01111000: CM 8, CINFO 7. With CINFO 7, any window size up to 32768 can be used.*/
@@ -2202,6 +2347,7 @@ unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsig
   unsigned FDICT = 0;
   unsigned CMFFLG = 256 * CMF + FDICT * 32 + FLEVEL * 64;
   unsigned FCHECK = 31 - CMFFLG % 31;
+  STATS_MARK(mark)
   CMFFLG += FCHECK;
 
   /*ucvector-controlled version of the output buffer, for dynamic array*/
@@ -2214,7 +2360,10 @@ unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsig
 
   if(!error)
   {
-    unsigned ADLER32 = adler32(in, (unsigned)insize);
+    unsigned ADLER32;
+    STATS_BEGIN(stats, mark);
+    ADLER32 = adler32(in, (unsigned)insize);
+    STATS_END(stats, checksum_ns, mark);
     for(i = 0; i != deflatesize; ++i) ucvector_push_back(&outv, deflatedata[i]);
     lodepng_free(deflatedata);
     lodepng_add32bitInt(&outv, ADLER32);
@@ -2251,6 +2400,14 @@ static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsi
   if(!settings->custom_zlib) return 87; /*no custom zlib function provided */
   return settings->custom_zlib(out, outsize, in, insize, settings);
 }
+
+static unsigned zlib_decompressv(ucvector* out, const unsigned char* in,
+                                 size_t insize, const LodePNGDecompressSettings* settings)
+{
+  unsigned error = zlib_decompress(&out->data, &out->size, in, insize, settings);
+  out->allocsize = out->size;
+  return error;
+}
 #endif /*LODEPNG_COMPILE_DECODER*/
 #ifdef LODEPNG_COMPILE_ENCODER
 static unsigned zlib_compress(unsigned char** out, size_t* outsize, const unsigned char* in,
@@ -2283,9 +2440,16 @@ void lodepng_compress_settings_init(LodePNGCompressSettings* settings)
   settings->custom_zlib = 0;
   settings->custom_deflate = 0;
   settings->custom_context = 0;
+#ifdef LODEPNG_COMPILE_STATS
+  settings->stats = 0;
+#endif /*LODEPNG_COMPILE_STATS*/
 }
 
+#ifdef LODEPNG_COMPILE_STATS
+const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0, 0};
+#else /*LODEPNG_COMPILE_STATS*/
 const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0};
+#endif /*LODEPNG_COMPILE_STATS*/
 
 
 #endif /*LODEPNG_COMPILE_ENCODER*/
@@ -2295,13 +2459,21 @@ const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT
 void lodepng_decompress_settings_init(LodePNGDecompressSettings* settings)
 {
   settings->ignore_adler32 = 0;
+  settings->max_output_size = 0;
 
   settings->custom_zlib = 0;
   settings->custom_inflate = 0;
   settings->custom_context = 0;
+#ifdef LODEPNG_COMPILE_STATS
+  settings->stats = 0;
+#endif /*LODEPNG_COMPILE_STATS*/
 }
 
-const LodePNGDecompressSettings lodepng_default_decompress_settings = {0, 0, 0, 0};
+#ifdef LODEPNG_COMPILE_STATS
+const LodePNGDecompressSettings lodepng_default_decompress_settings = {0, 0, 0, 0, 0, 0};
+#else /*LODEPNG_COMPILE_STATS*/
+const LodePNGDecompressSettings lodepng_default_decompress_settings = {0, 0, 0, 0, 0};
+#endif /*LODEPNG_COMPILE_STATS*/
 
 #endif /*LODEPNG_COMPILE_DECODER*/
 
@@ -4034,7 +4206,8 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   return 0;
 }
 
-static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h, unsigned bpp)
+static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h, unsigned bpp,
+                         LodePNGStats* stats)
 {
   /*
   For PNG filter method 0
@@ -4058,6 +4231,7 @@ static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w
     unsigned char filterType = in[inindex];
 
     CERROR_TRY_RETURN(unfilterScanline(&out[outindex], &in[inindex + 1], prevline, bytewidth, filterType, linebytes));
+    STATS_ADD(stats, filter_bytes[filterType], linebytes);
 
     prevline = &out[outindex];
   }
@@ -4065,6 +4239,39 @@ static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w
   return 0;
 }
 
+static unsigned unfilterInPlace(unsigned char* data, unsigned w, unsigned h, unsigned bpp, LodePNGStats* stats)
+{
+  /*
+  For PNG filter method 0
+  unfilters a non interlaced image over its own scanlines: row y is reconstructed at linebytes * y,
+  from the filtered bytes after its filter type byte at (1 + linebytes) * y. The window of the
+  reconstructed row lies y + 1 bytes before the filtered one, so unfilterScanline, going forward,
+  only overwrites filtered bytes it has already read, and the previous row ends right before it.
+  Afterwards the image takes up the first linebytes * h bytes of data, with padding bits if bpp < 8.
+  */
+
+  unsigned y;
+  unsigned char* prevline = 0;
+
+  /*bytewidth is used for filtering, is 1 when bpp < 8, number of bytes per pixel otherwise*/
+  size_t bytewidth = (bpp + 7) / 8;
+  size_t linebytes = (w * bpp + 7) / 8;
+
+  for(y = 0; y < h; ++y)
+  {
+    unsigned char* line = &data[linebytes * y];
+    const unsigned char* scanline = &data[(1 + linebytes) * y];
+    unsigned char filterType = scanline[0];
+
+    CERROR_TRY_RETURN(unfilterScanline(line, &scanline[1], prevline, bytewidth, filterType, linebytes));
+    STATS_ADD(stats, filter_bytes[filterType], linebytes);
+
+    prevline = line;
+  }
+
+  return 0;
+}
+
 /*
 in: Adam7 interlaced image, with no padding bits between scanlines, but between
  reduced images so that each reduced image starts at a byte.
@@ -4153,11 +4360,21 @@ static void removePaddingBits(unsigned char* out, const unsigned char* in,
   }
 }
 
+/*removePaddingBits for the h scanlines of a non interlaced image within one buffer. The bits after the
+image in its last byte, which would still be scanline bits, are cleared as in a zeroed out buffer.*/
+static void removePaddingBitsInPlace(unsigned char* data, size_t olinebits, size_t ilinebits, unsigned h)
+{
+  size_t bits = olinebits * h;
+  removePaddingBits(data, data, olinebits, ilinebits, h);
+  if(bits % 8) data[bits / 8] &= (unsigned char)(0xff << (8 - bits % 8));
+}
+
 /*out must be buffer big enough to contain full image, and in must contain the full decompressed data from
 the IDAT chunks (with filter index bytes and possible padding bits)
 return value is error*/
 static unsigned postProcessScanlines(unsigned char* out, unsigned char* in,
-                                     unsigned w, unsigned h, const LodePNGInfo* info_png)
+                                     unsigned w, unsigned h, const LodePNGInfo* info_png,
+                                     LodePNGStats* stats)
 {
   /*
   This function converts the filtered-padded-interlaced data into pure 2D image buffer with the PNG's colortype.
@@ -4167,17 +4384,18 @@ static unsigned postProcessScanlines(unsigned char* out, unsigned char* in,
   NOTE: the in buffer will be overwritten with intermediate data!
   */
   unsigned bpp = lodepng_get_bpp(&info_png->color);
+  STATS_MARK(mark)
   if(bpp == 0) return 31; /*error: invalid colortype*/
 
   if(info_png->interlace_method == 0)
   {
     if(bpp < 8 && w * bpp != ((w * bpp + 7) / 8) * 8)
     {
-      CERROR_TRY_RETURN(unfilter(in, in, w, h, bpp));
+      CERROR_TRY_RETURN(unfilter(in, in, w, h, bpp, stats));
       removePaddingBits(out, in, w * bpp, ((w * bpp + 7) / 8) * 8, h);
     }
     /*we can immediately filter into the out buffer, no other steps needed*/
-    else CERROR_TRY_RETURN(unfilter(out, in, w, h, bpp));
+    else CERROR_TRY_RETURN(unfilter(out, in, w, h, bpp, stats));
   }
   else /*interlace_method is 1 (Adam7)*/
   {
@@ -4188,7 +4406,7 @@ static unsigned postProcessScanlines(unsigned char* out, unsigned char* in,
 
     for(i = 0; i != 7; ++i)
     {
-      CERROR_TRY_RETURN(unfilter(&in[padded_passstart[i]], &in[filter_passstart[i]], passw[i], passh[i], bpp));
+      CERROR_TRY_RETURN(unfilter(&in[padded_passstart[i]], &in[filter_passstart[i]], passw[i], passh[i], bpp, stats));
       /*TODO: possible efficiency improvement: if in this reduced image the bits fit nicely in 1 scanline,
       move bytes instead of bits or move not at all*/
       if(bpp < 8)
@@ -4200,7 +4418,27 @@ static unsigned postProcessScanlines(unsigned char* out, unsigned char* in,
       }
     }
 
+    STATS_BEGIN(stats, mark);
     Adam7_deinterlace(out, in, w, h, bpp);
+    STATS_END(stats, adam7_ns, mark);
+  }
+
+  return 0;
+}
+
+/*postProcessScanlines for non interlaced images, without a second buffer: data must contain the full
+decompressed data from the IDAT chunks, and holds the pure 2D image at its start afterwards.
+return value is error*/
+static unsigned postProcessScanlinesInPlace(unsigned char* data, unsigned w, unsigned h,
+                                            const LodePNGInfo* info_png, LodePNGStats* stats)
+{
+  unsigned bpp = lodepng_get_bpp(&info_png->color);
+  if(bpp == 0) return 31; /*error: invalid colortype*/
+
+  CERROR_TRY_RETURN(unfilterInPlace(data, w, h, bpp, stats));
+  if(bpp < 8 && w * bpp != ((w * bpp + 7) / 8) * 8)
+  {
+    removePaddingBitsInPlace(data, w * bpp, ((w * bpp + 7) / 8) * 8, h);
   }
 
   return 0;
@@ -4513,6 +4751,193 @@ static unsigned readChunk_pHYs(LodePNGInfo* info, const unsigned char* data, siz
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
 /*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
+/*copies the data of all IDAT chunks of the already checked PNG in after each other*/
+static void gatherIdat(unsigned char* idat, const unsigned char* in)
+{
+  const unsigned char* chunk = &in[33]; /*first byte of the first chunk after the header*/
+  size_t pos = 0;
+  while(!lodepng_chunk_type_equals(chunk, "IEND"))
+  {
+    if(lodepng_chunk_type_equals(chunk, "IDAT"))
+    {
+      size_t length = lodepng_chunk_length(chunk);
+      memcpy(&idat[pos], lodepng_chunk_data_const(chunk), length);
+      pos += length;
+    }
+    chunk = lodepng_chunk_next_const(chunk);
+  }
+}
+
+/*
+Converts h rows of inrow bytes at the start of buffer into rows of outrow bytes in mode_out, in the same buffer,
+which must have room for h * outrow bytes. Every row goes through the row buffer. Growing rows are converted
+from the last one up and shrinking ones from the first one down, so no row is overwritten before its turn.
+*/
+static unsigned convertRowsInPlace(unsigned char* buffer, unsigned char* row, size_t inrow, size_t outrow,
+                                   const LodePNGColorMode* mode_out, const LodePNGColorMode* mode_in,
+                                   unsigned w, unsigned h)
+{
+  unsigned y;
+  for(y = 0; y != h; ++y)
+  {
+    size_t line = outrow > inrow ? h - 1 - y : y;
+    CERROR_TRY_RETURN(lodepng_convert(row, &buffer[line * inrow], mode_out, mode_in, w, 1));
+    memcpy(&buffer[line * outrow], row, outrow);
+  }
+  return 0;
+}
+
+/*
+The decoding of decodeGeneric and lodepng_decode after the chunks, within decoder.max_memory bytes.
+The IDAT data is used where it is in the file when it's in one chunk. The scanlines are inflated into
+the buffer that becomes the output, unfiltered in place there and converted to info_raw row by row, so
+a non interlaced image needs the one buffer of the larger of the scanlines and the output, and a row.
+Adam7 needs a second buffer to deinterlace into, which then becomes the output the same way, unless
+its rows don't start at a byte: those are converted whole into a third buffer.
+The peak of all that is worked out first, and nothing is allocated if it doesn't fit.
+*/
+static unsigned decodeLowMemory(unsigned char** out, unsigned w, unsigned h, LodePNGState* state,
+                                const unsigned char* in, const unsigned char* idat, size_t idatsize,
+                                unsigned idatchunks, size_t predict,
+                                const LodePNGDecompressSettings* zlibsettings)
+{
+  const LodePNGColorMode* color = &state->info_png.color;
+  LodePNGDecompressSettings settings = *zlibsettings;
+  unsigned bpp = lodepng_get_bpp(color);
+  unsigned convert = state->decoder.color_convert && !lodepng_color_mode_equal(&state->info_raw, color);
+  unsigned interlaced = state->info_png.interlace_method != 0;
+  /*the rows of the unfiltered image start at a byte, unless Adam7 packed them*/
+  unsigned aligned = !interlaced || (w * bpp) % 8 == 0;
+  size_t rawsize = lodepng_get_raw_size(w, h, color);
+  size_t finalsize = convert ? lodepng_get_raw_size(w, h, &state->info_raw) : rawsize;
+  size_t inrow = (w * bpp + 7) / 8;
+  size_t outrow = convert ? (w * lodepng_get_bpp(&state->info_raw) + 7) / 8 : inrow;
+  size_t idatcopy = idatchunks > 1 ? idatsize : 0;
+  size_t imagesize = convert && aligned && finalsize > rawsize ? finalsize : rawsize;
+  size_t scanlinessize = !interlaced && imagesize > predict ? imagesize : predict;
+  size_t convertsize = !convert ? 0 : aligned ? outrow : finalsize;
+  size_t peak;
+  unsigned char* idatbuffer = 0;
+  unsigned char* image = 0; /*the buffer that becomes the output*/
+  size_t imagealloc = 0;
+  ucvector scanlines;
+  unsigned error = 0;
+  size_t i;
+  LodePNGStats* stats = STATS_OF(state);
+  STATS_MARK(mark)
+
+  if(convert && !(state->info_raw.colortype == LCT_RGB || state->info_raw.colortype == LCT_RGBA)
+     && !(state->info_raw.bitdepth == 8))
+  {
+    return 56; /*unsupported color mode conversion*/
+  }
+
+  peak = idatcopy + scanlinessize;
+  if(interlaced && predict + imagesize > peak) peak = predict + imagesize;
+  if((interlaced ? imagesize : scanlinessize) + convertsize > peak)
+  {
+    peak = (interlaced ? imagesize : scanlinessize) + convertsize;
+  }
+  if(peak > state->decoder.max_memory) return 96; /*doesn't fit in the memory budget*/
+
+  if(idatcopy)
+  {
+    idatbuffer = (unsigned char*)lodepng_malloc(idatcopy);
+    if(!idatbuffer) return 83; /*alloc fail*/
+    STATS_ALLOC(stats, idatcopy);
+    gatherIdat(idatbuffer, in);
+    idat = idatbuffer;
+  }
+
+  ucvector_init(&scanlines);
+  if(!ucvector_reserve(&scanlines, scanlinessize)) error = 83; /*alloc fail*/
+  if(!error)
+  {
+    STATS_ALLOC(stats, scanlinessize);
+    /*inflating past the prediction would grow the buffer, the image is corrupt then anyway*/
+    settings.max_output_size = predict;
+    STATS_BEGIN(stats, mark);
+    error = zlib_decompressv(&scanlines, idat, idatsize, &settings);
+    STATS_END(stats, zlib_ns, mark);
+    if(!error && scanlines.size != predict) error = 91; /*decompressed size doesn't match prediction*/
+    /*a custom zlib decoder returns its own buffer, which has to be big enough for the conversion again*/
+    if(!error && !ucvector_reserve(&scanlines, scanlinessize)) error = 83; /*alloc fail*/
+  }
+  if(idatbuffer)
+  {
+    STATS_FREE(stats, idatcopy);
+    lodepng_free(idatbuffer);
+  }
+
+  if(!error && !interlaced)
+  {
+    /*the scanlines become the image, unfiltered over themselves. Converting needs the rows to start at a byte,
+    so the padding bits are only removed when the image isn't converted.*/
+    image = scanlines.data;
+    imagealloc = scanlinessize;
+    ucvector_init(&scanlines);
+    STATS_BEGIN(stats, mark);
+    if(convert) error = unfilterInPlace(image, w, h, bpp, stats);
+    else error = postProcessScanlinesInPlace(image, w, h, &state->info_png, stats);
+    STATS_END(stats, filter_ns, mark);
+  }
+  else if(!error)
+  {
+    image = (unsigned char*)lodepng_malloc(imagesize);
+    if(!image) error = 83; /*alloc fail*/
+    if(!error)
+    {
+      imagealloc = imagesize;
+      STATS_ALLOC(stats, imagesize);
+      for(i = 0; i != rawsize; ++i) image[i] = 0;
+      STATS_BEGIN(stats, mark);
+      error = postProcessScanlines(image, scanlines.data, w, h, &state->info_png, stats);
+      STATS_END(stats, filter_ns, mark);
+    }
+  }
+  if(scanlines.data) STATS_FREE(stats, scanlinessize);
+  ucvector_cleanup(&scanlines);
+
+  if(!error && convert)
+  {
+    unsigned char* buffer = (unsigned char*)lodepng_malloc(convertsize);
+    if(!buffer) error = 83; /*alloc fail*/
+    if(!error)
+    {
+      STATS_ALLOC(stats, convertsize);
+      STATS_BEGIN(stats, mark);
+      if(aligned)
+      {
+        error = convertRowsInPlace(image, buffer, inrow, outrow, &state->info_raw, color, w, h);
+      }
+      else
+      {
+        /*the packed rows of Adam7 below 8 bits per pixel are converted whole into the third buffer*/
+        error = lodepng_convert(buffer, image, &state->info_raw, color, w, h);
+        STATS_FREE(stats, imagealloc);
+        lodepng_free(image);
+        image = buffer;
+        imagealloc = convertsize;
+        buffer = 0;
+      }
+      STATS_END(stats, convert_ns, mark);
+      if(buffer) STATS_FREE(stats, convertsize);
+      lodepng_free(buffer);
+    }
+  }
+
+  if(!error && imagealloc > finalsize)
+  {
+    /*give back what the scanlines or the unconverted image needed more than the output*/
+    unsigned char* data = (unsigned char*)lodepng_realloc(image, finalsize);
+    if(data) image = data;
+  }
+  /*the output is the caller's now, lodepng_decode doesn't count it again*/
+  STATS_FREE(stats, imagealloc);
+  *out = image;
+  return error;
+}
+
 static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
                           LodePNGState* state,
                           const unsigned char* in, size_t insize)
@@ -4522,18 +4947,29 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   size_t i;
   ucvector idat; /*the data from idat chunks*/
   ucvector scanlines;
+  /*with decoder.max_memory, the IDAT chunks are only counted here and left in the file*/
+  const unsigned char* idatfirst = 0;
+  size_t idatsize = 0;
+  unsigned idatchunks = 0;
   size_t predict;
   size_t numpixels;
   size_t outsize = 0;
+  /*the zlib settings carry the stats pointer of the state down to inflate*/
+  LodePNGDecompressSettings zlibsettings = state->decoder.zlibsettings;
+  LodePNGStats* stats = STATS_OF(state);
 
   /*for unknown chunk order*/
   unsigned unknown = 0;
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
   unsigned critical_pos = 1; /*1 = after IHDR, 2 = after PLTE, 3 = after IDAT*/
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
+  STATS_MARK(mark)
 
   /*provide some proper output values if error will happen*/
   *out = 0;
+#ifdef LODEPNG_COMPILE_STATS
+  zlibsettings.stats = stats;
+#endif /*LODEPNG_COMPILE_STATS*/
 
   state->error = lodepng_inspect(w, h, state, in, insize); /*reads header and resets other parameters in state->info_png*/
   if(state->error) return;
@@ -4546,6 +4982,7 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   bytes with 16-bit RGBA, the rest is room for filter bytes.*/
   if(numpixels > 268435455) CERROR_RETURN(state->error, 92);
 
+  STATS_BEGIN(stats, mark);
   ucvector_init(&idat);
   chunk = &in[33]; /*first byte of the first chunk after the header*/
 
@@ -4574,9 +5011,18 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
     /*IDAT chunk, containing compressed image data*/
     if(lodepng_chunk_type_equals(chunk, "IDAT"))
     {
-      size_t oldsize = idat.size;
-      if(!ucvector_resize(&idat, oldsize + chunkLength)) CERROR_BREAK(state->error, 83 /*alloc fail*/);
-      for(i = 0; i != chunkLength; ++i) idat.data[oldsize + i] = data[i];
+      if(state->decoder.max_memory)
+      {
+        if(!idatchunks) idatfirst = data;
+        idatsize += chunkLength;
+        ++idatchunks;
+      }
+      else
+      {
+        size_t oldsize = idat.size;
+        if(!ucvector_resize(&idat, oldsize + chunkLength)) CERROR_BREAK(state->error, 83 /*alloc fail*/);
+        for(i = 0; i != chunkLength; ++i) idat.data[oldsize + i] = data[i];
+      }
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
       critical_pos = 3;
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
@@ -4664,11 +5110,18 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
 
     if(!state->decoder.ignore_crc && !unknown) /*check CRC if wanted, only on known chunk types*/
     {
-      if(lodepng_chunk_check_crc(chunk)) CERROR_BREAK(state->error, 57); /*invalid CRC*/
+      unsigned crc_error;
+      STATS_MARK(crc_mark)
+      STATS_BEGIN(stats, crc_mark);
+      crc_error = lodepng_chunk_check_crc(chunk);
+      STATS_END(stats, checksum_ns, crc_mark);
+      if(crc_error) CERROR_BREAK(state->error, 57); /*invalid CRC*/
     }
 
     if(!IEND) chunk = lodepng_chunk_next_const(chunk);
   }
+  STATS_END(stats, chunk_ns, mark);
+  if(idat.allocsize) STATS_ALLOC(stats, idat.allocsize);
 
   ucvector_init(&scanlines);
   /*predict output size, to allocate exact size for output buffer to avoid more dynamic allocation.
@@ -4691,26 +5144,54 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
     if(*w > 1) predict += lodepng_get_raw_size_idat((*w + 0) >> 1, (*h + 1) >> 1, color) + ((*h + 1) >> 1);
     predict += lodepng_get_raw_size_idat((*w + 0), (*h + 0) >> 1, color) + ((*h + 0) >> 1);
   }
+  if(state->decoder.max_memory)
+  {
+    if(!state->error)
+    {
+      state->error = decodeLowMemory(out, *w, *h, state, in, idatfirst, idatsize, idatchunks,
+                                     predict, &zlibsettings);
+    }
+    return;
+  }
   if(!state->error && !ucvector_reserve(&scanlines, predict)) state->error = 83; /*alloc fail*/
   if(!state->error)
   {
-    state->error = zlib_decompress(&scanlines.data, &scanlines.size, idat.data,
-                                   idat.size, &state->decoder.zlibsettings);
+    STATS_ALLOC(stats, predict);
+    STATS_BEGIN(stats, mark);
+    state->error = zlib_decompressv(&scanlines, idat.data, idat.size, &zlibsettings);
+    STATS_END(stats, zlib_ns, mark);
     if(!state->error && scanlines.size != predict) state->error = 91; /*decompressed size doesn't match prediction*/
   }
+  STATS_FREE(stats, idat.allocsize);
   ucvector_cleanup(&idat);
 
-  if(!state->error)
+  outsize = lodepng_get_raw_size(*w, *h, &state->info_png.color);
+  if(!state->error && state->info_png.interlace_method == 0)
+  {
+    /*the image is unfiltered over the scanlines, which become the output. That's at most the filter
+    type bytes and the padding bits larger than it, not worth a realloc*/
+    STATS_BEGIN(stats, mark);
+    state->error = postProcessScanlinesInPlace(scanlines.data, *w, *h, &state->info_png, stats);
+    STATS_END(stats, filter_ns, mark);
+    *out = scanlines.data;
+    ucvector_init(&scanlines);
+    /*lodepng_decode releases the output as an image of outsize bytes*/
+    STATS_FREE(stats, predict - outsize);
+  }
+  else if(!state->error)
   {
-    outsize = lodepng_get_raw_size(*w, *h, &state->info_png.color);
     *out = (unsigned char*)lodepng_malloc(outsize);
     if(!*out) state->error = 83; /*alloc fail*/
+    else STATS_ALLOC(stats, outsize);
   }
-  if(!state->error)
+  if(!state->error && state->info_png.interlace_method != 0)
   {
     for(i = 0; i < outsize; i++) (*out)[i] = 0;
-    state->error = postProcessScanlines(*out, scanlines.data, *w, *h, &state->info_png);
+    STATS_BEGIN(stats, mark);
+    state->error = postProcessScanlines(*out, scanlines.data, *w, *h, &state->info_png, stats);
+    STATS_END(stats, filter_ns, mark);
   }
+  if(scanlines.allocsize) STATS_FREE(stats, predict);
   ucvector_cleanup(&scanlines);
 }
 
@@ -4718,9 +5199,16 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
                         LodePNGState* state,
                         const unsigned char* in, size_t insize)
 {
+  LodePNGStats* stats = STATS_OF(state);
+  size_t decodedsize;
+  STATS_MARK(mark)
   *out = 0;
   decodeGeneric(out, w, h, state, in, insize);
+  /*the image is the caller's from here on, unless it gets converted. decodeLowMemory already converted it.*/
+  decodedsize = *out && !state->decoder.max_memory ? lodepng_get_raw_size(*w, *h, &state->info_png.color) : 0;
+  STATS_FREE(stats, decodedsize);
   if(state->error) return state->error;
+  STATS_ADD(stats, bytes_in, insize);
   if(!state->decoder.color_convert || lodepng_color_mode_equal(&state->info_raw, &state->info_png.color))
   {
     /*same color type, no copying or converting of data needed*/
@@ -4732,7 +5220,7 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
       if(state->error) return state->error;
     }
   }
-  else
+  else if(!state->decoder.max_memory)
   {
     /*color conversion needed; sort of copy of the data*/
     unsigned char* data = *out;
@@ -4752,10 +5240,20 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
     {
       state->error = 83; /*alloc fail*/
     }
-    else state->error = lodepng_convert(*out, data, &state->info_raw,
-                                        &state->info_png.color, *w, *h);
+    else
+    {
+      /*the decoded image was only released above, both are held while converting*/
+      STATS_ADD(stats, live_bytes, decodedsize);
+      STATS_ALLOC(stats, outsize);
+      STATS_BEGIN(stats, mark);
+      state->error = lodepng_convert(*out, data, &state->info_raw,
+                                     &state->info_png.color, *w, *h);
+      STATS_END(stats, convert_ns, mark);
+      STATS_FREE(stats, decodedsize + outsize);
+    }
     lodepng_free(data);
   }
+  if(!state->error) STATS_ADD(stats, bytes_out, lodepng_get_raw_size(*w, *h, &state->info_raw));
   return state->error;
 }
 
@@ -4814,6 +5312,7 @@ void lodepng_decoder_settings_init(LodePNGDecoderSettings* settings)
   settings->remember_unknown_chunks = 0;
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
   settings->ignore_crc = 0;
+  settings->max_memory = 0;
   lodepng_decompress_settings_init(&settings->zlibsettings);
 }
 
@@ -4832,6 +5331,9 @@ void lodepng_state_init(LodePNGState* state)
   lodepng_color_mode_init(&state->info_raw);
   lodepng_info_init(&state->info_png);
   state->error = 1;
+#ifdef LODEPNG_COMPILE_STATS
+  state->stats = 0;
+#endif /*LODEPNG_COMPILE_STATS*/
 }
 
 void lodepng_state_cleanup(LodePNGState* state)
@@ -4967,11 +5469,17 @@ static unsigned addChunk_IDAT(ucvector* out, const unsigned char* data, size_t d
 {
   ucvector zlibdata;
   unsigned error = 0;
+  LodePNGStats* stats = STATS_OF(zlibsettings);
+  STATS_MARK(mark)
 
   /*compress with the Zlib compressor*/
   ucvector_init(&zlibdata);
+  STATS_BEGIN(stats, mark);
   error = zlib_compress(&zlibdata.data, &zlibdata.size, data, datasize, zlibsettings);
+  STATS_END(stats, zlib_ns, mark);
+  STATS_ALLOC(stats, zlibdata.size);
   if(!error) error = addChunk(out, "IDAT", zlibdata.data, zlibdata.size);
+  STATS_FREE(stats, zlibdata.size);
   ucvector_cleanup(&zlibdata);
 
   return error;
@@ -5201,7 +5709,8 @@ static float flog2(float f)
 }
 
 static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h,
-                       const LodePNGColorMode* info, const LodePNGEncoderSettings* settings)
+                       const LodePNGColorMode* info, const LodePNGEncoderSettings* settings,
+                       LodePNGStats* stats)
 {
   /*
   For PNG filter method 0
@@ -5417,6 +5926,16 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
   }
   else return 88; /* unknown filter strategy */
 
+#ifdef LODEPNG_COMPILE_STATS
+  /*every strategy leaves the chosen filter type in the first byte of the scanline*/
+  if(stats && !error)
+  {
+    for(y = 0; y != h; ++y) stats->filter_bytes[out[y * (linebytes + 1)]] += linebytes;
+  }
+#else /*LODEPNG_COMPILE_STATS*/
+  (void)stats;
+#endif /*LODEPNG_COMPILE_STATS*/
+
   return error;
 }
 
@@ -5506,7 +6025,8 @@ static void Adam7_interlace(unsigned char* out, const unsigned char* in, unsigne
 return value is error**/
 static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const unsigned char* in,
                                     unsigned w, unsigned h,
-                                    const LodePNGInfo* info_png, const LodePNGEncoderSettings* settings)
+                                    const LodePNGInfo* info_png, const LodePNGEncoderSettings* settings,
+                                    LodePNGStats* stats)
 {
   /*
   This function converts the pure 2D image with the PNG's colortype, into filtered-padded-interlaced data. Steps:
@@ -5515,12 +6035,14 @@ static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const
   */
   unsigned bpp = lodepng_get_bpp(&info_png->color);
   unsigned error = 0;
+  STATS_MARK(mark)
 
   if(info_png->interlace_method == 0)
   {
     *outsize = h + (h * ((w * bpp + 7) / 8)); /*image size plus an extra byte per scanline + possible padding bits*/
     *out = (unsigned char*)lodepng_malloc(*outsize);
     if(!(*out) && (*outsize)) error = 83; /*alloc fail*/
+    else STATS_ALLOC(stats, *outsize);
 
     if(!error)
     {
@@ -5532,14 +6054,14 @@ static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const
         if(!error)
         {
           addPaddingBits(padded, in, ((w * bpp + 7) / 8) * 8, w * bpp, h);
-          error = filter(*out, padded, w, h, &info_png->color, settings);
+          error = filter(*out, padded, w, h, &info_png->color, settings, stats);
         }
         lodepng_free(padded);
       }
       else
       {
         /*we can immediately filter into the out buffer, no other steps needed*/
-        error = filter(*out, in, w, h, &info_png->color, settings);
+        error = filter(*out, in, w, h, &info_png->color, settings, stats);
       }
     }
   }
@@ -5554,15 +6076,19 @@ static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const
     *outsize = filter_passstart[7]; /*image size plus an extra byte per scanline + possible padding bits*/
     *out = (unsigned char*)lodepng_malloc(*outsize);
     if(!(*out)) error = 83; /*alloc fail*/
+    else STATS_ALLOC(stats, *outsize);
 
     adam7 = (unsigned char*)lodepng_malloc(passstart[7]);
     if(!adam7 && passstart[7]) error = 83; /*alloc fail*/
+    else STATS_ALLOC(stats, passstart[7]);
 
     if(!error)
     {
       unsigned i;
 
+      STATS_BEGIN(stats, mark);
       Adam7_interlace(adam7, in, w, h, bpp);
+      STATS_END(stats, adam7_ns, mark);
       for(i = 0; i != 7; ++i)
       {
         if(bpp < 8)
@@ -5572,19 +6098,20 @@ static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const
           addPaddingBits(padded, &adam7[passstart[i]],
                          ((passw[i] * bpp + 7) / 8) * 8, passw[i] * bpp, passh[i]);
           error = filter(&(*out)[filter_passstart[i]], padded,
-                         passw[i], passh[i], &info_png->color, settings);
+                         passw[i], passh[i], &info_png->color, settings, stats);
           lodepng_free(padded);
         }
         else
         {
           error = filter(&(*out)[filter_passstart[i]], &adam7[padded_passstart[i]],
-                         passw[i], passh[i], &info_png->color, settings);
+                         passw[i], passh[i], &info_png->color, settings, stats);
         }
 
         if(error) break;
       }
     }
 
+    if(adam7) STATS_FREE(stats, passstart[7]);
     lodepng_free(adam7);
   }
 
@@ -5639,11 +6166,18 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
   ucvector outv;
   unsigned char* data = 0; /*uncompressed version of the IDAT chunk data*/
   size_t datasize = 0;
+  /*the zlib settings carry the stats pointer of the state down to deflate*/
+  LodePNGCompressSettings zlibsettings = state->encoder.zlibsettings;
+  LodePNGStats* stats = STATS_OF(state);
+  STATS_MARK(mark)
 
   /*provide some proper output values if error will happen*/
   *out = 0;
   *outsize = 0;
   state->error = 0;
+#ifdef LODEPNG_COMPILE_STATS
+  zlibsettings.stats = stats;
+#endif /*LODEPNG_COMPILE_STATS*/
 
   lodepng_info_init(&info);
   lodepng_info_copy(&info, &state->info_png);
@@ -5657,7 +6191,9 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
 
   if(state->encoder.auto_convert)
   {
+    STATS_BEGIN(stats, mark);
     state->error = lodepng_auto_choose_color(&info.color, image, w, h, &state->info_raw);
+    STATS_END(stats, convert_ns, mark);
   }
   if(state->error) return state->error;
 
@@ -5684,13 +6220,28 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
     if(!converted && size) state->error = 83; /*alloc fail*/
     if(!state->error)
     {
+      STATS_ALLOC(stats, size);
+      STATS_BEGIN(stats, mark);
       state->error = lodepng_convert(converted, image, &info.color, &state->info_raw, w, h);
+      STATS_END(stats, convert_ns, mark);
+    }
+    if(!state->error)
+    {
+      STATS_BEGIN(stats, mark);
+      preProcessScanlines(&data, &datasize, converted, w, h, &info, &state->encoder, stats);
+      STATS_END(stats, filter_ns, mark);
     }
-    if(!state->error) preProcessScanlines(&data, &datasize, converted, w, h, &info, &state->encoder);
+    if(converted) STATS_FREE(stats, size);
     lodepng_free(converted);
   }
-  else preProcessScanlines(&data, &datasize, image, w, h, &info, &state->encoder);
+  else
+  {
+    STATS_BEGIN(stats, mark);
+    preProcessScanlines(&data, &datasize, image, w, h, &info, &state->encoder, stats);
+    STATS_END(stats, filter_ns, mark);
+  }
 
+  STATS_BEGIN(stats, mark);
   ucvector_init(&outv);
   while(!state->error) /*while only executed once, to break on error*/
   {
@@ -5741,7 +6292,7 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
     }
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
     /*IDAT (multiple IDAT chunks must be consecutive)*/
-    state->error = addChunk_IDAT(&outv, data, datasize, &state->encoder.zlibsettings);
+    state->error = addChunk_IDAT(&outv, data, datasize, &zlibsettings);
     if(state->error) break;
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
     /*tIME*/
@@ -5814,9 +6365,19 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
 
     break; /*this isn't really a while loop; no error happened so break out now!*/
   }
+  STATS_END(stats, chunk_ns, mark);
+  /*the output is the caller's once returned, it only counts while the IDAT data is still held*/
+  STATS_ALLOC(stats, outv.allocsize);
+  STATS_FREE(stats, outv.allocsize);
 
   lodepng_info_cleanup(&info);
+  if(data) STATS_FREE(stats, datasize);
   lodepng_free(data);
+  if(!state->error)
+  {
+    STATS_ADD(stats, bytes_in, lodepng_get_raw_size(w, h, &state->info_raw));
+    STATS_ADD(stats, bytes_out, outv.size);
+  }
   /*instead of cleaning the vector up, give it to the output*/
   *out = outv.data;
   *outsize = outv.size;
@@ -5992,6 +6553,8 @@ const char* lodepng_error_text(unsigned code)
     case 92: return "too many pixels, not supported";
     case 93: return "zero width or height is invalid";
     case 94: return "header chunk must have a size of 13 bytes";
+    case 95: return "zlib data decompresses to more than the max_output_size of the settings";
+    case 96: return "decoding needs more memory than the max_memory of the decoder settings";
   }
   return "unknown error code";
 }
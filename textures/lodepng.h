@@ -74,6 +74,11 @@ source files with custom allocators.*/
 #ifndef LODEPNG_NO_COMPILE_ALLOCATORS
 #define LODEPNG_COMPILE_ALLOCATORS
 #endif
+/*per stage timings and counters in the optional LodePNGStats block of the state. Costs
+nothing while the stats pointer is NULL, and disabling it removes the hooks entirely.*/
+#ifndef LODEPNG_NO_COMPILE_STATS
+#define LODEPNG_COMPILE_STATS
+#endif
 /*compile the C++ version (you can disable the C++ wrapper here even when compiling for C++)*/
 #ifdef __cplusplus
 #ifndef LODEPNG_NO_COMPILE_CPP
@@ -250,12 +255,47 @@ unsigned encode(const std::string& filename,
 const char* lodepng_error_text(unsigned code);
 #endif /*LODEPNG_COMPILE_ERROR_TEXT*/
 
+/*
+Statistics of decoding and encoding, filled in when the stats member of a LodePNGState
+points to one. All counters accumulate over every call that uses the same block, so one
+block can sum up a whole batch of images; lodepng_stats_init resets it.
+Times are in nanoseconds of wall clock time and exclusive: the time in a stage that runs
+inside another (Adam7 inside filtering, the Adler32 inside zlib) only counts for the inner one.
+They come from CLOCK_MONOTONIC, or C11 timespec_get without it, and stay 0 without either.
+When encoding, the zlib time is deflate and the CRC of written chunks counts as chunk time.
+Only the buffers that scale with the image are tracked for allocations and peak bytes:
+the IDAT data, the scanlines, the Adam7 passes, the converted image and the output.
+*/
+typedef struct LodePNGStats
+{
+  double chunk_ns; /*walking, parsing and writing chunks, including the ancillary ones*/
+  double zlib_ns; /*inflate when decoding, deflate when encoding*/
+  double filter_ns; /*unfiltering or filtering scanlines, and the padding bits*/
+  double adam7_ns; /*deinterlacing or interlacing*/
+  double convert_ns; /*color conversion between the raw and the PNG color type*/
+  double checksum_ns; /*CRC32 of the chunks and Adler32 of the zlib stream*/
+
+  size_t bytes_in; /*PNG bytes decoded, or raw image bytes encoded*/
+  size_t bytes_out; /*raw image bytes decoded, or PNG bytes encoded*/
+  unsigned deflate_blocks[3]; /*deflate blocks per BTYPE: stored, fixed and dynamic huffman*/
+  size_t filter_bytes[5]; /*scanline bytes per filter type: none, sub, up, average and paeth*/
+
+  unsigned allocations; /*image sized buffers allocated*/
+  size_t live_bytes; /*bytes of those held right now, back to 0 after each call*/
+  size_t peak_bytes; /*highest live_bytes seen*/
+} LodePNGStats;
+
+void lodepng_stats_init(LodePNGStats* stats);
+
 #ifdef LODEPNG_COMPILE_DECODER
 /*Settings for zlib decompression*/
 typedef struct LodePNGDecompressSettings LodePNGDecompressSettings;
 struct LodePNGDecompressSettings
 {
   unsigned ignore_adler32; /*if 1, continue and don't give an error message if the Adler32 checksum is corrupted*/
+  /*if not 0, inflating more than this many bytes fails with error 95 instead of growing the output further.
+  Custom zlib and inflate functions have to check it themselves. Default: 0*/
+  size_t max_output_size;
 
   /*use custom zlib decoder instead of built in one (default: null)*/
   unsigned (*custom_zlib)(unsigned char**, size_t*,
@@ -269,6 +309,9 @@ struct LodePNGDecompressSettings
                              const LodePNGDecompressSettings*);
 
   const void* custom_context; /*optional custom settings for custom functions*/
+#ifdef LODEPNG_COMPILE_STATS
+  LodePNGStats* stats; /*counts blocks and checksum time if not NULL. lodepng_decode sets it from the state.*/
+#endif /*LODEPNG_COMPILE_STATS*/
 };
 
 extern const LodePNGDecompressSettings lodepng_default_decompress_settings;
@@ -303,6 +346,9 @@ struct LodePNGCompressSettings /*deflate = compress*/
                              const LodePNGCompressSettings*);
 
   const void* custom_context; /*optional custom settings for custom functions*/
+#ifdef LODEPNG_COMPILE_STATS
+  LodePNGStats* stats; /*counts blocks and checksum time if not NULL. lodepng_encode sets it from the state.*/
+#endif /*LODEPNG_COMPILE_STATS*/
 };
 
 extern const LodePNGCompressSettings lodepng_default_compress_settings;
@@ -524,6 +570,17 @@ typedef struct LodePNGDecoderSettings
 
   unsigned color_convert; /*whether to convert the PNG to the color type you want. Default: yes*/
 
+  /*
+  if not 0, decode with as little memory as possible and fail with error 96, before allocating anything,
+  if the buffers for the image would need more than this many bytes at any one time. That counts the
+  output and the copy of the IDAT data if it's split over several chunks, but not the PNG itself.
+  The scanlines are inflated into the buffer that becomes the output, and unfiltered and converted
+  there, so a non interlaced image only needs the larger of its scanlines and its output, plus a row.
+  Adam7 needs both the scanlines and the deinterlaced image. Custom zlib functions get their own
+  buffers, which this can't count. Default: 0, the usual decoding with separate buffers per step.
+  */
+  size_t max_memory;
+
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
   unsigned read_text_chunks; /*if false but remember_unknown_chunks is true, they're stored in the unknown chunks*/
   /*store all bytes from unknown chunks in the LodePNGInfo (off by default, useful for a png editor)*/
@@ -630,6 +687,9 @@ typedef struct LodePNGState
   LodePNGColorMode info_raw; /*specifies the format in which you would like to get the raw pixel buffer*/
   LodePNGInfo info_png; /*info of the PNG image obtained after decoding*/
   unsigned error;
+#ifdef LODEPNG_COMPILE_STATS
+  LodePNGStats* stats; /*if not NULL, lodepng_decode and lodepng_encode add their statistics here. Default: NULL*/
+#endif /*LODEPNG_COMPILE_STATS*/
 #ifdef LODEPNG_COMPILE_CPP
   /* For the lodepng::State subclass. */
   virtual ~LodePNGState(){}
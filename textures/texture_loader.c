@@ -0,0 +1,456 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Texture loading on a background thread
+ *
+ * See texture_loader.h for usage.
+ */
+
+#include "texture_loader.h"
+#include "lodepng.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+typedef enum { false, true } bool;
+
+typedef enum {
+	STATE_LOADING,     // queued or being loaded, owned by the loader thread
+	STATE_UPLOADED,    // the upload is queued and fenced, owned by the render thread from here on
+	STATE_READY,       // the render context waited for the fence
+	STATE_FAILED
+} RequestState;
+
+struct TextureRequest {
+	TextureLoader* loader;
+	char* path;
+	GLint filter;
+
+	// set by the loader thread before STATE_UPLOADED
+	GLuint texture;
+	GLsync fence;
+	int width, height;
+
+	RequestState state;          // guarded by the loader's mutex
+	bool released;               // released while loading, the loader thread frees it
+
+	TextureRequest* next_queued;
+	TextureRequest *prev, *next; // every request not freed yet
+};
+
+struct TextureLoader {
+	// context of the loader thread, one of the two
+	GLFWwindow* window;
+	HeadlessSharedContext shared;
+	bool headless;
+
+	pthread_t thread;
+	bool joinable;
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cond, done_cond;
+	bool started, failed, quit;
+	TextureRequest *queue_head, *queue_tail;
+	TextureRequest* requests;
+
+	TextureLoadedCallback callback;
+	void* callback_data;
+	size_t memory_budget;   // decoder.max_memory of LodePNG, 0 for none
+
+	// statistics, guarded by the mutex
+	unsigned long loaded, failures;
+	double decode_ms, upload_ms;
+};
+
+static double now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// requests
+
+static void unlink_request(TextureLoader* loader, TextureRequest* request)
+{
+	if(request->prev) request->prev->next = request->next;
+	else loader->requests = request->next;
+	if(request->next) request->next->prev = request->prev;
+}
+
+static void free_request(TextureRequest* request)
+{
+	free(request->path);
+	free(request);
+}
+
+// loader thread
+
+static bool make_current(TextureLoader* loader)
+{
+	if(loader->headless) return headless_make_shared_current(&loader->shared);
+	glfwMakeContextCurrent(loader->window);
+	return glfwGetCurrentContext() == loader->window;
+}
+
+static void release_current(TextureLoader* loader)
+{
+	if(loader->headless) headless_release_shared(&loader->shared);
+	else glfwMakeContextCurrent(NULL);
+}
+
+// decodes and uploads a texture, setting the request's texture, fence and size. returns 0 on failure
+static bool load(TextureLoader* loader, TextureRequest* request)
+{
+	double start = now_ms();
+	unsigned char* image_data = NULL;
+	unsigned int width, height;
+	unsigned char* png;
+	size_t png_size;
+	unsigned int error = lodepng_load_file(&png, &png_size, request->path);
+	if(!error) {
+		LodePNGState state;
+		lodepng_state_init(&state);   // decodes to 8-bit RGBA
+		state.decoder.max_memory = loader->memory_budget;
+		error = lodepng_decode(&image_data, &width, &height, &state, png, png_size);
+		lodepng_state_cleanup(&state);
+		free(png);
+	}
+	if(error) {
+		free(image_data);
+		fprintf(stderr, "Error loading image file '%s' %u: %s\n", request->path, error, lodepng_error_text(error));
+		return false;
+	}
+	double decoded = now_ms();
+
+	glGenTextures(1, &request->texture);
+	glBindTexture(GL_TEXTURE_2D, request->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, request->filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, request->filter);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	free(image_data);
+
+	// the fence must reach the GPU before another context can wait on it
+	request->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+	request->width = width;
+	request->height = height;
+
+	pthread_mutex_lock(&loader->mutex);
+	loader->decode_ms += decoded - start;
+	loader->upload_ms += now_ms() - decoded;
+	pthread_mutex_unlock(&loader->mutex);
+	return true;
+}
+
+static void* loader_main(void* arg)
+{
+	TextureLoader* loader = arg;
+	bool current = make_current(loader);
+
+	pthread_mutex_lock(&loader->mutex);
+	loader->started = true;
+	loader->failed = !current;
+	pthread_cond_broadcast(&loader->done_cond);
+	while(current) {
+		while(!loader->quit && !loader->queue_head) pthread_cond_wait(&loader->work_cond, &loader->mutex);
+		if(loader->quit) break;
+
+		TextureRequest* request = loader->queue_head;
+		loader->queue_head = request->next_queued;
+		if(!loader->queue_head) loader->queue_tail = NULL;
+		pthread_mutex_unlock(&loader->mutex);
+
+		bool ok = request->released || load(loader, request);
+
+		pthread_mutex_lock(&loader->mutex);
+		if(request->released) {
+			// nobody is waiting for it any more
+			if(request->fence) glDeleteSync(request->fence);
+			glDeleteTextures(1, &request->texture);
+			unlink_request(loader, request);
+			free_request(request);
+			continue;
+		}
+		request->state = ok ? STATE_UPLOADED : STATE_FAILED;
+		if(ok) loader->loaded++;
+		else loader->failures++;
+		pthread_cond_broadcast(&loader->done_cond);
+
+		if(loader->callback) {
+			pthread_mutex_unlock(&loader->mutex);
+			loader->callback(loader->callback_data);
+			pthread_mutex_lock(&loader->mutex);
+		}
+	}
+	pthread_mutex_unlock(&loader->mutex);
+
+	if(current) {
+		// what the render thread never took over is deleted with the loader's context
+		TextureRequest* request;
+		for(request = loader->requests; request; request = request->next) {
+			if(request->state == STATE_UPLOADED) {
+				glDeleteSync(request->fence);
+				glDeleteTextures(1, &request->texture);
+			}
+		}
+		glFinish();
+		release_current(loader);
+	}
+	return NULL;
+}
+
+// loader
+
+static TextureLoader* start_loader(TextureLoader* loader)
+{
+	if(!GLEW_VERSION_3_2 && !GLEW_ARB_sync) {
+		fprintf(stderr, "Loading textures on a thread needs OpenGL 3.2 or ARB_sync for fences\n");
+		texture_loader_destroy(loader);
+		return NULL;
+	}
+
+	pthread_mutex_init(&loader->mutex, NULL);
+	pthread_cond_init(&loader->work_cond, NULL);
+	pthread_cond_init(&loader->done_cond, NULL);
+	loader->joinable = pthread_create(&loader->thread, NULL, loader_main, loader) == 0;
+	if(!loader->joinable) {
+		fprintf(stderr, "Could not start the texture loader thread\n");
+		loader->started = true;
+		loader->failed = true;
+	}
+
+	pthread_mutex_lock(&loader->mutex);
+	while(!loader->started) pthread_cond_wait(&loader->done_cond, &loader->mutex);
+	bool failed = loader->failed;
+	pthread_mutex_unlock(&loader->mutex);
+	if(failed) {
+		texture_loader_destroy(loader);
+		return NULL;
+	}
+	return loader;
+}
+
+TextureLoader* texture_loader_create_glfw(GLFWwindow* window)
+{
+	TextureLoader* loader = calloc(1, sizeof(TextureLoader));
+	if(!loader) return NULL;
+
+	// the hidden window is only there for its context, created with the same hints as 'window'
+	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+	loader->window = glfwCreateWindow(1, 1, "Texture loader", NULL, window);
+	glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
+	if(!loader->window) {
+		fprintf(stderr, "Could not create a shared context for the texture loader\n");
+		free(loader);
+		return NULL;
+	}
+	// creating a window does not change the current context, but make sure of it
+	glfwMakeContextCurrent(window);
+	return start_loader(loader);
+}
+
+TextureLoader* texture_loader_create_headless(HeadlessContext* ctx)
+{
+	TextureLoader* loader = calloc(1, sizeof(TextureLoader));
+	if(!loader) return NULL;
+
+	loader->headless = true;
+	if(!headless_create_shared(ctx, &loader->shared)) {
+		free(loader);
+		return NULL;
+	}
+	return start_loader(loader);
+}
+
+void texture_loader_destroy(TextureLoader* loader)
+{
+	if(!loader) return;
+
+	// the mutex only exists once start_loader() got that far
+	if(loader->started) {
+		pthread_mutex_lock(&loader->mutex);
+		loader->quit = true;
+		pthread_cond_broadcast(&loader->work_cond);
+		pthread_mutex_unlock(&loader->mutex);
+		if(loader->joinable) pthread_join(loader->thread, NULL);
+
+		pthread_cond_destroy(&loader->done_cond);
+		pthread_cond_destroy(&loader->work_cond);
+		pthread_mutex_destroy(&loader->mutex);
+	}
+
+	while(loader->requests) {
+		TextureRequest* request = loader->requests;
+		loader->requests = request->next;
+		free_request(request);
+	}
+
+	if(loader->headless) headless_free_shared(&loader->shared);
+	else glfwDestroyWindow(loader->window);
+	free(loader);
+}
+
+void texture_loader_set_callback(TextureLoader* loader, TextureLoadedCallback callback, void* data)
+{
+	loader->callback = callback;
+	loader->callback_data = data;
+}
+
+void texture_loader_set_memory_budget(TextureLoader* loader, size_t bytes)
+{
+	loader->memory_budget = bytes;
+}
+
+void texture_loader_print_stats(const TextureLoader* loader)
+{
+	TextureLoader* l = (TextureLoader*) loader; // the mutex is not part of the state
+	pthread_mutex_lock(&l->mutex);
+	unsigned long loaded = l->loaded;
+	printf("Texture loader: %lu textures loaded, %lu failed", loaded, l->failures);
+	if(loaded > 0) {
+		printf(", %.3f ms decoding and %.3f ms uploading per texture, on the loader thread",
+		       l->decode_ms / loaded, l->upload_ms / loaded);
+	}
+	printf("\n");
+	pthread_mutex_unlock(&l->mutex);
+}
+
+TextureRequest* texture_loader_load(TextureLoader* loader, const char* path, GLint filter)
+{
+	TextureRequest* request = calloc(1, sizeof(TextureRequest));
+	if(!request) return NULL;
+	request->path = malloc(strlen(path) + 1);
+	if(!request->path) {
+		free(request);
+		return NULL;
+	}
+	strcpy(request->path, path);
+	request->loader = loader;
+	request->filter = filter;
+	request->state = STATE_LOADING;
+
+	pthread_mutex_lock(&loader->mutex);
+	request->next = loader->requests;
+	if(loader->requests) loader->requests->prev = request;
+	loader->requests = request;
+	if(loader->queue_tail) loader->queue_tail->next_queued = request;
+	else loader->queue_head = request;
+	loader->queue_tail = request;
+	pthread_cond_signal(&loader->work_cond);
+	pthread_mutex_unlock(&loader->mutex);
+	return request;
+}
+
+// requests
+
+static RequestState get_state(TextureRequest* request)
+{
+	pthread_mutex_lock(&request->loader->mutex);
+	RequestState state = request->state;
+	pthread_mutex_unlock(&request->loader->mutex);
+	return state;
+}
+
+TextureStatus texture_request_status(TextureRequest* request)
+{
+	RequestState state = get_state(request);
+	if(state == STATE_UPLOADED) {
+		// the render context's commands wait on the GPU for the upload, the CPU goes on
+		glWaitSync(request->fence, 0, GL_TIMEOUT_IGNORED);
+		glDeleteSync(request->fence);
+		request->fence = 0;
+
+		pthread_mutex_lock(&request->loader->mutex);
+		request->state = state = STATE_READY;
+		pthread_mutex_unlock(&request->loader->mutex);
+	}
+	if(state == STATE_READY) return TEXTURE_READY;
+	return state == STATE_FAILED ? TEXTURE_FAILED : TEXTURE_LOADING;
+}
+
+TextureStatus texture_request_wait(TextureRequest* request)
+{
+	TextureLoader* loader = request->loader;
+	pthread_mutex_lock(&loader->mutex);
+	while(request->state == STATE_LOADING) pthread_cond_wait(&loader->done_cond, &loader->mutex);
+	pthread_mutex_unlock(&loader->mutex);
+	return texture_request_status(request);
+}
+
+GLuint texture_request_texture(TextureRequest* request)
+{
+	return get_state(request) == STATE_READY ? request->texture : 0;
+}
+
+void texture_request_size(TextureRequest* request, int* width, int* height)
+{
+	bool ready = get_state(request) == STATE_READY;
+	*width = ready ? request->width : 0;
+	*height = ready ? request->height : 0;
+}
+
+int texture_request_update(TextureRequest* request, const unsigned char* rgba, int width, int height)
+{
+	// ready requests belong to the render thread, the loader thread no longer touches them
+	if(get_state(request) != STATE_READY) return false;
+
+	glBindTexture(GL_TEXTURE_2D, request->texture);
+	if(width == request->width && height == request->height) {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	}
+	else {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+		request->width = width;
+		request->height = height;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return true;
+}
+
+void texture_request_release(TextureRequest* request)
+{
+	if(!request) return;
+	TextureLoader* loader = request->loader;
+	pthread_mutex_lock(&loader->mutex);
+	if(request->state == STATE_LOADING) {
+		// the loader thread has it, or will have it, it frees it when done
+		request->released = true;
+		pthread_mutex_unlock(&loader->mutex);
+		return;
+	}
+	unlink_request(loader, request);
+	pthread_mutex_unlock(&loader->mutex);
+
+	// textures are shared, any context of the group can delete them
+	if(request->fence) glDeleteSync(request->fence);
+	if(request->texture) glDeleteTextures(1, &request->texture);
+	free_request(request);
+}
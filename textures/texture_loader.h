@@ -0,0 +1,110 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Texture loading on a background thread
+ *
+ * Decoding a PNG and uploading it with glTexImage2D() can take longer than a frame, so textures
+ * streamed in while the application runs are loaded by a thread of their own. The thread owns a
+ * second context in the same share group as the render context: a hidden GLFW window, or a
+ * shared EGL context when running headless. It decodes each queued file with LodePNG, uploads it,
+ * and publishes the texture with a fence. The render thread never blocks on any of it:
+ * texture_request_status() only looks at the request, and once the upload is queued makes the
+ * render context's command stream wait for the fence on the GPU (glWaitSync), not the CPU.
+ *
+ *   TextureLoader* loader = texture_loader_create_glfw(window); // after the main window's context is current
+ *   TextureRequest* request = texture_loader_load(loader, "image.png", GL_LINEAR);
+ *   ...
+ *   if(texture_request_status(request) == TEXTURE_READY) {   // every frame, draws a placeholder until then
+ *       glBindTexture(GL_TEXTURE_2D, texture_request_texture(request));
+ *       ...
+ *   }
+ *   ...
+ *   texture_request_release(request);   // deletes the texture
+ *   texture_loader_destroy(loader);
+ *
+ * A callback, run on the loader thread after each texture, can wake a loop that waits for events,
+ * eg. with redraw_post() from ../common/redraw.h. texture_request_wait() blocks until a request
+ * is done, for headless runs and benchmarks whose frames must not depend on timing.
+ *
+ * Textures are RGBA, clamped to the edge, with the given filter for minification and magnification.
+ * Requires OpenGL 3.2 or ARB_sync, GLFW 3.2 and GLEW to be initialized before use, and pthreads.
+ */
+
+#ifndef OPENGL_PLAYGROUND_TEXTURE_LOADER_H
+#define OPENGL_PLAYGROUND_TEXTURE_LOADER_H
+
+#include <stddef.h>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "../common/headless.h"
+
+typedef enum {
+	TEXTURE_LOADING,   // queued, being decoded or on its way to the GPU
+	TEXTURE_READY,     // can be drawn with on the render thread
+	TEXTURE_FAILED     // the file could not be read or decoded, an error was printed
+} TextureStatus;
+
+typedef struct TextureLoader TextureLoader;
+typedef struct TextureRequest TextureRequest;
+
+// called on the loader thread when a request is done, successfully or not
+typedef void (*TextureLoadedCallback)(void* data);
+
+// starts the loader thread with a hidden window sharing objects with 'window', whose context must
+// be current. call it on the main thread, with the context hints of 'window' still set
+TextureLoader* texture_loader_create_glfw(GLFWwindow* window);
+// the same with a context sharing objects with a headless one
+TextureLoader* texture_loader_create_headless(HeadlessContext* ctx);
+// stops the thread, dropping what is still queued. frees every request, and deletes the textures
+// that never became ready. textures of ready requests that were not released are left to the caller
+void texture_loader_destroy(TextureLoader* loader);
+// sets the callback, before the first texture_loader_load()
+void texture_loader_set_callback(TextureLoader* loader, TextureLoadedCallback callback, void* data);
+// decodes with at most 'bytes' of buffers per image, before the first texture_loader_load(). images
+// that need more fail to load instead. 0, the default, decodes as fast as possible with no limit
+void texture_loader_set_memory_budget(TextureLoader* loader, size_t bytes);
+// prints how many textures were loaded, and the time spent decoding and uploading them
+void texture_loader_print_stats(const TextureLoader* loader);
+
+// queues 'path' to be loaded. returns NULL if out of memory
+TextureRequest* texture_loader_load(TextureLoader* loader, const char* path, GLint filter);
+
+// on the render thread, never blocks
+TextureStatus texture_request_status(TextureRequest* request);
+// on the render thread, blocks until the request is ready or failed
+TextureStatus texture_request_wait(TextureRequest* request);
+// the texture once ready, 0 before
+GLuint texture_request_texture(TextureRequest* request);
+void texture_request_size(TextureRequest* request, int* width, int* height);
+// on the render thread, replaces the pixels of a ready texture with 'rgba', eg. after its file changed
+// (see ../common/asset_watch.h). updated in place with glTexSubImage2D when the size is the same,
+// reallocated otherwise, keeping its name. returns 0 if the request is not ready
+int texture_request_update(TextureRequest* request, const unsigned char* rgba, int width, int height);
+// on the render thread. deletes the texture, or cancels the request if it is still loading
+void texture_request_release(TextureRequest* request);
+
+#endif // OPENGL_PLAYGROUND_TEXTURE_LOADER_H
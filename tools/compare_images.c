@@ -0,0 +1,272 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Compares rendered frames with reference images
+ *
+ * Usage: compare_images [options] reference.png actual.png
+ *        compare_images [options] --list pairs.txt
+ *
+ *   --list file          compares every "reference.png actual.png" pair in the file, one per line
+ *   --threads N          threads, one per CPU by default. a single pair splits its image in tiles,
+ *                        a list decodes and compares several pairs at the same time
+ *   --threshold N        a pixel differs when one of its channels differs by more than N, 0 by default
+ *   --max-pixels N       pass with at most N differing pixels, 0 by default
+ *   --min-psnr DB        fail below this PSNR
+ *   --min-ssim S         fail below this SSIM, between 0 and 1
+ *   --heatmap file.png   writes the heatmap of a single pair
+ *   --heatmap-dir dir    writes a heatmap for every pair of a list that fails, named after its position
+ *                        in the list and the actual image, eg. diffs/0003_icons.png
+ *
+ * Prints one line per pair and exits with 0 when all of them pass, 1 when some fail, 2 on errors
+ * (missing files, different sizes). Eg. after rendering every example with --headless --output:
+ *
+ *   ./compare_images --list pairs.txt --min-psnr 40 --heatmap-dir diffs
+ *
+ * Compiling this tool:
+ * Linux: gcc -O2 ../common/worker_pool.c ../textures/lodepng.c image_diff.c compare_images.c -lpthread -lm -o compare_images
+ *
+ * Requires the included LodePNG library: http://lodev.org/lodepng/
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "image_diff.h"
+
+typedef enum { false, true } bool;
+
+#define MAX_PATH 1024
+
+typedef struct {
+	char reference[MAX_PATH];
+	char actual[MAX_PATH];
+	bool loaded;               // both images decoded and compared
+	bool passed;
+	ImageDiffResult result;
+} Pair;
+
+struct {
+	int threads;
+	int threshold;
+	unsigned long max_pixels;
+	double min_psnr, min_ssim;
+	const char* heatmap;
+	const char* heatmap_dir;
+} options = {0, 0, 0, 0.0, 0.0, NULL, NULL};
+
+static double now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static bool passes(const ImageDiffResult* r)
+{
+	return r->differing_pixels <= options.max_pixels && r->psnr >= options.min_psnr && r->ssim >= options.min_ssim;
+}
+
+static void print_pair(const Pair* pair)
+{
+	if(!pair->loaded) {
+		printf("ERROR %s %s\n", pair->reference, pair->actual);
+		return;
+	}
+	const ImageDiffResult* r = &pair->result;
+	printf("%s %s %s psnr=%.2f ssim=%.5f max=%d pixels=%lu\n", pair->passed ? "PASS" : "FAIL",
+		pair->reference, pair->actual, isinf(r->psnr) ? 99.99 : r->psnr, r->ssim, r->max_diff, r->differing_pixels);
+}
+
+// list mode
+
+static Pair* read_pairs(const char* file, int* count)
+{
+	FILE* f = fopen(file, "r");
+	if(!f) {
+		fprintf(stderr, "Could not open pair list '%s'\n", file);
+		return NULL;
+	}
+	Pair* pairs = NULL;
+	int capacity = 0;
+	*count = 0;
+	char line[2 * MAX_PATH + 16];
+	while(fgets(line, sizeof(line), f)) {
+		if(*count == capacity) {
+			capacity = capacity ? capacity * 2 : 64;
+			Pair* grown = realloc(pairs, capacity * sizeof(Pair));
+			if(!grown) break;
+			pairs = grown;
+		}
+		Pair* pair = &pairs[*count];
+		memset(pair, 0, sizeof(Pair));
+		if(sscanf(line, "%1023s %1023s", pair->reference, pair->actual) == 2) (*count)++;
+	}
+	fclose(f);
+	return pairs;
+}
+
+typedef struct {
+	Pair* pairs;
+	int count;
+	atomic_int next;
+} PairQueue;
+
+// the index of the pair in the list keeps run1/a.png and run2/a.png apart. false if the path is too long
+static bool heatmap_path(char* path, int index, const char* actual)
+{
+	const char* name = strrchr(actual, '/');
+	name = name ? name + 1 : actual;
+	int length = snprintf(path, MAX_PATH, "%s/%04d_%s", options.heatmap_dir, index + 1, name);
+	if(length < 0 || length >= MAX_PATH) {
+		fprintf(stderr, "Heatmap path for '%s' is too long, not writing it\n", actual);
+		return false;
+	}
+	return true;
+}
+
+static void* compare_pairs(void* arg)
+{
+	PairQueue* queue = arg;
+	// each thread compares whole pairs, decoding is most of the work
+	ImageDiffer* differ = image_differ_create(1, options.threshold);
+	if(!differ) return NULL;
+
+	for(;;) {
+		int i = atomic_fetch_add(&queue->next, 1);
+		if(i >= queue->count) break;
+		Pair* pair = &queue->pairs[i];
+		pair->loaded = image_diff_files(differ, pair->reference, pair->actual, NULL, &pair->result);
+		pair->passed = pair->loaded && passes(&pair->result);
+		if(pair->loaded && !pair->passed && options.heatmap_dir) {
+			// compared again only for the few that fail
+			char path[MAX_PATH];
+			if(heatmap_path(path, i, pair->actual)) {
+				image_diff_files(differ, pair->reference, pair->actual, path, &pair->result);
+			}
+		}
+	}
+	image_differ_destroy(differ);
+	return NULL;
+}
+
+static int run_list(const char* file)
+{
+	PairQueue queue;
+	queue.pairs = read_pairs(file, &queue.count);
+	if(!queue.pairs) return 2;
+	atomic_store(&queue.next, 0);
+
+	int num_threads = options.threads > 0 ? options.threads : sysconf(_SC_NPROCESSORS_ONLN);
+	if(num_threads < 1) num_threads = 1;
+	pthread_t* threads = malloc(num_threads * sizeof(pthread_t));
+	if(!threads) return 2;
+
+	double start = now_ms();
+	int i, started = 0;
+	for(i = 1; i < num_threads; i++) {
+		if(pthread_create(&threads[started], NULL, compare_pairs, &queue) != 0) break;
+		started++;
+	}
+	compare_pairs(&queue);
+	for(i = 0; i < started; i++) pthread_join(threads[i], NULL);
+	double elapsed = now_ms() - start;
+
+	int failed = 0, errors = 0;
+	for(i = 0; i < queue.count; i++) {
+		print_pair(&queue.pairs[i]);
+		if(!queue.pairs[i].loaded) errors++;
+		else if(!queue.pairs[i].passed) failed++;
+	}
+	fprintf(stderr, "Compared %d pairs in %.1f ms (%.1f per second) with %d threads: %d failed, %d errors\n",
+		queue.count, elapsed, queue.count * 1000.0 / (elapsed > 0 ? elapsed : 1), started + 1, failed, errors);
+
+	free(threads);
+	free(queue.pairs);
+	return errors ? 2 : failed ? 1 : 0;
+}
+
+// single pair
+
+static int run_pair(const char* reference, const char* actual)
+{
+	ImageDiffer* differ = image_differ_create(options.threads, options.threshold);
+	if(!differ) return 2;
+
+	Pair pair;
+	memset(&pair, 0, sizeof(Pair));
+	snprintf(pair.reference, MAX_PATH, "%s", reference);
+	snprintf(pair.actual, MAX_PATH, "%s", actual);
+	pair.loaded = image_diff_files(differ, reference, actual, options.heatmap, &pair.result);
+	pair.passed = pair.loaded && passes(&pair.result);
+	print_pair(&pair);
+
+	image_differ_destroy(differ);
+	return !pair.loaded ? 2 : pair.passed ? 0 : 1;
+}
+
+static void usage()
+{
+	fprintf(stderr, "Usage: compare_images [--threads N] [--threshold N] [--max-pixels N] [--min-psnr DB] [--min-ssim S]\n"
+		"                      [--heatmap file.png] reference.png actual.png\n"
+		"       compare_images [options] [--heatmap-dir dir] --list pairs.txt\n");
+}
+
+int main(int argc, char** argv)
+{
+	const char* list = NULL;
+	const char* files[2];
+	int num_files = 0;
+
+	int i;
+	for(i = 1; i < argc; i++) {
+		bool has_value = i + 1 < argc;
+		if(strcmp(argv[i], "--list") == 0 && has_value) list = argv[++i];
+		else if(strcmp(argv[i], "--threads") == 0 && has_value) options.threads = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--threshold") == 0 && has_value) options.threshold = atoi(argv[++i]);
+		else if(strcmp(argv[i], "--max-pixels") == 0 && has_value) options.max_pixels = strtoul(argv[++i], NULL, 10);
+		else if(strcmp(argv[i], "--min-psnr") == 0 && has_value) options.min_psnr = atof(argv[++i]);
+		else if(strcmp(argv[i], "--min-ssim") == 0 && has_value) options.min_ssim = atof(argv[++i]);
+		else if(strcmp(argv[i], "--heatmap") == 0 && has_value) options.heatmap = argv[++i];
+		else if(strcmp(argv[i], "--heatmap-dir") == 0 && has_value) options.heatmap_dir = argv[++i];
+		else if(argv[i][0] != '-' && num_files < 2) files[num_files++] = argv[i];
+		else {
+			usage();
+			return 2;
+		}
+	}
+
+	if(list) return run_list(list);
+	if(num_files != 2) {
+		usage();
+		return 2;
+	}
+	return run_pair(files[0], files[1]);
+}
@@ -0,0 +1,392 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Image comparison against reference images
+ *
+ * See image_diff.h
+ */
+
+#include "image_diff.h"
+#include "../textures/lodepng.h"
+#include "../common/worker_pool.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <stdatomic.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+typedef enum { false, true } bool;
+
+// a tile's SSIM windows reach past its right and bottom edges into the next tiles
+#define LUMA_STRIDE (IMAGE_DIFF_TILE_SIZE + IMAGE_DIFF_SSIM_WINDOW - IMAGE_DIFF_SSIM_STEP)
+#define SSIM_C1 (0.01 * 255 * 0.01 * 255)
+#define SSIM_C2 (0.03 * 255 * 0.03 * 255)
+
+typedef struct {
+	uint64_t sse;                   // sum of squared errors
+	double ssim_sum;
+	unsigned long windows;
+	unsigned long differing_pixels;
+	int max_diff;
+} TileResult;
+
+typedef struct {
+	ImageDiffer* differ;
+	unsigned char luma_reference[LUMA_STRIDE * LUMA_STRIDE];
+	unsigned char luma_actual[LUMA_STRIDE * LUMA_STRIDE];
+} Worker;
+
+struct ImageDiffer {
+	int threshold;
+	WorkerPool* pool;
+	Worker* workers;                // one per worker of the pool
+	int num_workers;
+
+	// the comparison in progress
+	const unsigned char* reference;
+	const unsigned char* actual;
+	unsigned char* heatmap;
+	unsigned int width, height;
+	int tiles_x, num_tiles;
+	TileResult* tiles;
+	int tiles_capacity;
+	atomic_int next_tile;
+};
+
+static int luma(const unsigned char* rgba)
+{
+	// BT.601 weights in 8 bit fixed point
+	return (77 * rgba[0] + 150 * rgba[1] + 29 * rgba[2] + 128) >> 8;
+}
+
+static void heat_pixel(unsigned char* out, const unsigned char* reference, int diff, int threshold)
+{
+	if(diff == 0) {
+		// dim the reference, so differences stand out but can still be placed
+		unsigned char gray = luma(reference) / 3;
+		out[0] = out[1] = out[2] = gray;
+	}
+	else if(diff <= threshold) {
+		out[0] = 0; out[1] = 0; out[2] = 160;
+	}
+	else {
+		out[0] = 255; out[1] = diff * 2 > 255 ? 255 : diff * 2; out[2] = 0;
+	}
+	out[3] = 255;
+}
+
+// kernels
+
+// differences of 'n' pixels of a row
+static void diff_row(const unsigned char* a, const unsigned char* b, int n, int threshold, unsigned char* heatmap, TileResult* r)
+{
+	int i = 0;
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i low_byte = _mm_set1_epi32(0xFF);
+	const __m128i limit = _mm_set1_epi32(threshold);
+	__m128i max = zero, sse = zero; // a row is too short for the 32 bit sums to overflow
+	for(; i + 4 <= n; i += 4) {
+		__m128i va = _mm_loadu_si128((const __m128i*) (a + i * 4));
+		__m128i vb = _mm_loadu_si128((const __m128i*) (b + i * 4));
+		__m128i d = _mm_and_si128(_mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va)), rgb);
+		max = _mm_max_epu8(max, d);
+		__m128i lo = _mm_unpacklo_epi8(d, zero);
+		__m128i hi = _mm_unpackhi_epi8(d, zero);
+		sse = _mm_add_epi32(sse, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+
+		// largest channel difference of each pixel, in the low byte of its lane
+		__m128i m = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+		m = _mm_and_si128(_mm_max_epu8(m, _mm_srli_epi32(d, 16)), low_byte);
+		int above = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(m, limit)));
+		r->differing_pixels += __builtin_popcount(above);
+		if(heatmap) {
+			uint32_t pixel_max[4];
+			_mm_storeu_si128((__m128i*) pixel_max, m);
+			int k;
+			for(k = 0; k < 4; k++) heat_pixel(heatmap + (i + k) * 4, a + (i + k) * 4, pixel_max[k], threshold);
+		}
+	}
+	uint32_t sums[4];
+	_mm_storeu_si128((__m128i*) sums, sse);
+	r->sse += (uint64_t) sums[0] + sums[1] + sums[2] + sums[3];
+	unsigned char maxima[16];
+	_mm_storeu_si128((__m128i*) maxima, max);
+	int k;
+	for(k = 0; k < 16; k++) {
+		if(maxima[k] > r->max_diff) r->max_diff = maxima[k];
+	}
+#endif
+	// the pixels left over, or all of them without SSE2
+	for(; i < n; i++) {
+		int c, pixel_max = 0;
+		for(c = 0; c < 3; c++) {
+			int d = abs(a[i * 4 + c] - b[i * 4 + c]);
+			r->sse += d * d;
+			if(d > pixel_max) pixel_max = d;
+		}
+		if(pixel_max > r->max_diff) r->max_diff = pixel_max;
+		if(pixel_max > threshold) r->differing_pixels++;
+		if(heatmap) heat_pixel(heatmap + i * 4, a + i * 4, pixel_max, threshold);
+	}
+}
+
+// SSIM of one window of luma
+static double ssim_window(const unsigned char* x, const unsigned char* y, int stride)
+{
+	int sx, sy, sxx, syy, sxy;
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	__m128i vsx = zero, vsy = zero, vsxx = zero, vsyy = zero, vsxy = zero;
+	int row;
+	for(row = 0; row < IMAGE_DIFF_SSIM_WINDOW; row++) {
+		__m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (x + row * stride)), zero);
+		__m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (y + row * stride)), zero);
+		vsx = _mm_add_epi16(vsx, a);
+		vsy = _mm_add_epi16(vsy, b);
+		vsxx = _mm_add_epi32(vsxx, _mm_madd_epi16(a, a));
+		vsyy = _mm_add_epi32(vsyy, _mm_madd_epi16(b, b));
+		vsxy = _mm_add_epi32(vsxy, _mm_madd_epi16(a, b));
+	}
+	// widen the 16 bit sums, then add up the lanes
+	const __m128i ones = _mm_set1_epi16(1);
+	vsx = _mm_madd_epi16(vsx, ones);
+	vsy = _mm_madd_epi16(vsy, ones);
+	int32_t lanes[5][4];
+	_mm_storeu_si128((__m128i*) lanes[0], vsx);
+	_mm_storeu_si128((__m128i*) lanes[1], vsy);
+	_mm_storeu_si128((__m128i*) lanes[2], vsxx);
+	_mm_storeu_si128((__m128i*) lanes[3], vsyy);
+	_mm_storeu_si128((__m128i*) lanes[4], vsxy);
+	sx = lanes[0][0] + lanes[0][1] + lanes[0][2] + lanes[0][3];
+	sy = lanes[1][0] + lanes[1][1] + lanes[1][2] + lanes[1][3];
+	sxx = lanes[2][0] + lanes[2][1] + lanes[2][2] + lanes[2][3];
+	syy = lanes[3][0] + lanes[3][1] + lanes[3][2] + lanes[3][3];
+	sxy = lanes[4][0] + lanes[4][1] + lanes[4][2] + lanes[4][3];
+#else
+	sx = sy = sxx = syy = sxy = 0;
+	int row, col;
+	for(row = 0; row < IMAGE_DIFF_SSIM_WINDOW; row++) {
+		for(col = 0; col < IMAGE_DIFF_SSIM_WINDOW; col++) {
+			int a = x[row * stride + col], b = y[row * stride + col];
+			sx += a; sy += b;
+			sxx += a * a; syy += b * b; sxy += a * b;
+		}
+	}
+#endif
+	const double n = IMAGE_DIFF_SSIM_WINDOW * IMAGE_DIFF_SSIM_WINDOW;
+	double mean_x = sx / n, mean_y = sy / n;
+	double var_x = sxx / n - mean_x * mean_x;
+	double var_y = syy / n - mean_y * mean_y;
+	double cov = sxy / n - mean_x * mean_y;
+	return ((2 * mean_x * mean_y + SSIM_C1) * (2 * cov + SSIM_C2))
+		/ ((mean_x * mean_x + mean_y * mean_y + SSIM_C1) * (var_x + var_y + SSIM_C2));
+}
+
+// tiles
+
+static void compare_tile(Worker* w, int tile)
+{
+	ImageDiffer* differ = w->differ;
+	TileResult* r = &differ->tiles[tile];
+	memset(r, 0, sizeof(TileResult));
+
+	unsigned int width = differ->width, height = differ->height;
+	unsigned int x0 = (tile % differ->tiles_x) * IMAGE_DIFF_TILE_SIZE;
+	unsigned int y0 = (tile / differ->tiles_x) * IMAGE_DIFF_TILE_SIZE;
+	unsigned int x1 = x0 + IMAGE_DIFF_TILE_SIZE < width ? x0 + IMAGE_DIFF_TILE_SIZE : width;
+	unsigned int y1 = y0 + IMAGE_DIFF_TILE_SIZE < height ? y0 + IMAGE_DIFF_TILE_SIZE : height;
+
+	unsigned int x, y;
+	for(y = y0; y < y1; y++) {
+		size_t offset = ((size_t) y * width + x0) * 4;
+		diff_row(differ->reference + offset, differ->actual + offset, x1 - x0, differ->threshold,
+			differ->heatmap ? differ->heatmap + offset : NULL, r);
+	}
+
+	// luma of the tile and of the borders its windows reach into
+	unsigned int lx1 = x0 + LUMA_STRIDE < width ? x0 + LUMA_STRIDE : width;
+	unsigned int ly1 = y0 + LUMA_STRIDE < height ? y0 + LUMA_STRIDE : height;
+	for(y = y0; y < ly1; y++) {
+		const unsigned char* a = differ->reference + ((size_t) y * width + x0) * 4;
+		const unsigned char* b = differ->actual + ((size_t) y * width + x0) * 4;
+		unsigned char* la = w->luma_reference + (y - y0) * LUMA_STRIDE;
+		unsigned char* lb = w->luma_actual + (y - y0) * LUMA_STRIDE;
+		for(x = 0; x < lx1 - x0; x++) {
+			la[x] = luma(a + x * 4);
+			lb[x] = luma(b + x * 4);
+		}
+	}
+
+	// windows starting in this tile and fitting in the image
+	for(y = y0; y < y1 && y + IMAGE_DIFF_SSIM_WINDOW <= height; y += IMAGE_DIFF_SSIM_STEP) {
+		for(x = x0; x < x1 && x + IMAGE_DIFF_SSIM_WINDOW <= width; x += IMAGE_DIFF_SSIM_STEP) {
+			size_t offset = (y - y0) * LUMA_STRIDE + (x - x0);
+			r->ssim_sum += ssim_window(w->luma_reference + offset, w->luma_actual + offset, LUMA_STRIDE);
+			r->windows++;
+		}
+	}
+}
+
+static void compare_tiles(Worker* w)
+{
+	ImageDiffer* differ = w->differ;
+	for(;;) {
+		int tile = atomic_fetch_add(&differ->next_tile, 1);
+		if(tile >= differ->num_tiles) return;
+		compare_tile(w, tile);
+	}
+}
+
+static void compare_tiles_job(void* arg, int worker)
+{
+	ImageDiffer* differ = arg;
+	compare_tiles(&differ->workers[worker]);
+}
+
+ImageDiffer* image_differ_create(int num_threads, int threshold)
+{
+	ImageDiffer* differ = calloc(1, sizeof(ImageDiffer));
+	if(!differ) return NULL;
+	differ->threshold = threshold;
+
+	differ->pool = worker_pool_create(num_threads, compare_tiles_job, differ);
+	if(differ->pool) {
+		differ->num_workers = worker_pool_size(differ->pool);
+		differ->workers = calloc(differ->num_workers, sizeof(Worker));
+	}
+	if(!differ->workers) {
+		image_differ_destroy(differ);
+		return NULL;
+	}
+
+	int i;
+	for(i = 0; i < differ->num_workers; i++) differ->workers[i].differ = differ;
+	return differ;
+}
+
+void image_differ_destroy(ImageDiffer* differ)
+{
+	if(!differ) return;
+
+	worker_pool_destroy(differ->pool);
+	free(differ->workers);
+	free(differ->tiles);
+	free(differ);
+}
+
+int image_diff(ImageDiffer* differ, const unsigned char* reference, const unsigned char* actual,
+	unsigned int width, unsigned int height, unsigned char* heatmap, ImageDiffResult* result)
+{
+	memset(result, 0, sizeof(ImageDiffResult));
+	if(width == 0 || height == 0) return false;
+
+	int tiles_x = (width + IMAGE_DIFF_TILE_SIZE - 1) / IMAGE_DIFF_TILE_SIZE;
+	int tiles_y = (height + IMAGE_DIFF_TILE_SIZE - 1) / IMAGE_DIFF_TILE_SIZE;
+	int num_tiles = tiles_x * tiles_y;
+	if(num_tiles > differ->tiles_capacity) {
+		TileResult* tiles = realloc(differ->tiles, num_tiles * sizeof(TileResult));
+		if(!tiles) return false;
+		differ->tiles = tiles;
+		differ->tiles_capacity = num_tiles;
+	}
+
+	differ->reference = reference;
+	differ->actual = actual;
+	differ->heatmap = heatmap;
+	differ->width = width;
+	differ->height = height;
+	differ->tiles_x = tiles_x;
+	differ->num_tiles = num_tiles;
+	atomic_store(&differ->next_tile, 0);
+	worker_pool_run(differ->pool);
+
+	// added up in tile order, so the result does not depend on the number of threads
+	uint64_t sse = 0;
+	double ssim_sum = 0;
+	unsigned long windows = 0;
+	int i;
+	for(i = 0; i < num_tiles; i++) {
+		const TileResult* r = &differ->tiles[i];
+		sse += r->sse;
+		ssim_sum += r->ssim_sum;
+		windows += r->windows;
+		result->differing_pixels += r->differing_pixels;
+		if(r->max_diff > result->max_diff) result->max_diff = r->max_diff;
+	}
+	result->mse = (double) sse / ((double) width * height * 3);
+	result->psnr = sse == 0 ? INFINITY : 10.0 * log10(255.0 * 255.0 / result->mse);
+	if(windows > 0) result->ssim = ssim_sum / windows;
+	else result->ssim = sse == 0 ? 1.0 : 0.0;
+	return true;
+}
+
+static bool load_png(unsigned char** pixels, unsigned int* width, unsigned int* height, const char* file)
+{
+	unsigned int error = lodepng_decode32_file(pixels, width, height, file);
+	if(error) fprintf(stderr, "Error loading image file '%s' %u: %s\n", file, error, lodepng_error_text(error));
+	return !error;
+}
+
+int image_diff_files(ImageDiffer* differ, const char* reference_file, const char* actual_file,
+	const char* heatmap_file, ImageDiffResult* result)
+{
+	memset(result, 0, sizeof(ImageDiffResult));
+	unsigned char* reference = NULL;
+	unsigned char* actual = NULL;
+	unsigned char* heatmap = NULL;
+	unsigned int width = 0, height = 0, actual_width = 0, actual_height = 0;
+
+	bool ok = load_png(&reference, &width, &height, reference_file)
+		&& load_png(&actual, &actual_width, &actual_height, actual_file);
+	if(ok && (actual_width != width || actual_height != height)) {
+		fprintf(stderr, "'%s' is %ux%u, but the reference '%s' is %ux%u\n",
+			actual_file, actual_width, actual_height, reference_file, width, height);
+		ok = false;
+	}
+	if(ok && heatmap_file) {
+		heatmap = malloc((size_t) width * height * 4);
+		ok = heatmap != NULL;
+	}
+	ok = ok && image_diff(differ, reference, actual, width, height, heatmap, result);
+	if(ok && heatmap_file) {
+		unsigned int error = lodepng_encode32_file(heatmap_file, heatmap, width, height);
+		if(error) {
+			fprintf(stderr, "Error saving image file '%s' %u: %s\n", heatmap_file, error, lodepng_error_text(error));
+			ok = false;
+		}
+	}
+
+	free(reference);
+	free(actual);
+	free(heatmap);
+	return ok;
+}
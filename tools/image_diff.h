@@ -0,0 +1,83 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016-2017 Inês Almeida
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * OpenGL Playground - Image comparison against reference images
+ *
+ * Compares a rendered frame (eg. saved with --headless --output) with a reference image:
+ *   - the mean squared error and PSNR over the RGB channels, alpha is ignored
+ *   - the largest difference of any channel, and how many pixels differ by more than a threshold
+ *   - SSIM (structural similarity), the mean over 8x8 windows of luma placed every 4 pixels
+ *   - optionally, a heatmap of the differences: the reference in dim gray where the images match,
+ *     blue where they differ by no more than the threshold, and red to yellow above it
+ *
+ * The image is split into 64x64 tiles, which worker threads take from a shared counter.
+ * Inside a tile the kernels use SSE2 when it is available: absolute differences, squared
+ * errors, maxima and the sums over each SSIM window are computed 16 channels at a time.
+ * A differ keeps its threads between comparisons, create one and feed it every frame of a run:
+ *
+ *   ImageDiffer* differ = image_differ_create(0, 0);
+ *   ImageDiffResult result;
+ *   if(image_diff_files(differ, "reference/icons.png", "icons.png", "icons_diff.png", &result)) {
+ *       printf("PSNR %.2f dB, SSIM %.4f\n", result.psnr, result.ssim);
+ *   }
+ *   image_differ_destroy(differ);
+ *
+ * Files are decoded and written with the bundled LodePNG (../textures/lodepng.h).
+ * Requires POSIX threads.
+ */
+
+#ifndef OPENGL_PLAYGROUND_IMAGE_DIFF_H
+#define OPENGL_PLAYGROUND_IMAGE_DIFF_H
+
+#define IMAGE_DIFF_TILE_SIZE 64
+#define IMAGE_DIFF_SSIM_WINDOW 8
+#define IMAGE_DIFF_SSIM_STEP 4
+
+typedef struct {
+	double mse;                      // mean squared error of the RGB channels
+	double psnr;                     // in dB, INFINITY when the images are identical
+	double ssim;                     // 1 when identical. images smaller than a window only get 1 or 0
+	int max_diff;                    // largest difference of any RGB channel, 0 to 255
+	unsigned long differing_pixels;  // pixels with a channel differing by more than the threshold
+} ImageDiffResult;
+
+typedef struct ImageDiffer ImageDiffer;
+
+// 'num_threads' compare tiles at the same time, counting the calling thread, 0 for one per CPU.
+// a channel must differ by more than 'threshold' for its pixel to count as differing. returns NULL on failure
+ImageDiffer* image_differ_create(int num_threads, int threshold);
+void image_differ_destroy(ImageDiffer* differ);
+
+// compares two RGBA images of the same size, rows top to bottom, without padding.
+// 'heatmap' is NULL or an RGBA image of the same size to write the heatmap to. returns 0 on failure
+int image_diff(ImageDiffer* differ, const unsigned char* reference, const unsigned char* actual,
+	unsigned int width, unsigned int height, unsigned char* heatmap, ImageDiffResult* result);
+
+// decodes both PNG files and compares them. images of different sizes fail with a message.
+// writes the heatmap to 'heatmap_file' unless it is NULL
+int image_diff_files(ImageDiffer* differ, const char* reference_file, const char* actual_file,
+	const char* heatmap_file, ImageDiffResult* result);
+
+#endif // OPENGL_PLAYGROUND_IMAGE_DIFF_H